@@ -93,17 +93,19 @@ def setColorsOnJoints():
 
 def doRemoveColorSets():
     with UndoContext("doRemoveColorSets"):
-        msh = cmds.brSkinBrushContext(GET_CONTEXT.getLatest(), query=True, meshName=True)
-        if not msh or not cmds.objExists(msh):
-            return
-        skinnedMesh_history = cmds.listHistory(msh, levels=0, pruneDagObjects=True) or []
-        cmds.setAttr(msh + ".displayColors", 0)
+        # all the meshes painted in the session
+        meshes = cmds.brSkinBrushContext(GET_CONTEXT.getLatest(), query=True, paintMeshes=True)
+        for msh in meshes or []:
+            if not cmds.objExists(msh):
+                continue
+            skinnedMesh_history = cmds.listHistory(msh, levels=0, pruneDagObjects=True) or []
+            cmds.setAttr(msh + ".displayColors", 0)
 
-        while skinnedMesh_history:
-            nd = skinnedMesh_history.pop(0)
-            if cmds.nodeType(nd) != "createColorSet":
-                break
-            cmds.delete(nd)
+            while skinnedMesh_history:
+                nd = skinnedMesh_history.pop(0)
+                if cmds.nodeType(nd) != "createColorSet":
+                    break
+                cmds.delete(nd)
 
 
 def getShapesSelected(returnTransform=False):
@@ -123,33 +125,11 @@ def getShapesSelected(returnTransform=False):
     return selectionShapes
 
 
-def setToDgMode():
-    with UndoContext("setToDgMode"):
-        goodMode = "off"  # "serial" anmd "serialUncached" and "parallel" crashes
-        if cmds.evaluationManager(query=True, mode=True) != [goodMode]:
-            val = cmds.optionVar(query="evaluationMode")
-            cmds.evaluationManager(mode=goodMode)
-            cmds.optionVar(intValue=("revertParallelEvaluationMode", val))
-            # Set everything in the entire scene dirty
-            cmds.dgdirty(allPlugs=True)
-        else:
-            cmds.optionVar(intValue=("revertParallelEvaluationMode", 0))
-
-
-def retrieveParallelMode():
-    with UndoContext("retrieveParallelMode"):
-        val = cmds.optionVar(query="revertParallelEvaluationMode")
-        if val != 0:
-            cmds.optionVar(intValue=("revertParallelEvaluationMode", 0))
-            mode = "parallel" if val == 3 else "serial"
-            cmds.evaluationManager(mode=mode)
-
-
 def toolOnSetupStart():  # Called directly from cpp
     with UndoContext("toolOnSetupStart"):
         cmds.optionVar(intValue=("startTime", time.time()))
 
-        setToDgMode()
+        # the evaluation mode is left alone, the weights edits only dirty the skinCluster
         # disable AutoSave --------------------------
         if cmds.autoSave(query=True, enable=True):
             if not cmds.optionVar(exists="autoSaveEnable"):
@@ -403,6 +383,7 @@ def deleteExistingColorSets():
                 "multiColorsSet2",
                 "soloColorsSet",
                 "soloColorsSet2",
+                "problemVerticesSet",
             ]:
                 if colSet in existingColorSets:
                     cmds.polyColorSet(obj, delete=True, colorSet=colSet)
@@ -33,7 +33,6 @@ from .brushTools.brushPythonFunctions import (
     showBackNurbs,
     restoreShading,
     doRemoveColorSets,
-    retrieveParallelMode,
     disconnectNurbs,
     doUpdateWireFrameColorSoloMode,
 )
@@ -315,6 +314,10 @@ class SkinPaintWin(Window):
         selectItems.triggered.connect(partial(self.applyLock, "selJoints"))
         self.popMenu.addAction(selectItems)
 
+        selectVertices = self.popMenu.addAction("Select Vertices")
+        selectVertices.triggered.connect(self.selectInfluencesVertices)
+        self.popMenu.addAction(selectVertices)
+
         self.popMenu.addSeparator()
 
         colorItems = self.popMenu.addAction("Color Selected")
@@ -461,6 +464,7 @@ class SkinPaintWin(Window):
         self.close_callback.append(addUserEventCallback("brSkinBrush_toolOnSetupStart", self.toolOnSetupStart))
         self.close_callback.append(addUserEventCallback("brSkinBrush_toolOnSetupEnd", self.toolOnSetupEnd))
         self.close_callback.append(addUserEventCallback("brSkinBrush_afterPaint", afterPaint))
+        self.close_callback.append(addUserEventCallback("brSkinBrush_paintMeshChanged", self.paintMeshChangedCB))
         self.close_callback.append(addUserEventCallback("brSkinBrush_toolOffCleanup", self.toolOffCleanup))
         # fmt: on
 
@@ -493,7 +497,6 @@ class SkinPaintWin(Window):
 
             # delete colors on Q pressed
             doRemoveColorSets()
-            retrieveParallelMode()
 
             # retrieve autoSave
             if (
@@ -686,6 +689,8 @@ class SkinPaintWin(Window):
             # getMirrorInfluenceArray
             # let's select the shape first
             cmds.select(self.dataOfSkin.deformedShape, replace=True)
+            # a map painted from the weight editor is left on the context
+            cmds.brSkinBrushContext(GET_CONTEXT.getLatest(), edit=True, mapAttribute="")
             cmds.setToolTo(GET_CONTEXT.getLatest())
             self.getMirrorInfluenceArray()
 
@@ -738,6 +743,17 @@ class SkinPaintWin(Window):
         )
         self.updateCurrentInfluence(jointName)
 
+    def paintMeshChangedCB(self):
+        # the brush went over another mesh of the selection, list its influences
+        mshShape = cmds.brSkinBrushContext(GET_CONTEXT.getLatest(), query=True, meshName=True)
+        if not mshShape or not cmds.objExists(mshShape):
+            return
+        with UndoContext("paintMeshChanged"):
+            cmds.select(mshShape)
+            self.refresh(force=True)
+            cmds.select(clear=True)
+        self.updateCurrentInfluenceCB()
+
     def updateCurrentInfluence(self, jointName):
         items = {}
         ito = None
@@ -1336,6 +1352,23 @@ class SkinPaintWin(Window):
         if isInPaint():
             cmds.brSkinBrushContext(cmds.currentCtx(), edit=True, influenceName=text)
 
+    def selectInfluencesVertices(self):
+        selectedItems = self.uiInfluenceTREE.selectedItems()
+        indices = [item._index for item in selectedItems]
+        if not indices:
+            return
+        if not isInPaint():
+            self.dataOfSkin.selectVertsOfColumns(indices)
+            return
+        # the brush keeps an influence -> vertices index, no need to scan the weights
+        selectedVertices = set()
+        for ind in indices:
+            verts = cmds.brSkinBrushContext(
+                cmds.currentCtx(), query=True, influenceVertices=ind
+            )
+            selectedVertices.update(verts or [])
+        self.dataOfSkin.selectVertexIndices(selectedVertices)
+
     def applyLock(self, typeOfLock):
         autoHide = not self.showLocks_btn.isChecked()
         selectedItems = self.uiInfluenceTREE.selectedItems()
@@ -462,10 +462,12 @@ class SkinWeightWin(Window):
         if not isinstance(self.dataOfDeformer, DataOfOneDimensionalAttrs):
             raise ValueError("Cannot import xml couples for this deformer type")
 
-        for inCol, comboB in enumerate(self.associationXml_tbl.lstComboxes):
-            currentText = comboB.currentText()
-            if currentText in self.dicNmFilePath:
-                self.dataOfDeformer.doImport(self.dicNmFilePath[currentText], inCol)
+        # one undo for all the columns
+        with GlobalContext(message="doImportXmlCouples"):
+            for inCol, comboB in enumerate(self.associationXml_tbl.lstComboxes):
+                currentText = comboB.currentText()
+                if currentText in self.dicNmFilePath:
+                    self.dataOfDeformer.doImport(self.dicNmFilePath[currentText], inCol)
         self.refresh(force=True)
 
     def exportButtonsVis(self, val):
@@ -766,8 +768,10 @@ class SkinWeightWin(Window):
     def refreshSkinDisplay(self):  # call by skinBrush
         if isinstance(self.dataOfDeformer, DataOfSkin):
             with ResettingModel(self._tm):
-                self.dataOfDeformer.rebuildRawSkin()
-                self.dataOfDeformer.convertRawSkinToNumpyArray()
+                # only the painted vertices when the journal goes back far enough
+                if not self.dataOfDeformer.refreshChangedVertices():
+                    self.dataOfDeformer.rebuildRawSkin()
+                    self.dataOfDeformer.convertRawSkinToNumpyArray()
         self._tv.repaint()
 
     def selectionCallBackRefresh(self):
@@ -990,6 +994,9 @@ class SkinWeightWin(Window):
         else:
             undoArgs = (self.dataOfDeformer.undoValues,)
             redoArgs = (self.dataOfDeformer.redoValues,)
+            if undoArgs == (None,) and redoArgs == (None,):
+                # set by blurSkinMap, already in the undo queue
+                return
             newClass = DataQuickSet(undoArgs, redoArgs, mainWindow=self)
             cmds.pythonCommand(hex(id(newClass)))
 
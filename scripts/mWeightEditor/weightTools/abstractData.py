@@ -13,6 +13,7 @@ from .utils import (
     getSoftSelectionValues,
     getThreeIndices,
     getListDeformersFromSel,
+    getNurbsCVsCount,
     orderMelList,
 )
 import six
@@ -372,8 +373,7 @@ class DataAbstract(object):
         if self.shapePath.apiType() == OpenMaya.MFn.kNurbsSurface:
             self.isNurbsSurface = True
             MfnSurface = OpenMaya.MFnNurbsSurface(self.shapePath)
-            self.numCVsInV_ = MfnSurface.numCVsInV()
-            self.numCVsInU_ = MfnSurface.numCVsInU()
+            self.numCVsInU_, self.numCVsInV_ = getNurbsCVsCount(MfnSurface)
             self.nbVertices = self.numCVsInV_ * self.numCVsInU_
 
         elif self.shapePath.apiType() == OpenMaya.MFn.kLattice:
@@ -299,3 +299,87 @@ def setNumpyAttr(attrName, value):
             )
 
     raise NotImplementedError("WTF? How did you get here??")
+
+
+_HAS_SKIN_WEIGHTS_BUFFER = None
+
+
+def hasSkinWeightsBuffer():
+    """Check if the blurSkin plugin commands for buffer access are available
+    The plugin is loaded on the first call only, the result is cached
+    """
+    global _HAS_SKIN_WEIGHTS_BUFFER
+    if _HAS_SKIN_WEIGHTS_BUFFER is not None:
+        return _HAS_SKIN_WEIGHTS_BUFFER
+    from maya import cmds
+
+    if not cmds.pluginInfo("blurSkin", query=True, loaded=True):
+        try:
+            cmds.loadPlugin("blurSkin", quiet=True)
+        except RuntimeError:
+            _HAS_SKIN_WEIGHTS_BUFFER = False
+            return False
+    _HAS_SKIN_WEIGHTS_BUFFER = hasattr(cmds, "blurSkinGetWeights")
+    return _HAS_SKIN_WEIGHTS_BUFFER
+
+
+def getSkinWeightsBuffer(skinClusterName, indices=None, nbInfluences=None):
+    """Read the skin weights straight into a numpy array with blurSkinGetWeights
+
+    Parameters
+    ----------
+    skinClusterName : str
+        The skinCluster to read from
+    indices : list or np.array, optional
+        Flat point indices (nurbs: u * numCVsInV + v, lattice: u * S * T + t * S + s).
+        All the points if None
+    nbInfluences : int, optional
+        Number of influences of the skinCluster, queried if None
+
+    Returns
+    -------
+    : np.array :
+        A (nbIndices, nbInfluences) array of doubles
+    """
+    from maya import cmds
+
+    if nbInfluences is None:
+        nbInfluences = len(cmds.skinCluster(skinClusterName, query=True, influence=True))
+    kwargs = {"skinCluster": skinClusterName}
+    if indices is not None:
+        indicesArray = np.ascontiguousarray(indices, dtype=np.int32)
+        kwargs["indicesAddress"] = hex(indicesArray.ctypes.data)
+        kwargs["indicesCount"] = indicesArray.size
+        nbIndices = indicesArray.size
+    else:
+        nbIndices = cmds.blurSkinGetWeights(skinCluster=skinClusterName, pointCount=True)
+    values = np.zeros((nbIndices, nbInfluences), dtype=np.float64)
+    cmds.blurSkinGetWeights(
+        address=hex(values.ctypes.data), bufferSize=values.size, **kwargs
+    )
+    return values
+
+
+def setSkinWeightsBuffer(skinClusterName, values, indices=None, normalize=False):
+    """Set the skin weights from a numpy array with blurSkinSetWeights (undoable)
+
+    Parameters
+    ----------
+    skinClusterName : str
+        The skinCluster to write to
+    values : np.array
+        A (nbIndices, nbInfluences) array
+    indices : list or np.array, optional
+        Flat point indices, all the points if None
+    normalize : bool
+        Let the skinCluster normalize the weights
+    """
+    from maya import cmds
+
+    values = np.ascontiguousarray(values, dtype=np.float64)
+    kwargs = {"skinCluster": skinClusterName, "normalize": normalize}
+    if indices is not None:
+        indicesArray = np.ascontiguousarray(indices, dtype=np.int32)
+        kwargs["indicesAddress"] = hex(indicesArray.ctypes.data)
+        kwargs["indicesCount"] = indicesArray.size
+    cmds.blurSkinSetWeights(address=hex(values.ctypes.data), bufferSize=values.size, **kwargs)
@@ -4,12 +4,12 @@ from maya import OpenMaya, OpenMayaAnim, cmds
 
 import numpy as np
 import re
-from .utils import GlobalContext, getThreeIndices, orderMelList
+from .utils import GlobalContext, getNurbsCVsCount, getThreeIndices, orderMelList
 
 from .abstractData import DataAbstract
 from six.moves import range, zip
 
-from .mayaToNumpy import mayaToNumpy, numpyToMaya
+from .mayaToNumpy import mayaToNumpy, numpyToMaya, hasSkinWeightsBuffer, getSkinWeightsBuffer
 
 
 ###################################################################################
@@ -39,6 +39,7 @@ class DataOfSkin(DataAbstract):
         self.normalizeWeights = []
 
         self.undoDic = {"isSkin": True, "inListVertices": [], "theSkinCluster": ""}
+        self.journalVersion = None
 
         self.clearData()
         super(DataOfSkin, self).__init__(
@@ -91,7 +92,18 @@ class DataOfSkin(DataAbstract):
                 listVerticesIndices=selectedVertices,
             )
 
-    def fixAroundVertices(self, tolerance=3):
+    def fixAroundVertices(self, tolerance=3, colorSet=None):
+        if self.isMesh and cmds.pluginInfo("blurSkin", query=True, loaded=True):
+            # one native parallel pass over the edges, the problems can be shown in a color set
+            kwargs = {"colorSet": colorSet} if colorSet else {}
+            problemVerts = cmds.blurSkinAnalyze(
+                skinCluster=self.theSkinCluster,
+                meshName=self.deformedShape,
+                stretchTolerance=tolerance,
+                maxInfluences=0,
+                **kwargs
+            )
+            return sorted(problemVerts or [])
         with GlobalContext(message="fixAroundVertices", doPrint=True):
             geometriesOut = OpenMaya.MObjectArray()
             self.sknFn.getOutputGeometry(geometriesOut)
@@ -593,28 +605,46 @@ class DataOfSkin(DataAbstract):
         shapeName = self.shapePath.fullPathName()
         vertexCount = 0
 
-        fnComponent = OpenMaya.MFnSingleIndexedComponent()
         self.isNurbsSurface = False
         self.isLattice = False
         self.isNurbsCurve = False
-        componentAlreadyBuild = False
         if self.softOn:
             revertSortedIndices = np.array(indices)[self.opposite_sortedIndices]
         else:
             revertSortedIndices = indices
-        if self.shapePath.apiType() == OpenMaya.MFn.kNurbsCurve:
+        apiType = self.shapePath.apiType()
+        if apiType == OpenMaya.MFn.kNurbsCurve:
             self.isNurbsCurve = True
+        elif apiType == OpenMaya.MFn.kNurbsSurface:
+            self.isNurbsSurface = True
+            # same count as the plugins, the periodic overlapping cvs are not skinned
+            MfnSurface = OpenMaya.MFnNurbsSurface(self.shapePath)
+            numCVsInU_, self.numCVsInV_ = getNurbsCVsCount(MfnSurface)
+        elif apiType == OpenMaya.MFn.kLattice:
+            self.isLattice = True
+        elif apiType != OpenMaya.MFn.kMesh:
+            return None
+
+        #####################################################
+        if getskinWeights and hasSkinWeightsBuffer():
+            # the plugin decodes the indices and fills the numpy buffer directly,
+            # no need to build the component
+            with GlobalContext(message="blurSkinGetWeights", doPrint=self.verbose):
+                return getSkinWeightsBuffer(
+                    inputSkinCluster,
+                    indices=revertSortedIndices if indices else None,
+                    nbInfluences=len(self.indicesJoints),
+                ).reshape(-1)
+
+        fnComponent = OpenMaya.MFnSingleIndexedComponent()
+        componentAlreadyBuild = False
+        if self.isNurbsCurve:
             componentType = OpenMaya.MFn.kCurveCVComponent
             crvFn = OpenMaya.MFnNurbsCurve(self.shapePath)
             vertexCount = crvFn.numCVs()
-        elif self.shapePath.apiType() == OpenMaya.MFn.kNurbsSurface:
-            self.isNurbsSurface = True
+        elif self.isNurbsSurface:
             componentAlreadyBuild = True
             componentType = OpenMaya.MFn.kSurfaceCVComponent
-            MfnSurface = OpenMaya.MFnNurbsSurface(self.shapePath)
-
-            self.numCVsInV_ = MfnSurface.numCVsInV()
-            numCVsInU_ = MfnSurface.numCVsInU()
             fnComponent = OpenMaya.MFnDoubleIndexedComponent()
             self.fullComponent = fnComponent.create(componentType)
             if not indices:
@@ -625,8 +655,7 @@ class DataOfSkin(DataAbstract):
                     indexU = indVtx // self.numCVsInV_
                     fnComponent.addElement(int(indexU), int(indexV))
 
-        elif self.shapePath.apiType() == OpenMaya.MFn.kLattice:  # lattice
-            self.isLattice = True
+        elif self.isLattice:
             componentAlreadyBuild = True
             componentType = OpenMaya.MFn.kLatticeComponent
             fnComponent = OpenMaya.MFnTripleIndexedComponent()
@@ -641,12 +670,10 @@ class DataOfSkin(DataAbstract):
                     s, t, v = getThreeIndices(div_s, div_t, div_u, indVtx)
                     fnComponent.addElement(int(s), int(t), int(v))
 
-        elif self.shapePath.apiType() == OpenMaya.MFn.kMesh:
+        else:
             componentType = OpenMaya.MFn.kMeshVertComponent
             mshFn = OpenMaya.MFnMesh(self.shapePath)
             vertexCount = mshFn.numVertices()
-        else:
-            return None
 
         if not componentAlreadyBuild:
             self.fullComponent = fnComponent.create(componentType)
@@ -656,7 +683,6 @@ class DataOfSkin(DataAbstract):
                 for ind in revertSortedIndices:
                     fnComponent.addElement(int(ind))
 
-        #####################################################
         if self.isNurbsSurface or self.isNurbsCurve:  # bug Maya
             return self.getValuesSkinClusterCmds(inputSkinCluster, indices)
 
@@ -736,7 +762,10 @@ class DataOfSkin(DataAbstract):
 
     def convertRawSkinToNumpyArray(self):
         with GlobalContext(message="convertingSkinValues", doPrint=self.verbose):
-            self.raw2dArray = mayaToNumpy(self.rawSkinValues).reshape((-1, self.nbDrivers))
+            if isinstance(self.rawSkinValues, np.ndarray):
+                self.raw2dArray = self.rawSkinValues.reshape((-1, self.nbDrivers))
+            else:
+                self.raw2dArray = mayaToNumpy(self.rawSkinValues).reshape((-1, self.nbDrivers))
 
         # reorder
         if self.softOn:  # order with indices
@@ -749,6 +778,44 @@ class DataOfSkin(DataAbstract):
         self.usedDeformersIndices = np.where(myAny)[0]
         self.hideColumnIndices = np.where(~myAny)[0]
         self.computeSumArray()
+        # the data is in sync with the skinCluster at this version of the journal
+        self.journalVersion = None
+        if hasSkinWeightsBuffer():
+            self.journalVersion = cmds.blurSkinJournal(skinCluster=self.theSkinCluster, version=True)
+
+    def refreshChangedVertices(self):
+        """Update only the rows of the vertices changed since the data was read
+
+        Returns:
+            bool: False if a full rebuild is needed
+        """
+        if self.journalVersion is None or not isinstance(self.raw2dArray, np.ndarray):
+            return False
+        changed = cmds.blurSkinJournal(
+            skinCluster=self.theSkinCluster, changedSince=self.journalVersion
+        )
+        self.journalVersion = cmds.blurSkinJournal(skinCluster=self.theSkinCluster, version=True)
+        if changed == [-1]:
+            return False
+        if not changed:
+            return True
+        # the raw rows are in the order the vertices were read
+        rawVertices = np.array(self.vertices)
+        if self.softOn:
+            rawVertices = rawVertices[self.opposite_sortedIndices]
+        rows = np.nonzero(np.isin(rawVertices, changed))[0]
+        if rows.size:
+            self.raw2dArray[rows] = getSkinWeightsBuffer(
+                self.theSkinCluster, indices=rawVertices[rows], nbInfluences=self.nbDrivers
+            )
+        if self.softOn:
+            self.display2dArray = self.raw2dArray[self.sortedIndices]
+
+        myAny = np.any(self.raw2dArray, axis=0)
+        self.usedDeformersIndices = np.where(myAny)[0]
+        self.hideColumnIndices = np.where(~myAny)[0]
+        self.computeSumArray()
+        return True
 
     def rebuildRawSkin(self):
         if self.fullShapeIsUsed:
@@ -1025,6 +1092,9 @@ class DataOfSkin(DataAbstract):
 
     def selectVerts(self, selectedIndices):
         selectedVertices = set([self.vertices[ind] for ind in selectedIndices])
+        self.selectVertexIndices(selectedVertices)
+
+    def selectVertexIndices(self, selectedVertices):
         if not selectedVertices:
             cmds.select(clear=True)
             return
@@ -1045,7 +1115,7 @@ class DataOfSkin(DataAbstract):
                 if cmds.nodeType(self.deformedShape) == "lattice"
                 else self.deformedShape
             )
-            for indVtx in self.vertices:
+            for indVtx in selectedVertices:
                 s, t, u = getThreeIndices(div_s, div_t, div_u, indVtx)
                 toSel += ["{0}.pt[{1}][{2}][{3}]".format(prt, s, t, u)]
         else:
@@ -496,6 +496,18 @@ class HorizHeaderView(QtWidgets.QHeaderView):
         datatable = self._getDatatable()
         selectedColumns = self.getSelectedColumns()
         colIndex = selectedColumns.pop()
+        if cmds.pluginInfo("brSkinBrush", query=True, loaded=True) and datatable.isMesh:
+            # the skin brush paints the exact map, blendShape targets included
+            from mPaintEditor import GET_CONTEXT
+
+            GET_CONTEXT.updateIndex()
+            brushContext = GET_CONTEXT.getLatest()
+            cmds.brSkinBrushContext(
+                brushContext, edit=True, mapAttribute=datatable.listAttrs[colIndex]
+            )
+            cmds.select(datatable.deformedShape, replace=True)
+            cmds.setToolTo(brushContext)
+            return
         theAtt = datatable.attributesToPaint[datatable.shortColumnsNames[colIndex]]
         mel.eval('artSetToolAndSelectAttr("artAttrCtx", "{}");'.format(theAtt))
 
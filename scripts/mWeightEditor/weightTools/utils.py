@@ -281,9 +281,7 @@ def _getSurfaceCVComponent(component, dagPath, componentFn, softOn, returnSimple
     vVal.createFromInt(0)
     ptrv = vVal.asIntPtr()
 
-    depNode_name = dagPath.fullPathName()
-
-    numCVsInV_ = cmds.getAttr(depNode_name + ".spansV") + cmds.getAttr(depNode_name + ".degreeV")
+    _, numCVsInV_ = getNurbsCVsCount(OpenMaya.MFnNurbsSurface(dagPath))
 
     doubleFn = OpenMaya.MFnDoubleIndexedComponent(component)
     elementWeights = []
@@ -434,6 +432,19 @@ def getThreeIndices(div_s, div_t, div_u, *args):
     raise ValueError("Invalid Arguments")
 
 
+def getNurbsCVsCount(surfaceFn):
+    """The number of cvs in u and v of a nurbs surface, without the overlapping cvs of the
+    periodic directions. Same count as the plugins, for the flat indices u * numCVsInV + v
+    """
+    numCVsInU = surfaceFn.numCVsInU()
+    numCVsInV = surfaceFn.numCVsInV()
+    if surfaceFn.formInU() == OpenMaya.MFnNurbsSurface.kPeriodic:
+        numCVsInU -= surfaceFn.degreeU()
+    if surfaceFn.formInV() == OpenMaya.MFnNurbsSurface.kPeriodic:
+        numCVsInV -= surfaceFn.degreeV()
+    return numCVsInU, numCVsInV
+
+
 def _fillComponentObject(componentObj, selPath):
     componentSelList = OpenMaya.MSelectionList()
     componentSelList.clear()
@@ -76,6 +76,14 @@ class DataOfOneDimensionalAttrs(DataAbstract):
 
     def doImport(self, filePth, colIndex):
         print(filePth)
+        if self.useMapCommand():
+            # the file is read and compared natively, only the changed values are set
+            cmds.blurSkinMap(
+                attribute=self.listAttrs[colIndex],
+                meshName=self.deformedShape,
+                importFile=str(filePth),
+            )
+            return
         fileArr = np.loadtxt(str(filePth))
         difference = fileArr - self.fullAttributesArr[:, colIndex]
 
@@ -242,10 +250,39 @@ class DataOfOneDimensionalAttrs(DataAbstract):
                 arrValue[indices] = values
                 cmds.setAttr(att, arrValue, type=attType)
 
+    def useMapCommand(self):
+        """blurSkinMap edits the maps of meshes natively, with its own undo"""
+        return self.isMesh and cmds.pluginInfo("blurSkin", query=True, loaded=True)
+
+    def mapCommandOnEditedColumns(self, message, allVertices=False, **kwargs):
+        arrIndicesVerts = np.array(self.vertices)
+        editedColumns = np.any(self.sumMasks, axis=0).tolist()
+        with GlobalContext(message=message, doPrint=self.verbose):
+            for colIndex, isColumnChanged in enumerate(editedColumns):
+                if not isColumnChanged:
+                    continue
+                indices = np.nonzero(self.sumMasks[:, colIndex])[0]
+                verts = arrIndicesVerts[indices + self.Mtop]
+                if allVertices:
+                    verts = np.array(self.indicesVertices)
+                cmds.blurSkinMap(
+                    attribute=self.listAttrs[colIndex],
+                    meshName=self.deformedShape,
+                    vertices=verts.tolist(),
+                    **kwargs
+                )
+        # the undo is the one of the commands
+        self.undoValues = None
+        self.redoValues = None
+
     def smoothVertices(self, iteration=10):
-        self.getAttributesValues(onlyfullArr=True)
         if iteration < 1:
             return
+        if self.useMapCommand():
+            self.mapCommandOnEditedColumns("smoothVertices", smooth=iteration)
+            self.getAttributesValues()
+            return
+        self.getAttributesValues(onlyfullArr=True)
 
         arrIndicesVerts = np.array(self.vertices)
 
@@ -314,6 +351,16 @@ class DataOfOneDimensionalAttrs(DataAbstract):
         if not self.isMesh:
             print("FAIL not vertices")
             return
+        if self.useMapCommand():
+            self.mapCommandOnEditedColumns(
+                "setUsingUVs",
+                allVertices=True,
+                uvRamp=axis,
+                normalize=normalize,
+                opposite=opposite,
+            )
+            self.getAttributesValues()
+            return
 
         fnComponent = OpenMaya.MFnSingleIndexedComponent()
         userComponents = fnComponent.create(OpenMaya.MFn.kMeshVertComponent)
@@ -0,0 +1,75 @@
+#ifndef _blurSkinAnalyze_h
+
+#define _blurSkinAnalyze_h
+
+#include <maya/MArgDatabase.h>
+#include <maya/MArgList.h>
+#include <maya/MColorArray.h>
+#include <maya/MDagPath.h>
+#include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MObject.h>
+#include <maya/MPxCommand.h>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MSyntax.h>
+
+#include <vector>
+
+// Finds the badly skinned vertices of a mesh in one parallel pass over the edges.
+// For every vertex: the worst stretch or compression of its edges between the input and the
+// output of the skinCluster, the biggest weight difference with a connected vertex (half the sum
+// of the absolute differences, 0 to 1) and its number of influences. A vertex is a problem when
+// one of them is over its tolerance. The problems are returned worst first, and can be written in
+// a color set displayed on the mesh.
+class blurSkinAnalyzeCmd : public MPxCommand {
+   public:
+    blurSkinAnalyzeCmd() {}
+    virtual ~blurSkinAnalyzeCmd() {}
+
+    MStatus doIt(const MArgList&);
+    MStatus undoIt();
+    MStatus redoIt();
+    // only the color set is undone
+    bool isUndoable() const { return colorSet_.length() > 0; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kSkinClusterNameFlagShort;
+    const static char* kSkinClusterNameFlagLong;
+    const static char* kMeshNameFlagShort;
+    const static char* kMeshNameFlagLong;
+    const static char* kStretchToleranceFlagShort;
+    const static char* kStretchToleranceFlagLong;
+    const static char* kGradientToleranceFlagShort;
+    const static char* kGradientToleranceFlagLong;
+    const static char* kMaxInfluencesFlagShort;
+    const static char* kMaxInfluencesFlagLong;
+    const static char* kColorSetFlagShort;
+    const static char* kColorSetFlagLong;
+    const static char* kStatisticsFlagShort;
+    const static char* kStatisticsFlagLong;
+    const static char* kVerboseFlagShort;
+    const static char* kVerboseFlagLong;
+    const static char* kHelpFlagShort;
+    const static char* kHelpFlagLong;
+
+   private:
+    MStatus setColors(const MColorArray& colors);
+
+    MString skinClusterName_, meshName_;
+    double stretchTolerance_ = 3.0;   // 0 is not checked
+    double gradientTolerance_ = 0.0;  // 0 is not checked
+    int maxInfluences_ = -1;          // -1 the one of the skinCluster, 0 is not checked
+    bool verbose = false;
+
+    MObject skinCluster_;
+    MDagPath shapePath_;
+
+    // color set
+    MString colorSet_, previousColorSet_;
+    bool createdColorSet_ = false, previousDisplayColors_ = false;
+    MColorArray undoColors_, redoColors_;
+};
+
+#endif
@@ -48,6 +48,12 @@
 #include <unordered_set>
 #include <vector>
 
+#include "functions.h"
+
+// implicit smooth, one solve of (I + t L) w = w0 per unlocked influence
+#define DIFFUSE_TOLERANCE 1e-6
+#define DIFFUSE_MAX_ITERATIONS 500
+
 class blurSkinCmd : public MPxCommand {
    public:
     blurSkinCmd();
@@ -62,7 +68,8 @@ class blurSkinCmd : public MPxCommand {
         kCommandQuery,
         kCommandSetColors,
         kCommandGetZeroInfluences,
-        kCommandPruneWeights
+        kCommandPruneWeights,
+        kCommandDiffuse
     };
 
     MStatus doIt(const MArgList&);
@@ -70,6 +77,7 @@ class blurSkinCmd : public MPxCommand {
     MStatus redoIt();
     MStatus getAverageWeight(MIntArray vertices, int currentVertex);
     MStatus addWeights(int currentVertex);
+    MStatus diffuseWeights();
     void verboseSetWeights(int currentVertex);
     void getTypeOfSurface();
     MStatus getListLockJoints();
@@ -123,6 +131,9 @@ class blurSkinCmd : public MPxCommand {
     const static char* kDepthFlagShort;
     const static char* kDepthFlagLong;
 
+    const static char* kDiffusionTimeFlagShort;
+    const static char* kDiffusionTimeFlagLong;
+
     const static char* kRespectLocksFlagShort;
     const static char* kRespectLocksFlagLong;
 
@@ -151,6 +162,8 @@ class blurSkinCmd : public MPxCommand {
     int nbJoints;
 
     MDoubleArray fullOrigWeights, weigthsForUndo, currentWeights, newWeights, weightsForSetting;
+    SparseWeightRows weightRows_;      // non zero influences of currentWeights, for the smooth
+    std::vector<int> verticesAround_;  // vertices of the sparse smooth, reused
     MIntArray lockJoints, lockVertices;
 
     MIntArray indicesVertices_, indicesU_, indicesV_;
@@ -169,7 +182,8 @@ class blurSkinCmd : public MPxCommand {
     bool isNurbsSurface_, isMeshSurface_, isNurbsCurve_, isBezierCurve_;
     bool useSelection = false;
     int depth_, repeat_, indSkinCluster_;
-    double percentMvt_, threshold_;
+    int maxInfluences_ = 0;  // 0 when the skinCluster does not maintain max influences
+    double percentMvt_, threshold_, diffusionTime_;
 
     int numCVsInV_, numCVsInU_;
     int UDeg_, VDeg_;
@@ -3,6 +3,7 @@
 #include <maya/MColorArray.h>
 #include <maya/MDagPath.h>
 #include <maya/MDagPathArray.h>
+#include <maya/MDGContext.h>
 #include <maya/MDataBlock.h>
 #include <maya/MDataHandle.h>
 #include <maya/MDoubleArray.h>
@@ -29,6 +30,7 @@
 #include <maya/MVector.h>
 #include <string.h>
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -51,9 +53,16 @@ class blurSkinDisplay : public MPxNode {
     MString soloColorSet = MString("soloColorsSet");
     MString noColorSet = MString("noColorsSet");
 
-    MDoubleArray paintedValues;
+    // values painted since the last clear, a value is 0 if its generation is not the current one
+    std::vector<double> paintedValues;
+    std::vector<unsigned int> paintedGeneration;
+    std::vector<int> touchedVertices;  // vertices of the current generation, in paint order
+    unsigned int currentGeneration = 1;
+    std::vector<unsigned int> expandMark;  // autoExpand vertices to fix, marked by iteration
+    unsigned int expandStamp = 0;
     MIntArray fullVvertexList;
     std::vector<MIntArray> connectedVertices;  // use by MItMeshVertex getConnectedVertices
+    std::vector<int> adjacencyStarts, adjacencyIndices;  // connectedVertices flattened
     std::vector<MIntArray> connectedFaces;     // use by MItMeshVertex getConnectedFaces
     std::vector<MIntArray> allVertsAround;     // used verts around
     int fullVertexListLength = 0;
@@ -103,6 +112,14 @@ class blurSkinDisplay : public MPxNode {
     MStatus querySkinClusterValues(MIntArray& verticesIndices, MDoubleArray& theWeights,
                                    bool doColors = false);
     void getConnectedVertices(MObject& outMesh, int nbVertices);
+    inline double getPaintedValue(int vertexIndex) const {
+        return paintedGeneration[vertexIndex] == currentGeneration ? paintedValues[vertexIndex]
+                                                                   : 0.0;
+    }
+    void setPaintedValue(int vertexIndex, double value);
+    void resetPaintedValues(int nbVertices);
+    void clearPaintedValues();
+    void autoExpandPaintedValues();
     void refreshVertsConnection();
     void getConnectedSkinCluster();
     void connectSkinClusterWL();
@@ -118,12 +135,18 @@ class blurSkinDisplay : public MPxNode {
                           MColorArray& soloEditColors);
     MStatus editSoloColorSet(MFnMesh& meshFn);
     MColor getASoloColor(double val);
+    // sets the reload flags for a dirty input, returns true if the outMesh is affected
+    bool markDirtyPlug(const MPlug& plugBeingDirtied);
 
    public:
     blurSkinDisplay();
     virtual ~blurSkinDisplay();
     virtual MStatus compute(const MPlug& plug, MDataBlock& dataBlock);
     virtual MStatus setDependentsDirty(const MPlug& plugBeingDirtied, MPlugArray& affectedPlugs);
+    // the evaluation manager doesn't call setDependentsDirty when evaluating
+    virtual MStatus preEvaluation(const MDGContext& context, const MEvaluationNode& evaluationNode);
+    // compute reads the skinCluster and edits its locks, never evaluated next to another node
+    virtual SchedulingType schedulingType() const { return kUntrusted; }
     MStatus connectionBroken(const MPlug& plug, const MPlug& otherPlug, bool asSrc);
     virtual MPlug passThroughToOne(const MPlug& plug) const;
     // MStatus postEvaluation(const MDGContext & 	context, const MEvaluationNode & 	evaluationNode,
@@ -0,0 +1,98 @@
+#ifndef _blurSkinJournal_h
+
+#define _blurSkinJournal_h
+
+#include <maya/MArgDatabase.h>
+#include <maya/MArgList.h>
+#include <maya/MCallbackIdArray.h>
+#include <maya/MDagPath.h>
+#include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MNodeMessage.h>
+#include <maya/MObject.h>
+#include <maya/MObjectHandle.h>
+#include <maya/MPxCommand.h>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MSyntax.h>
+
+#include <deque>
+#include <set>
+
+// Per skinCluster change journal.
+// Every weightList edit (brush, weight editor, scripts, undo) is caught by an attribute changed
+// callback. The edited vertices are pending until someone asks for the changes, then they are
+// stored as ranges of consecutive vertices under a new version. The journal keeps at most
+// JOURNAL_MAX_RANGES ranges, asking for changes older than what is kept means a full reload.
+
+#define JOURNAL_MAX_RANGES 65536
+
+struct JournalRange {
+    int version;
+    int firstVertex;
+    int vertexCount;
+};
+
+class SkinClusterJournal {
+   public:
+    SkinClusterJournal(MObject& skinCluster);
+    ~SkinClusterJournal();
+
+    bool isValid() const { return handle_.isValid(); }
+    bool isSkinCluster(const MObject& skinCluster) const { return handle_.objectRef() == skinCluster; }
+
+    int version();
+    // false if the journal does not go back to sinceVersion
+    bool changedSince(int sinceVersion, MIntArray& vertices);
+
+   private:
+    static void weightsChangedCallback(MNodeMessage::AttributeMessage msg, MPlug& plug,
+                                       MPlug& otherPlug, void* clientData);
+    void flushPending();
+
+    MObjectHandle handle_;
+    MObject weightListAttr_, weightsAttr_;
+    MCallbackIdArray callbackIds_;
+
+    int version_ = 0;
+    int droppedVersion_ = 0;  // changes up to this version are not in the journal anymore
+    std::set<int> pending_;
+    std::deque<JournalRange> ranges_;
+};
+
+// returns the journal of the skinCluster, starts tracking it on first call
+SkinClusterJournal* getSkinClusterJournal(MObject& skinCluster);
+void stopSkinClusterJournal(MObject& skinCluster);
+void clearSkinClusterJournals();
+
+class blurSkinJournalCmd : public MPxCommand {
+   public:
+    blurSkinJournalCmd() {}
+    virtual ~blurSkinJournalCmd() {}
+
+    MStatus doIt(const MArgList&);
+    bool isUndoable() const { return false; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kSkinClusterNameFlagShort;
+    const static char* kSkinClusterNameFlagLong;
+    const static char* kMeshNameFlagShort;
+    const static char* kMeshNameFlagLong;
+    const static char* kVersionFlagShort;
+    const static char* kVersionFlagLong;
+    const static char* kChangedSinceFlagShort;
+    const static char* kChangedSinceFlagLong;
+    const static char* kStopFlagShort;
+    const static char* kStopFlagLong;
+    const static char* kVerboseFlagShort;
+    const static char* kVerboseFlagLong;
+    const static char* kHelpFlagShort;
+    const static char* kHelpFlagLong;
+
+   private:
+    MString skinClusterName_, meshName_;
+    bool verbose = false;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef _blurSkinMap_h
+
+#define _blurSkinMap_h
+
+#include <maya/MArgDatabase.h>
+#include <maya/MArgList.h>
+#include <maya/MDagPath.h>
+#include <maya/MDoubleArray.h>
+#include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MPlug.h>
+#include <maya/MPxCommand.h>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MSyntax.h>
+
+#include <vector>
+
+// Edits a per vertex map (deformer weights, blendShape weights, doubleArray attributes) of the
+// weight editor in place.
+// The operations run in this order on the masked vertices: import of a file, uv ramp, smooth,
+// remap, clamp. Only the elements whose value changed are written, in one undo.
+class blurSkinMapCmd : public MPxCommand {
+   public:
+    blurSkinMapCmd() {}
+    virtual ~blurSkinMapCmd() {}
+
+    MStatus doIt(const MArgList&);
+    MStatus undoIt();
+    MStatus redoIt();
+    bool isUndoable() const { return true; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kAttributeFlagShort;
+    const static char* kAttributeFlagLong;
+    const static char* kMeshNameFlagShort;
+    const static char* kMeshNameFlagLong;
+    const static char* kVerticesFlagShort;
+    const static char* kVerticesFlagLong;
+    const static char* kImportFileFlagShort;
+    const static char* kImportFileFlagLong;
+    const static char* kUvRampFlagShort;
+    const static char* kUvRampFlagLong;
+    const static char* kNormalizeFlagShort;
+    const static char* kNormalizeFlagLong;
+    const static char* kOppositeFlagShort;
+    const static char* kOppositeFlagLong;
+    const static char* kSmoothFlagShort;
+    const static char* kSmoothFlagLong;
+    const static char* kRemapFlagShort;
+    const static char* kRemapFlagLong;
+    const static char* kClampFlagShort;
+    const static char* kClampFlagLong;
+    const static char* kVerboseFlagShort;
+    const static char* kVerboseFlagLong;
+    const static char* kHelpFlagShort;
+    const static char* kHelpFlagLong;
+
+   private:
+    MStatus importFile(const std::vector<int>& vertices, std::vector<double>& values);
+    MStatus uvRamp(const std::vector<int>& vertices, std::vector<double>& values);
+    MStatus smooth(const std::vector<int>& vertices, std::vector<double>& values);
+
+    MString attributeName_, meshName_, importFile_;
+    int uvAxis_ = -1;  // 0 u, 1 v
+    bool normalize_ = false, opposite_ = false;
+    int smoothRepeat_ = 0;
+    bool remap_ = false, clamp_ = false;
+    double remapValues_[4] = {0.0, 1.0, 0.0, 1.0};  // old min, old max, new min, new max
+    double clampValues_[2] = {0.0, 1.0};
+    bool verbose = false;
+
+    MPlug mapPlug_;
+    MDagPath shapePath_;
+    int nbVertices_ = 0;
+    // changed elements only
+    MIntArray changedVertices_;
+    MDoubleArray undoValues_, redoValues_;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef _blurSkinMirror_h
+
+#define _blurSkinMirror_h
+
+#include <maya/MArgDatabase.h>
+#include <maya/MArgList.h>
+#include <maya/MDagPath.h>
+#include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MObject.h>
+#include <maya/MPxCommand.h>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MSyntax.h>
+
+#include <vector>
+
+#include "weightsFile.h"
+
+// Mirrors the weights of a whole skinCluster.
+// The vertex symmetry map is the symmetricVertices attribute of the transform when it matches the
+// shape, otherwise it is built from the orig shape points mirrored on the axis. The influences are
+// swapped with the mirrorInfluences pairing (logical indices, as sent to the brush).
+// direction 1 copies the positive side on the negative one, -1 the opposite, 0 symmetrizes both
+// sides. Vertices on the axis are always symmetrized.
+
+// returns for every vertex its mirror, -1 if none is found within tolerance
+MStatus buildSymmetryMap(const MObject& origMesh, int axis, double tolerance,
+                         std::vector<int>& symmetryMap);
+
+class blurSkinMirrorCmd : public MPxCommand {
+   public:
+    blurSkinMirrorCmd() {}
+    virtual ~blurSkinMirrorCmd() {}
+
+    MStatus doIt(const MArgList&);
+    MStatus undoIt();
+    MStatus redoIt();
+    bool isUndoable() const { return true; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kSkinClusterNameFlagShort;
+    const static char* kSkinClusterNameFlagLong;
+    const static char* kMeshNameFlagShort;
+    const static char* kMeshNameFlagLong;
+    const static char* kAxisFlagShort;
+    const static char* kAxisFlagLong;
+    const static char* kDirectionFlagShort;
+    const static char* kDirectionFlagLong;
+    const static char* kToleranceFlagShort;
+    const static char* kToleranceFlagLong;
+    const static char* kMirrorInfluencesFlagShort;
+    const static char* kMirrorInfluencesFlagLong;
+    const static char* kVerboseFlagShort;
+    const static char* kVerboseFlagLong;
+    const static char* kHelpFlagShort;
+    const static char* kHelpFlagLong;
+
+   private:
+    MString skinClusterName_, meshName_;
+    int axis_ = 0;
+    int direction_ = 1;
+    double tolerance_ = 0.001;
+    MIntArray mirrorInfluences_;
+    bool verbose = false;
+
+    MObject skinCluster_;
+    MDagPath shapePath_;
+    int nbInfluences_ = 0;
+    MIntArray logicalIndices_;
+    // sparse rows from the first to the last mirrored vertex
+    WeightsBlock undoBlock_, redoBlock_;
+};
+
+#endif
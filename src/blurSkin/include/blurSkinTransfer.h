@@ -0,0 +1,92 @@
+#ifndef _blurSkinTransfer_h
+
+#define _blurSkinTransfer_h
+
+#include <maya/MArgDatabase.h>
+#include <maya/MArgList.h>
+#include <maya/MDagPath.h>
+#include <maya/MFnMesh.h>
+#include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MObject.h>
+#include <maya/MPxCommand.h>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MSyntax.h>
+
+#include <vector>
+
+#include "weightsFile.h"
+
+// Skin weights transfer between meshes of different topologies.
+// Every target vertex takes the weights of the closest point on the source surface, the weights
+// of the 3 vertices of the source triangle are blended with the barycentric coordinates and the
+// influences are matched by name, then by name without namespace.
+
+#define TRANSFER_BVH_LEAF_SIZE 4
+
+// bvh over the source triangles, nodes are stored depth first, the left child of a node is the
+// next node
+struct TriangleBVH {
+    struct Node {
+        double boxMin[3], boxMax[3];
+        int first;   // first triangle of a leaf / right child of an inner node
+        int count;   // 0 for inner nodes
+    };
+
+    void build(const std::vector<double>& points, const std::vector<int>& triangles);
+    // returns the closest triangle, barycentric receives the weights of its 3 vertices
+    int closestPoint(const double* point, double* barycentric) const;
+
+   private:
+    int buildNode(int first, int count);
+    double boxDistance(const Node& node, const double* point) const;
+
+    const std::vector<double>* points_ = nullptr;
+    const std::vector<int>* triangles_ = nullptr;
+    std::vector<int> triangleIndices_;
+    std::vector<double> centers_;
+    std::vector<Node> nodes_;
+};
+
+class blurSkinTransferCmd : public MPxCommand {
+   public:
+    blurSkinTransferCmd() {}
+    virtual ~blurSkinTransferCmd() {}
+
+    MStatus doIt(const MArgList&);
+    MStatus undoIt();
+    MStatus redoIt();
+    bool isUndoable() const { return true; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kSourceSkinClusterFlagShort;
+    const static char* kSourceSkinClusterFlagLong;
+    const static char* kSourceMeshFlagShort;
+    const static char* kSourceMeshFlagLong;
+    const static char* kSkinClusterNameFlagShort;
+    const static char* kSkinClusterNameFlagLong;
+    const static char* kMeshNameFlagShort;
+    const static char* kMeshNameFlagLong;
+    const static char* kListVerticesIndicesFlagShort;
+    const static char* kListVerticesIndicesFlagLong;
+    const static char* kVerboseFlagShort;
+    const static char* kVerboseFlagLong;
+    const static char* kHelpFlagShort;
+    const static char* kHelpFlagLong;
+
+   private:
+    MString sourceSkinClusterName_, sourceMeshName_, skinClusterName_, meshName_;
+    MIntArray maskVertices_;
+    bool verbose = false;
+
+    MObject skinCluster_;
+    MDagPath shapePath_;
+    int nbInfluences_ = 0;
+    MIntArray logicalIndices_;
+    // sparse rows from the first to the last transferred vertex
+    WeightsBlock undoBlock_, redoBlock_;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _blurSkinWeightsBuffer_h
+
+#define _blurSkinWeightsBuffer_h
+
+#include <maya/MArgDatabase.h>
+#include <maya/MArgList.h>
+#include <maya/MDagPath.h>
+#include <maya/MDoubleArray.h>
+#include <maya/MFnSkinCluster.h>
+#include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MObject.h>
+#include <maya/MPxCommand.h>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MSyntax.h>
+
+#include <cstdint>
+#include <vector>
+
+// Bulk access to the skin weights through memory owned by the caller (a numpy array for
+// instance). Buffers are passed as addresses strings with their capacity :
+//   dense   values[nbIndices * nbInfluences]
+//   sparse  rows[nbIndices + 1], columns[nnz], values[nnz]   (CSR, columns are influences
+//           indices in the order of influenceObjects)
+// The indices are flat point indices, decoded in u/v for nurbs and s/t/u for lattices.
+
+struct WeightsBufferArgs {
+    MString skinClusterName, meshName;
+    uint64_t indicesAddress = 0;
+    int indicesCount = -1;
+    uint64_t valuesAddress = 0, rowsAddress = 0, columnsAddress = 0;
+    int bufferSize = 0;
+    bool sparse = false;
+    bool verbose = false;
+
+    MObject skinCluster;
+    MDagPath shapePath;
+    MIntArray indices;
+    int nbInfluences = 0;
+};
+
+class blurSkinGetWeightsCmd : public MPxCommand {
+   public:
+    blurSkinGetWeightsCmd() {}
+    virtual ~blurSkinGetWeightsCmd() {}
+
+    MStatus doIt(const MArgList&);
+    bool isUndoable() const { return false; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kCountOnlyFlagShort;
+    const static char* kCountOnlyFlagLong;
+    const static char* kPointCountFlagShort;
+    const static char* kPointCountFlagLong;
+
+   private:
+    MStatus getDense(WeightsBufferArgs& bufferArgs);
+    MStatus getSparse(WeightsBufferArgs& bufferArgs, bool countOnly);
+};
+
+class blurSkinSetWeightsCmd : public MPxCommand {
+   public:
+    blurSkinSetWeightsCmd() {}
+    virtual ~blurSkinSetWeightsCmd() {}
+
+    MStatus doIt(const MArgList&);
+    MStatus undoIt();
+    MStatus redoIt();
+    bool isUndoable() const { return true; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kNormalizeFlagShort;
+    const static char* kNormalizeFlagLong;
+
+   private:
+    MObject skinCluster_;
+    MDagPath shapePath_;
+    MObject component_;
+    MIntArray influenceIndices_;
+    MDoubleArray newWeights_, oldWeights_;
+    bool normalize_ = false;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef _blurSkinWeightsIO_h
+
+#define _blurSkinWeightsIO_h
+
+#include <maya/MArgDatabase.h>
+#include <maya/MArgList.h>
+#include <maya/MDagPath.h>
+#include <maya/MFnSkinCluster.h>
+#include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MObject.h>
+#include <maya/MPxCommand.h>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MStringArray.h>
+#include <maya/MSyntax.h>
+
+#include <vector>
+
+#include "weightsFile.h"
+
+// reads the sparse weights of consecutive vertices from the weightList plug, influences are
+// stored as physical indices (order of influenceObjects)
+MStatus readSparseWeights(MObject& skinCluster, int firstVertex, int vertexCount,
+                          const std::vector<int>& logicalToPhysical, WeightsBlock& block);
+// writes the sparse rows of consecutive vertices in the weightList plug, only the entries that
+// change are set or removed. logicalIndices maps the physical influences of the block to the
+// logical ones, oldBlock receives the previous weights as sparse rows
+MStatus writeSparseWeights(MObject& skinCluster, const MIntArray& logicalIndices,
+                           const WeightsBlock& block, WeightsBlock* oldBlock = nullptr);
+
+class blurSkinExportCmd : public MPxCommand {
+   public:
+    blurSkinExportCmd() {}
+    virtual ~blurSkinExportCmd() {}
+
+    MStatus doIt(const MArgList&);
+    bool isUndoable() const { return false; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kSkinClusterNameFlagShort;
+    const static char* kSkinClusterNameFlagLong;
+    const static char* kMeshNameFlagShort;
+    const static char* kMeshNameFlagLong;
+    const static char* kFileFlagShort;
+    const static char* kFileFlagLong;
+    const static char* kBlockSizeFlagShort;
+    const static char* kBlockSizeFlagLong;
+    const static char* kCompressFlagShort;
+    const static char* kCompressFlagLong;
+    const static char* kVerboseFlagShort;
+    const static char* kVerboseFlagLong;
+    const static char* kHelpFlagShort;
+    const static char* kHelpFlagLong;
+
+   private:
+    MString skinClusterName_, meshName_, filePath_;
+    int blockSize_ = 4096;
+    bool compress_ = true;
+    bool verbose = false;
+};
+
+class blurSkinImportCmd : public MPxCommand {
+   public:
+    blurSkinImportCmd() {}
+    virtual ~blurSkinImportCmd() {}
+
+    MStatus doIt(const MArgList&);
+    MStatus undoIt();
+    MStatus redoIt();
+    bool isUndoable() const { return true; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kSkinClusterNameFlagShort;
+    const static char* kSkinClusterNameFlagLong;
+    const static char* kMeshNameFlagShort;
+    const static char* kMeshNameFlagLong;
+    const static char* kFileFlagShort;
+    const static char* kFileFlagLong;
+    const static char* kForceFlagShort;
+    const static char* kForceFlagLong;
+    const static char* kNormalizeFlagShort;
+    const static char* kNormalizeFlagLong;
+    const static char* kVerboseFlagShort;
+    const static char* kVerboseFlagLong;
+    const static char* kHelpFlagShort;
+    const static char* kHelpFlagLong;
+
+   private:
+    MString skinClusterName_, meshName_, filePath_;
+    bool force_ = false;
+    bool normalize_ = true;
+    bool verbose = false;
+
+    MObject skinCluster_;
+    MDagPath shapePath_;
+    MIntArray logicalIndices_;
+    // sparse before / after rows, one entry per file block
+    std::vector<WeightsBlock> undoBlocks_, redoBlocks_;
+};
+
+#endif
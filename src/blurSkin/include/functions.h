@@ -4,29 +4,46 @@
 
 // MAYA HEADER FILES:
 
+#include <maya/MArrayDataHandle.h>
 #include <maya/MColorArray.h>
 #include <maya/MDagPath.h>
 #include <maya/MDagPathArray.h>
+#include <maya/MDataHandle.h>
 #include <maya/MFnDagNode.h>
 #include <maya/MFnDependencyNode.h>
+#include <maya/MFnDoubleArrayData.h>
+#include <maya/MFnDoubleIndexedComponent.h>
 #include <maya/MFnIntArrayData.h>
+#include <maya/MFnLattice.h>
 #include <maya/MFnMesh.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnNurbsCurve.h>
+#include <maya/MFnNurbsSurface.h>
 #include <maya/MFnSingleIndexedComponent.h>
 #include <maya/MFnSkinCluster.h>
+#include <maya/MFnTripleIndexedComponent.h>
+#include <maya/MFnTypedAttribute.h>
 #include <maya/MGlobal.h>
 #include <maya/MItDependencyGraph.h>
 #include <maya/MObject.h>
 #include <maya/MObjectArray.h>
 #include <maya/MPlug.h>
+#include <maya/MSelectionList.h>
+#include <maya/MStringArray.h>
 
 #include <algorithm>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <random>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "sparseWeights.h"
+#include "vertexMaps.h"
+
 // FUNCTION DECLARATION:
 unsigned int getMIntArrayIndex(MIntArray& myArray, int searching);
 void CVsAround(int storedU, int storedV, int numCVsInU, int numCVsInV, bool UIsPeriodic,
@@ -53,5 +70,31 @@ MStatus editArray(int command, int influence, int nbJoints, MIntArray& lockJoint
 MStatus setAverageWeight(MIntArray& verticesAround, int currentVertex, int indexCurrVert,
                          int nbJoints, MIntArray& lockJoints, MDoubleArray& fullWeightArray,
                          MDoubleArray& theWeights);
+
 MStatus doPruneWeight(MDoubleArray& theWeights, int nbJoints, double pruneCutWeight);
+
+// geometry / influences helpers shared by the weights commands
+MStatus getSkinClusterAndShape(const MString& skinClusterName, const MString& meshName,
+                               MObject& theSkinCluster, MDagPath& shapePath, bool verbose);
+MStatus getInfluencesInfos(MObject& skinCluster, MStringArray& influenceNames,
+                           MIntArray& logicalIndices);
+void getLogicalToPhysical(const MIntArray& logicalIndices, std::vector<int>& logicalToPhysical);
+MString leafName(const MString& name);
+void getNurbsCVsCount(MFnNurbsSurface& surfaceFn, int& numCVsInU, int& numCVsInV);
+int getGeometryPointCount(const MDagPath& shapePath);
+MStatus buildGeometryComponent(const MDagPath& shapePath, const MIntArray& indices,
+                               MObject& component);
+MStatus buildGeometryComponentRange(const MDagPath& shapePath, int first, int count,
+                                    MObject& component);
+uint64_t getTopologyHash(const MDagPath& shapePath);
+// connected vertices of every vertex from the edges, the ones of vertex i are
+// adjacencyIndices[adjacencyStarts[i]] to adjacencyIndices[adjacencyStarts[i + 1] - 1]
+void buildMeshAdjacency(MFnMesh& meshFn, std::vector<int>& adjacencyStarts,
+                        std::vector<int>& adjacencyIndices);
+
+// sparse symmetric positive definite solve, matrix in CSR, x holds the initial guess
+// jacobi preconditioned conjugate gradient, returns the number of iterations
+int solveConjugateGradient(const std::vector<int>& rows, const std::vector<int>& columns,
+                           const std::vector<double>& values, const std::vector<double>& rhs,
+                           std::vector<double>& x, double tolerance, int maxIterations);
 #endif
\ No newline at end of file
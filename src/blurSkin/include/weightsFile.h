@@ -0,0 +1,131 @@
+#ifndef _weightsFile_h
+
+#define _weightsFile_h
+
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MStringArray.h>
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// Binary skin weights file
+//
+//   WeightsFileHeader
+//   influences names      numInfluences x (uint32 length, chars)
+//   blocks payloads       8 bytes aligned, optionally compressed
+//   WeightsBlockEntry     numBlocks entries, the block table
+//
+// A block holds the sparse rows of vertexCount consecutive vertices :
+//   double   weights[nnz]
+//   uint32   counts[vertexCount]      number of non zero weights per vertex
+//   uint32   influences[nnz]          index in the influences names of the file
+// The weights come first so they stay aligned when read straight from the mapped file.
+
+#define WEIGHTS_FILE_MAGIC 0x5753424D  // "MBSW"
+#define WEIGHTS_FILE_VERSION 1
+
+enum WeightsBlockCodec { kCodecRaw = 0, kCodecZlib = 1 };
+
+#pragma pack(push, 1)
+struct WeightsFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t topologyHash;
+    uint32_t numVertices;
+    uint32_t numInfluences;
+    uint32_t numBlocks;
+    uint32_t blockSize;
+    uint64_t namesOffset;
+    uint64_t blockTableOffset;
+};
+
+struct WeightsBlockEntry {
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t nnz;
+    uint32_t codec;
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t rawSize;
+};
+#pragma pack(pop)
+
+// sparse rows of consecutive vertices, owned memory
+struct WeightsBlock {
+    int firstVertex = 0;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> influences;
+    std::vector<double> weights;
+
+    void clear() {
+        counts.clear();
+        influences.clear();
+        weights.clear();
+    }
+    int vertexCount() const { return (int)counts.size(); }
+};
+
+// sparse rows of consecutive vertices, pointing inside the mapped file (or the reader scratch
+// buffer for compressed blocks)
+struct WeightsBlockView {
+    int firstVertex = 0;
+    int vertexCount = 0;
+    int nnz = 0;
+    const double* weights = nullptr;
+    const uint32_t* counts = nullptr;
+    const uint32_t* influences = nullptr;
+};
+
+class WeightsFileWriter {
+   public:
+    WeightsFileWriter() {}
+    ~WeightsFileWriter();
+
+    MStatus open(const MString& path, uint64_t topologyHash, int numVertices, int blockSize,
+                 const MStringArray& influenceNames, bool compress);
+    MStatus writeBlock(const WeightsBlock& block);
+    MStatus close();
+
+   private:
+    void writePadding();
+
+    std::ofstream stream_;
+    WeightsFileHeader header_;
+    std::vector<WeightsBlockEntry> blockTable_;
+    std::vector<char> rawBuffer_, compressedBuffer_;
+    bool compress_ = false;
+};
+
+class WeightsFileReader {
+   public:
+    WeightsFileReader() {}
+    ~WeightsFileReader();
+
+    MStatus open(const MString& path);
+    void close();
+
+    const WeightsFileHeader& header() const { return header_; }
+    const MStringArray& influenceNames() const { return influenceNames_; }
+    int numBlocks() const { return (int)header_.numBlocks; }
+    MStatus getBlock(int blockIndex, WeightsBlockView& view);
+
+   private:
+    MStatus map(const MString& path);
+
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#else
+    int fileDescriptor_ = -1;
+#endif
+    WeightsFileHeader header_;
+    const WeightsBlockEntry* blockTable_ = nullptr;
+    MStringArray influenceNames_;
+    std::vector<double> scratch_;  // 8 bytes aligned buffer for decompressed blocks
+};
+
+#endif
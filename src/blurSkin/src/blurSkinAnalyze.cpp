@@ -0,0 +1,291 @@
+#include "blurSkinAnalyze.h"
+
+#include <maya/MDoubleArray.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MFnMesh.h>
+#include <maya/MFnSkinCluster.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "blurSkinWeightsIO.h"
+#include "functions.h"
+
+const char* blurSkinAnalyzeCmd::kSkinClusterNameFlagShort = "-skn";
+const char* blurSkinAnalyzeCmd::kSkinClusterNameFlagLong = "-skinCluster";
+const char* blurSkinAnalyzeCmd::kMeshNameFlagShort = "-mn";
+const char* blurSkinAnalyzeCmd::kMeshNameFlagLong = "-meshName";
+const char* blurSkinAnalyzeCmd::kStretchToleranceFlagShort = "-st";
+const char* blurSkinAnalyzeCmd::kStretchToleranceFlagLong = "-stretchTolerance";
+const char* blurSkinAnalyzeCmd::kGradientToleranceFlagShort = "-gt";
+const char* blurSkinAnalyzeCmd::kGradientToleranceFlagLong = "-gradientTolerance";
+const char* blurSkinAnalyzeCmd::kMaxInfluencesFlagShort = "-mi";
+const char* blurSkinAnalyzeCmd::kMaxInfluencesFlagLong = "-maxInfluences";
+const char* blurSkinAnalyzeCmd::kColorSetFlagShort = "-cs";
+const char* blurSkinAnalyzeCmd::kColorSetFlagLong = "-colorSet";
+const char* blurSkinAnalyzeCmd::kStatisticsFlagShort = "-sts";
+const char* blurSkinAnalyzeCmd::kStatisticsFlagLong = "-statistics";
+const char* blurSkinAnalyzeCmd::kVerboseFlagShort = "-vrb";
+const char* blurSkinAnalyzeCmd::kVerboseFlagLong = "-verbose";
+const char* blurSkinAnalyzeCmd::kHelpFlagShort = "-h";
+const char* blurSkinAnalyzeCmd::kHelpFlagLong = "-help";
+
+static void DisplayAnalyzeHelp() {
+    MString help;
+    help += "Flags:\n";
+    help += "-skinCluster         -skn   String     Name of the skinCluster\n";
+    help += "-meshName            -mn    String     Name of the mesh if skincluster is not passed\n";
+    help += "                                          If -skn and -mn are not passed uses selection\n";
+    help += "-stretchTolerance    -st    Double     Max stretch or compression of the edges\n";
+    help += "                                          0 not checked, default 3\n";
+    help += "-gradientTolerance   -gt    Double     Max weights difference on an edge, 0 to 1\n";
+    help += "                                          0 not checked, default 0\n";
+    help += "-maxInfluences       -mi    Int        Max influences of a vertex, 0 not checked\n";
+    help += "                                          default the one of the skinCluster\n";
+    help += "-colorSet            -cs    String     Color set showing the problems, red worst\n";
+    help += "-statistics          -sts   N/A        Returns max stretch, max gradient, max and\n";
+    help += "                                          average influences, number of problems\n";
+    help += "-verbose             -vrb   Bool       Verbose print\n";
+    help += "-help                -h     N/A        Display this text.\n";
+    help += "Returns the problem vertices, worst first.\n";
+    MGlobal::displayInfo(help);
+}
+
+void* blurSkinAnalyzeCmd::creator() { return new blurSkinAnalyzeCmd(); }
+
+MSyntax blurSkinAnalyzeCmd::newSyntax() {
+    MSyntax syntax;
+    syntax.addFlag(kSkinClusterNameFlagShort, kSkinClusterNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kMeshNameFlagShort, kMeshNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kStretchToleranceFlagShort, kStretchToleranceFlagLong, MSyntax::kDouble);
+    syntax.addFlag(kGradientToleranceFlagShort, kGradientToleranceFlagLong, MSyntax::kDouble);
+    syntax.addFlag(kMaxInfluencesFlagShort, kMaxInfluencesFlagLong, MSyntax::kLong);
+    syntax.addFlag(kColorSetFlagShort, kColorSetFlagLong, MSyntax::kString);
+    syntax.addFlag(kStatisticsFlagShort, kStatisticsFlagLong);
+    syntax.addFlag(kVerboseFlagShort, kVerboseFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kHelpFlagShort, kHelpFlagLong);
+    return syntax;
+}
+
+MStatus blurSkinAnalyzeCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kHelpFlagShort)) {
+        DisplayAnalyzeHelp();
+        return MS::kSuccess;
+    }
+    if (argData.isFlagSet(kVerboseFlagShort))
+        verbose = argData.flagArgumentBool(kVerboseFlagShort, 0, &status);
+    if (argData.isFlagSet(kSkinClusterNameFlagShort))
+        skinClusterName_ = argData.flagArgumentString(kSkinClusterNameFlagShort, 0);
+    if (argData.isFlagSet(kMeshNameFlagShort))
+        meshName_ = argData.flagArgumentString(kMeshNameFlagShort, 0);
+    if (argData.isFlagSet(kStretchToleranceFlagShort))
+        stretchTolerance_ = argData.flagArgumentDouble(kStretchToleranceFlagShort, 0, &status);
+    if (argData.isFlagSet(kGradientToleranceFlagShort))
+        gradientTolerance_ = argData.flagArgumentDouble(kGradientToleranceFlagShort, 0, &status);
+    if (argData.isFlagSet(kMaxInfluencesFlagShort))
+        maxInfluences_ = argData.flagArgumentInt(kMaxInfluencesFlagShort, 0, &status);
+    if (argData.isFlagSet(kColorSetFlagShort))
+        colorSet_ = argData.flagArgumentString(kColorSetFlagShort, 0);
+    bool statistics = argData.isFlagSet(kStatisticsFlagShort);
+
+    status = getSkinClusterAndShape(skinClusterName_, meshName_, skinCluster_, shapePath_,
+                                    verbose);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (shapePath_.apiType() != MFn::kMesh) {
+        MGlobal::displayError("analyze only works on meshes");
+        return MS::kFailure;
+    }
+    MFnMesh meshFn(shapePath_);
+    int nbVertices = meshFn.numVertices();
+
+    // the input of the skinCluster against its output
+    MFnSkinCluster skinFn(skinCluster_);
+    unsigned int geometryIndex = skinFn.indexForOutputShape(shapePath_.node(), &status);
+    MObject inputMesh;
+    if (status == MS::kSuccess) inputMesh = skinFn.inputShapeAtIndex(geometryIndex, &status);
+    if (inputMesh.isNull()) findOrigMesh(skinCluster_, inputMesh, verbose);
+    MFnMesh inputFn(inputMesh, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (inputFn.numVertices() != nbVertices) {
+        MGlobal::displayError("skinCluster input and output have different vertices counts");
+        return MS::kFailure;
+    }
+    const float* inputPoints = inputFn.getRawPoints(&status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    const float* outputPoints = meshFn.getRawPoints(&status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (maxInfluences_ == -1) {
+        MFnDependencyNode skinDep(skinCluster_);
+        maxInfluences_ = 0;
+        if (skinDep.findPlug("maintainMaxInfluences", false).asBool())
+            maxInfluences_ = skinDep.findPlug("maxInfluences", false).asInt();
+    }
+
+    MStringArray influenceNames;
+    MIntArray logicalIndices;
+    getInfluencesInfos(skinCluster_, influenceNames, logicalIndices);
+    std::vector<int> logicalToPhysical;
+    getLogicalToPhysical(logicalIndices, logicalToPhysical);
+    WeightsBlock weightsBlock;
+    status = readSparseWeights(skinCluster_, 0, nbVertices, logicalToPhysical, weightsBlock);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    std::vector<size_t> rows(nbVertices + 1, 0);
+    for (int i = 0; i < nbVertices; ++i) rows[i + 1] = rows[i] + weightsBlock.counts[i];
+
+    std::vector<int> adjacencyStarts, adjacencyIndices;
+    buildMeshAdjacency(meshFn, adjacencyStarts, adjacencyIndices);
+
+    // every vertex only reads, each edge is measured from both sides
+    std::vector<double> stretch(nbVertices, 1.0), gradient(nbVertices, 0.0), score(nbVertices);
+    std::vector<int> influenceCounts(nbVertices, 0);
+#pragma omp parallel for
+    for (int vertex = 0; vertex < nbVertices; ++vertex) {
+        const float* inputPt = inputPoints + 3 * vertex;
+        const float* outputPt = outputPoints + 3 * vertex;
+        const uint32_t* influences = weightsBlock.influences.data() + rows[vertex];
+        const double* weights = weightsBlock.weights.data() + rows[vertex];
+        int count = (int)weightsBlock.counts[vertex];
+        double total = 0.0;
+        for (int k = 0; k < count; ++k) {
+            if (weights[k] <= 0.0) continue;
+            ++influenceCounts[vertex];
+            total += weights[k];
+        }
+        for (int n = adjacencyStarts[vertex]; n < adjacencyStarts[vertex + 1]; ++n) {
+            int other = adjacencyIndices[n];
+            double inputLength = 0.0, outputLength = 0.0;
+            for (int c = 0; c < 3; ++c) {
+                double inputDelta = inputPoints[3 * other + c] - inputPt[c];
+                double outputDelta = outputPoints[3 * other + c] - outputPt[c];
+                inputLength += inputDelta * inputDelta;
+                outputLength += outputDelta * outputDelta;
+            }
+            inputLength = std::sqrt(inputLength);
+            outputLength = std::sqrt(outputLength);
+            if (inputLength > 1e-9) {
+                double ratio = outputLength > inputLength
+                                   ? outputLength / inputLength
+                                   : inputLength / std::max(outputLength, 1e-9);
+                stretch[vertex] = std::max(stretch[vertex], ratio);
+            }
+            // |a - b| = a + b - 2 min(a, b), summed over the influences of both rows
+            const uint32_t* otherInfluences = weightsBlock.influences.data() + rows[other];
+            const double* otherWeights = weightsBlock.weights.data() + rows[other];
+            int otherCount = (int)weightsBlock.counts[other];
+            double otherTotal = 0.0, common = 0.0;
+            for (int j = 0; j < otherCount; ++j) {
+                if (otherWeights[j] <= 0.0) continue;
+                otherTotal += otherWeights[j];
+                for (int k = 0; k < count; ++k) {
+                    if (influences[k] != otherInfluences[j] || weights[k] <= 0.0) continue;
+                    common += std::min(weights[k], otherWeights[j]);
+                    break;
+                }
+            }
+            double difference = 0.5 * (total + otherTotal - 2.0 * common);
+            gradient[vertex] = std::max(gradient[vertex], difference);
+        }
+        double vertexScore = 0.0;
+        if (stretchTolerance_ > 0.0)
+            vertexScore = std::max(vertexScore, stretch[vertex] / stretchTolerance_);
+        if (gradientTolerance_ > 0.0)
+            vertexScore = std::max(vertexScore, gradient[vertex] / gradientTolerance_);
+        if (maxInfluences_ > 0)
+            vertexScore = std::max(vertexScore, influenceCounts[vertex] / (double)maxInfluences_);
+        score[vertex] = vertexScore;
+    }
+
+    std::vector<int> problems;
+    for (int vertex = 0; vertex < nbVertices; ++vertex)
+        if (score[vertex] > 1.0) problems.push_back(vertex);
+    std::stable_sort(problems.begin(), problems.end(),
+                     [&score](int a, int b) { return score[a] > score[b]; });
+
+    double maxStretch = 1.0, maxGradient = 0.0, averageInfluences = 0.0;
+    int maxInfluenceCount = 0;
+    for (int vertex = 0; vertex < nbVertices; ++vertex) {
+        maxStretch = std::max(maxStretch, stretch[vertex]);
+        maxGradient = std::max(maxGradient, gradient[vertex]);
+        maxInfluenceCount = std::max(maxInfluenceCount, influenceCounts[vertex]);
+        averageInfluences += influenceCounts[vertex];
+    }
+    averageInfluences /= std::max(nbVertices, 1);
+    if (verbose) {
+        MString info = shapePath_.partialPathName() + MString(" : ") + (int)problems.size() +
+                       MString(" problem vertices, max stretch ") + maxStretch +
+                       MString(", max gradient ") + maxGradient + MString(", influences max ") +
+                       maxInfluenceCount + MString(" average ") + averageInfluences;
+        MGlobal::displayInfo(info);
+    }
+
+    if (statistics) {
+        MDoubleArray result;
+        result.append(maxStretch);
+        result.append(maxGradient);
+        result.append(maxInfluenceCount);
+        result.append(averageInfluences);
+        result.append((double)problems.size());
+        setResult(result);
+    } else {
+        MIntArray result((unsigned int)problems.size());
+        for (size_t i = 0; i < problems.size(); ++i) result[(unsigned int)i] = problems[i];
+        setResult(result);
+    }
+
+    if (colorSet_.length() == 0) return MS::kSuccess;
+    // white is fine, yellow just over a tolerance to red at twice it
+    redoColors_ = MColorArray(nbVertices, MColor(1.0f, 1.0f, 1.0f));
+    for (int vertex : problems) {
+        float t = (float)std::min(score[vertex] - 1.0, 1.0);
+        redoColors_[vertex] = MColor(1.0f, 1.0f - t, 0.0f);
+    }
+    MStringArray colorSets;
+    meshFn.getColorSetNames(colorSets);
+    createdColorSet_ = colorSets.indexOf(colorSet_) == -1;
+    if (!createdColorSet_) meshFn.getVertexColors(undoColors_, &colorSet_);
+    previousColorSet_ = meshFn.currentColorSetName();
+    previousDisplayColors_ = meshFn.findPlug("displayColors", false).asBool();
+    return redoIt();
+}
+
+// one color per vertex, every face vertex uses the color of its vertex
+MStatus blurSkinAnalyzeCmd::setColors(const MColorArray& colors) {
+    MStatus status;
+    MFnMesh meshFn(shapePath_, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    MIntArray polyCounts, polyVertices;
+    meshFn.getVertices(polyCounts, polyVertices);
+    status = meshFn.setColors(colors, &colorSet_);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    return meshFn.assignColors(polyVertices, &colorSet_);
+}
+
+MStatus blurSkinAnalyzeCmd::redoIt() {
+    MStatus status;
+    MFnMesh meshFn(shapePath_, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    MStringArray colorSets;
+    meshFn.getColorSetNames(colorSets);
+    if (colorSets.indexOf(colorSet_) == -1) meshFn.createColorSetWithName(colorSet_);
+    status = setColors(redoColors_);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    meshFn.setCurrentColorSetName(colorSet_);
+    meshFn.findPlug("displayColors", false).setBool(true);
+    return status;
+}
+
+MStatus blurSkinAnalyzeCmd::undoIt() {
+    MStatus status;
+    MFnMesh meshFn(shapePath_, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    meshFn.findPlug("displayColors", false).setBool(previousDisplayColors_);
+    if (previousColorSet_.length() > 0 && previousColorSet_ != colorSet_)
+        meshFn.setCurrentColorSetName(previousColorSet_);
+    if (createdColorSet_) return meshFn.deleteColorSet(colorSet_);
+    return setColors(undoColors_);
+}
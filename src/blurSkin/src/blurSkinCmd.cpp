@@ -42,6 +42,9 @@ const char* blurSkinCmd::kRepeatFlagLong = "-repeat";
 const char* blurSkinCmd::kDepthFlagShort = "-d";
 const char* blurSkinCmd::kDepthFlagLong = "-depth";
 
+const char* blurSkinCmd::kDiffusionTimeFlagShort = "-dt";
+const char* blurSkinCmd::kDiffusionTimeFlagLong = "-diffusionTime";
+
 const char* blurSkinCmd::kRespectLocksFlagShort = "-rl";
 const char* blurSkinCmd::kRespectLocksFlagLong = "-respectLocks";
 
@@ -77,10 +80,12 @@ void DisplayHelp() {
     help += "-listJointsValues    -ljw   Doubles    List joints weights\n";
     help += "-repeat              -rp    Int        Repeat the calculation             default 1\n";
     help += "-depth               -d     Int        Depth for the smooth               default 1\n";
+    help += "-diffusionTime       -dt    Double     Width of the diffuse smooth        default 10.\n";
     help += "-respectLocks        -rl    N/A        Respect locks                      default True\n";
     help += "-zeroInfluences      -zi    N/A        Get zero columns \n";
     help += "-command             -c     N/A        The command action correct inputs are :\n";
     help += "                                          smooth - add - absolute - percentage - average - colors - prune\n";
+    help += "                                          diffuse - implicit smooth of the whole selection\n";
     help += "-threshold           -th    Double     Threshold for the prune weights\n";
     help += "-help                -h     N/A        Display this text.\n";
     MGlobal::displayInfo(help);
@@ -113,6 +118,7 @@ MSyntax blurSkinCmd::newSyntax() {
 
     syntax.addFlag(kRepeatFlagShort, kRepeatFlagLong, MSyntax::kLong);
     syntax.addFlag(kDepthFlagShort, kDepthFlagLong, MSyntax::kLong);
+    syntax.addFlag(kDiffusionTimeFlagShort, kDiffusionTimeFlagLong, MSyntax::kDouble);
     syntax.addFlag(kRespectLocksFlagShort, kRespectLocksFlagLong);
     syntax.addFlag(kThresholdFlagShort, kThresholdFlagLong, MSyntax::kDouble);
     syntax.addFlag(kZeroInfluencesFlagShort, kZeroInfluencesFlagLong);
@@ -130,6 +136,7 @@ blurSkinCmd::blurSkinCmd()
       percentMvt_(1.0),
       indSkinCluster_(0),
       threshold_(0.0001),
+      diffusionTime_(10.0),
       respectLocks_(true),
       verbose(false) {}
 
@@ -231,6 +238,13 @@ MStatus blurSkinCmd::printWeight(int vertex, int u, int v) {
 MStatus blurSkinCmd::getAverageWeight(MIntArray vertices, int currentVertex) {
     if (verbose) MGlobal::displayInfo(MString(" ---- getAverageWeight ----"));
     if (verbose) MGlobal::displayInfo(MString("nbJoints ") + nbJoints);
+    verticesAround_.resize(vertices.length());
+    for (unsigned int k = 0; k < vertices.length(); ++k) verticesAround_[k] = vertices[k];
+    if (setAverageWeightSparse(verticesAround_.data(), (int)verticesAround_.size(), currentVertex,
+                               currentVertex, nbJoints, lockJoints, currentWeights, weightRows_,
+                               newWeights, 1.0, maxInfluences_))
+        return MS::kSuccess;
+    // too many influences around for the sparse smooth, dense average
     MStatus stat;
     int sizeVertices = vertices.length();
     int i, j, posi;
@@ -285,7 +299,123 @@ MStatus blurSkinCmd::getAverageWeight(MIntArray vertices, int currentVertex) {
                 newWeights.set(targetW, posiToSet);
             }
         }
+        pruneRowToMaxInfluences(newWeights, currentVertex * nbJoints, nbJoints, lockJoints,
+                                maxInfluences_);
+    }
+    return MS::kSuccess;
+}
+
+MStatus blurSkinCmd::diffuseWeights() {
+    if (verbose) MGlobal::displayInfo(MString(" ---- diffuseWeights ----"));
+    MStatus stat;
+    int nbVertices = currentWeights.length() / nbJoints;
+
+    // unknowns are the unlocked vertices of the selection, everything else is a constraint
+    std::vector<int> localIndex(nbVertices, -1);
+    std::vector<int> freeVertices;
+    for (unsigned int i = 0; i < indicesVertices_.length(); ++i) {
+        int index = indicesVertices_[i];
+        if (index >= nbVertices || lockVertices_[index] == 1 || localIndex[index] != -1) continue;
+        localIndex[index] = (int)freeVertices.size();
+        freeVertices.push_back(index);
+    }
+    int nbFree = (int)freeVertices.size();
+    if (nbFree == 0) return MS::kSuccess;
+
+    // assemble I + tL once, the constrained neighbors go to the right hand side
+    std::vector<int> rows(1, 0), columns, boundaryRows(1, 0), boundaryVertices;
+    std::vector<double> values;
+    MIntArray vertices;
+    MObject allComponents;
+    MItMeshVertex itVertex(meshPath_, allComponents, &stat);  // unused on nurbs
+    int prevIndex;
+    for (int i = 0; i < nbFree; ++i) {
+        int index = freeVertices[i];
+        vertices.clear();
+        if (isMeshSurface_) {
+            itVertex.setIndex(index, prevIndex);
+            itVertex.getConnectedVertices(vertices);
+        } else if (isNurbsSurface_) {
+            CVsAround(index / numCVsInV_, index % numCVsInV_, numCVsInU_, numCVsInV_,
+                      UIsPeriodic_, VIsPeriodic_, vertices);
+        }
+        int degree = 0;
+        columns.push_back(i);
+        values.push_back(1.0);
+        int diagonalPosition = (int)values.size() - 1;
+        for (unsigned int k = 0; k < vertices.length(); ++k) {
+            int neighbor = vertices[k];
+            if (neighbor == index || neighbor >= nbVertices) continue;
+            ++degree;
+            if (localIndex[neighbor] != -1) {
+                columns.push_back(localIndex[neighbor]);
+                values.push_back(-diffusionTime_);
+            } else {
+                boundaryVertices.push_back(neighbor);
+            }
+        }
+        values[diagonalPosition] += diffusionTime_ * degree;
+        rows.push_back((int)columns.size());
+        boundaryRows.push_back((int)boundaryVertices.size());
     }
+
+    std::vector<int> freeInfluences;
+    for (int j = 0; j < nbJoints; ++j) {
+        if (lockJoints[j] != 1) freeInfluences.push_back(j);
+    }
+    int nbInfluences = (int)freeInfluences.size();
+    std::vector<std::vector<double>> solutions(nbInfluences);
+    std::vector<int> iterations(nbInfluences, 0);
+    const MDoubleArray& origWeights = currentWeights;
+
+    // influences are independent solves
+#pragma omp parallel for
+    for (int f = 0; f < nbInfluences; ++f) {
+        int j = freeInfluences[f];
+        std::vector<double>& solution = solutions[f];
+        std::vector<double> rhs(nbFree);
+        solution.resize(nbFree);
+        bool allZero = true;
+        for (int i = 0; i < nbFree; ++i) {
+            double value = origWeights[freeVertices[i] * nbJoints + j];
+            double boundary = 0.0;
+            for (int k = boundaryRows[i]; k < boundaryRows[i + 1]; ++k)
+                boundary += origWeights[boundaryVertices[k] * nbJoints + j];
+            rhs[i] = value + diffusionTime_ * boundary;
+            solution[i] = value;
+            if (rhs[i] != 0.0) allZero = false;
+        }
+        if (allZero) continue;
+        iterations[f] = solveConjugateGradient(rows, columns, values, rhs, solution,
+                                               DIFFUSE_TOLERANCE, DIFFUSE_MAX_ITERATIONS);
+    }
+    if (verbose) {
+        int maxIterations = 0;
+        for (int f = 0; f < nbInfluences; ++f) maxIterations = std::max(maxIterations, iterations[f]);
+        MGlobal::displayInfo(MString("    diffuse ") + nbFree + MString(" vertices ") +
+                             nbInfluences + MString(" influences, max iterations ") +
+                             maxIterations);
+    }
+
+    // renormalize, locked influences keep their weight
+    for (int i = 0; i < nbFree; ++i) {
+        int index = freeVertices[i];
+        double totalLock = 0.0, totalUnlock = 0.0;
+        for (int j = 0; j < nbJoints; ++j) {
+            if (lockJoints[j] == 1) totalLock += currentWeights[index * nbJoints + j];
+        }
+        for (int f = 0; f < nbInfluences; ++f) {
+            double& value = solutions[f][i];
+            if (value < 0.0) value = 0.0;
+            totalUnlock += value;
+        }
+        double normalizedValueAvailable = 1.0 - totalLock;
+        if (normalizedValueAvailable <= 0.0 || totalUnlock <= 0.0) continue;
+        double mult = normalizedValueAvailable / totalUnlock;
+        for (int f = 0; f < nbInfluences; ++f)
+            newWeights.set(solutions[f][i] * mult, index * nbJoints + freeInfluences[f]);
+    }
+    currentWeights.copy(newWeights);
     return MS::kSuccess;
 }
 
@@ -628,6 +758,12 @@ MStatus blurSkinCmd::getAllWeights() {
 
     currentWeights.copy(fullOrigWeights);
     newWeights.copy(fullOrigWeights);
+
+    // the smooth stays within the influence budget of the skinCluster
+    maxInfluences_ = 0;
+    MPlug maintainInflPlug = theSkinCluster.findPlug("maintainMaxInfluences", false, &stat);
+    if (stat == MS::kSuccess && maintainInflPlug.asBool())
+        maxInfluences_ = theSkinCluster.findPlug("maxInfluences", false).asInt();
     return MS::kSuccess;
 }
 
@@ -693,6 +829,8 @@ MStatus blurSkinCmd::GatherCommandArguments(const MArgList& args) {
             command_ = kCommandSetColors;
         else if (commandStringName == "prune")
             command_ = kCommandPruneWeights;
+        else if (commandStringName == "diffuse")
+            command_ = kCommandDiffuse;
     }
     // overwrites commands
     // --------------------------------------------------------------------------
@@ -715,6 +853,9 @@ MStatus blurSkinCmd::GatherCommandArguments(const MArgList& args) {
     if (argData.isFlagSet(kDepthFlagShort))
         depth_ = argData.flagArgumentInt(kDepthFlagShort, 0, &status);
 
+    if (argData.isFlagSet(kDiffusionTimeFlagShort))
+        diffusionTime_ = argData.flagArgumentDouble(kDiffusionTimeFlagShort, 0, &status);
+
     if (argData.isFlagSet(kRespectLocksFlagShort))
         respectLocks_ = argData.flagArgumentBool(kRespectLocksFlagShort, 0, &status);
 
@@ -1009,12 +1150,16 @@ MStatus blurSkinCmd::executeAction() {
             }
         }
         currentWeights.copy(newWeights);
+    } else if (command_ == kCommandDiffuse) {
+        stat = diffuseWeights();
+        if (stat == MS::kFailure) return MS::kFailure;
     } else if (isNurbsSurface_) {
         int index, storedU, storedV;
         MIntArray vertices;
 
         for (int r = 0; r < repeat_; r++) {
             if (verbose) MGlobal::displayInfo(MString("repeat nb :") + r);
+            weightRows_.clear();  // currentWeights changed
             for (int i = 0; i < indicesVertices_.length(); ++i) {
                 index = indicesVertices_[i];
                 if (lockVertices_[index] != 1) {  // if not locked
@@ -1050,6 +1195,7 @@ MStatus blurSkinCmd::executeAction() {
         int prevIndex;
         // repeat the function
         for (int r = 0; r < repeat_; r++) {
+            weightRows_.clear();  // currentWeights changed
             while (!itVertex.isDone()) {
                 int currentVertex = itVertex.index();
                 if (lockVertices_[currentVertex] != 1) {  // if not locked
@@ -269,7 +269,7 @@ MStatus blurSkinDisplay::compute(const MPlug& plug, MDataBlock& dataBlock) {
                 if (verbose) MGlobal::displayInfo(MString("      --> INIT"));
                 this->fullVvertexList.setLength(this->nbVertices);
                 for (int i = 0; i < this->nbVertices; ++i) this->fullVvertexList[i] = i;
-                this->paintedValues = MDoubleArray(this->nbVertices, 0);
+                resetPaintedValues(this->nbVertices);
                 if (verbose)
                     MGlobal::displayInfo(
                         MString("          set COLORS "));  // beginning opening of node
@@ -363,47 +363,17 @@ MStatus blurSkinDisplay::compute(const MPlug& plug, MDataBlock& dataBlock) {
                         if (this->autoExpand && this->postSetting) {  // not asking refresh of skin
                             if (verbose)
                                 MGlobal::displayInfo("            --> auto Expand on postSetting ");
-                            for (int k = 0; k < this->nbAutoExpand; ++k) {
-                                double threshold = .6;
-                                std::unordered_set<int> toFixVtx;
-                                for (unsigned int i = 0; i < this->paintedValues.length(); i++) {
-                                    if (this->paintedValues[i] > threshold) {
-                                        MIntArray vertsAround = this->connectedVertices[i];
-                                        for (int j = 0; j < vertsAround.length(); ++j) {
-                                            int theVertAround = vertsAround[j];
-                                            if (this->paintedValues[theVertAround] <= 0.05) {
-                                                toFixVtx.insert(theVertAround);
-                                            }
-                                        }
-                                    }
-                                }
-                                MIntArray vtxToFix;
-                                for (int vtx : toFixVtx) vtxToFix.append(vtx);
-                                for (int i = 0; i < vtxToFix.length(); ++i) {
-                                    int vtx = vtxToFix[i];
-                                    MIntArray vertsAround = this->connectedVertices[vtx];
-                                    double newVal = 0.0;
-                                    int nbAround = 0;
-                                    for (int j = 0; j < vertsAround.length(); ++j) {
-                                        int theVertAround = vertsAround[j];
-                                        if (toFixVtx.find(theVertAround) == toFixVtx.end()) {
-                                            nbAround++;
-                                            newVal += this->paintedValues[theVertAround];
-                                        }
-                                    }
-                                    newVal /= nbAround;
-                                    this->paintedValues[vtx] = newVal;
-                                }
-                            }
+                            autoExpandPaintedValues();
                         }
-                        // now set the values -----
-                        for (unsigned int i = 0; i < this->paintedValues.length(); i++) {
+                        // now set the values, only the painted vertices are visited -----
+                        std::sort(this->touchedVertices.begin(), this->touchedVertices.end());
+                        for (int i : this->touchedVertices) {
                             if (this->paintedValues[i] != 0) {  // not zero ----
                                 editVertsIndices.append(i);
                                 editVertsWeights.append(this->paintedValues[i]);
-                                this->paintedValues[i] = 0.0;
                             }
                         }
+                        clearPaintedValues();
                         // store the mirror values
                         if (this->mirrorIsActive) {
                             int mirrorInfluenceIndex = this->mirrorInfluences[this->influenceIndex];
@@ -565,12 +535,13 @@ MStatus blurSkinDisplay::compute(const MPlug& plug, MDataBlock& dataBlock) {
                     MObject dataObj = dataBlock.inputValue(_paintableAttr).data();
                     arrayData.setObject(dataObj);
 
-                    unsigned int length = arrayData.length();
+                    unsigned int length =
+                        std::min(arrayData.length(), (unsigned int)this->paintedValues.size());
                     for (unsigned int i = 0; i < length; i++) {
                         double val = arrayData[i];
                         if (val > 0.0) {
                             if (this->commandIndex >= 6) {
-                                if (this->paintedValues[i] != 1) {  // painting locks
+                                if (getPaintedValue(i) != 1) {  // painting locks
                                     bool doStoreLock =
                                         (this->commandIndex == 6 && !this->lockVertices[i]) ||
                                         (this->commandIndex == 7 && this->lockVertices[i]);
@@ -588,18 +559,18 @@ MStatus blurSkinDisplay::compute(const MPlug& plug, MDataBlock& dataBlock) {
                                         }
                                         editVertsIndices.append(i);
                                         editVertsWeights.append(1.0);
-                                        this->paintedValues[i] = 1;  // store to not repaint
+                                        setPaintedValue(i, 1);  // store to not repaint
                                     }
                                 }
                             } else if (!this->lockVertices[i]) {
                                 if (val !=
-                                    this->paintedValues[i]) {  // not already painted and not locked
+                                    getPaintedValue(i)) {  // not already painted and not locked
                                     // only if other zone painted ----------
                                     val = std::max(0.0, std::min(val, 1.0));  // clamp
 
                                     editVertsIndices.append(i);
                                     editVertsWeights.append(val);
-                                    this->paintedValues[i] = val;  // store to not repaint
+                                    setPaintedValue(i, val);  // store to not repaint
                                     // MGlobal::displayInfo(MString(" paint value ") + i + MString("
                                     // - ") + val);
 
@@ -805,6 +776,96 @@ void blurSkinDisplay::getConnectedVertices(MObject& outMesh, int nbVertices) {
         vertexIter.getConnectedFaces(surroundingFaces);
         connectedFaces[vtxTmp] = surroundingFaces;
     }
+    // flat copy for the autoExpand walks
+    adjacencyStarts.assign(nbVertices + 1, 0);
+    for (int vtx = 0; vtx < nbVertices; ++vtx)
+        adjacencyStarts[vtx + 1] = adjacencyStarts[vtx] + connectedVertices[vtx].length();
+    adjacencyIndices.resize(adjacencyStarts[nbVertices]);
+    for (int vtx = 0; vtx < nbVertices; ++vtx) {
+        const MIntArray& vertsAround = connectedVertices[vtx];
+        for (unsigned int j = 0; j < vertsAround.length(); ++j)
+            adjacencyIndices[adjacencyStarts[vtx] + j] = vertsAround[j];
+    }
+}
+
+void blurSkinDisplay::resetPaintedValues(int nbVertices) {
+    paintedValues.assign(nbVertices, 0.0);
+    paintedGeneration.assign(nbVertices, 0);
+    expandMark.assign(nbVertices, 0);
+    touchedVertices.clear();
+    currentGeneration = 1;
+    expandStamp = 0;
+}
+
+void blurSkinDisplay::setPaintedValue(int vertexIndex, double value) {
+    if (paintedGeneration[vertexIndex] != currentGeneration) {
+        paintedGeneration[vertexIndex] = currentGeneration;
+        touchedVertices.push_back(vertexIndex);
+    }
+    paintedValues[vertexIndex] = value;
+}
+
+void blurSkinDisplay::clearPaintedValues() {
+    // a new generation zeroes every value, the array is only really reset when it wraps
+    touchedVertices.clear();
+    if (++currentGeneration == 0) resetPaintedValues((int)paintedValues.size());
+}
+
+void blurSkinDisplay::autoExpandPaintedValues() {
+    // fills the unpainted vertices next to the strongly painted ones with the average of their
+    // painted neighbors. Only the border of the stroke is walked: a vertex whose neighbors are all
+    // painted can't get new vertices to fix, it leaves the frontier
+    const double threshold = .6;
+    const double unpainted = 0.05;
+    auto hasUnpaintedNeighbor = [&](int vtx) {
+        for (int j = adjacencyStarts[vtx]; j < adjacencyStarts[vtx + 1]; ++j)
+            if (getPaintedValue(adjacencyIndices[j]) <= unpainted) return true;
+        return false;
+    };
+    std::vector<int> frontier, toFixVtx, nextFrontier;
+    for (int vtx : touchedVertices)
+        if (paintedValues[vtx] > threshold) frontier.push_back(vtx);
+
+    for (int k = 0; k < this->nbAutoExpand && !frontier.empty(); ++k) {
+        if (++expandStamp == 0) {
+            std::fill(expandMark.begin(), expandMark.end(), 0);
+            expandStamp = 1;
+        }
+        toFixVtx.clear();
+        for (int vtx : frontier) {
+            for (int j = adjacencyStarts[vtx]; j < adjacencyStarts[vtx + 1]; ++j) {
+                int theVertAround = adjacencyIndices[j];
+                if (expandMark[theVertAround] != expandStamp &&
+                    getPaintedValue(theVertAround) <= unpainted) {
+                    expandMark[theVertAround] = expandStamp;
+                    toFixVtx.push_back(theVertAround);
+                }
+            }
+        }
+        // the averages only read vertices that are not fixed in this iteration
+        std::vector<double> newValues(toFixVtx.size(), 0.0);
+        for (size_t i = 0; i < toFixVtx.size(); ++i) {
+            int vtx = toFixVtx[i];
+            int nbAround = 0;
+            for (int j = adjacencyStarts[vtx]; j < adjacencyStarts[vtx + 1]; ++j) {
+                int theVertAround = adjacencyIndices[j];
+                if (expandMark[theVertAround] != expandStamp) {
+                    nbAround++;
+                    newValues[i] += getPaintedValue(theVertAround);
+                }
+            }
+            if (nbAround > 0) newValues[i] /= nbAround;
+        }
+        for (size_t i = 0; i < toFixVtx.size(); ++i) setPaintedValue(toFixVtx[i], newValues[i]);
+
+        nextFrontier.clear();
+        for (int vtx : frontier)
+            if (hasUnpaintedNeighbor(vtx)) nextFrontier.push_back(vtx);
+        for (int vtx : toFixVtx)
+            if (paintedValues[vtx] > threshold && hasUnpaintedNeighbor(vtx))
+                nextFrontier.push_back(vtx);
+        frontier.swap(nextFrontier);
+    }
 }
 
 void blurSkinDisplay::refreshVertsConnection() {
@@ -1343,25 +1404,24 @@ MStatus blurSkinDisplay::connectionBroken(const MPlug& plug, const MPlug& otherP
     return MS::kUnknownParameter;
 };
 
-MStatus blurSkinDisplay::setDependentsDirty(const MPlug& plugBeingDirtied,
-                                            MPlugArray& affectedPlugs) {
-    MStatus status;
-    MObject thisNode = thisMObject();
-    MFnDependencyNode fnThisNode(thisNode);
-    this->changeOfMirrorData =
+bool blurSkinDisplay::markDirtyPlug(const MPlug& plugBeingDirtied) {
+    // the flags are or-ed, several inputs can be dirty for one evaluation
+    bool mirrorDirty =
         plugBeingDirtied == _mirrorActive || plugBeingDirtied == _mirrorInfluenceArray;
+    this->changeOfMirrorData = this->changeOfMirrorData || mirrorDirty;
 
-    this->reloadCommand = plugBeingDirtied == _commandAttr || plugBeingDirtied == _influenceAttr ||
-                          plugBeingDirtied == _smoothRepeat || plugBeingDirtied == _smoothDepth ||
-                          plugBeingDirtied == _postSetting || plugBeingDirtied == _colorType ||
-                          plugBeingDirtied == _cpList || plugBeingDirtied == _getLockWeights ||
-                          plugBeingDirtied == _soloColorType || plugBeingDirtied == _minSoloColor ||
-                          plugBeingDirtied == _maxSoloColor || this->changeOfMirrorData ||
-                          plugBeingDirtied == _normalize || plugBeingDirtied == _autoExpandAttr;
+    this->reloadCommand =
+        this->reloadCommand || plugBeingDirtied == _commandAttr ||
+        plugBeingDirtied == _influenceAttr || plugBeingDirtied == _smoothRepeat ||
+        plugBeingDirtied == _smoothDepth || plugBeingDirtied == _postSetting ||
+        plugBeingDirtied == _colorType || plugBeingDirtied == _cpList ||
+        plugBeingDirtied == _getLockWeights || plugBeingDirtied == _soloColorType ||
+        plugBeingDirtied == _minSoloColor || plugBeingDirtied == _maxSoloColor || mirrorDirty ||
+        plugBeingDirtied == _normalize || plugBeingDirtied == _autoExpandAttr;
 
-    this->clearTheArray = (plugBeingDirtied == _clearArray);
-    this->callUndo = (plugBeingDirtied == _callUndo);
-    this->inputVerticesChanged = (plugBeingDirtied == _cpList);
+    this->clearTheArray = this->clearTheArray || (plugBeingDirtied == _clearArray);
+    this->callUndo = this->callUndo || (plugBeingDirtied == _callUndo);
+    this->inputVerticesChanged = this->inputVerticesChanged || (plugBeingDirtied == _cpList);
 
     if (!(plugBeingDirtied == _paintableAttr || this->reloadCommand || this->clearTheArray ||
           this->callUndo)) {
@@ -1382,9 +1442,41 @@ MStatus blurSkinDisplay::setDependentsDirty(const MPlug& plugBeingDirtied,
     if ((plugBeingDirtied == _paintableAttr) || this->reloadCommand || this->clearTheArray ||
         this->callUndo || this->changedColorInfluence) {
         this->applyPaint = true;
-        MPlug outMeshPlug(thisNode, blurSkinDisplay::_outMesh);
+        return true;
+    }
+    return false;
+}
+
+MStatus blurSkinDisplay::setDependentsDirty(const MPlug& plugBeingDirtied,
+                                            MPlugArray& affectedPlugs) {
+    // only the last dirtied input is kept
+    this->changeOfMirrorData = false;
+    this->reloadCommand = false;
+    this->clearTheArray = false;
+    this->callUndo = false;
+    this->inputVerticesChanged = false;
+    if (markDirtyPlug(plugBeingDirtied)) {
+        MPlug outMeshPlug(thisMObject(), blurSkinDisplay::_outMesh);
         affectedPlugs.append(outMeshPlug);
     }
     return (MS::kSuccess);
 }
 
+MStatus blurSkinDisplay::preEvaluation(const MDGContext& context,
+                                       const MEvaluationNode& evaluationNode) {
+    MStatus status;
+    // cached playback evaluates in other contexts, the paint state is for the current one only
+    if (!context.isNormal()) return MS::kSuccess;
+
+    this->changeOfMirrorData = false;
+    this->reloadCommand = false;
+    this->clearTheArray = false;
+    this->callUndo = false;
+    this->inputVerticesChanged = false;
+    for (MEvaluationNodeIterator dirtyIt = evaluationNode.iterator(&status); !dirtyIt.isDone();
+         dirtyIt.next()) {
+        markDirtyPlug(dirtyIt.plug());
+    }
+    return status;
+}
+
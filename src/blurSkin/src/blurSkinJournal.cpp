@@ -0,0 +1,216 @@
+#include "blurSkinJournal.h"
+
+#include <maya/MFnDependencyNode.h>
+#include <maya/MPlug.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "functions.h"
+
+const char* blurSkinJournalCmd::kSkinClusterNameFlagShort = "-skn";
+const char* blurSkinJournalCmd::kSkinClusterNameFlagLong = "-skinCluster";
+const char* blurSkinJournalCmd::kMeshNameFlagShort = "-mn";
+const char* blurSkinJournalCmd::kMeshNameFlagLong = "-meshName";
+const char* blurSkinJournalCmd::kVersionFlagShort = "-v";
+const char* blurSkinJournalCmd::kVersionFlagLong = "-version";
+const char* blurSkinJournalCmd::kChangedSinceFlagShort = "-cs";
+const char* blurSkinJournalCmd::kChangedSinceFlagLong = "-changedSince";
+const char* blurSkinJournalCmd::kStopFlagShort = "-st";
+const char* blurSkinJournalCmd::kStopFlagLong = "-stop";
+const char* blurSkinJournalCmd::kVerboseFlagShort = "-vrb";
+const char* blurSkinJournalCmd::kVerboseFlagLong = "-verbose";
+const char* blurSkinJournalCmd::kHelpFlagShort = "-h";
+const char* blurSkinJournalCmd::kHelpFlagLong = "-help";
+
+static void DisplayJournalHelp() {
+    MString help;
+    help += "Flags:\n";
+    help += "-skinCluster         -skn   String     Name of the skinCluster\n";
+    help += "-meshName            -mn    String     Name of the mesh if skincluster is not passed\n";
+    help += "                                          If -skn and -mn are not passed uses selection\n";
+    help += "-version             -v     N/A        Return the current version, starts the journal\n";
+    help += "-changedSince        -cs    Int        Return the vertices changed since this version\n";
+    help += "                                          [-1] if the journal does not go back that far\n";
+    help += "-stop                -st    N/A        Stop the journal of the skinCluster\n";
+    help += "-verbose             -vrb   Bool       Verbose print\n";
+    help += "-help                -h     N/A        Display this text.\n";
+    MGlobal::displayInfo(help);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Journal
+// ------------------------------------------------------------------------------------------------
+static std::vector<SkinClusterJournal*> journals;
+
+SkinClusterJournal::SkinClusterJournal(MObject& skinCluster) : handle_(skinCluster) {
+    MStatus status;
+    MFnDependencyNode skinClusterDep(skinCluster);
+    weightListAttr_ = skinClusterDep.attribute("weightList");
+    weightsAttr_ = skinClusterDep.attribute("weights");
+    MCallbackId callbackId = MNodeMessage::addAttributeChangedCallback(
+        skinCluster, SkinClusterJournal::weightsChangedCallback, this, &status);
+    if (status == MS::kSuccess) callbackIds_.append(callbackId);
+}
+
+SkinClusterJournal::~SkinClusterJournal() {
+    if (callbackIds_.length() > 0) MMessage::removeCallbacks(callbackIds_);
+}
+
+void SkinClusterJournal::weightsChangedCallback(MNodeMessage::AttributeMessage msg, MPlug& plug,
+                                                MPlug&, void* clientData) {
+    if (!(msg & (MNodeMessage::kAttributeSet | MNodeMessage::kAttributeArrayAdded |
+                 MNodeMessage::kAttributeArrayRemoved)))
+        return;
+    SkinClusterJournal* journal = static_cast<SkinClusterJournal*>(clientData);
+    // called for every plug set, only store the vertex index
+    MObject attr = plug.attribute();
+    if (attr == journal->weightsAttr_) {
+        // weightList[v].weights[j] or weightList[v].weights
+        MPlug weightsPlug = plug.isElement() ? plug.array() : plug;
+        MPlug weightListPlug = weightsPlug.parent();
+        if (weightListPlug.isElement()) journal->pending_.insert(weightListPlug.logicalIndex());
+    } else if (attr == journal->weightListAttr_) {
+        if (plug.isElement()) journal->pending_.insert(plug.logicalIndex());
+    }
+}
+
+void SkinClusterJournal::flushPending() {
+    if (pending_.empty()) return;
+    ++version_;
+    // the set is sorted, merge consecutive vertices
+    JournalRange range = {version_, -1, 0};
+    for (int vertexIndex : pending_) {
+        if (range.vertexCount > 0 && vertexIndex == range.firstVertex + range.vertexCount) {
+            ++range.vertexCount;
+            continue;
+        }
+        if (range.vertexCount > 0) ranges_.push_back(range);
+        range.firstVertex = vertexIndex;
+        range.vertexCount = 1;
+    }
+    ranges_.push_back(range);
+    pending_.clear();
+
+    // bounded, drop the oldest versions
+    while (ranges_.size() > JOURNAL_MAX_RANGES) {
+        droppedVersion_ = ranges_.front().version;
+        ranges_.pop_front();
+    }
+}
+
+int SkinClusterJournal::version() {
+    flushPending();
+    return version_;
+}
+
+bool SkinClusterJournal::changedSince(int sinceVersion, MIntArray& vertices) {
+    flushPending();
+    vertices.clear();
+    // a version newer than the journal comes from a previous journal of this skinCluster
+    if (sinceVersion < droppedVersion_ || sinceVersion > version_) return false;
+
+    std::vector<int> changed;
+    // ranges are ordered by version, walk back from the newest
+    for (auto it = ranges_.rbegin(); it != ranges_.rend() && it->version > sinceVersion; ++it) {
+        for (int i = 0; i < it->vertexCount; ++i) changed.push_back(it->firstVertex + i);
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    vertices.setLength((unsigned int)changed.size());
+    for (unsigned int i = 0; i < changed.size(); ++i) vertices[i] = changed[i];
+    return true;
+}
+
+SkinClusterJournal* getSkinClusterJournal(MObject& skinCluster) {
+    // drop the journals of deleted skinClusters
+    for (auto it = journals.begin(); it != journals.end();) {
+        if (!(*it)->isValid()) {
+            delete *it;
+            it = journals.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (SkinClusterJournal* journal : journals) {
+        if (journal->isSkinCluster(skinCluster)) return journal;
+    }
+    SkinClusterJournal* journal = new SkinClusterJournal(skinCluster);
+    journals.push_back(journal);
+    return journal;
+}
+
+void stopSkinClusterJournal(MObject& skinCluster) {
+    for (auto it = journals.begin(); it != journals.end(); ++it) {
+        if ((*it)->isValid() && (*it)->isSkinCluster(skinCluster)) {
+            delete *it;
+            journals.erase(it);
+            return;
+        }
+    }
+}
+
+void clearSkinClusterJournals() {
+    for (SkinClusterJournal* journal : journals) delete journal;
+    journals.clear();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Command
+// ------------------------------------------------------------------------------------------------
+void* blurSkinJournalCmd::creator() { return new blurSkinJournalCmd(); }
+
+MSyntax blurSkinJournalCmd::newSyntax() {
+    MSyntax syntax;
+    syntax.addFlag(kSkinClusterNameFlagShort, kSkinClusterNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kMeshNameFlagShort, kMeshNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kVersionFlagShort, kVersionFlagLong);
+    syntax.addFlag(kChangedSinceFlagShort, kChangedSinceFlagLong, MSyntax::kLong);
+    syntax.addFlag(kStopFlagShort, kStopFlagLong);
+    syntax.addFlag(kVerboseFlagShort, kVerboseFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kHelpFlagShort, kHelpFlagLong);
+    return syntax;
+}
+
+MStatus blurSkinJournalCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kHelpFlagShort)) {
+        DisplayJournalHelp();
+        return MS::kSuccess;
+    }
+    if (argData.isFlagSet(kVerboseFlagShort))
+        verbose = argData.flagArgumentBool(kVerboseFlagShort, 0, &status);
+    if (argData.isFlagSet(kSkinClusterNameFlagShort))
+        skinClusterName_ = argData.flagArgumentString(kSkinClusterNameFlagShort, 0, &status);
+    if (argData.isFlagSet(kMeshNameFlagShort))
+        meshName_ = argData.flagArgumentString(kMeshNameFlagShort, 0, &status);
+
+    MObject skinCluster;
+    MDagPath shapePath;
+    status = getSkinClusterAndShape(skinClusterName_, meshName_, skinCluster, shapePath, verbose);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kStopFlagShort)) {
+        stopSkinClusterJournal(skinCluster);
+        return MS::kSuccess;
+    }
+
+    SkinClusterJournal* journal = getSkinClusterJournal(skinCluster);
+    if (argData.isFlagSet(kChangedSinceFlagShort)) {
+        int sinceVersion = argData.flagArgumentInt(kChangedSinceFlagShort, 0, &status);
+        MIntArray vertices;
+        if (!journal->changedSince(sinceVersion, vertices)) {
+            if (verbose)
+                MGlobal::displayInfo(MString("journal does not go back to version ") +
+                                     sinceVersion + MString(", full reload needed"));
+            vertices = MIntArray(1, -1);
+        }
+        setResult(vertices);
+        return MS::kSuccess;
+    }
+    setResult(journal->version());
+    return MS::kSuccess;
+}
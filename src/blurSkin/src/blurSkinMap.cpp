@@ -0,0 +1,358 @@
+#include "blurSkinMap.h"
+
+#include <maya/MFloatArray.h>
+#include <maya/MFnMesh.h>
+#include <maya/MSelectionList.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#ifdef BLURSKIN_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "functions.h"
+
+const char* blurSkinMapCmd::kAttributeFlagShort = "-att";
+const char* blurSkinMapCmd::kAttributeFlagLong = "-attribute";
+const char* blurSkinMapCmd::kMeshNameFlagShort = "-mn";
+const char* blurSkinMapCmd::kMeshNameFlagLong = "-meshName";
+const char* blurSkinMapCmd::kVerticesFlagShort = "-vtx";
+const char* blurSkinMapCmd::kVerticesFlagLong = "-vertices";
+const char* blurSkinMapCmd::kImportFileFlagShort = "-if";
+const char* blurSkinMapCmd::kImportFileFlagLong = "-importFile";
+const char* blurSkinMapCmd::kUvRampFlagShort = "-uv";
+const char* blurSkinMapCmd::kUvRampFlagLong = "-uvRamp";
+const char* blurSkinMapCmd::kNormalizeFlagShort = "-nrm";
+const char* blurSkinMapCmd::kNormalizeFlagLong = "-normalize";
+const char* blurSkinMapCmd::kOppositeFlagShort = "-opp";
+const char* blurSkinMapCmd::kOppositeFlagLong = "-opposite";
+const char* blurSkinMapCmd::kSmoothFlagShort = "-sm";
+const char* blurSkinMapCmd::kSmoothFlagLong = "-smooth";
+const char* blurSkinMapCmd::kRemapFlagShort = "-rmp";
+const char* blurSkinMapCmd::kRemapFlagLong = "-remap";
+const char* blurSkinMapCmd::kClampFlagShort = "-cl";
+const char* blurSkinMapCmd::kClampFlagLong = "-clamp";
+const char* blurSkinMapCmd::kVerboseFlagShort = "-vrb";
+const char* blurSkinMapCmd::kVerboseFlagLong = "-verbose";
+const char* blurSkinMapCmd::kHelpFlagShort = "-h";
+const char* blurSkinMapCmd::kHelpFlagLong = "-help";
+
+static void DisplayMapHelp() {
+    MString help;
+    help += "Flags:\n";
+    help += "-attribute           -att   String     The map, node.weightList[0].weights,\n";
+    help += "                                          node.inputTarget[0].baseWeights ...\n";
+    help += "-meshName            -mn    String     Shape of the map, default the selection\n";
+    help += "-vertices            -vtx   Int        Vertices to edit (multi use), default all\n";
+    help += "-importFile          -if    String     One value per vertex text file, or .gz\n";
+    help += "-uvRamp              -uv    String     Sets the map to the u or v of the vertices\n";
+    help += "-normalize           -nrm   Bool       Ramp from 0 to 1 on the vertices edited\n";
+    help += "-opposite            -opp   Bool       Ramp from 1 to 0\n";
+    help += "-smooth              -sm    Int        Number of smooth iterations\n";
+    help += "-remap               -rmp   Double x4  Old min, old max, new min, new max\n";
+    help += "-clamp               -cl    Double x2  Min and max of the values\n";
+    help += "-verbose             -vrb   Bool       Verbose print\n";
+    help += "-help                -h     N/A        Display this text.\n";
+    help += "The operations run in this order : importFile uvRamp smooth remap clamp\n";
+    help += "uvRamp and smooth only work on meshes.\n";
+    help += "Returns the vertices that changed.\n";
+    MGlobal::displayInfo(help);
+}
+
+void* blurSkinMapCmd::creator() { return new blurSkinMapCmd(); }
+
+MSyntax blurSkinMapCmd::newSyntax() {
+    MSyntax syntax;
+    syntax.addFlag(kAttributeFlagShort, kAttributeFlagLong, MSyntax::kString);
+    syntax.addFlag(kMeshNameFlagShort, kMeshNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kVerticesFlagShort, kVerticesFlagLong, MSyntax::kLong);
+    syntax.makeFlagMultiUse(kVerticesFlagShort);
+    syntax.addFlag(kImportFileFlagShort, kImportFileFlagLong, MSyntax::kString);
+    syntax.addFlag(kUvRampFlagShort, kUvRampFlagLong, MSyntax::kString);
+    syntax.addFlag(kNormalizeFlagShort, kNormalizeFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kOppositeFlagShort, kOppositeFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kSmoothFlagShort, kSmoothFlagLong, MSyntax::kLong);
+    syntax.addFlag(kRemapFlagShort, kRemapFlagLong, MSyntax::kDouble, MSyntax::kDouble,
+                   MSyntax::kDouble, MSyntax::kDouble);
+    syntax.addFlag(kClampFlagShort, kClampFlagLong, MSyntax::kDouble, MSyntax::kDouble);
+    syntax.addFlag(kVerboseFlagShort, kVerboseFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kHelpFlagShort, kHelpFlagLong);
+    return syntax;
+}
+
+MStatus blurSkinMapCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kHelpFlagShort)) {
+        DisplayMapHelp();
+        return MS::kSuccess;
+    }
+    if (argData.isFlagSet(kVerboseFlagShort))
+        verbose = argData.flagArgumentBool(kVerboseFlagShort, 0, &status);
+    if (argData.isFlagSet(kAttributeFlagShort))
+        attributeName_ = argData.flagArgumentString(kAttributeFlagShort, 0);
+    if (argData.isFlagSet(kMeshNameFlagShort))
+        meshName_ = argData.flagArgumentString(kMeshNameFlagShort, 0);
+    if (argData.isFlagSet(kImportFileFlagShort))
+        importFile_ = argData.flagArgumentString(kImportFileFlagShort, 0);
+    if (argData.isFlagSet(kUvRampFlagShort)) {
+        MString axisName = argData.flagArgumentString(kUvRampFlagShort, 0);
+        if (axisName == "u")
+            uvAxis_ = 0;
+        else if (axisName == "v")
+            uvAxis_ = 1;
+        else {
+            MGlobal::displayError(MString("-uvRamp must be u or v not ") + axisName);
+            return MS::kFailure;
+        }
+    }
+    if (argData.isFlagSet(kNormalizeFlagShort))
+        normalize_ = argData.flagArgumentBool(kNormalizeFlagShort, 0, &status);
+    if (argData.isFlagSet(kOppositeFlagShort))
+        opposite_ = argData.flagArgumentBool(kOppositeFlagShort, 0, &status);
+    if (argData.isFlagSet(kSmoothFlagShort))
+        smoothRepeat_ = argData.flagArgumentInt(kSmoothFlagShort, 0, &status);
+    if (argData.isFlagSet(kRemapFlagShort)) {
+        remap_ = true;
+        for (int i = 0; i < 4; ++i)
+            remapValues_[i] = argData.flagArgumentDouble(kRemapFlagShort, i, &status);
+        if (remapValues_[1] == remapValues_[0]) {
+            MGlobal::displayError("-remap old min and old max must be different");
+            return MS::kFailure;
+        }
+    }
+    if (argData.isFlagSet(kClampFlagShort)) {
+        clamp_ = true;
+        for (int i = 0; i < 2; ++i)
+            clampValues_[i] = argData.flagArgumentDouble(kClampFlagShort, i, &status);
+    }
+
+    if (attributeName_.length() == 0) {
+        MGlobal::displayError("-attribute is required");
+        return MS::kFailure;
+    }
+    status = getMapPlug(attributeName_, mapPlug_);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    MSelectionList selList;
+    if (meshName_.length() > 0) {
+        status = selList.add(meshName_);
+        if (status != MS::kSuccess) {
+            MGlobal::displayError(MString("can not find mesh ") + meshName_);
+            return MS::kFailure;
+        }
+    } else {
+        MGlobal::getActiveSelectionList(selList);
+        if (selList.length() == 0) {
+            MGlobal::displayError("select a shape or pass -meshName");
+            return MS::kFailure;
+        }
+    }
+    selList.getDagPath(0, shapePath_);
+    shapePath_.extendToShape();
+    nbVertices_ = getGeometryPointCount(shapePath_);
+    if (nbVertices_ == 0) {
+        MGlobal::displayError(shapePath_.partialPathName() + MString(" has no vertices"));
+        return MS::kFailure;
+    }
+    if ((uvAxis_ != -1 || smoothRepeat_ > 0) && shapePath_.apiType() != MFn::kMesh) {
+        MGlobal::displayError("uvRamp and smooth only work on meshes");
+        return MS::kFailure;
+    }
+
+    // the mask, sorted without duplicates
+    std::vector<int> vertices;
+    if (argData.isFlagSet(kVerticesFlagShort)) {
+        int nbUse = argData.numberOfFlagUses(kVerticesFlagShort);
+        vertices.reserve(nbUse);
+        for (int i = 0; i < nbUse; i++) {
+            MArgList flagArgs;
+            argData.getFlagArgumentList(kVerticesFlagShort, i, flagArgs);
+            int vertex = flagArgs.asInt(0);
+            if (vertex >= 0 && vertex < nbVertices_) vertices.push_back(vertex);
+        }
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    } else {
+        vertices.resize(nbVertices_);
+        for (int i = 0; i < nbVertices_; ++i) vertices[i] = i;
+    }
+
+    MDoubleArray currentValues;
+    status = readMapValues(mapPlug_, nbVertices_, currentValues);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    std::vector<double> values(nbVertices_);
+    for (int i = 0; i < nbVertices_; ++i) values[i] = currentValues[i];
+
+    if (importFile_.length() > 0) {
+        status = importFile(vertices, values);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    if (uvAxis_ != -1) {
+        status = uvRamp(vertices, values);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    if (smoothRepeat_ > 0) {
+        status = smooth(vertices, values);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    if (remap_) {
+        double mult = (remapValues_[3] - remapValues_[2]) / (remapValues_[1] - remapValues_[0]);
+        for (int vertex : vertices)
+            values[vertex] = remapValues_[2] + (values[vertex] - remapValues_[0]) * mult;
+    }
+    if (clamp_) {
+        for (int vertex : vertices)
+            values[vertex] = std::max(clampValues_[0], std::min(values[vertex], clampValues_[1]));
+    }
+
+    // only what changed is written
+    for (int vertex : vertices) {
+        if (values[vertex] == currentValues[vertex]) continue;
+        changedVertices_.append(vertex);
+        undoValues_.append(currentValues[vertex]);
+        redoValues_.append(values[vertex]);
+    }
+    setResult(changedVertices_);
+    if (verbose)
+        MGlobal::displayInfo(MString("changed ") + (int)changedVertices_.length() +
+                             MString(" values of ") + attributeName_);
+    if (changedVertices_.length() == 0) return MS::kSuccess;
+    return redoIt();
+}
+
+// the whole file, gunzipped. gzread also reads the files that are not compressed
+static bool readMapFileText(const MString& path, std::string& text) {
+#ifdef BLURSKIN_USE_ZLIB
+    gzFile theFile = gzopen(path.asChar(), "rb");
+    if (theFile == nullptr) {
+        MGlobal::displayError(MString("can not open ") + path);
+        return false;
+    }
+    char buffer[1 << 16];
+    int nbRead;
+    while ((nbRead = gzread(theFile, buffer, sizeof(buffer))) > 0) text.append(buffer, nbRead);
+    bool failed = nbRead < 0;
+    gzclose(theFile);
+    if (failed) {
+        MGlobal::displayError(MString("can not read ") + path);
+        return false;
+    }
+#else
+    std::ifstream theFile(path.asChar(), std::ios::binary);
+    if (!theFile.is_open()) {
+        MGlobal::displayError(MString("can not open ") + path);
+        return false;
+    }
+    text.assign(std::istreambuf_iterator<char>(theFile), std::istreambuf_iterator<char>());
+    if (text.size() >= 2 && (unsigned char)text[0] == 0x1f && (unsigned char)text[1] == 0x8b) {
+        MGlobal::displayError(path + MString(" is gzipped, blurSkin is built without zlib"));
+        return false;
+    }
+#endif
+    return true;
+}
+
+// one value per vertex, as numpy savetxt writes them, gzipped for the .gz files
+MStatus blurSkinMapCmd::importFile(const std::vector<int>& vertices, std::vector<double>& values) {
+    std::string text;
+    if (!readMapFileText(importFile_, text)) return MS::kFailure;
+    std::istringstream theStream(text);
+    std::vector<double> fileValues;
+    fileValues.reserve(nbVertices_);
+    double value;
+    while (theStream >> value) fileValues.push_back(value);
+    if ((int)fileValues.size() != nbVertices_) {
+        MGlobal::displayError(importFile_ + MString(" has ") + (int)fileValues.size() +
+                              MString(" values for ") + nbVertices_ + MString(" vertices"));
+        return MS::kFailure;
+    }
+    for (int vertex : vertices) values[vertex] = fileValues[vertex];
+    return MS::kSuccess;
+}
+
+// the uv of a vertex is the one of its first face, vertices without uvs are not changed
+MStatus blurSkinMapCmd::uvRamp(const std::vector<int>& vertices, std::vector<double>& values) {
+    MStatus status;
+    MFnMesh meshFn(shapePath_, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    MString uvSet = meshFn.currentUVSetName();
+    MFloatArray uArray, vArray;
+    meshFn.getUVs(uArray, vArray, &uvSet);
+    MIntArray uvCounts, uvIds, polyCounts, polyVertices;
+    meshFn.getAssignedUVs(uvCounts, uvIds, &uvSet);
+    meshFn.getVertices(polyCounts, polyVertices);
+
+    std::vector<int> vertexUv(nbVertices_, -1);
+    unsigned int faceVertex = 0, uvIndex = 0;
+    for (unsigned int face = 0; face < polyCounts.length(); ++face) {
+        if (uvCounts[face] == polyCounts[face]) {
+            for (int k = 0; k < polyCounts[face]; ++k) {
+                int vertex = polyVertices[faceVertex + k];
+                if (vertexUv[vertex] == -1) vertexUv[vertex] = uvIds[uvIndex + k];
+            }
+        }
+        faceVertex += polyCounts[face];
+        uvIndex += uvCounts[face];
+    }
+    const MFloatArray& coords = uvAxis_ == 0 ? uArray : vArray;
+
+    double minValue = 0.0, maxValue = 1.0;
+    if (normalize_) {
+        minValue = 1e30;
+        maxValue = -1e30;
+        for (int vertex : vertices) {
+            if (vertexUv[vertex] == -1) continue;
+            double coord = coords[vertexUv[vertex]];
+            minValue = std::min(minValue, coord);
+            maxValue = std::max(maxValue, coord);
+        }
+    }
+    double range = maxValue - minValue;
+    for (int vertex : vertices) {
+        if (vertexUv[vertex] == -1) continue;
+        double value = coords[vertexUv[vertex]];
+        if (normalize_) value = range > 0.0 ? (value - minValue) / range : 0.0;
+        values[vertex] = opposite_ ? 1.0 - value : value;
+    }
+    return MS::kSuccess;
+}
+
+// average of the neighbors, each iteration reads the previous one
+MStatus blurSkinMapCmd::smooth(const std::vector<int>& vertices, std::vector<double>& values) {
+    MStatus status;
+    MFnMesh meshFn(shapePath_, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    std::vector<int> adjacencyStarts, adjacencyIndices;
+    buildMeshAdjacency(meshFn, adjacencyStarts, adjacencyIndices);
+
+    // the vertices out of the mask are the same in both buffers
+    std::vector<double> nextValues(values);
+    int nbMasked = (int)vertices.size();
+    for (int iteration = 0; iteration < smoothRepeat_; ++iteration) {
+#pragma omp parallel for if (nbMasked > 1000)
+        for (int k = 0; k < nbMasked; ++k) {
+            int vertex = vertices[k];
+            int start = adjacencyStarts[vertex], end = adjacencyStarts[vertex + 1];
+            if (start == end) {
+                nextValues[vertex] = values[vertex];
+                continue;
+            }
+            double sum = 0.0;
+            for (int n = start; n < end; ++n) sum += values[adjacencyIndices[n]];
+            nextValues[vertex] = sum / (double)(end - start);
+        }
+        values.swap(nextValues);
+    }
+    return MS::kSuccess;
+}
+
+MStatus blurSkinMapCmd::redoIt() { return setMapValues(mapPlug_, changedVertices_, redoValues_); }
+
+MStatus blurSkinMapCmd::undoIt() { return setMapValues(mapPlug_, changedVertices_, undoValues_); }
@@ -0,0 +1,383 @@
+#include "blurSkinMirror.h"
+
+#include <maya/MFnDependencyNode.h>
+#include <maya/MFnMesh.h>
+#include <maya/MPointArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "blurSkinWeightsIO.h"
+#include "functions.h"
+
+const char* blurSkinMirrorCmd::kSkinClusterNameFlagShort = "-skn";
+const char* blurSkinMirrorCmd::kSkinClusterNameFlagLong = "-skinCluster";
+const char* blurSkinMirrorCmd::kMeshNameFlagShort = "-mn";
+const char* blurSkinMirrorCmd::kMeshNameFlagLong = "-meshName";
+const char* blurSkinMirrorCmd::kAxisFlagShort = "-ax";
+const char* blurSkinMirrorCmd::kAxisFlagLong = "-axis";
+const char* blurSkinMirrorCmd::kDirectionFlagShort = "-dir";
+const char* blurSkinMirrorCmd::kDirectionFlagLong = "-direction";
+const char* blurSkinMirrorCmd::kToleranceFlagShort = "-tol";
+const char* blurSkinMirrorCmd::kToleranceFlagLong = "-tolerance";
+const char* blurSkinMirrorCmd::kMirrorInfluencesFlagShort = "-mi";
+const char* blurSkinMirrorCmd::kMirrorInfluencesFlagLong = "-mirrorInfluences";
+const char* blurSkinMirrorCmd::kVerboseFlagShort = "-vrb";
+const char* blurSkinMirrorCmd::kVerboseFlagLong = "-verbose";
+const char* blurSkinMirrorCmd::kHelpFlagShort = "-h";
+const char* blurSkinMirrorCmd::kHelpFlagLong = "-help";
+
+static void DisplayMirrorHelp() {
+    MString help;
+    help += "Flags:\n";
+    help += "-skinCluster         -skn   String     Name of the skinCluster\n";
+    help += "-meshName            -mn    String     Name of the mesh if skincluster is not passed\n";
+    help += "                                          If -skn and -mn are not passed uses selection\n";
+    help += "-axis                -ax    String     Mirror axis x y or z (orig shape space) default x\n";
+    help += "-direction           -dir   Int        1 positive to negative, -1 negative to positive\n";
+    help += "                                          0 symmetrize both sides          default 1\n";
+    help += "-tolerance           -tol   Double     Distance to match the mirror vertices\n";
+    help += "                                          default 0.001\n";
+    help += "-mirrorInfluences    -mi    Int        Mirror influence of each influence (logical\n";
+    help += "                                          indices), default each is its own mirror\n";
+    help += "-verbose             -vrb   Bool       Verbose print\n";
+    help += "-help                -h     N/A        Display this text.\n";
+    help += "Returns the vertices that have no mirror.\n";
+    MGlobal::displayInfo(help);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Symmetry map
+// ------------------------------------------------------------------------------------------------
+static inline int64_t cellKey(int64_t x, int64_t y, int64_t z) {
+    return (x * 73856093) ^ (y * 19349663) ^ (z * 83492791);
+}
+
+MStatus buildSymmetryMap(const MObject& origMesh, int axis, double tolerance,
+                         std::vector<int>& symmetryMap) {
+    MStatus status;
+    MFnMesh meshFn(origMesh, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    MPointArray pts;
+    meshFn.getPoints(pts, MSpace::kObject);
+    int nbVertices = pts.length();
+
+    // hash grid of the points, cells of the tolerance size
+    double cellSize = std::max(tolerance, 1e-6);
+    std::unordered_map<int64_t, std::vector<int>> grid;
+    grid.reserve(nbVertices);
+    std::vector<int64_t> cells(nbVertices * 3);
+    for (int i = 0; i < nbVertices; ++i) {
+        for (int k = 0; k < 3; ++k) cells[i * 3 + k] = (int64_t)std::floor(pts[i][k] / cellSize);
+        grid[cellKey(cells[i * 3], cells[i * 3 + 1], cells[i * 3 + 2])].push_back(i);
+    }
+
+    double toleranceSquared = tolerance * tolerance;
+    symmetryMap.assign(nbVertices, -1);
+#pragma omp parallel for
+    for (int i = 0; i < nbVertices; ++i) {
+        MPoint mirrorPt = pts[i];
+        mirrorPt[axis] = -mirrorPt[axis];
+        int64_t cell[3];
+        for (int k = 0; k < 3; ++k) cell[k] = (int64_t)std::floor(mirrorPt[k] / cellSize);
+        double bestDistance = toleranceSquared;
+        for (int64_t x = cell[0] - 1; x <= cell[0] + 1; ++x) {
+            for (int64_t y = cell[1] - 1; y <= cell[1] + 1; ++y) {
+                for (int64_t z = cell[2] - 1; z <= cell[2] + 1; ++z) {
+                    auto it = grid.find(cellKey(x, y, z));
+                    if (it == grid.end()) continue;
+                    for (int other : it->second) {
+                        double distance = (pts[other] - mirrorPt).length();
+                        distance *= distance;
+                        if (distance <= bestDistance) {
+                            bestDistance = distance;
+                            symmetryMap[i] = other;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return MS::kSuccess;
+}
+
+// true if every matched vertex of the map is the mirror of its vertex along axis
+static bool symmetryMapMirrors(const MPointArray& pts, const MIntArray& symmetryList, int axis,
+                               double tolerance) {
+    int nbVertices = (int)pts.length();
+    for (int i = 0; i < nbVertices; ++i) {
+        int mirror = symmetryList[i];
+        if (mirror == -1) continue;
+        if (mirror < 0 || mirror >= nbVertices) return false;
+        MPoint mirrorPt = pts[i];
+        mirrorPt[axis] = -mirrorPt[axis];
+        if (mirrorPt.distanceTo(pts[mirror]) > tolerance) return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Command
+// ------------------------------------------------------------------------------------------------
+void* blurSkinMirrorCmd::creator() { return new blurSkinMirrorCmd(); }
+
+MSyntax blurSkinMirrorCmd::newSyntax() {
+    MSyntax syntax;
+    syntax.addFlag(kSkinClusterNameFlagShort, kSkinClusterNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kMeshNameFlagShort, kMeshNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kAxisFlagShort, kAxisFlagLong, MSyntax::kString);
+    syntax.addFlag(kDirectionFlagShort, kDirectionFlagLong, MSyntax::kLong);
+    syntax.addFlag(kToleranceFlagShort, kToleranceFlagLong, MSyntax::kDouble);
+    syntax.addFlag(kMirrorInfluencesFlagShort, kMirrorInfluencesFlagLong, MSyntax::kLong);
+    syntax.makeFlagMultiUse(kMirrorInfluencesFlagShort);
+    syntax.addFlag(kVerboseFlagShort, kVerboseFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kHelpFlagShort, kHelpFlagLong);
+    return syntax;
+}
+
+MStatus blurSkinMirrorCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kHelpFlagShort)) {
+        DisplayMirrorHelp();
+        return MS::kSuccess;
+    }
+    if (argData.isFlagSet(kVerboseFlagShort))
+        verbose = argData.flagArgumentBool(kVerboseFlagShort, 0, &status);
+    if (argData.isFlagSet(kSkinClusterNameFlagShort))
+        skinClusterName_ = argData.flagArgumentString(kSkinClusterNameFlagShort, 0);
+    if (argData.isFlagSet(kMeshNameFlagShort))
+        meshName_ = argData.flagArgumentString(kMeshNameFlagShort, 0);
+    if (argData.isFlagSet(kAxisFlagShort)) {
+        MString axisName = argData.flagArgumentString(kAxisFlagShort, 0);
+        if (axisName == "x")
+            axis_ = 0;
+        else if (axisName == "y")
+            axis_ = 1;
+        else if (axisName == "z")
+            axis_ = 2;
+        else {
+            MGlobal::displayError(MString("-axis must be x, y or z not ") + axisName);
+            return MS::kFailure;
+        }
+    }
+    if (argData.isFlagSet(kDirectionFlagShort))
+        direction_ = argData.flagArgumentInt(kDirectionFlagShort, 0, &status);
+    if (argData.isFlagSet(kToleranceFlagShort))
+        tolerance_ = argData.flagArgumentDouble(kToleranceFlagShort, 0, &status);
+    if (argData.isFlagSet(kMirrorInfluencesFlagShort)) {
+        int nbUse = argData.numberOfFlagUses(kMirrorInfluencesFlagShort);
+        for (int i = 0; i < nbUse; i++) {
+            MArgList flagArgs;
+            argData.getFlagArgumentList(kMirrorInfluencesFlagShort, i, flagArgs);
+            mirrorInfluences_.append(flagArgs.asInt(0));
+        }
+    }
+
+    status = getSkinClusterAndShape(skinClusterName_, meshName_, skinCluster_, shapePath_,
+                                    verbose);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (shapePath_.apiType() != MFn::kMesh) {
+        MGlobal::displayError("mirror only works on meshes");
+        return MS::kFailure;
+    }
+    int nbVertices = getGeometryPointCount(shapePath_);
+
+    // vertex symmetry
+    MObject origMesh;
+    findOrigMesh(skinCluster_, origMesh, verbose);
+    if (origMesh.isNull()) {
+        MGlobal::displayError("cannot find the orig shape of the skinCluster");
+        return MS::kFailure;
+    }
+    // the side of each vertex comes from the orig shape
+    MFnMesh origFn(origMesh);
+    MPointArray origPts;
+    origFn.getPoints(origPts, MSpace::kObject);
+    if ((int)origPts.length() != nbVertices) {
+        MGlobal::displayError("orig shape and shape have different vertices counts");
+        return MS::kFailure;
+    }
+    // the stored map has its own axis and tolerance, it's only reused without those flags and
+    // if it mirrors along the axis
+    std::vector<int> symmetryMap;
+    MIntArray symetryList;
+    MFnDependencyNode transformDep(shapePath_.transform());
+    bool symmetryFlags =
+        argData.isFlagSet(kAxisFlagShort) || argData.isFlagSet(kToleranceFlagShort);
+    if (!symmetryFlags && transformDep.hasAttribute("symmetricVertices") &&
+        getSymetryAttributes(skinCluster_, symetryList) == MS::kSuccess &&
+        (int)symetryList.length() == nbVertices &&
+        symmetryMapMirrors(origPts, symetryList, axis_, tolerance_)) {
+        symmetryMap.resize(nbVertices);
+        for (int i = 0; i < nbVertices; ++i) symmetryMap[i] = symetryList[i];
+    } else {
+        status = buildSymmetryMap(origMesh, axis_, tolerance_, symmetryMap);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+
+    // influences : physical index -> physical index of the mirror
+    MStringArray influenceNames;
+    MIntArray logicalIndices;
+    getInfluencesInfos(skinCluster_, influenceNames, logicalIndices);
+    nbInfluences_ = influenceNames.length();
+    logicalIndices_ = logicalIndices;
+    std::vector<int> logicalToPhysical;
+    getLogicalToPhysical(logicalIndices, logicalToPhysical);
+    std::vector<int> mirrorInfluence(nbInfluences_);
+    for (int j = 0; j < nbInfluences_; ++j) {
+        mirrorInfluence[j] = j;
+        int logical = logicalIndices[j];
+        if (logical >= (int)mirrorInfluences_.length()) continue;
+        int mirrorLogical = mirrorInfluences_[logical];
+        if (mirrorLogical < 0 || mirrorLogical >= (int)logicalToPhysical.size()) continue;
+        if (logicalToPhysical[mirrorLogical] != -1)
+            mirrorInfluence[j] = logicalToPhysical[mirrorLogical];
+    }
+
+    MIntArray lockJoints, lockVertices;
+    getListLockJoints(skinCluster_, lockJoints);
+    std::vector<char> lockedInfluence(nbInfluences_, 0);
+    int nbLocked = 0;
+    for (int j = 0; j < nbInfluences_ && j < (int)lockJoints.length(); ++j) {
+        lockedInfluence[j] = lockJoints[j] == 1;
+        nbLocked += lockedInfluence[j];
+    }
+    MFnDependencyNode shapeDep(shapePath_.node());
+    if (shapeDep.hasAttribute("lockedVertices")) getListLockVertices(skinCluster_, lockVertices);
+
+    WeightsBlock currentBlock;
+    status = readSparseWeights(skinCluster_, 0, nbVertices, logicalToPhysical, currentBlock);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    std::vector<size_t> rows(nbVertices + 1, 0);
+    for (int i = 0; i < nbVertices; ++i) rows[i + 1] = rows[i] + currentBlock.counts[i];
+
+    // the vertices to write, and the room their new row can take
+    std::vector<int> targets;
+    MIntArray unmatched;
+    std::vector<size_t> targetRows(1, 0);
+    for (int i = 0; i < nbVertices; ++i) {
+        if (i < (int)lockVertices.length() && lockVertices[i] == 1) continue;
+        double coord = origPts[i][axis_];
+        bool onAxis = std::fabs(coord) <= tolerance_;
+        if (!onAxis && direction_ > 0 && coord > 0.0) continue;
+        if (!onAxis && direction_ < 0 && coord < 0.0) continue;
+        int mirror = symmetryMap[i];
+        if (mirror < 0 || mirror >= nbVertices) {
+            unmatched.append(i);
+            continue;
+        }
+        targets.push_back(i);
+        targetRows.push_back(targetRows.back() + currentBlock.counts[i] +
+                             currentBlock.counts[mirror] + nbLocked);
+    }
+    int nbTargets = (int)targets.size();
+    if (unmatched.length() > 0)
+        MGlobal::displayWarning(MString("") + (int)unmatched.length() +
+                                MString(" vertices have no mirror and are not changed"));
+    setResult(unmatched);
+    if (nbTargets == 0) return MS::kSuccess;
+
+    // new rows, every target only reads the current weights
+    std::vector<uint32_t> newCounts(nbTargets, 0);
+    std::vector<uint32_t> newInfluences(targetRows.back());
+    std::vector<double> newWeights(targetRows.back());
+    int nbNoUnlocked = 0;  // room left by the locks but nothing unlocked to fill it
+#pragma omp parallel for reduction(+ : nbNoUnlocked)
+    for (int t = 0; t < nbTargets; ++t) {
+        int vertex = targets[t];
+        int mirror = symmetryMap[vertex];
+        double coord = origPts[vertex][axis_];
+        bool symmetrize = direction_ == 0 || std::fabs(coord) <= tolerance_;
+        uint32_t* influences = &newInfluences[targetRows[t]];
+        double* weights = &newWeights[targetRows[t]];
+        uint32_t count = 0;
+        auto addWeight = [&](uint32_t influence, double theWeight) {
+            for (uint32_t k = 0; k < count; ++k) {
+                if (influences[k] == influence) {
+                    weights[k] += theWeight;
+                    return;
+                }
+            }
+            influences[count] = influence;
+            weights[count++] = theWeight;
+        };
+        double mirrorMult = symmetrize ? 0.5 : 1.0;
+        double totalLock = 0.0, totalUnlock = 0.0;
+        for (size_t e = rows[vertex]; e < rows[vertex + 1]; ++e) {
+            uint32_t influence = currentBlock.influences[e];
+            double theWeight = currentBlock.weights[e];
+            if (lockedInfluence[influence]) {
+                addWeight(influence, theWeight);
+                totalLock += theWeight;
+            } else if (symmetrize) {
+                addWeight(influence, 0.5 * theWeight);
+                totalUnlock += 0.5 * theWeight;
+            }
+        }
+        for (size_t e = rows[mirror]; e < rows[mirror + 1]; ++e) {
+            uint32_t influence = mirrorInfluence[currentBlock.influences[e]];
+            if (lockedInfluence[influence]) continue;
+            double theWeight = mirrorMult * currentBlock.weights[e];
+            addWeight(influence, theWeight);
+            totalUnlock += theWeight;
+        }
+        // locked influences keep their weight, the others fill what is left
+        double normalizedValueAvailable = std::max(1.0 - totalLock, 0.0);
+        double mult = totalUnlock > 0.0 ? normalizedValueAvailable / totalUnlock : 0.0;
+        if (totalUnlock == 0.0 && normalizedValueAvailable > 0.0) ++nbNoUnlocked;
+        for (uint32_t k = 0; k < count; ++k) {
+            if (!lockedInfluence[influences[k]]) weights[k] *= mult;
+        }
+        newCounts[t] = count;
+    }
+    if (nbNoUnlocked > 0)
+        MGlobal::displayWarning(MString("") + nbNoUnlocked +
+                                MString(" vertices have no unlocked weight to mirror, their "
+                                        "weights are not normalized"));
+
+    // one block from the first to the last target
+    int firstVertex = targets.front();
+    int vertexCount = targets.back() - firstVertex + 1;
+    redoBlock_.clear();
+    redoBlock_.firstVertex = firstVertex;
+    redoBlock_.counts.resize(vertexCount, 0);
+    int target = 0;
+    for (int i = 0; i < vertexCount; ++i) {
+        int vertex = firstVertex + i;
+        size_t rowStart = redoBlock_.weights.size();
+        if (target < nbTargets && targets[target] == vertex) {
+            for (uint32_t k = 0; k < newCounts[target]; ++k) {
+                double theWeight = newWeights[targetRows[target] + k];
+                if (theWeight == 0.0) continue;
+                redoBlock_.influences.push_back(newInfluences[targetRows[target] + k]);
+                redoBlock_.weights.push_back(theWeight);
+            }
+            ++target;
+        } else {
+            for (size_t e = rows[vertex]; e < rows[vertex + 1]; ++e) {
+                redoBlock_.influences.push_back(currentBlock.influences[e]);
+                redoBlock_.weights.push_back(currentBlock.weights[e]);
+            }
+        }
+        redoBlock_.counts[i] = (uint32_t)(redoBlock_.weights.size() - rowStart);
+    }
+
+    status = writeSparseWeights(skinCluster_, logicalIndices_, redoBlock_, &undoBlock_);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (verbose)
+        MGlobal::displayInfo(MString("mirrored ") + nbTargets + MString(" vertices of ") +
+                             shapePath_.partialPathName());
+    return MS::kSuccess;
+}
+
+MStatus blurSkinMirrorCmd::redoIt() {
+    return writeSparseWeights(skinCluster_, logicalIndices_, redoBlock_);
+}
+
+MStatus blurSkinMirrorCmd::undoIt() {
+    return writeSparseWeights(skinCluster_, logicalIndices_, undoBlock_);
+}
@@ -0,0 +1,440 @@
+#include "blurSkinTransfer.h"
+
+#include <maya/MPointArray.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "blurSkinWeightsIO.h"
+#include "functions.h"
+
+const char* blurSkinTransferCmd::kSourceSkinClusterFlagShort = "-ssk";
+const char* blurSkinTransferCmd::kSourceSkinClusterFlagLong = "-sourceSkinCluster";
+const char* blurSkinTransferCmd::kSourceMeshFlagShort = "-smn";
+const char* blurSkinTransferCmd::kSourceMeshFlagLong = "-sourceMeshName";
+const char* blurSkinTransferCmd::kSkinClusterNameFlagShort = "-skn";
+const char* blurSkinTransferCmd::kSkinClusterNameFlagLong = "-skinCluster";
+const char* blurSkinTransferCmd::kMeshNameFlagShort = "-mn";
+const char* blurSkinTransferCmd::kMeshNameFlagLong = "-meshName";
+const char* blurSkinTransferCmd::kListVerticesIndicesFlagShort = "-li";
+const char* blurSkinTransferCmd::kListVerticesIndicesFlagLong = "-listVerticesIndices";
+const char* blurSkinTransferCmd::kVerboseFlagShort = "-vrb";
+const char* blurSkinTransferCmd::kVerboseFlagLong = "-verbose";
+const char* blurSkinTransferCmd::kHelpFlagShort = "-h";
+const char* blurSkinTransferCmd::kHelpFlagLong = "-help";
+
+static void DisplayTransferHelp() {
+    MString help;
+    help += "Flags:\n";
+    help += "-sourceSkinCluster   -ssk   String     Name of the source skinCluster\n";
+    help += "-sourceMeshName      -smn   String     Name of the source mesh if -ssk is not passed\n";
+    help += "-skinCluster         -skn   String     Name of the target skinCluster\n";
+    help += "-meshName            -mn    String     Name of the target mesh if -skn is not passed\n";
+    help += "                                          If -skn and -mn are not passed uses selection\n";
+    help += "-listVerticesIndices -li    Int        Target vertices to transfer, default all\n";
+    help += "-verbose             -vrb   Bool       Verbose print\n";
+    help += "-help                -h     N/A        Display this text.\n";
+    MGlobal::displayInfo(help);
+}
+
+// ------------------------------------------------------------------------------------------------
+// BVH
+// ------------------------------------------------------------------------------------------------
+static inline double dot3(const double* a, const double* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// closest point on the triangle abc, returns the squared distance
+static double closestPointOnTriangle(const double* p, const double* a, const double* b,
+                                     const double* c, double* barycentric) {
+    double ab[3], ac[3], ap[3], bp[3], cp[3];
+    for (int k = 0; k < 3; ++k) {
+        ab[k] = b[k] - a[k];
+        ac[k] = c[k] - a[k];
+        ap[k] = p[k] - a[k];
+        bp[k] = p[k] - b[k];
+        cp[k] = p[k] - c[k];
+    }
+    double d1 = dot3(ab, ap), d2 = dot3(ac, ap);
+    double d3 = dot3(ab, bp), d4 = dot3(ac, bp);
+    double d5 = dot3(ab, cp), d6 = dot3(ac, cp);
+    double va = d3 * d6 - d5 * d4;
+    double vb = d5 * d2 - d1 * d6;
+    double vc = d1 * d4 - d3 * d2;
+    double u, v, w;
+    if (d1 <= 0.0 && d2 <= 0.0) {
+        u = 1.0, v = 0.0, w = 0.0;
+    } else if (d3 >= 0.0 && d4 <= d3) {
+        u = 0.0, v = 1.0, w = 0.0;
+    } else if (d6 >= 0.0 && d5 <= d6) {
+        u = 0.0, v = 0.0, w = 1.0;
+    } else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {  // edge ab
+        v = (d1 - d3) > 0.0 ? d1 / (d1 - d3) : 0.0;
+        u = 1.0 - v, w = 0.0;
+    } else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {  // edge ac
+        w = (d2 - d6) > 0.0 ? d2 / (d2 - d6) : 0.0;
+        u = 1.0 - w, v = 0.0;
+    } else if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {  // edge bc
+        double denom = (d4 - d3) + (d5 - d6);
+        w = denom > 0.0 ? (d4 - d3) / denom : 0.0;
+        u = 0.0, v = 1.0 - w;
+    } else {  // inside, degenerated triangles fall back on a
+        double denom = va + vb + vc;
+        v = denom > 0.0 ? vb / denom : 0.0;
+        w = denom > 0.0 ? vc / denom : 0.0;
+        u = 1.0 - v - w;
+    }
+    barycentric[0] = u;
+    barycentric[1] = v;
+    barycentric[2] = w;
+    double distance = 0.0;
+    for (int k = 0; k < 3; ++k) {
+        double q = u * a[k] + v * b[k] + w * c[k] - p[k];
+        distance += q * q;
+    }
+    return distance;
+}
+
+void TriangleBVH::build(const std::vector<double>& points, const std::vector<int>& triangles) {
+    points_ = &points;
+    triangles_ = &triangles;
+    int nbTriangles = (int)triangles.size() / 3;
+    triangleIndices_.resize(nbTriangles);
+    centers_.resize(nbTriangles * 3);
+    for (int t = 0; t < nbTriangles; ++t) {
+        triangleIndices_[t] = t;
+        for (int k = 0; k < 3; ++k) {
+            centers_[t * 3 + k] = (points[triangles[t * 3] * 3 + k] +
+                                   points[triangles[t * 3 + 1] * 3 + k] +
+                                   points[triangles[t * 3 + 2] * 3 + k]) /
+                                  3.0;
+        }
+    }
+    nodes_.clear();
+    nodes_.reserve(2 * nbTriangles / TRANSFER_BVH_LEAF_SIZE + 1);
+    if (nbTriangles > 0) buildNode(0, nbTriangles);
+}
+
+int TriangleBVH::buildNode(int first, int count) {
+    const std::vector<double>& points = *points_;
+    const std::vector<int>& triangles = *triangles_;
+    Node node;
+    double centerMin[3], centerMax[3];
+    for (int k = 0; k < 3; ++k) {
+        node.boxMin[k] = centerMin[k] = std::numeric_limits<double>::max();
+        node.boxMax[k] = centerMax[k] = -std::numeric_limits<double>::max();
+    }
+    for (int i = first; i < first + count; ++i) {
+        int t = triangleIndices_[i];
+        for (int c = 0; c < 3; ++c) {
+            const double* pt = &points[triangles[t * 3 + c] * 3];
+            for (int k = 0; k < 3; ++k) {
+                node.boxMin[k] = std::min(node.boxMin[k], pt[k]);
+                node.boxMax[k] = std::max(node.boxMax[k], pt[k]);
+            }
+        }
+        for (int k = 0; k < 3; ++k) {
+            centerMin[k] = std::min(centerMin[k], centers_[t * 3 + k]);
+            centerMax[k] = std::max(centerMax[k], centers_[t * 3 + k]);
+        }
+    }
+    int nodeIndex = (int)nodes_.size();
+    node.first = first;
+    node.count = count;
+    nodes_.push_back(node);
+    if (count <= TRANSFER_BVH_LEAF_SIZE) return nodeIndex;
+
+    // median split on the longest axis of the centers
+    int axis = 0;
+    for (int k = 1; k < 3; ++k) {
+        if (centerMax[k] - centerMin[k] > centerMax[axis] - centerMin[axis]) axis = k;
+    }
+    int half = count / 2;
+    std::nth_element(triangleIndices_.begin() + first, triangleIndices_.begin() + first + half,
+                     triangleIndices_.begin() + first + count, [&](int a, int b) {
+                         return centers_[a * 3 + axis] < centers_[b * 3 + axis];
+                     });
+    buildNode(first, half);
+    int right = buildNode(first + half, count - half);
+    nodes_[nodeIndex].first = right;
+    nodes_[nodeIndex].count = 0;
+    return nodeIndex;
+}
+
+double TriangleBVH::boxDistance(const Node& node, const double* point) const {
+    double distance = 0.0;
+    for (int k = 0; k < 3; ++k) {
+        double d = std::max(std::max(node.boxMin[k] - point[k], point[k] - node.boxMax[k]), 0.0);
+        distance += d * d;
+    }
+    return distance;
+}
+
+int TriangleBVH::closestPoint(const double* point, double* barycentric) const {
+    if (nodes_.empty()) return -1;
+    const std::vector<double>& points = *points_;
+    const std::vector<int>& triangles = *triangles_;
+    double bestDistance = std::numeric_limits<double>::max();
+    int bestTriangle = -1;
+    double triangleBarycentric[3];
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty()) {
+        int nodeIndex = stack.back();
+        stack.pop_back();
+        const Node& node = nodes_[nodeIndex];
+        if (boxDistance(node, point) >= bestDistance) continue;
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                int t = triangleIndices_[i];
+                double distance = closestPointOnTriangle(
+                    point, &points[triangles[t * 3] * 3], &points[triangles[t * 3 + 1] * 3],
+                    &points[triangles[t * 3 + 2] * 3], triangleBarycentric);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestTriangle = t;
+                    for (int k = 0; k < 3; ++k) barycentric[k] = triangleBarycentric[k];
+                }
+            }
+            continue;
+        }
+        // visit the nearest child first
+        int left = nodeIndex + 1, right = node.first;
+        if (boxDistance(nodes_[left], point) < boxDistance(nodes_[right], point)) {
+            stack.push_back(right);
+            stack.push_back(left);
+        } else {
+            stack.push_back(left);
+            stack.push_back(right);
+        }
+    }
+    return bestTriangle;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Command
+// ------------------------------------------------------------------------------------------------
+void* blurSkinTransferCmd::creator() { return new blurSkinTransferCmd(); }
+
+MSyntax blurSkinTransferCmd::newSyntax() {
+    MSyntax syntax;
+    syntax.addFlag(kSourceSkinClusterFlagShort, kSourceSkinClusterFlagLong, MSyntax::kString);
+    syntax.addFlag(kSourceMeshFlagShort, kSourceMeshFlagLong, MSyntax::kString);
+    syntax.addFlag(kSkinClusterNameFlagShort, kSkinClusterNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kMeshNameFlagShort, kMeshNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kListVerticesIndicesFlagShort, kListVerticesIndicesFlagLong, MSyntax::kLong);
+    syntax.makeFlagMultiUse(kListVerticesIndicesFlagShort);
+    syntax.addFlag(kVerboseFlagShort, kVerboseFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kHelpFlagShort, kHelpFlagLong);
+    return syntax;
+}
+
+MStatus blurSkinTransferCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kHelpFlagShort)) {
+        DisplayTransferHelp();
+        return MS::kSuccess;
+    }
+    if (argData.isFlagSet(kVerboseFlagShort))
+        verbose = argData.flagArgumentBool(kVerboseFlagShort, 0, &status);
+    if (argData.isFlagSet(kSourceSkinClusterFlagShort))
+        sourceSkinClusterName_ = argData.flagArgumentString(kSourceSkinClusterFlagShort, 0);
+    if (argData.isFlagSet(kSourceMeshFlagShort))
+        sourceMeshName_ = argData.flagArgumentString(kSourceMeshFlagShort, 0);
+    if (argData.isFlagSet(kSkinClusterNameFlagShort))
+        skinClusterName_ = argData.flagArgumentString(kSkinClusterNameFlagShort, 0);
+    if (argData.isFlagSet(kMeshNameFlagShort))
+        meshName_ = argData.flagArgumentString(kMeshNameFlagShort, 0);
+    if (argData.isFlagSet(kListVerticesIndicesFlagShort)) {
+        int nbUse = argData.numberOfFlagUses(kListVerticesIndicesFlagShort);
+        for (int i = 0; i < nbUse; i++) {
+            MArgList flagArgs;
+            argData.getFlagArgumentList(kListVerticesIndicesFlagShort, i, flagArgs);
+            maskVertices_.append(flagArgs.asInt(0));
+        }
+    }
+    if (sourceSkinClusterName_.length() == 0 && sourceMeshName_.length() == 0) {
+        MGlobal::displayError("-sourceSkinCluster or -sourceMeshName is required");
+        return MS::kFailure;
+    }
+
+    MObject sourceSkinCluster;
+    MDagPath sourcePath;
+    status = getSkinClusterAndShape(sourceSkinClusterName_, sourceMeshName_, sourceSkinCluster,
+                                    sourcePath, verbose);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = getSkinClusterAndShape(skinClusterName_, meshName_, skinCluster_, shapePath_,
+                                    verbose);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (sourcePath.apiType() != MFn::kMesh || shapePath_.apiType() != MFn::kMesh) {
+        MGlobal::displayError("transfer only works from a mesh to a mesh");
+        return MS::kFailure;
+    }
+
+    // source triangles in world space
+    MFnMesh sourceFn(sourcePath);
+    MPointArray pts;
+    sourceFn.getPoints(pts, MSpace::kWorld);
+    int nbSourceVertices = pts.length();
+    std::vector<double> sourcePoints(nbSourceVertices * 3);
+    for (int i = 0; i < nbSourceVertices; ++i) {
+        sourcePoints[i * 3] = pts[i].x;
+        sourcePoints[i * 3 + 1] = pts[i].y;
+        sourcePoints[i * 3 + 2] = pts[i].z;
+    }
+    MIntArray triangleCounts, triangleVertices;
+    sourceFn.getTriangles(triangleCounts, triangleVertices);
+    if (triangleVertices.length() == 0) {
+        MGlobal::displayError(sourcePath.partialPathName() + MString(" has no faces"));
+        return MS::kFailure;
+    }
+    std::vector<int> sourceTriangles(triangleVertices.length());
+    for (unsigned int i = 0; i < triangleVertices.length(); ++i)
+        sourceTriangles[i] = triangleVertices[i];
+
+    // source weights as sparse rows
+    MStringArray sourceNames;
+    MIntArray sourceLogicalIndices;
+    getInfluencesInfos(sourceSkinCluster, sourceNames, sourceLogicalIndices);
+    std::vector<int> sourceLogicalToPhysical;
+    getLogicalToPhysical(sourceLogicalIndices, sourceLogicalToPhysical);
+    WeightsBlock sourceBlock;
+    status = readSparseWeights(sourceSkinCluster, 0, nbSourceVertices, sourceLogicalToPhysical,
+                               sourceBlock);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    std::vector<size_t> sourceRows(nbSourceVertices + 1, 0);
+    for (int i = 0; i < nbSourceVertices; ++i)
+        sourceRows[i + 1] = sourceRows[i] + sourceBlock.counts[i];
+
+    // remap the influences by name, then by name without namespace
+    MStringArray influenceNames;
+    MIntArray logicalIndices;
+    getInfluencesInfos(skinCluster_, influenceNames, logicalIndices);
+    nbInfluences_ = influenceNames.length();
+    logicalIndices_ = logicalIndices;
+    MStringArray leafNames;
+    for (int j = 0; j < nbInfluences_; ++j) leafNames.append(leafName(influenceNames[j]));
+    std::vector<int> remap(sourceNames.length(), -1);
+    MString missing;
+    for (unsigned int i = 0; i < sourceNames.length(); ++i) {
+        int ind = influenceNames.indexOf(sourceNames[i]);
+        if (ind == -1) ind = leafNames.indexOf(leafName(sourceNames[i]));
+        remap[i] = ind;
+        if (ind == -1) missing += sourceNames[i] + MString(" ");
+    }
+    if (missing.length() > 0)
+        MGlobal::displayWarning(
+            MString("influences not in the target skinCluster, weights dropped : ") + missing);
+
+    // target vertices, sorted for the sparse rows
+    MFnMesh targetFn(shapePath_);
+    MPointArray targetPts;
+    targetFn.getPoints(targetPts, MSpace::kWorld);
+    int nbTargetVertices = targetPts.length();
+    std::vector<int> targetVertices;
+    if (maskVertices_.length() > 0) {
+        for (unsigned int i = 0; i < maskVertices_.length(); ++i) {
+            if (maskVertices_[i] < 0 || maskVertices_[i] >= nbTargetVertices) {
+                MGlobal::displayError(MString("index out of range : ") + maskVertices_[i]);
+                return MS::kFailure;
+            }
+            targetVertices.push_back(maskVertices_[i]);
+        }
+        std::sort(targetVertices.begin(), targetVertices.end());
+        targetVertices.erase(std::unique(targetVertices.begin(), targetVertices.end()),
+                             targetVertices.end());
+    } else {
+        targetVertices.resize(nbTargetVertices);
+        for (int i = 0; i < nbTargetVertices; ++i) targetVertices[i] = i;
+    }
+    int nbTargets = (int)targetVertices.size();
+    if (nbTargets == 0) return MS::kSuccess;
+
+    // closest points, queries are independent
+    TriangleBVH bvh;
+    bvh.build(sourcePoints, sourceTriangles);
+    std::vector<int> closestTriangles(nbTargets);
+    std::vector<double> barycentrics(nbTargets * 3);
+#pragma omp parallel for
+    for (int i = 0; i < nbTargets; ++i) {
+        const MPoint& pt = targetPts[targetVertices[i]];
+        double point[3] = {pt.x, pt.y, pt.z};
+        closestTriangles[i] = bvh.closestPoint(point, &barycentrics[i * 3]);
+    }
+
+    // one block from the first to the last target, the vertices out of the mask keep their
+    // current weights
+    int firstVertex = targetVertices.front();
+    int vertexCount = targetVertices.back() - firstVertex + 1;
+    WeightsBlock currentBlock;
+    if (vertexCount != nbTargets) {
+        std::vector<int> logicalToPhysical;
+        getLogicalToPhysical(logicalIndices, logicalToPhysical);
+        status = readSparseWeights(skinCluster_, firstVertex, vertexCount, logicalToPhysical,
+                                   currentBlock);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    redoBlock_.clear();
+    redoBlock_.firstVertex = firstVertex;
+    redoBlock_.counts.resize(vertexCount, 0);
+    std::vector<double> targetWeights(nbInfluences_, 0.0);
+    size_t currentEntry = 0;
+    int target = 0;
+    for (int i = 0; i < vertexCount; ++i) {
+        size_t rowStart = redoBlock_.weights.size();
+        if (target < nbTargets && targetVertices[target] == firstVertex + i) {
+            int t = closestTriangles[target];
+            double total = 0.0, keptTotal = 0.0;
+            for (int c = 0; c < 3; ++c) {
+                double barycentric = barycentrics[target * 3 + c];
+                if (barycentric == 0.0) continue;
+                int sourceVertex = sourceTriangles[t * 3 + c];
+                for (size_t e = sourceRows[sourceVertex]; e < sourceRows[sourceVertex + 1]; ++e) {
+                    double theWeight = barycentric * sourceBlock.weights[e];
+                    total += theWeight;
+                    int influence = remap[sourceBlock.influences[e]];
+                    if (influence == -1) continue;
+                    targetWeights[influence] += theWeight;
+                    keptTotal += theWeight;
+                }
+            }
+            double mult = keptTotal > 0.0 ? total / keptTotal : 0.0;
+            for (int j = 0; j < nbInfluences_; ++j) {
+                if (targetWeights[j] == 0.0) continue;
+                redoBlock_.influences.push_back(j);
+                redoBlock_.weights.push_back(targetWeights[j] * mult);
+                targetWeights[j] = 0.0;
+            }
+            ++target;
+            if (!currentBlock.counts.empty()) currentEntry += currentBlock.counts[i];
+        } else {
+            for (uint32_t k = 0; k < currentBlock.counts[i]; ++k, ++currentEntry) {
+                redoBlock_.influences.push_back(currentBlock.influences[currentEntry]);
+                redoBlock_.weights.push_back(currentBlock.weights[currentEntry]);
+            }
+        }
+        redoBlock_.counts[i] = (uint32_t)(redoBlock_.weights.size() - rowStart);
+    }
+
+    status = writeSparseWeights(skinCluster_, logicalIndices_, redoBlock_, &undoBlock_);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (verbose)
+        MGlobal::displayInfo(MString("transferred ") + nbTargets + MString(" vertices from ") +
+                             sourcePath.partialPathName() + MString(" to ") +
+                             shapePath_.partialPathName());
+    setResult(nbTargets);
+    return MS::kSuccess;
+}
+
+MStatus blurSkinTransferCmd::redoIt() {
+    return writeSparseWeights(skinCluster_, logicalIndices_, redoBlock_);
+}
+
+MStatus blurSkinTransferCmd::undoIt() {
+    return writeSparseWeights(skinCluster_, logicalIndices_, undoBlock_);
+}
@@ -0,0 +1,349 @@
+#include "blurSkinWeightsBuffer.h"
+
+#include <maya/MFnDependencyNode.h>
+#include <maya/MPlug.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "functions.h"
+
+// flags shared by blurSkinGetWeights and blurSkinSetWeights
+static const char* kSkinClusterNameFlagShort = "-skn";
+static const char* kSkinClusterNameFlagLong = "-skinCluster";
+static const char* kMeshNameFlagShort = "-mn";
+static const char* kMeshNameFlagLong = "-meshName";
+static const char* kIndicesAddressFlagShort = "-ia";
+static const char* kIndicesAddressFlagLong = "-indicesAddress";
+static const char* kIndicesCountFlagShort = "-ic";
+static const char* kIndicesCountFlagLong = "-indicesCount";
+static const char* kAddressFlagShort = "-ad";
+static const char* kAddressFlagLong = "-address";
+static const char* kRowsAddressFlagShort = "-ra";
+static const char* kRowsAddressFlagLong = "-rowsAddress";
+static const char* kColumnsAddressFlagShort = "-ca";
+static const char* kColumnsAddressFlagLong = "-columnsAddress";
+static const char* kBufferSizeFlagShort = "-bsz";
+static const char* kBufferSizeFlagLong = "-bufferSize";
+static const char* kSparseFlagShort = "-sp";
+static const char* kSparseFlagLong = "-sparse";
+static const char* kVerboseFlagShort = "-vrb";
+static const char* kVerboseFlagLong = "-verbose";
+
+const char* blurSkinGetWeightsCmd::kCountOnlyFlagShort = "-co";
+const char* blurSkinGetWeightsCmd::kCountOnlyFlagLong = "-countOnly";
+const char* blurSkinGetWeightsCmd::kPointCountFlagShort = "-pc";
+const char* blurSkinGetWeightsCmd::kPointCountFlagLong = "-pointCount";
+
+const char* blurSkinSetWeightsCmd::kNormalizeFlagShort = "-nr";
+const char* blurSkinSetWeightsCmd::kNormalizeFlagLong = "-normalize";
+
+static void addBufferFlags(MSyntax& syntax) {
+    syntax.addFlag(kSkinClusterNameFlagShort, kSkinClusterNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kMeshNameFlagShort, kMeshNameFlagLong, MSyntax::kString);
+    // addresses are strings, MSyntax::kLong is only 32 bits
+    syntax.addFlag(kIndicesAddressFlagShort, kIndicesAddressFlagLong, MSyntax::kString);
+    syntax.addFlag(kIndicesCountFlagShort, kIndicesCountFlagLong, MSyntax::kLong);
+    syntax.addFlag(kAddressFlagShort, kAddressFlagLong, MSyntax::kString);
+    syntax.addFlag(kRowsAddressFlagShort, kRowsAddressFlagLong, MSyntax::kString);
+    syntax.addFlag(kColumnsAddressFlagShort, kColumnsAddressFlagLong, MSyntax::kString);
+    syntax.addFlag(kBufferSizeFlagShort, kBufferSizeFlagLong, MSyntax::kLong);
+    syntax.addFlag(kSparseFlagShort, kSparseFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kVerboseFlagShort, kVerboseFlagLong, MSyntax::kBoolean);
+}
+
+static uint64_t getAddress(MArgDatabase& argData, const char* flag) {
+    if (!argData.isFlagSet(flag)) return 0;
+    MString addressStr = argData.flagArgumentString(flag, 0);
+    // base 0 accepts "0x..." as returned by hex(arr.ctypes.data)
+    return (uint64_t)strtoull(addressStr.asChar(), nullptr, 0);
+}
+
+static MStatus gatherBufferArgs(MArgDatabase& argData, WeightsBufferArgs& bufferArgs) {
+    MStatus status;
+    if (argData.isFlagSet(kVerboseFlagShort))
+        bufferArgs.verbose = argData.flagArgumentBool(kVerboseFlagShort, 0, &status);
+    if (argData.isFlagSet(kSkinClusterNameFlagShort))
+        bufferArgs.skinClusterName = argData.flagArgumentString(kSkinClusterNameFlagShort, 0);
+    if (argData.isFlagSet(kMeshNameFlagShort))
+        bufferArgs.meshName = argData.flagArgumentString(kMeshNameFlagShort, 0);
+    if (argData.isFlagSet(kSparseFlagShort))
+        bufferArgs.sparse = argData.flagArgumentBool(kSparseFlagShort, 0, &status);
+    if (argData.isFlagSet(kBufferSizeFlagShort))
+        bufferArgs.bufferSize = argData.flagArgumentInt(kBufferSizeFlagShort, 0, &status);
+    if (argData.isFlagSet(kIndicesCountFlagShort))
+        bufferArgs.indicesCount = argData.flagArgumentInt(kIndicesCountFlagShort, 0, &status);
+    bufferArgs.indicesAddress = getAddress(argData, kIndicesAddressFlagShort);
+    bufferArgs.valuesAddress = getAddress(argData, kAddressFlagShort);
+    bufferArgs.rowsAddress = getAddress(argData, kRowsAddressFlagShort);
+    bufferArgs.columnsAddress = getAddress(argData, kColumnsAddressFlagShort);
+
+    status = getSkinClusterAndShape(bufferArgs.skinClusterName, bufferArgs.meshName,
+                                    bufferArgs.skinCluster, bufferArgs.shapePath,
+                                    bufferArgs.verbose);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    MFnSkinCluster theSkinCluster(bufferArgs.skinCluster);
+    MDagPathArray listOfJoints;
+    bufferArgs.nbInfluences = theSkinCluster.influenceObjects(listOfJoints);
+
+    int nbPoints = getGeometryPointCount(bufferArgs.shapePath);
+    if (bufferArgs.indicesAddress != 0) {
+        if (bufferArgs.indicesCount < 0) {
+            MGlobal::displayError("-indicesAddress needs -indicesCount");
+            return MS::kFailure;
+        }
+        const int* indicesPtr = reinterpret_cast<const int*>(bufferArgs.indicesAddress);
+        bufferArgs.indices = MIntArray(indicesPtr, bufferArgs.indicesCount);
+        for (int i = 0; i < bufferArgs.indicesCount; ++i) {
+            if (indicesPtr[i] < 0 || indicesPtr[i] >= nbPoints) {
+                MGlobal::displayError(MString("index out of range : ") + indicesPtr[i]);
+                return MS::kFailure;
+            }
+        }
+    } else {
+        bufferArgs.indices.setLength(nbPoints);
+        for (int i = 0; i < nbPoints; ++i) bufferArgs.indices[i] = i;
+    }
+    return MS::kSuccess;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Get
+// ------------------------------------------------------------------------------------------------
+void* blurSkinGetWeightsCmd::creator() { return new blurSkinGetWeightsCmd(); }
+
+MSyntax blurSkinGetWeightsCmd::newSyntax() {
+    MSyntax syntax;
+    addBufferFlags(syntax);
+    syntax.addFlag(kCountOnlyFlagShort, kCountOnlyFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kPointCountFlagShort, kPointCountFlagLong);
+    return syntax;
+}
+
+MStatus blurSkinGetWeightsCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    WeightsBufferArgs bufferArgs;
+    status = gatherBufferArgs(argData, bufferArgs);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    // number of points of the shape, to size the buffers
+    if (argData.isFlagSet(kPointCountFlagShort)) {
+        setResult((int)bufferArgs.indices.length());
+        return MS::kSuccess;
+    }
+    bool countOnly = false;
+    if (argData.isFlagSet(kCountOnlyFlagShort))
+        countOnly = argData.flagArgumentBool(kCountOnlyFlagShort, 0, &status);
+
+    if (bufferArgs.sparse || countOnly) return getSparse(bufferArgs, countOnly);
+    return getDense(bufferArgs);
+}
+
+MStatus blurSkinGetWeightsCmd::getDense(WeightsBufferArgs& bufferArgs) {
+    MStatus status;
+    int nbIndices = bufferArgs.indices.length();
+    int nbValues = nbIndices * bufferArgs.nbInfluences;
+    if (bufferArgs.valuesAddress == 0 || bufferArgs.bufferSize < nbValues) {
+        MGlobal::displayError(MString("-address needs a buffer of ") + nbValues +
+                              MString(" doubles"));
+        return MS::kFailure;
+    }
+    double* values = reinterpret_cast<double*>(bufferArgs.valuesAddress);
+
+    MFn::Type fType = bufferArgs.shapePath.apiType();
+    if (fType == MFn::kNurbsSurface || fType == MFn::kNurbsCurve) {
+        // getWeights is not reliable on nurbs, read the plugs
+        memset(values, 0, sizeof(double) * nbValues);
+        MStringArray influenceNames;
+        MIntArray logicalIndices;
+        getInfluencesInfos(bufferArgs.skinCluster, influenceNames, logicalIndices);
+        std::vector<int> logicalToPhysical;
+        getLogicalToPhysical(logicalIndices, logicalToPhysical);
+        int nbLogical = (int)logicalToPhysical.size();
+
+        MFnDependencyNode skinClusterDep(bufferArgs.skinCluster);
+        MPlug weight_list_plug = skinClusterDep.findPlug("weightList", false);
+        for (int i = 0; i < nbIndices; ++i) {
+            MPlug plug_weights =
+                weight_list_plug.elementByLogicalIndex(bufferArgs.indices[i]).child(0);
+            int nb_weights = plug_weights.numElements();
+            for (int j = 0; j < nb_weights; ++j) {
+                MPlug weight_plug = plug_weights.elementByPhysicalIndex(j);
+                int indexInfluence = weight_plug.logicalIndex();
+                if (indexInfluence >= nbLogical || logicalToPhysical[indexInfluence] == -1)
+                    continue;
+                values[i * bufferArgs.nbInfluences + logicalToPhysical[indexInfluence]] =
+                    weight_plug.asDouble();
+            }
+        }
+    } else {
+        MObject component;
+        status = buildGeometryComponent(bufferArgs.shapePath, bufferArgs.indices, component);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+
+        MFnSkinCluster theSkinCluster(bufferArgs.skinCluster);
+        MDoubleArray weights;
+        unsigned int infCount;
+        status = theSkinCluster.getWeights(bufferArgs.shapePath, component, weights, infCount);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        if ((int)weights.length() != nbValues) {
+            MGlobal::displayError("unexpected weights count from the skinCluster");
+            return MS::kFailure;
+        }
+        weights.get(values);
+    }
+    setResult(bufferArgs.nbInfluences);
+    return MS::kSuccess;
+}
+
+MStatus blurSkinGetWeightsCmd::getSparse(WeightsBufferArgs& bufferArgs, bool countOnly) {
+    int nbIndices = bufferArgs.indices.length();
+    MStringArray influenceNames;
+    MIntArray logicalIndices;
+    getInfluencesInfos(bufferArgs.skinCluster, influenceNames, logicalIndices);
+    std::vector<int> logicalToPhysical;
+    getLogicalToPhysical(logicalIndices, logicalToPhysical);
+    int nbLogical = (int)logicalToPhysical.size();
+
+    int* rows = nullptr;
+    int* columns = nullptr;
+    double* values = nullptr;
+    if (!countOnly) {
+        if (bufferArgs.rowsAddress == 0 || bufferArgs.columnsAddress == 0 ||
+            bufferArgs.valuesAddress == 0) {
+            MGlobal::displayError("-sparse needs -rowsAddress, -columnsAddress and -address");
+            return MS::kFailure;
+        }
+        rows = reinterpret_cast<int*>(bufferArgs.rowsAddress);
+        columns = reinterpret_cast<int*>(bufferArgs.columnsAddress);
+        values = reinterpret_cast<double*>(bufferArgs.valuesAddress);
+        rows[0] = 0;
+    }
+
+    MFnDependencyNode skinClusterDep(bufferArgs.skinCluster);
+    MPlug weight_list_plug = skinClusterDep.findPlug("weightList", false);
+    int nnz = 0;
+    for (int i = 0; i < nbIndices; ++i) {
+        MPlug plug_weights = weight_list_plug.elementByLogicalIndex(bufferArgs.indices[i]).child(0);
+        int nb_weights = plug_weights.numElements();
+        for (int j = 0; j < nb_weights; ++j) {
+            MPlug weight_plug = plug_weights.elementByPhysicalIndex(j);
+            int indexInfluence = weight_plug.logicalIndex();
+            if (indexInfluence >= nbLogical || logicalToPhysical[indexInfluence] == -1) continue;
+            double theWeight = weight_plug.asDouble();
+            if (theWeight == 0.0) continue;
+            if (!countOnly) {
+                if (nnz >= bufferArgs.bufferSize) {
+                    MGlobal::displayError(
+                        "buffer too small, query the size first with -countOnly");
+                    return MS::kFailure;
+                }
+                columns[nnz] = logicalToPhysical[indexInfluence];
+                values[nnz] = theWeight;
+            }
+            ++nnz;
+        }
+        if (!countOnly) rows[i + 1] = nnz;
+    }
+    setResult(nnz);
+    return MS::kSuccess;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Set
+// ------------------------------------------------------------------------------------------------
+void* blurSkinSetWeightsCmd::creator() { return new blurSkinSetWeightsCmd(); }
+
+MSyntax blurSkinSetWeightsCmd::newSyntax() {
+    MSyntax syntax;
+    addBufferFlags(syntax);
+    syntax.addFlag(kNormalizeFlagShort, kNormalizeFlagLong, MSyntax::kBoolean);
+    return syntax;
+}
+
+MStatus blurSkinSetWeightsCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    WeightsBufferArgs bufferArgs;
+    status = gatherBufferArgs(argData, bufferArgs);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (argData.isFlagSet(kNormalizeFlagShort))
+        normalize_ = argData.flagArgumentBool(kNormalizeFlagShort, 0, &status);
+
+    int nbIndices = bufferArgs.indices.length();
+    int nbInfluences = bufferArgs.nbInfluences;
+    int nbValues = nbIndices * nbInfluences;
+    if (bufferArgs.valuesAddress == 0) {
+        MGlobal::displayError("-address is required");
+        return MS::kFailure;
+    }
+    const double* values = reinterpret_cast<const double*>(bufferArgs.valuesAddress);
+
+    if (bufferArgs.sparse) {
+        if (bufferArgs.rowsAddress == 0 || bufferArgs.columnsAddress == 0) {
+            MGlobal::displayError("-sparse needs -rowsAddress and -columnsAddress");
+            return MS::kFailure;
+        }
+        const int* rows = reinterpret_cast<const int*>(bufferArgs.rowsAddress);
+        const int* columns = reinterpret_cast<const int*>(bufferArgs.columnsAddress);
+        // the rows must be increasing and stay in the values buffer
+        if (rows[0] < 0) {
+            MGlobal::displayError(MString("rows start out of range : ") + rows[0]);
+            return MS::kFailure;
+        }
+        for (int i = 0; i < nbIndices; ++i) {
+            if (rows[i + 1] < rows[i]) {
+                MGlobal::displayError(MString("rows are not increasing at : ") + i);
+                return MS::kFailure;
+            }
+        }
+        if (rows[nbIndices] > bufferArgs.bufferSize) {
+            MGlobal::displayError("rows reference more values than -bufferSize");
+            return MS::kFailure;
+        }
+        newWeights_ = MDoubleArray(nbValues, 0.0);
+        for (int i = 0; i < nbIndices; ++i) {
+            for (int k = rows[i]; k < rows[i + 1]; ++k) {
+                if (columns[k] < 0 || columns[k] >= nbInfluences) {
+                    MGlobal::displayError(MString("influence index out of range : ") +
+                                          columns[k]);
+                    return MS::kFailure;
+                }
+                newWeights_[i * nbInfluences + columns[k]] = values[k];
+            }
+        }
+    } else {
+        if (bufferArgs.bufferSize < nbValues) {
+            MGlobal::displayError(MString("-address needs a buffer of ") + nbValues +
+                                  MString(" doubles"));
+            return MS::kFailure;
+        }
+        newWeights_ = MDoubleArray(values, nbValues);
+    }
+
+    skinCluster_ = bufferArgs.skinCluster;
+    shapePath_ = bufferArgs.shapePath;
+    influenceIndices_.setLength(nbInfluences);
+    for (int j = 0; j < nbInfluences; ++j) influenceIndices_[j] = j;
+    status = buildGeometryComponent(shapePath_, bufferArgs.indices, component_);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    return redoIt();
+}
+
+MStatus blurSkinSetWeightsCmd::redoIt() {
+    MFnSkinCluster theSkinCluster(skinCluster_);
+    return theSkinCluster.setWeights(shapePath_, component_, influenceIndices_, newWeights_,
+                                     normalize_, &oldWeights_);
+}
+
+MStatus blurSkinSetWeightsCmd::undoIt() {
+    MFnSkinCluster theSkinCluster(skinCluster_);
+    return theSkinCluster.setWeights(shapePath_, component_, influenceIndices_, oldWeights_,
+                                     false);
+}
@@ -0,0 +1,444 @@
+#include "blurSkinWeightsIO.h"
+
+#include <maya/MDGModifier.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MPlug.h>
+#include <maya/MTimer.h>
+
+#include <string>
+
+#include "functions.h"
+
+const char* blurSkinExportCmd::kSkinClusterNameFlagShort = "-skn";
+const char* blurSkinExportCmd::kSkinClusterNameFlagLong = "-skinCluster";
+const char* blurSkinExportCmd::kMeshNameFlagShort = "-mn";
+const char* blurSkinExportCmd::kMeshNameFlagLong = "-meshName";
+const char* blurSkinExportCmd::kFileFlagShort = "-f";
+const char* blurSkinExportCmd::kFileFlagLong = "-file";
+const char* blurSkinExportCmd::kBlockSizeFlagShort = "-bs";
+const char* blurSkinExportCmd::kBlockSizeFlagLong = "-blockSize";
+const char* blurSkinExportCmd::kCompressFlagShort = "-c";
+const char* blurSkinExportCmd::kCompressFlagLong = "-compress";
+const char* blurSkinExportCmd::kVerboseFlagShort = "-vrb";
+const char* blurSkinExportCmd::kVerboseFlagLong = "-verbose";
+const char* blurSkinExportCmd::kHelpFlagShort = "-h";
+const char* blurSkinExportCmd::kHelpFlagLong = "-help";
+
+const char* blurSkinImportCmd::kSkinClusterNameFlagShort = "-skn";
+const char* blurSkinImportCmd::kSkinClusterNameFlagLong = "-skinCluster";
+const char* blurSkinImportCmd::kMeshNameFlagShort = "-mn";
+const char* blurSkinImportCmd::kMeshNameFlagLong = "-meshName";
+const char* blurSkinImportCmd::kFileFlagShort = "-f";
+const char* blurSkinImportCmd::kFileFlagLong = "-file";
+const char* blurSkinImportCmd::kForceFlagShort = "-fo";
+const char* blurSkinImportCmd::kForceFlagLong = "-force";
+const char* blurSkinImportCmd::kNormalizeFlagShort = "-nr";
+const char* blurSkinImportCmd::kNormalizeFlagLong = "-normalize";
+const char* blurSkinImportCmd::kVerboseFlagShort = "-vrb";
+const char* blurSkinImportCmd::kVerboseFlagLong = "-verbose";
+const char* blurSkinImportCmd::kHelpFlagShort = "-h";
+const char* blurSkinImportCmd::kHelpFlagLong = "-help";
+
+static void DisplayExportHelp() {
+    MString help;
+    help += "Flags:\n";
+    help += "-skinCluster         -skn   String     Name of the skinCluster\n";
+    help += "-meshName            -mn    String     Name of the mesh if skincluster is not passed\n";
+    help += "                                          If -skn and -mn are not passed uses selection\n";
+    help += "-file                -f     String     Path of the binary weights file\n";
+    help += "-blockSize           -bs    Int        Vertices per block               default 4096\n";
+    help += "-compress            -c     Bool       Compress the blocks (zlib)       default True\n";
+    help += "-verbose             -vrb   Bool       Verbose print\n";
+    help += "-help                -h     N/A        Display this text.\n";
+    MGlobal::displayInfo(help);
+}
+
+static void DisplayImportHelp() {
+    MString help;
+    help += "Flags:\n";
+    help += "-skinCluster         -skn   String     Name of the skinCluster\n";
+    help += "-meshName            -mn    String     Name of the mesh if skincluster is not passed\n";
+    help += "                                          If -skn and -mn are not passed uses selection\n";
+    help += "-file                -f     String     Path of the binary weights file\n";
+    help += "-force               -fo    Bool       Import even if the topology differs\n";
+    help += "                                          only the common vertices are set\n";
+    help += "-normalize           -nr    Bool       Renormalize vertices with weights on\n";
+    help += "                                          influences missing in the skinCluster  default True\n";
+    help += "-verbose             -vrb   Bool       Verbose print\n";
+    help += "-help                -h     N/A        Display this text.\n";
+    MGlobal::displayInfo(help);
+}
+
+MStatus readSparseWeights(MObject& skinCluster, int firstVertex, int vertexCount,
+                          const std::vector<int>& logicalToPhysical, WeightsBlock& block) {
+    MStatus status;
+    MFnDependencyNode skinClusterDep(skinCluster);
+    MPlug weight_list_plug = skinClusterDep.findPlug("weightList", false, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    block.clear();
+    block.firstVertex = firstVertex;
+    block.counts.resize(vertexCount, 0);
+    int nbLogical = (int)logicalToPhysical.size();
+    for (int i = 0; i < vertexCount; ++i) {
+        // weightList[i].weight
+        MPlug ith_weights_plug = weight_list_plug.elementByLogicalIndex(firstVertex + i);
+        MPlug plug_weights = ith_weights_plug.child(0);
+        int nb_weights = plug_weights.numElements();
+        uint32_t count = 0;
+        for (int j = 0; j < nb_weights; ++j) {
+            MPlug weight_plug = plug_weights.elementByPhysicalIndex(j);
+            double theWeight = weight_plug.asDouble();
+            if (theWeight == 0.0) continue;
+            int indexInfluence = weight_plug.logicalIndex();
+            // weights of removed influences stay in the array
+            if (indexInfluence >= nbLogical || logicalToPhysical[indexInfluence] == -1) continue;
+            block.influences.push_back(logicalToPhysical[indexInfluence]);
+            block.weights.push_back(theWeight);
+            ++count;
+        }
+        block.counts[i] = count;
+    }
+    return MS::kSuccess;
+}
+
+// index of the influence in the row, -1 if it's not there or zero
+static inline long long findInRow(const WeightsBlock& block, size_t rowStart, size_t rowEnd,
+                                  uint32_t influence) {
+    for (size_t e = rowStart; e < rowEnd; ++e) {
+        if (block.influences[e] == influence) return block.weights[e] != 0.0 ? (long long)e : -1;
+    }
+    return -1;
+}
+
+MStatus writeSparseWeights(MObject& skinCluster, const MIntArray& logicalIndices,
+                           const WeightsBlock& block, WeightsBlock* oldBlock) {
+    MStatus status;
+    int vertexCount = block.vertexCount();
+    if (vertexCount == 0) return MS::kSuccess;
+    uint32_t nbInfluences = logicalIndices.length();
+
+    std::vector<int> logicalToPhysical;
+    getLogicalToPhysical(logicalIndices, logicalToPhysical);
+    WeightsBlock currentBlock;
+    status = readSparseWeights(skinCluster, block.firstVertex, vertexCount, logicalToPhysical,
+                               currentBlock);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    MFnDependencyNode skinClusterDep(skinCluster);
+    MPlug weight_list_plug = skinClusterDep.findPlug("weightList", false, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    // the rows are written in place, nothing is dense
+    MDGModifier removeModifier;
+    bool hasRemoved = false;
+    size_t rowStart = 0, currentRowStart = 0;
+    for (int i = 0; i < vertexCount; ++i) {
+        size_t rowEnd = rowStart + block.counts[i];
+        size_t currentRowEnd = currentRowStart + currentBlock.counts[i];
+        // weightList[i].weight
+        MPlug plug_weights =
+            weight_list_plug.elementByLogicalIndex(block.firstVertex + i).child(0);
+        for (size_t e = rowStart; e < rowEnd; ++e) {
+            uint32_t influence = block.influences[e];
+            double theWeight = block.weights[e];
+            if (influence >= nbInfluences) {
+                MGlobal::displayError(MString("influence index out of range : ") + influence);
+                return MS::kFailure;
+            }
+            if (theWeight == 0.0) continue;
+            long long current = findInRow(currentBlock, currentRowStart, currentRowEnd, influence);
+            if (current != -1 && currentBlock.weights[current] == theWeight) continue;
+            MPlug weight_plug = plug_weights.elementByLogicalIndex(logicalIndices[influence]);
+            status = weight_plug.setDouble(theWeight);
+            CHECK_MSTATUS_AND_RETURN_IT(status);
+        }
+        // the previous weights not in the new row
+        for (size_t e = currentRowStart; e < currentRowEnd; ++e) {
+            uint32_t influence = currentBlock.influences[e];
+            if (findInRow(block, rowStart, rowEnd, influence) != -1) continue;
+            MPlug weight_plug = plug_weights.elementByLogicalIndex(logicalIndices[influence]);
+            removeModifier.removeMultiInstance(weight_plug, false);
+            hasRemoved = true;
+        }
+        rowStart = rowEnd;
+        currentRowStart = currentRowEnd;
+    }
+    if (hasRemoved) {
+        status = removeModifier.doIt();
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    if (oldBlock) *oldBlock = std::move(currentBlock);
+    return MS::kSuccess;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Export
+// ------------------------------------------------------------------------------------------------
+void* blurSkinExportCmd::creator() { return new blurSkinExportCmd(); }
+
+MSyntax blurSkinExportCmd::newSyntax() {
+    MSyntax syntax;
+    syntax.addFlag(kSkinClusterNameFlagShort, kSkinClusterNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kMeshNameFlagShort, kMeshNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kFileFlagShort, kFileFlagLong, MSyntax::kString);
+    syntax.addFlag(kBlockSizeFlagShort, kBlockSizeFlagLong, MSyntax::kLong);
+    syntax.addFlag(kCompressFlagShort, kCompressFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kVerboseFlagShort, kVerboseFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kHelpFlagShort, kHelpFlagLong);
+    return syntax;
+}
+
+MStatus blurSkinExportCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kHelpFlagShort)) {
+        DisplayExportHelp();
+        return MS::kSuccess;
+    }
+    if (argData.isFlagSet(kVerboseFlagShort))
+        verbose = argData.flagArgumentBool(kVerboseFlagShort, 0, &status);
+    if (argData.isFlagSet(kSkinClusterNameFlagShort))
+        skinClusterName_ = argData.flagArgumentString(kSkinClusterNameFlagShort, 0, &status);
+    if (argData.isFlagSet(kMeshNameFlagShort))
+        meshName_ = argData.flagArgumentString(kMeshNameFlagShort, 0, &status);
+    if (argData.isFlagSet(kBlockSizeFlagShort))
+        blockSize_ = std::max(1, argData.flagArgumentInt(kBlockSizeFlagShort, 0, &status));
+    if (argData.isFlagSet(kCompressFlagShort))
+        compress_ = argData.flagArgumentBool(kCompressFlagShort, 0, &status);
+    if (!argData.isFlagSet(kFileFlagShort)) {
+        MGlobal::displayError("-file is required");
+        return MS::kFailure;
+    }
+    filePath_ = argData.flagArgumentString(kFileFlagShort, 0, &status);
+
+    MObject skinCluster;
+    MDagPath shapePath;
+    status = getSkinClusterAndShape(skinClusterName_, meshName_, skinCluster, shapePath, verbose);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    MTimer timer;
+    timer.beginTimer();
+
+    MStringArray influenceNames;
+    MIntArray logicalIndices;
+    getInfluencesInfos(skinCluster, influenceNames, logicalIndices);
+    std::vector<int> logicalToPhysical;
+    getLogicalToPhysical(logicalIndices, logicalToPhysical);
+
+    int nbVertices = getGeometryPointCount(shapePath);
+    WeightsFileWriter writer;
+    status = writer.open(filePath_, getTopologyHash(shapePath), nbVertices, blockSize_,
+                         influenceNames, compress_);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    // stream the blocks, only one block of sparse rows is in memory
+    WeightsBlock block;
+    size_t nnz = 0;
+    for (int first = 0; first < nbVertices; first += blockSize_) {
+        int vertexCount = std::min(blockSize_, nbVertices - first);
+        status = readSparseWeights(skinCluster, first, vertexCount, logicalToPhysical, block);
+        if (status != MS::kSuccess) {
+            MGlobal::displayError(MString("failed reading the weights of vertex ") + first);
+            writer.close();
+            return status;
+        }
+        status = writer.writeBlock(block);
+        if (status != MS::kSuccess) {
+            MGlobal::displayError(MString("failed writing ") + filePath_);
+            writer.close();
+            return status;
+        }
+        nnz += block.weights.size();
+    }
+    status = writer.close();
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    timer.endTimer();
+    if (verbose)
+        MGlobal::displayInfo(MString("exported ") + nbVertices + MString(" vertices, ") +
+                             (int)nnz + MString(" weights, ") + influenceNames.length() +
+                             MString(" influences in ") + timer.elapsedTime() + MString("s"));
+    setResult(nbVertices);
+    return MS::kSuccess;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Import
+// ------------------------------------------------------------------------------------------------
+void* blurSkinImportCmd::creator() { return new blurSkinImportCmd(); }
+
+MSyntax blurSkinImportCmd::newSyntax() {
+    MSyntax syntax;
+    syntax.addFlag(kSkinClusterNameFlagShort, kSkinClusterNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kMeshNameFlagShort, kMeshNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kFileFlagShort, kFileFlagLong, MSyntax::kString);
+    syntax.addFlag(kForceFlagShort, kForceFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kNormalizeFlagShort, kNormalizeFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kVerboseFlagShort, kVerboseFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kHelpFlagShort, kHelpFlagLong);
+    return syntax;
+}
+
+MStatus blurSkinImportCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kHelpFlagShort)) {
+        DisplayImportHelp();
+        return MS::kSuccess;
+    }
+    if (argData.isFlagSet(kVerboseFlagShort))
+        verbose = argData.flagArgumentBool(kVerboseFlagShort, 0, &status);
+    if (argData.isFlagSet(kSkinClusterNameFlagShort))
+        skinClusterName_ = argData.flagArgumentString(kSkinClusterNameFlagShort, 0, &status);
+    if (argData.isFlagSet(kMeshNameFlagShort))
+        meshName_ = argData.flagArgumentString(kMeshNameFlagShort, 0, &status);
+    if (argData.isFlagSet(kForceFlagShort))
+        force_ = argData.flagArgumentBool(kForceFlagShort, 0, &status);
+    if (argData.isFlagSet(kNormalizeFlagShort))
+        normalize_ = argData.flagArgumentBool(kNormalizeFlagShort, 0, &status);
+    if (!argData.isFlagSet(kFileFlagShort)) {
+        MGlobal::displayError("-file is required");
+        return MS::kFailure;
+    }
+    filePath_ = argData.flagArgumentString(kFileFlagShort, 0, &status);
+
+    status = getSkinClusterAndShape(skinClusterName_, meshName_, skinCluster_, shapePath_,
+                                    verbose);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    WeightsFileReader reader;
+    status = reader.open(filePath_);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    const WeightsFileHeader& header = reader.header();
+
+    int nbVertices = getGeometryPointCount(shapePath_);
+    if (header.topologyHash != getTopologyHash(shapePath_)) {
+        if (!force_) {
+            MGlobal::displayError(MString("topology of ") + shapePath_.partialPathName() +
+                                  MString(" differs from the file, use -force to import anyway"));
+            return MS::kFailure;
+        }
+        MGlobal::displayWarning(MString("topology differs, file has ") + (int)header.numVertices +
+                                MString(" vertices, shape has ") + nbVertices);
+    }
+
+    // remap the influences by name, then by name without namespace
+    MStringArray influenceNames;
+    MIntArray logicalIndices;
+    getInfluencesInfos(skinCluster_, influenceNames, logicalIndices);
+    logicalIndices_ = logicalIndices;
+    int nbInfluences = influenceNames.length();
+    MStringArray leafNames;
+    for (int j = 0; j < nbInfluences; ++j) leafNames.append(leafName(influenceNames[j]));
+
+    const MStringArray& fileNames = reader.influenceNames();
+    std::vector<int> remap(fileNames.length(), -1);
+    MString missing;
+    for (unsigned int i = 0; i < fileNames.length(); ++i) {
+        int ind = influenceNames.indexOf(fileNames[i]);
+        if (ind == -1) ind = leafNames.indexOf(leafName(fileNames[i]));
+        remap[i] = ind;
+        if (ind == -1) missing += fileNames[i] + MString(" ");
+    }
+    if (missing.length() > 0)
+        MGlobal::displayWarning(MString("influences not in the skinCluster, weights dropped : ") +
+                                missing);
+
+    // stream the blocks from the mapped file to the skinCluster
+    undoBlocks_.clear();
+    redoBlocks_.clear();
+    undoBlocks_.reserve(reader.numBlocks());
+    redoBlocks_.reserve(reader.numBlocks());
+    int nbVerticesSet = 0;
+    for (int b = 0; b < reader.numBlocks(); ++b) {
+        WeightsBlockView view;
+        status = reader.getBlock(b, view);
+        // the rows must cover the values and reference the influences of the file
+        if (status == MS::kSuccess) {
+            uint64_t nbEntries = 0;
+            for (int i = 0; i < view.vertexCount; ++i) nbEntries += view.counts[i];
+            if (nbEntries != (uint64_t)view.nnz) status = MS::kFailure;
+            for (int k = 0; k < view.nnz && status == MS::kSuccess; ++k) {
+                if (view.influences[k] >= fileNames.length()) status = MS::kFailure;
+            }
+        }
+        if (status != MS::kSuccess) {
+            MGlobal::displayError(MString("corrupted block ") + b + MString(" in ") + filePath_);
+            undoIt();
+            return MS::kFailure;
+        }
+        if (view.firstVertex >= nbVertices) continue;
+        int vertexCount = std::min(view.vertexCount, nbVertices - view.firstVertex);
+
+        WeightsBlock block;
+        block.firstVertex = view.firstVertex;
+        block.counts.resize(vertexCount, 0);
+        int entry = 0;
+        for (int i = 0; i < vertexCount; ++i) {
+            size_t rowStart = block.weights.size();
+            double fileTotal = 0.0, keptTotal = 0.0;
+            for (uint32_t k = 0; k < view.counts[i]; ++k, ++entry) {
+                double theWeight = view.weights[entry];
+                fileTotal += theWeight;
+                int target = remap[view.influences[entry]];
+                if (target == -1) continue;
+                keptTotal += theWeight;
+                // two file influences can land on the same one by leaf name
+                bool merged = false;
+                for (size_t r = rowStart; r < block.weights.size(); ++r) {
+                    if (block.influences[r] == (uint32_t)target) {
+                        block.weights[r] += theWeight;
+                        merged = true;
+                        break;
+                    }
+                }
+                if (!merged) {
+                    block.influences.push_back(target);
+                    block.weights.push_back(theWeight);
+                }
+            }
+            block.counts[i] = (uint32_t)(block.weights.size() - rowStart);
+            if (normalize_ && keptTotal > 0.0 && keptTotal != fileTotal) {
+                double mult = fileTotal / keptTotal;
+                for (size_t r = rowStart; r < block.weights.size(); ++r) block.weights[r] *= mult;
+            }
+        }
+        WeightsBlock oldBlock;
+        status = writeSparseWeights(skinCluster_, logicalIndices_, block, &oldBlock);
+        if (status != MS::kSuccess) {
+            undoIt();
+            return status;
+        }
+        undoBlocks_.push_back(std::move(oldBlock));
+        redoBlocks_.push_back(std::move(block));
+        nbVerticesSet += vertexCount;
+    }
+    if (verbose)
+        MGlobal::displayInfo(MString("imported ") + nbVerticesSet + MString(" vertices from ") +
+                             filePath_);
+    setResult(nbVerticesSet);
+    return MS::kSuccess;
+}
+
+MStatus blurSkinImportCmd::redoIt() {
+    MStatus status;
+    for (size_t b = 0; b < redoBlocks_.size(); ++b) {
+        status = writeSparseWeights(skinCluster_, logicalIndices_, redoBlocks_[b]);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    return MS::kSuccess;
+}
+
+MStatus blurSkinImportCmd::undoIt() {
+    MStatus status;
+    for (size_t b = undoBlocks_.size(); b-- > 0;) {
+        status = writeSparseWeights(skinCluster_, logicalIndices_, undoBlocks_[b]);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    return MS::kSuccess;
+}
@@ -609,3 +609,309 @@ MStatus doPruneWeight(MDoubleArray& theWeights, int nbJoints, double pruneCutWei
     }
     return MS::kSuccess;
 };
+
+// from the names passed to a command (or the selection) retrieves the skinCluster and its shape
+MStatus getSkinClusterAndShape(const MString& skinClusterName, const MString& meshName,
+                               MObject& theSkinCluster, MDagPath& shapePath, bool verbose) {
+    MStatus stat;
+    MSelectionList selList;
+    bool hasShape = false;
+
+    if (meshName.length() > 0) {
+        stat = selList.add(meshName);
+        if (stat != MS::kSuccess) {
+            MGlobal::displayError(MString("can not find mesh ") + meshName);
+            return MS::kFailure;
+        }
+        selList.getDagPath(0, shapePath);
+        shapePath.extendToShape();
+        hasShape = true;
+        selList.clear();
+    }
+    if (skinClusterName.length() > 0) {
+        stat = selList.add(skinClusterName);
+        if (stat != MS::kSuccess) {
+            MGlobal::displayError(MString("can not find skinCluster ") + skinClusterName);
+            return MS::kFailure;
+        }
+        selList.getDependNode(0, theSkinCluster);
+        if (theSkinCluster.apiType() != MFn::kSkinClusterFilter) {
+            MGlobal::displayError(skinClusterName + MString(" is not a skinCluster"));
+            return MS::kFailure;
+        }
+        if (!hasShape) {
+            MFnSkinCluster theSkinClusterFn(theSkinCluster);
+            stat = theSkinClusterFn.getPathAtIndex(0, shapePath);
+            if (stat != MS::kSuccess) {
+                MGlobal::displayError(skinClusterName + MString(" deforms no geometry"));
+                return MS::kFailure;
+            }
+        }
+        return MS::kSuccess;
+    }
+    if (!hasShape) {
+        MGlobal::getActiveSelectionList(selList);
+        if (selList.length() == 0) {
+            MGlobal::displayError("select a skinned shape or pass -skinCluster / -meshName");
+            return MS::kFailure;
+        }
+        MObject component;
+        selList.getDagPath(0, shapePath, component);
+        shapePath.extendToShape();
+    }
+    stat = findSkinCluster(shapePath, theSkinCluster, 0, verbose);
+    if (stat != MS::kSuccess) {
+        MGlobal::displayError(MString("can not find skinCluster on ") + shapePath.fullPathName());
+        return MS::kFailure;
+    }
+    return MS::kSuccess;
+}
+
+// influences names in the physical order of influenceObjects and their logical index in the
+// skinCluster matrix array
+MStatus getInfluencesInfos(MObject& skinCluster, MStringArray& influenceNames,
+                           MIntArray& logicalIndices) {
+    MStatus stat;
+    MFnSkinCluster theSkinCluster(skinCluster);
+    MDagPathArray listOfJoints;
+    int nbJoints = theSkinCluster.influenceObjects(listOfJoints, &stat);
+    influenceNames.clear();
+    logicalIndices.clear();
+    for (int i = 0; i < nbJoints; ++i) {
+        influenceNames.append(listOfJoints[i].partialPathName());
+        logicalIndices.append(theSkinCluster.indexForInfluenceObject(listOfJoints[i], &stat));
+    }
+    return stat;
+}
+
+// logical index of the skinCluster matrix -> index in influenceObjects, -1 if unused
+void getLogicalToPhysical(const MIntArray& logicalIndices, std::vector<int>& logicalToPhysical) {
+    int maxLogical = -1;
+    for (unsigned int i = 0; i < logicalIndices.length(); ++i)
+        maxLogical = std::max(maxLogical, logicalIndices[i]);
+    logicalToPhysical.assign(maxLogical + 1, -1);
+    for (unsigned int i = 0; i < logicalIndices.length(); ++i)
+        logicalToPhysical[logicalIndices[i]] = i;
+}
+
+// strips the dag path and namespaces
+MString leafName(const MString& name) {
+    std::string str = name.asChar();
+    size_t pos = str.find_last_of("|:");
+    if (pos == std::string::npos) return name;
+    return MString(str.substr(pos + 1).c_str());
+}
+
+// the periodic CVs are not stored in the skinCluster
+void getNurbsCVsCount(MFnNurbsSurface& surfaceFn, int& numCVsInU, int& numCVsInV) {
+    numCVsInU = surfaceFn.numCVsInU();
+    numCVsInV = surfaceFn.numCVsInV();
+    if (surfaceFn.formInU() == MFnNurbsSurface::kPeriodic) numCVsInU -= surfaceFn.degreeU();
+    if (surfaceFn.formInV() == MFnNurbsSurface::kPeriodic) numCVsInV -= surfaceFn.degreeV();
+}
+
+int getGeometryPointCount(const MDagPath& shapePath) {
+    MFn::Type fType = shapePath.apiType();
+    if (fType == MFn::kMesh) {
+        MFnMesh meshFn(shapePath);
+        return meshFn.numVertices();
+    } else if (fType == MFn::kNurbsSurface) {
+        MFnNurbsSurface surfaceFn(shapePath);
+        int numCVsInU, numCVsInV;
+        getNurbsCVsCount(surfaceFn, numCVsInU, numCVsInV);
+        return numCVsInU * numCVsInV;
+    } else if (fType == MFn::kNurbsCurve) {
+        MFnNurbsCurve curveFn(shapePath);
+        return curveFn.numCVs();
+    } else if (fType == MFn::kLattice) {
+        MFnLattice latticeFn(shapePath);
+        unsigned int divS, divT, divU;
+        latticeFn.getDivisions(divS, divT, divU);
+        return divS * divT * divU;
+    }
+    return 0;
+}
+
+// build the component of the shape for flat point indices, empty indices is the complete
+// component.
+//     nurbs   : index = u * numCVsInV + v
+//     lattice : index = u * divS * divT + t * divS + s
+MStatus buildGeometryComponent(const MDagPath& shapePath, const MIntArray& indices,
+                               MObject& component) {
+    MFn::Type fType = shapePath.apiType();
+    int nbIndices = indices.length();
+    if (fType == MFn::kMesh || fType == MFn::kNurbsCurve) {
+        MFnSingleIndexedComponent singleFn;
+        component = singleFn.create(fType == MFn::kMesh ? MFn::kMeshVertComponent
+                                                        : MFn::kCurveCVComponent);
+        if (nbIndices == 0)
+            singleFn.setCompleteData(getGeometryPointCount(shapePath));
+        else
+            singleFn.addElements(const_cast<MIntArray&>(indices));
+    } else if (fType == MFn::kNurbsSurface) {
+        MFnNurbsSurface surfaceFn(shapePath);
+        int numCVsInU, numCVsInV;
+        getNurbsCVsCount(surfaceFn, numCVsInU, numCVsInV);
+        MFnDoubleIndexedComponent doubleFn;
+        component = doubleFn.create(MFn::kSurfaceCVComponent);
+        if (nbIndices == 0) {
+            doubleFn.setCompleteData(numCVsInU, numCVsInV);
+        } else {
+            MIntArray uIndices(nbIndices), vIndices(nbIndices);
+            for (int i = 0; i < nbIndices; ++i) {
+                uIndices[i] = indices[i] / numCVsInV;
+                vIndices[i] = indices[i] % numCVsInV;
+            }
+            doubleFn.addElements(uIndices, vIndices);
+        }
+    } else if (fType == MFn::kLattice) {
+        MFnLattice latticeFn(shapePath);
+        unsigned int divS, divT, divU;
+        latticeFn.getDivisions(divS, divT, divU);
+        MFnTripleIndexedComponent tripleFn;
+        component = tripleFn.create(MFn::kLatticeComponent);
+        if (nbIndices == 0) {
+            tripleFn.setCompleteData(divS, divT, divU);
+        } else {
+            MIntArray sIndices(nbIndices), tIndices(nbIndices), uIndices(nbIndices);
+            int divST = divS * divT;
+            for (int i = 0; i < nbIndices; ++i) {
+                int ind = indices[i];
+                uIndices[i] = ind / divST;
+                tIndices[i] = (ind % divST) / divS;
+                sIndices[i] = ind % divS;
+            }
+            tripleFn.addElements(sIndices, tIndices, uIndices);
+        }
+    } else {
+        return MS::kFailure;
+    }
+    return MS::kSuccess;
+}
+
+MStatus buildGeometryComponentRange(const MDagPath& shapePath, int first, int count,
+                                    MObject& component) {
+    MIntArray indices(count);
+    for (int i = 0; i < count; ++i) indices[i] = first + i;
+    return buildGeometryComponent(shapePath, indices, component);
+}
+
+// FNV-1a of the point count and connectivity, only used to detect topology changes
+static inline void hashInt(uint64_t& hash, int64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (uint64_t)((value >> (i * 8)) & 0xFF);
+        hash *= 1099511628211ULL;
+    }
+}
+
+uint64_t getTopologyHash(const MDagPath& shapePath) {
+    uint64_t hash = 14695981039346656037ULL;
+    MFn::Type fType = shapePath.apiType();
+    hashInt(hash, (int64_t)fType);
+    hashInt(hash, getGeometryPointCount(shapePath));
+    if (fType == MFn::kMesh) {
+        MFnMesh meshFn(shapePath);
+        MIntArray vertexCount, vertexList;
+        meshFn.getVertices(vertexCount, vertexList);
+        for (unsigned int i = 0; i < vertexCount.length(); ++i) hashInt(hash, vertexCount[i]);
+        for (unsigned int i = 0; i < vertexList.length(); ++i) hashInt(hash, vertexList[i]);
+    } else if (fType == MFn::kNurbsSurface) {
+        MFnNurbsSurface surfaceFn(shapePath);
+        hashInt(hash, surfaceFn.degreeU());
+        hashInt(hash, surfaceFn.degreeV());
+        hashInt(hash, surfaceFn.formInU());
+        hashInt(hash, surfaceFn.formInV());
+        hashInt(hash, surfaceFn.numCVsInU());
+        hashInt(hash, surfaceFn.numCVsInV());
+    } else if (fType == MFn::kNurbsCurve) {
+        MFnNurbsCurve curveFn(shapePath);
+        hashInt(hash, curveFn.degree());
+        hashInt(hash, curveFn.form());
+    }
+    return hash;
+}
+
+void buildMeshAdjacency(MFnMesh& meshFn, std::vector<int>& adjacencyStarts,
+                        std::vector<int>& adjacencyIndices) {
+    int nbVertices = meshFn.numVertices();
+    int nbEdges = meshFn.numEdges();
+    std::vector<int> edgeVertices(2 * nbEdges);
+    adjacencyStarts.assign(nbVertices + 1, 0);
+    int2 edge;
+    for (int e = 0; e < nbEdges; ++e) {
+        meshFn.getEdgeVertices(e, edge);
+        edgeVertices[2 * e] = edge[0];
+        edgeVertices[2 * e + 1] = edge[1];
+        ++adjacencyStarts[edge[0] + 1];
+        ++adjacencyStarts[edge[1] + 1];
+    }
+    for (int i = 0; i < nbVertices; ++i) adjacencyStarts[i + 1] += adjacencyStarts[i];
+    adjacencyIndices.resize(adjacencyStarts[nbVertices]);
+    std::vector<int> fill(adjacencyStarts.begin(), adjacencyStarts.end() - 1);
+    for (int e = 0; e < nbEdges; ++e) {
+        adjacencyIndices[fill[edgeVertices[2 * e]]++] = edgeVertices[2 * e + 1];
+        adjacencyIndices[fill[edgeVertices[2 * e + 1]]++] = edgeVertices[2 * e];
+    }
+}
+
+static inline void multiplyCSR(const std::vector<int>& rows, const std::vector<int>& columns,
+                               const std::vector<double>& values, const std::vector<double>& x,
+                               std::vector<double>& result) {
+    int size = (int)rows.size() - 1;
+    for (int i = 0; i < size; ++i) {
+        double sum = 0.0;
+        for (int k = rows[i]; k < rows[i + 1]; ++k) sum += values[k] * x[columns[k]];
+        result[i] = sum;
+    }
+}
+
+int solveConjugateGradient(const std::vector<int>& rows, const std::vector<int>& columns,
+                           const std::vector<double>& values, const std::vector<double>& rhs,
+                           std::vector<double>& x, double tolerance, int maxIterations) {
+    int size = (int)rows.size() - 1;
+    if (size <= 0) return 0;
+
+    std::vector<double> invDiagonal(size, 1.0);
+    for (int i = 0; i < size; ++i) {
+        for (int k = rows[i]; k < rows[i + 1]; ++k) {
+            if (columns[k] == i && values[k] != 0.0) invDiagonal[i] = 1.0 / values[k];
+        }
+    }
+    std::vector<double> residual(size), preconditioned(size), direction(size), product(size);
+    multiplyCSR(rows, columns, values, x, product);
+    double rhsNorm = 0.0, rz = 0.0;
+    for (int i = 0; i < size; ++i) {
+        residual[i] = rhs[i] - product[i];
+        preconditioned[i] = invDiagonal[i] * residual[i];
+        direction[i] = preconditioned[i];
+        rz += residual[i] * preconditioned[i];
+        rhsNorm += rhs[i] * rhs[i];
+    }
+    // tolerance is relative to the right hand side
+    double threshold = tolerance * tolerance * std::max(rhsNorm, 1e-30);
+
+    int iteration = 0;
+    for (; iteration < maxIterations; ++iteration) {
+        double residualNorm = 0.0;
+        for (int i = 0; i < size; ++i) residualNorm += residual[i] * residual[i];
+        if (residualNorm <= threshold) break;
+
+        multiplyCSR(rows, columns, values, direction, product);
+        double pAp = 0.0;
+        for (int i = 0; i < size; ++i) pAp += direction[i] * product[i];
+        if (pAp <= 0.0) break;
+        double alpha = rz / pAp;
+
+        double rzNext = 0.0;
+        for (int i = 0; i < size; ++i) {
+            x[i] += alpha * direction[i];
+            residual[i] -= alpha * product[i];
+            preconditioned[i] = invDiagonal[i] * residual[i];
+            rzNext += residual[i] * preconditioned[i];
+        }
+        double beta = rzNext / rz;
+        rz = rzNext;
+        for (int i = 0; i < size; ++i) direction[i] = preconditioned[i] + beta * direction[i];
+    }
+    return iteration;
+}
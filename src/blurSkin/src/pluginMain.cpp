@@ -1,7 +1,14 @@
 #include <maya/MFnPlugin.h>
 
+#include "blurSkinAnalyze.h"
 #include "blurSkinCmd.h"
 #include "blurSkinEdit.h"
+#include "blurSkinJournal.h"
+#include "blurSkinMap.h"
+#include "blurSkinMirror.h"
+#include "blurSkinTransfer.h"
+#include "blurSkinWeightsBuffer.h"
+#include "blurSkinWeightsIO.h"
 #include "pointsDisplay.h"
 #include "version.h"
 
@@ -12,6 +19,42 @@ MStatus initializePlugin(MObject obj) {
     status = plugin.registerCommand("blurSkinCmd", blurSkinCmd::creator, blurSkinCmd::newSyntax);
     CHECK_MSTATUS_AND_RETURN_IT(status);
 
+    status = plugin.registerCommand("blurSkinExport", blurSkinExportCmd::creator,
+                                    blurSkinExportCmd::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.registerCommand("blurSkinImport", blurSkinImportCmd::creator,
+                                    blurSkinImportCmd::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.registerCommand("blurSkinGetWeights", blurSkinGetWeightsCmd::creator,
+                                    blurSkinGetWeightsCmd::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.registerCommand("blurSkinSetWeights", blurSkinSetWeightsCmd::creator,
+                                    blurSkinSetWeightsCmd::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.registerCommand("blurSkinJournal", blurSkinJournalCmd::creator,
+                                    blurSkinJournalCmd::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.registerCommand("blurSkinMirror", blurSkinMirrorCmd::creator,
+                                    blurSkinMirrorCmd::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.registerCommand("blurSkinTransfer", blurSkinTransferCmd::creator,
+                                    blurSkinTransferCmd::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.registerCommand("blurSkinMap", blurSkinMapCmd::creator,
+                                    blurSkinMapCmd::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.registerCommand("blurSkinAnalyze", blurSkinAnalyzeCmd::creator,
+                                    blurSkinAnalyzeCmd::newSyntax);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
     status = plugin.registerNode("blurSkinDisplay", blurSkinDisplay::id, blurSkinDisplay::creator,
                                  blurSkinDisplay::initialize);
 
@@ -47,6 +90,34 @@ MStatus uninitializePlugin(MObject obj) {
     status = plugin.deregisterCommand("blurSkinCmd");
     CHECK_MSTATUS_AND_RETURN_IT(status);
 
+    status = plugin.deregisterCommand("blurSkinExport");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.deregisterCommand("blurSkinImport");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.deregisterCommand("blurSkinGetWeights");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.deregisterCommand("blurSkinSetWeights");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    clearSkinClusterJournals();
+    status = plugin.deregisterCommand("blurSkinJournal");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.deregisterCommand("blurSkinMirror");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.deregisterCommand("blurSkinTransfer");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.deregisterCommand("blurSkinMap");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    status = plugin.deregisterCommand("blurSkinAnalyze");
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
     status = plugin.deregisterNode(blurSkinDisplay::id);
     if (!status) {
         status.perror("deregisterNode");
@@ -0,0 +1,288 @@
+#include "weightsFile.h"
+
+#include <maya/MGlobal.h>
+
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef BLURSKIN_USE_ZLIB
+#include <zlib.h>
+#endif
+
+// ------------------------------------------------------------------------------------------------
+// Writer
+// ------------------------------------------------------------------------------------------------
+WeightsFileWriter::~WeightsFileWriter() {
+    if (stream_.is_open()) stream_.close();
+}
+
+void WeightsFileWriter::writePadding() {
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    std::streamoff position = stream_.tellp();
+    int padding = (int)((8 - (position % 8)) % 8);
+    if (padding) stream_.write(zeros, padding);
+}
+
+MStatus WeightsFileWriter::open(const MString& path, uint64_t topologyHash, int numVertices,
+                                int blockSize, const MStringArray& influenceNames, bool compress) {
+    stream_.open(path.asChar(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream_.is_open()) {
+        MGlobal::displayError(MString("can not open file for writing ") + path);
+        return MS::kFailure;
+    }
+#ifdef BLURSKIN_USE_ZLIB
+    compress_ = compress;
+#else
+    if (compress)
+        MGlobal::displayWarning("plugin built without zlib, blocks are written uncompressed");
+    compress_ = false;
+#endif
+    blockTable_.clear();
+
+    memset(&header_, 0, sizeof(header_));
+    header_.magic = WEIGHTS_FILE_MAGIC;
+    header_.version = WEIGHTS_FILE_VERSION;
+    header_.topologyHash = topologyHash;
+    header_.numVertices = numVertices;
+    header_.numInfluences = influenceNames.length();
+    header_.blockSize = blockSize;
+    header_.namesOffset = sizeof(WeightsFileHeader);
+    // header is rewritten on close, once the block table is known
+    stream_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+
+    for (unsigned int i = 0; i < influenceNames.length(); ++i) {
+        uint32_t nameLength = influenceNames[i].length();
+        stream_.write(reinterpret_cast<const char*>(&nameLength), sizeof(nameLength));
+        stream_.write(influenceNames[i].asChar(), nameLength);
+    }
+    writePadding();
+    return stream_.good() ? MS::kSuccess : MS::kFailure;
+}
+
+MStatus WeightsFileWriter::writeBlock(const WeightsBlock& block) {
+    WeightsBlockEntry entry;
+    entry.firstVertex = block.firstVertex;
+    entry.vertexCount = block.vertexCount();
+    entry.nnz = (uint32_t)block.weights.size();
+    entry.codec = kCodecRaw;
+
+    size_t weightsSize = block.weights.size() * sizeof(double);
+    size_t countsSize = block.counts.size() * sizeof(uint32_t);
+    size_t influencesSize = block.influences.size() * sizeof(uint32_t);
+    entry.rawSize = weightsSize + countsSize + influencesSize;
+
+    rawBuffer_.resize(entry.rawSize);
+    char* dst = rawBuffer_.data();
+    if (weightsSize) memcpy(dst, block.weights.data(), weightsSize);
+    if (countsSize) memcpy(dst + weightsSize, block.counts.data(), countsSize);
+    if (influencesSize)
+        memcpy(dst + weightsSize + countsSize, block.influences.data(), influencesSize);
+
+    const char* toWrite = rawBuffer_.data();
+    entry.storedSize = entry.rawSize;
+#ifdef BLURSKIN_USE_ZLIB
+    if (compress_ && entry.rawSize > 0) {
+        uLongf compressedSize = compressBound((uLong)entry.rawSize);
+        compressedBuffer_.resize(compressedSize);
+        int res = compress2(reinterpret_cast<Bytef*>(compressedBuffer_.data()), &compressedSize,
+                            reinterpret_cast<const Bytef*>(rawBuffer_.data()),
+                            (uLong)entry.rawSize, Z_BEST_SPEED);
+        // keep the block raw when it does not shrink
+        if (res == Z_OK && compressedSize < entry.rawSize) {
+            entry.codec = kCodecZlib;
+            entry.storedSize = compressedSize;
+            toWrite = compressedBuffer_.data();
+        }
+    }
+#endif
+    entry.offset = (uint64_t)stream_.tellp();
+    stream_.write(toWrite, entry.storedSize);
+    writePadding();
+    blockTable_.push_back(entry);
+    return stream_.good() ? MS::kSuccess : MS::kFailure;
+}
+
+MStatus WeightsFileWriter::close() {
+    if (!stream_.is_open()) return MS::kFailure;
+    header_.numBlocks = (uint32_t)blockTable_.size();
+    header_.blockTableOffset = (uint64_t)stream_.tellp();
+    if (!blockTable_.empty())
+        stream_.write(reinterpret_cast<const char*>(blockTable_.data()),
+                      blockTable_.size() * sizeof(WeightsBlockEntry));
+    stream_.seekp(0);
+    stream_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+    bool isGood = stream_.good();
+    stream_.close();
+    return isGood ? MS::kSuccess : MS::kFailure;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Reader
+// ------------------------------------------------------------------------------------------------
+WeightsFileReader::~WeightsFileReader() { close(); }
+
+MStatus WeightsFileReader::map(const MString& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.asChar(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return MS::kFailure;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return MS::kFailure;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return MS::kFailure;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return MS::kFailure;
+    }
+    fileHandle_ = file;
+    mappingHandle_ = mapping;
+    size_ = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(path.asChar(), O_RDONLY);
+    if (fd == -1) return MS::kFailure;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == -1 || fileStat.st_size == 0) {
+        ::close(fd);
+        return MS::kFailure;
+    }
+    void* data = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        return MS::kFailure;
+    }
+    madvise(data, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+    fileDescriptor_ = fd;
+    size_ = (size_t)fileStat.st_size;
+#endif
+    data_ = static_cast<const unsigned char*>(data);
+    return MS::kSuccess;
+}
+
+void WeightsFileReader::close() {
+    if (data_) {
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+#else
+        munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+    }
+#ifdef _WIN32
+    if (mappingHandle_) CloseHandle(mappingHandle_);
+    if (fileHandle_) CloseHandle(fileHandle_);
+    mappingHandle_ = nullptr;
+    fileHandle_ = nullptr;
+#else
+    if (fileDescriptor_ != -1) ::close(fileDescriptor_);
+    fileDescriptor_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    blockTable_ = nullptr;
+    influenceNames_.clear();
+}
+
+MStatus WeightsFileReader::open(const MString& path) {
+    close();
+    if (map(path) != MS::kSuccess) {
+        MGlobal::displayError(MString("can not open file for reading ") + path);
+        return MS::kFailure;
+    }
+    if (size_ < sizeof(WeightsFileHeader)) {
+        MGlobal::displayError(path + MString(" is not a skin weights file"));
+        close();
+        return MS::kFailure;
+    }
+    memcpy(&header_, data_, sizeof(header_));
+    if (header_.magic != WEIGHTS_FILE_MAGIC) {
+        MGlobal::displayError(path + MString(" is not a skin weights file"));
+        close();
+        return MS::kFailure;
+    }
+    if (header_.version > WEIGHTS_FILE_VERSION) {
+        MGlobal::displayError(path + MString(" was written by a newer version of the plugin"));
+        close();
+        return MS::kFailure;
+    }
+    uint64_t tableEnd =
+        header_.blockTableOffset + (uint64_t)header_.numBlocks * sizeof(WeightsBlockEntry);
+    if (tableEnd > size_ || (header_.blockTableOffset % 8) != 0) {
+        MGlobal::displayError(path + MString(" is truncated"));
+        close();
+        return MS::kFailure;
+    }
+    blockTable_ = reinterpret_cast<const WeightsBlockEntry*>(data_ + header_.blockTableOffset);
+
+    // influences names
+    size_t position = (size_t)header_.namesOffset;
+    for (uint32_t i = 0; i < header_.numInfluences; ++i) {
+        uint32_t nameLength;
+        if (position + sizeof(nameLength) > size_) break;
+        memcpy(&nameLength, data_ + position, sizeof(nameLength));
+        position += sizeof(nameLength);
+        if (position + nameLength > size_) break;
+        MString name;
+        name.set(reinterpret_cast<const char*>(data_ + position), nameLength);
+        influenceNames_.append(name);
+        position += nameLength;
+    }
+    if (influenceNames_.length() != header_.numInfluences) {
+        MGlobal::displayError(path + MString(" has corrupted influences names"));
+        close();
+        return MS::kFailure;
+    }
+    return MS::kSuccess;
+}
+
+MStatus WeightsFileReader::getBlock(int blockIndex, WeightsBlockView& view) {
+    if (!data_ || blockIndex < 0 || blockIndex >= (int)header_.numBlocks) return MS::kFailure;
+    const WeightsBlockEntry& entry = blockTable_[blockIndex];
+    if (entry.offset > size_ || entry.storedSize > size_ - entry.offset) return MS::kFailure;
+    if ((uint64_t)entry.firstVertex + entry.vertexCount > header_.numVertices)
+        return MS::kFailure;
+
+    // the decoded size is the one of the counts of the block
+    uint64_t expectedSize = (uint64_t)entry.nnz * (sizeof(double) + sizeof(uint32_t)) +
+                            (uint64_t)entry.vertexCount * sizeof(uint32_t);
+    if (expectedSize != entry.rawSize) return MS::kFailure;
+
+    const unsigned char* raw = data_ + entry.offset;
+    if (entry.codec == kCodecZlib) {
+#ifdef BLURSKIN_USE_ZLIB
+        scratch_.resize((size_t)(entry.rawSize / sizeof(double)) + 1);
+        uLongf rawSize = (uLongf)entry.rawSize;
+        int res = uncompress(reinterpret_cast<Bytef*>(scratch_.data()), &rawSize,
+                             reinterpret_cast<const Bytef*>(raw), (uLong)entry.storedSize);
+        if (res != Z_OK || rawSize != entry.rawSize) return MS::kFailure;
+        raw = reinterpret_cast<const unsigned char*>(scratch_.data());
+#else
+        MGlobal::displayError("file has compressed blocks and the plugin is built without zlib");
+        return MS::kFailure;
+#endif
+    } else if (entry.codec != kCodecRaw || entry.storedSize != entry.rawSize) {
+        return MS::kFailure;
+    }
+    view.firstVertex = entry.firstVertex;
+    view.vertexCount = entry.vertexCount;
+    view.nnz = entry.nnz;
+    view.weights = reinterpret_cast<const double*>(raw);
+    view.counts = reinterpret_cast<const uint32_t*>(raw + entry.nnz * sizeof(double));
+    view.influences = view.counts + entry.vertexCount;
+    return MS::kSuccess;
+}
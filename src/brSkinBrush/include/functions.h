@@ -2,19 +2,26 @@
 #define _functions_h
 
 #include "enums.h"
+#include "sparseWeights.h"
+#include "vertexMaps.h"
 // MAYA HEADER FILES:
 
+#include <maya/MArrayDataHandle.h>
 #include <maya/MBoundingBox.h>
 #include <maya/MColorArray.h>
+#include <maya/MDataHandle.h>
 #include <maya/MDagPath.h>
 #include <maya/MDagPathArray.h>
 #include <maya/MFnDagNode.h>
 #include <maya/MFnDependencyNode.h>
+#include <maya/MFnDoubleArrayData.h>
 #include <maya/MFnIntArrayData.h>
 #include <maya/MFnMesh.h>
+#include <maya/MFnNumericAttribute.h>
 #include <maya/MFnNurbsSurface.h>
 #include <maya/MFnSingleIndexedComponent.h>
 #include <maya/MFnSkinCluster.h>
+#include <maya/MFnTypedAttribute.h>
 #include <maya/MGlobal.h>
 #include <maya/MItDependencyGraph.h>
 #include <maya/MMatrix.h>
@@ -22,6 +29,7 @@
 #include <maya/MObjectArray.h>
 #include <maya/MPlug.h>
 #include <maya/MPointArray.h>
+#include <maya/MSelectionList.h>
 
 #include <algorithm>
 #include <cstdint>
@@ -58,6 +66,11 @@ MStatus getListLockJoints(MObject& skinCluster, int nbJoints, MIntArray indicesF
                           MIntArray& jointsLocks);
 MStatus getListLockVertices(MObject& skinCluster, MIntArray& vertsLocks, MIntArray& lockedIndices);
 MStatus getSymetryAttributes(MObject& skinCluster, MIntArray& symetryList);
+// sparse weightList read through the data handles, rows are the vertices and columns the
+// influences in the order of influenceObjects, zero weights are skipped
+MStatus readWeightListCSR(MObject& skinCluster, MIntArray& indicesForInfluenceObjects,
+                          int numVertices, std::vector<int>& rows, std::vector<int>& columns,
+                          std::vector<double>& values);
 MStatus getMirrorVertices(MIntArray mirrorVertices, MIntArray& theEditVerts,
                           MIntArray& theMirrorVerts, MIntArray& editAndMirrorVerts,
                           MDoubleArray& editVertsWeights, MDoubleArray& mirrorVertsWeights,
@@ -74,14 +87,108 @@ MStatus editArrayMirror(ModifierCommands command, int influence, int influenceMi
                         MDoubleArray& theWeights, bool normalize = true, double mutliplier = 1.0,
                         bool verbose = false);
 
+// value is 1 at the center of the brush and 0 on its border, curve is the brush -curve flag
+double brushFalloffValue(int curve, double value, double strength);
+
 MStatus setAverageWeight(std::vector<int>& verticesAround, int currentVertex, int indexCurrVert,
                          int nbJoints, MIntArray& lockJoints, MDoubleArray& fullWeightArray,
                          MDoubleArray& theWeights, double strengthVal);
+
+// maps are painted like a skinCluster of one influence, see vertexMaps.h
+// single channel editArray and smooth: the values are clamped in [0, 1], no locks, no normalization
+void editMapArray(ModifierCommands command, const MDoubleArray& fullValues,
+                  const std::map<int, double>& valuesToSet, MDoubleArray& theValues,
+                  double mutliplier = 1.0);
+double getMapAverageValue(const std::vector<int>& verticesAround, const MDoubleArray& fullValues,
+                          double currentValue);
 MStatus doPruneWeight(MDoubleArray& theWeights, int nbJoints, double pruneCutWeight);
 MStatus transferPointNurbsToMesh(MFnMesh& msh, MFnNurbsSurface& nrbs);
+// index in getCVs of each vertex of the tessellation of the nurbs
+void getNurbsProxyVertexToCV(MFnNurbsSurface& nurbsFn, std::vector<int>& proxyVertexToCV);
+MStatus transferPointNurbsToMesh(MFnMesh& msh, MFnNurbsSurface& nrbs,
+                                 const std::vector<int>& proxyVertexToCV, MIntArray& vertices);
 
 bool RayIntersectsBBox(MPoint minPt, MPoint maxPt, MPoint Orig, MVector dest);
 
+// Influence boxes for the pick influence mode. Boxes are stored one array per component, with
+// the inverse of their matrix, so the ray tests of a leaf run in one loop. The bvh is built on
+// their world bounding boxes.
+#define PICK_BVH_LEAF_SIZE 4
+
+struct InfluencePickBVH {
+    void build(const std::vector<MMatrix>& matrices, const std::vector<MPoint>& minPts,
+               const std::vector<MPoint>& maxPts);
+    void clear();
+    bool empty() const { return boxIndices.empty(); }
+    // index of the box hit by the ray with the closest center, -1 if none
+    int closestHit(const MPoint& orig, const MVector& direction) const;
+
+    // boxes, in bvh order. boxIndices gives the index passed to build
+    std::vector<int> boxIndices;
+    std::vector<double> inverse[12];  // inverse matrices, 3 first columns of the 4 rows
+    std::vector<double> boxMin[3], boxMax[3];  // local
+    std::vector<double> center[3];             // world
+    // nodes, world bounding boxes. A leaf has its boxes in [first, first + count), an inner node
+    // has a count of 0 and its children at first and first + 1
+    std::vector<double> nodeMin[3], nodeMax[3];
+    std::vector<int> nodeFirst, nodeCount;
+    int depth = 0;  // levels below the root, sizes the traversal stack
+};
+
+// Uniform grid over the mesh points for the volume brush, in object space. The cells are hashed
+// in a table of buckets, cells sharing a bucket are sorted out by the distance test. The points
+// are copied, refresh and update only move the vertices that changed cell.
+struct VertexSpatialHash {
+    void build(const float* rawPoints, int numVertices, float cellSize);
+    void clear();
+    bool empty() const { return vertexBucket.empty(); }
+    // compares every point, returns the number of vertices that moved
+    int refresh(const float* rawPoints);
+    void update(const float* rawPoints, const MIntArray& vertices);
+    // vertices within radius of the center with their distance, the candidate buckets are walked
+    // in parallel
+    void query(const float* center, float radius, std::vector<std::pair<int, float>>& found) const;
+
+    float cellSize = 0.0f;
+    std::vector<float> points;
+    std::vector<std::vector<int>> buckets;
+    std::vector<unsigned int> vertexBucket;
+
+   private:
+    unsigned int bucketOf(const float* point) const;
+    unsigned int bucketOfCell(int x, int y, int z) const;
+    void moveVertex(int vertexIndex, const float* point);
+    unsigned int bucketMask = 0;
+};
+
+// Connectivity of the painted mesh in flat arrays. Rows are stored one after the other, the row i
+// of a table is in [starts[i], starts[i + 1]). Everything is built from the mesh arrays, without
+// maya call, so it can run on a worker.
+struct MeshTopology {
+    // faces, triangles and faces per vertex in one pass, enough for the hit
+    void buildFaces(int numVertices, const MIntArray& faceCounts, const MIntArray& faceConnects,
+                    const MIntArray& triangleCounts, const MIntArray& triangles);
+    // vertices sharing a face with each vertex, sorted, needs buildFaces
+    void buildVertexVertices();
+    // the 2 vertices of each edge, in edge order
+    void buildEdges(int numVertices, std::vector<int>& pairs);
+    void clear();
+    void swap(MeshTopology& other);
+    // memory held by the arrays
+    size_t byteSize() const;
+
+    const int* triangle(int face, int triangleIndex) const {
+        return &triangleVertices[3 * (faceTriangleStarts[face] + triangleIndex)];
+    }
+
+    std::vector<int> faceStarts, faceVertices;              // face -> vertices, in face order
+    std::vector<int> faceTriangleStarts, triangleVertices;  // face -> triangles, 3 vertices each
+    std::vector<int> vertexFaceStarts, vertexFaces;         // vertex -> faces
+    std::vector<int> vertexVertexStarts, vertexVertices;    // vertex -> vertices around
+    std::vector<int> edgeVertices;                          // 2 per edge
+    std::vector<int> vertexEdgeStarts, vertexEdges;         // vertex -> edges
+};
+
 bool bboxIntersection(const MPoint& minPoint, const MPoint& maxPoint, const MMatrix& bbSpace,
                       const MPoint& rayPoint, const MVector& rayVector, MPoint& intersection);
 
@@ -95,6 +202,9 @@ void getRawNeighbors(const MIntArray& counts, const MIntArray& indices, int numV
 void convertToCountIndex(const std::vector<std::unordered_set<int>>& input,
                          std::vector<int>& counts, std::vector<int>& indices);
 
+// vertex indices sorted along a morton curve of their positions, close vertices stay close
+void getMortonOrder(const float* rawPoints, int numVertices, std::vector<int>& order);
+
 float pack_float(float x, float y);
 int unpack_float(float f, float* x, float* y);
 
@@ -164,8 +164,33 @@
 #define kWeightOrderedIndicesFlag "-woi"
 #define kWeightOrderedIndicesFlagLong "-weightOrderedIndices"
 
+#define kInfluenceVerticesFlag "-ifv"
+#define kInfluenceVerticesFlagLong "-influenceVertices"
+
+#define kZeroInfluencesFlag "-zi"
+#define kZeroInfluencesFlagLong "-zeroInfluences"
+
+#define kWeightsReadTimingsFlag "-wrt"
+#define kWeightsReadTimingsFlagLong "-weightsReadTimings"
+
+#define kPaintMeshesFlag "-pms"
+#define kPaintMeshesFlagLong "-paintMeshes"
+
+#define kDragLatencyFlag "-dla"
+#define kDragLatencyFlagLong "-dragLatency"
+
+#define kSetupTimingsFlag "-sut"
+#define kSetupTimingsFlagLong "-setupTimings"
+
+#define kTopologyByteSizeFlag "-tbs"
+#define kTopologyByteSizeFlagLong "-topologyByteSize"
+
 #define kPickedInfluenceFlag "-pii"
 #define kPickedInfluenceFlagLong "-pickedInfluence"
 
 #define kAdjustValueFlag "-dv"
 #define kAdjustValueFlagLong "-dragValue"
+
+// per vertex map painted instead of the skinCluster, read at the next tool entry
+#define kMapAttributeFlag "-mpa"
+#define kMapAttributeFlagLong "-mapAttribute"
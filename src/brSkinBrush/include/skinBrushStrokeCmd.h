@@ -0,0 +1,131 @@
+// ---------------------------------------------------------------------
+//
+//  skinBrushStrokeCmd.h
+//  brSkinBrush
+//
+// ---------------------------------------------------------------------
+#ifndef __skinBrushTool__skinBrushStrokeCmd__
+#define __skinBrushTool__skinBrushStrokeCmd__
+
+#include "enums.h"
+#include "functions.h"
+
+#include <maya/MArgDatabase.h>
+#include <maya/MArgList.h>
+#include <maya/MDagPath.h>
+#include <maya/MDoubleArray.h>
+#include <maya/MFloatPoint.h>
+#include <maya/MIntArray.h>
+#include <maya/MMatrix.h>
+#include <maya/MMeshIntersector.h>
+#include <maya/MObject.h>
+#include <maya/MPoint.h>
+#include <maya/MPxCommand.h>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MStringArray.h>
+#include <maya/MSyntax.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// Runs the brush engine without a viewport, for scripts and batch painting.
+// A stroke is a list of world space points, or a curve sampled along its length. The points are
+// snapped on the closest point of the mesh, the dabs of a stroke are merged like a drag of the
+// brush and the command is applied to the weights in memory when the stroke ends. All the strokes
+// end in one setWeights and one undo.
+class skinBrushStrokeCmd : public MPxCommand {
+   public:
+    skinBrushStrokeCmd() {}
+    virtual ~skinBrushStrokeCmd() {}
+
+    MStatus doIt(const MArgList&);
+    MStatus undoIt();
+    MStatus redoIt();
+    bool isUndoable() const { return true; }
+    static void* creator();
+    static MSyntax newSyntax();
+
+    const static char* kMeshNameFlagShort;
+    const static char* kMeshNameFlagLong;
+    const static char* kPointFlagShort;
+    const static char* kPointFlagLong;
+    const static char* kStrokeCountFlagShort;
+    const static char* kStrokeCountFlagLong;
+    const static char* kCurveFlagShort;
+    const static char* kCurveFlagLong;
+    const static char* kSizeFlagShort;
+    const static char* kSizeFlagLong;
+    const static char* kStrengthFlagShort;
+    const static char* kStrengthFlagLong;
+    const static char* kFalloffFlagShort;
+    const static char* kFalloffFlagLong;
+    const static char* kCommandFlagShort;
+    const static char* kCommandFlagLong;
+    const static char* kInfluenceFlagShort;
+    const static char* kInfluenceFlagLong;
+    const static char* kMirrorFlagShort;
+    const static char* kMirrorFlagLong;
+    const static char* kMirrorInfluenceFlagShort;
+    const static char* kMirrorInfluenceFlagLong;
+    const static char* kSmoothRepeatFlagShort;
+    const static char* kSmoothRepeatFlagLong;
+    const static char* kVolumeFlagShort;
+    const static char* kVolumeFlagLong;
+    const static char* kIgnoreLockFlagShort;
+    const static char* kIgnoreLockFlagLong;
+    const static char* kVerboseFlagShort;
+    const static char* kVerboseFlagLong;
+    const static char* kHelpFlagShort;
+    const static char* kHelpFlagLong;
+
+   private:
+    MStatus getStrokes(const MArgDatabase& argData, std::vector<std::vector<MPoint>>& strokes);
+    MStatus getMeshData();
+    int getInfluenceIndex(const MString& influenceName);
+    // vertices under the brush with their distance to the hit, false if nothing is under it
+    bool getDab(const MPoint& worldPoint, bool mirror, std::unordered_map<int, float>& dicVertsDist);
+    // closest point of the surface on the current shape, origHitPoint receives it on the orig shape
+    bool getSurfacePoint(MMeshIntersector& intersector, const MPoint& point, MFloatPoint& hitPoint,
+                         int& faceHit, MFloatPoint* origHitPoint = nullptr);
+    std::vector<int> getSmoothNeighbors(int vertexIndex);
+    void addDab(std::unordered_map<int, float>& dicVertsDist,
+                std::unordered_map<int, float>& dicVertsDistPrevPaint,
+                std::vector<float>& intensityValues, std::unordered_map<int, float>& skinValToSet);
+    MStatus applyStroke(std::unordered_map<int, float>& valuesToSet,
+                        std::unordered_map<int, float>& valuesMirrorToSet);
+    MStatus setWeights(MDoubleArray& weights, MDoubleArray* oldWeights);
+
+    // settings
+    MString meshName_;
+    double size_ = 1.0, strength_ = 1.0;
+    int curve_ = 2, smoothRepeat_ = 3, paintMirror_ = 0;
+    ModifierCommands command_ = ModifierCommands::Add;
+    int influence_ = 0, mirrorInfluence_ = 0;
+    bool volume_ = false, ignoreLock_ = false, verbose = false;
+
+    MDagPath meshPath_;
+    MObject skinCluster_;
+    bool normalize_ = true;
+
+    // mesh and weights, cleared at the end of doIt
+    MStringArray influenceNames_;
+    int numVertices_ = 0, nbJoints_ = 0, maxInfluences_ = 0;
+    std::vector<float> points_, origPoints_;  // object space
+    std::unique_ptr<MMeshIntersector> intersector_, intersectorOrig_;
+    MeshTopology topology_;
+    VertexSpatialHash volumeHash_;
+    MDoubleArray fullWeights_;
+    MIntArray lockJoints_, ignoreLockJoints_, lockVertices_;
+    MFloatPoint origHitPoint_;
+    std::set<int> editedVertices_;
+
+    // undo
+    MIntArray influenceIndices_, undoVertices_;
+    MDoubleArray undoWeights_, redoWeights_;
+};
+
+#endif
@@ -18,16 +18,21 @@
 #include <maya/M3dView.h>
 #include <maya/MArgDatabase.h>
 #include <maya/MArgList.h>
+#include <maya/MBoundingBox.h>
+#include <maya/MCallbackIdArray.h>
 #include <maya/MCursor.h>
+#include <maya/MDagMessage.h>
 #include <maya/MDagPath.h>
 #include <maya/MDagPathArray.h>
 #include <maya/MEulerRotation.h>
 #include <maya/MEvent.h>
+#include <maya/MEventMessage.h>
 #include <maya/MFloatMatrix.h>
 #include <maya/MFloatPointArray.h>
 #include <maya/MFnCamera.h>
 #include <maya/MFnDoubleArrayData.h>
 #include <maya/MFnDoubleIndexedComponent.h>
+#include <maya/MFnGeometryFilter.h>
 #include <maya/MFnMatrixData.h>
 #include <maya/MFnMesh.h>
 #include <maya/MFnNurbsSurface.h>
@@ -42,7 +47,10 @@
 #include <maya/MItSelectionList.h>
 #include <maya/MMatrix.h>
 #include <maya/MMeshIntersector.h>
+#include <maya/MNodeMessage.h>
+#include <maya/MPlugArray.h>
 #include <maya/MPointArray.h>
+#include <maya/MProgressWindow.h>
 #include <maya/MPxContext.h>
 #include <maya/MPxContextCommand.h>
 #include <maya/MPxToolCommand.h>
@@ -65,8 +73,14 @@
 #include <rapidjson/stringbuffer.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <map>
+#include <memory>
 #include <numeric>  //std::iota
 #include <set>
 #include <unordered_map>
@@ -83,6 +97,82 @@
 #define CHECK_MSTATUS_AND_RETURN_SILENT(status) \
     if (status != MStatus::kSuccess) return MStatus::kSuccess;
 
+// The weights are loaded by pages of vertices close in space. The pages touched by the brush are
+// loaded first, the others on idle within the time budget. Small meshes are loaded at once.
+#define WEIGHT_PAGE_SIZE 4096
+#define WEIGHT_PAGES_LAZY_MIN 16
+#define WEIGHT_PAGES_IDLE_MS 20
+
+// vertices per chunk of the flood, each chunk is one setWeights call
+#define FLOOD_CHUNK_SIZE 16384
+
+// time budget of a drag event. Past it the next events only store their position, up to
+// DRAG_MAX_COALESCED of them. The next painted event paints the line through all of them and
+// applies it once, the weights are the ones of the full stroke. When it is still late, the color
+// write and the preview edges and points wait for an on-time event
+#define DRAG_EVENT_BUDGET_MS 16.0
+#define DRAG_MAX_COALESCED 8
+
+// the per vertex arrays of a paint mesh, held behind a pointer so parking a mesh does not copy them
+struct PaintMeshArrays {
+    // dense vertex * influence weights, the pages not read yet stay at 0
+    MDoubleArray skinWeightList, fullUndoSkinWeightList;
+    MIntArray lockVertices;
+    MDoubleArray soloColorsValues;
+    MColorArray multiCurrentColors, soloCurrentColors;  // lock vertices colors not stored here
+    MIntArray VertexCountPerPolygon, fullVertexList;
+    MVectorArray verticesNormals;
+    MIntArray verticesNormalsIndices;
+};
+
+// a skinned mesh of the paint session. The mesh under the brush lives in the context members, the
+// other ones are parked here with their weights, colors and topology, switching is a swap
+struct PaintMeshState {
+    MDagPath shapePath;
+    MObject skinCluster;
+    bool loaded = false;                   // read the first time the brush goes over it
+    MMeshIsectAccelParams hitAccelParams;  // for the hit test while parked
+
+    MDagPath origMeshDag;
+    MFloatMatrix inclusiveMatrix, inclusiveMatrixInverse;
+    unsigned int numVertices = 0, numFaces = 0, numEdges = 0;
+    MMeshIsectAccelParams accelParams, accelParamsOrigMesh;
+    std::unique_ptr<MMeshIntersector> intersectorOrigShape, intersector;
+    MObject allVtxCompObj;
+
+    MIntArray influenceIndices;
+    MDagPathArray inflDagPaths;
+    MStringArray inflNames;
+    MIntArray inflNamePixelSize;
+    bool maintainMaxInfluences = false;
+    unsigned int maxInfluences = 0;
+    bool normalize = true;
+    int nbJoints = 0, nbJointsBig = 0;
+    MIntArray deformersIndices, indicesForInfluenceObjects;
+    std::vector<std::vector<std::pair<int, float>>> skin_weights_;
+    std::unique_ptr<PaintMeshArrays> meshArrays{new PaintMeshArrays()};
+    std::vector<std::vector<int>> influenceVertices;
+
+    std::vector<int> vertexWeightPage;
+    std::vector<std::vector<int>> weightPagesVertices;
+    std::vector<bool> weightPageLoaded;
+    int nbWeightPagesLoaded = 0;
+    bool allWeightPagesLoaded = true;
+
+    // edits done while parked, refreshed when the mesh comes back under the brush
+    MCallbackIdArray weightsCallbackIds;
+    MObject weightListAttr, weightsAttr, lockWeightsAttr, lockedVerticesAttr;
+    std::set<int> dirtyVertices;
+    std::set<int> dirtyLockInfluences;
+    bool dirtyVerticesLocks = false;
+
+    MIntArray mirrorInfluences, lockJoints, ignoreLockJoints;
+    MColorArray jointsColors;
+
+    MeshTopology topology;
+    int fullVertexListLength = 0;
+};
+
 // struct to store the deformers when pick using D key
 struct drawingDeformers {
     MMatrix mat;
@@ -151,8 +241,10 @@ class skinBrushTool : public MPxToolCommand {
     void setNormalize(bool value);
 
     void setSkinCluster(MObject &skinCluster);
+    void setMapPlug(MPlug &plug);
     void setIsNurbs(bool value);
     void setnumCVInV(int value);
+    void setProxyVertexToCV(const std::vector<int> &value);
 
     void setSkinClusterName(MString &skinClusterName);
     MStatus getSkinClusterObj();
@@ -219,8 +311,10 @@ class skinBrushTool : public MPxToolCommand {
     MDagPath meshDag, nurbsDag;
     MObject skinObj;
     MString skinName;
+    MPlug mapPlug;  // null when the skinCluster is painted
     bool isNurbs = false;
     int numCVsInV_ = 0;
+    std::vector<int> proxyVertexToCV;  // CV of each vertex of the tessellation
 
     bool normalize;
     MString influenceName;
@@ -269,19 +363,42 @@ class SkinBrushContext : public MPxContext {
     MStatus doDragCommon(MEvent &event);
     MStatus doReleaseCommon(MEvent &event);
     void doTheAction();
+    void finalizeUndoCommand(ModifierCommands theCommandIndex, MIntArray &editVertsIndices,
+                             MDoubleArray &undoWeights, MIntArray &undoLocks,
+                             MIntArray &redoLocks);
+    void floodInChunks(ModifierCommands theCommandIndex, double value);
     ModifierCommands getCommandIndexModifiers() const;
+    void scheduleNextDragEvent(std::chrono::steady_clock::time_point eventStart);
     MStatus getMesh();
+    MStatus getMeshData();
+    MStatus setupPaintMesh();
     MStatus getTheOrigMeshForMirror();
-
-    void getConnectedVertices();
-    void getConnectedVerticesSecond();
-    void getConnectedVerticesThird();
+    // a per vertex map painted as a skinCluster of one influence, see -mapAttribute
+    MStatus getMapChannel();
+    MStatus fillMapValues();
+
+    // several skinned meshes in one session, the one under the brush is active
+    void collectPaintMeshes();
+    int getCloserPaintMesh(short screenPixelX, short screenPixelY, bool activeHit);
+    MStatus activatePaintMesh(int index);
+    void resumePaintMesh(PaintMeshState &state);
+    void swapPaintMeshState(PaintMeshState &state);
+    void addParkedWeightsCallbacks(PaintMeshState &state);
+    void clearPaintMeshes();
+    void refreshPaintMeshVertices(MObject &skinCluster, MIntArray &verticesIndices);
+    static void parkedWeightsChangedCallback(MNodeMessage::AttributeMessage msg, MPlug &plug,
+                                             MPlug &otherPlug, void *clientData);
+
+    // the topology is built from the mesh arrays on a worker thread, see getMeshData
     void getConnectedVerticesTyler();
-    void getConnectedVerticesFlatten();
+    void getMeshEdges();
+    void buildTopology(MIntArray triangleCounts, MIntArray triangleVertices, MIntArray normals);
+    // hitOnly returns as soon as the hover can run, otherwise the whole topology is waited for
+    void waitForTopology(bool hitOnly = false);
     std::vector<int> getSurroundingVerticesPerVert(int vertexIndex);
-    std::vector<int> getSurroundingVerticesPerFace(int vertexIndex);
+    std::vector<int> getSurroundingVerticesPerFace(int faceIndex);
 
-    void getFromMeshNormals();
+    void getFromMeshNormals(const MIntArray &normals);
     MStatus getSelection(MDagPath &dagPath);
     MStatus getSkinCluster(MDagPath &meshDag, MObject &skinClusterObj);
     void refreshJointsLocks();
@@ -290,15 +407,35 @@ class SkinBrushContext : public MPxContext {
     void refreshTheseVertices(MIntArray &verticesIndices);
     void refreshMirrorInfluences(MIntArray &inputMirrorInfluences);
 
+    // weights edited outside of the brush
+    void addWeightsCallbacks();
+    void removeWeightsCallbacks();
+    void refreshDirtyVertices();
+    static void weightsChangedCallback(MNodeMessage::AttributeMessage msg, MPlug &plug,
+                                       MPlug &otherPlug, void *clientData);
+    static void idleRefreshCallback(void *clientData);
+
+    // influences boxes for the pick influence mode, rebuilt when an influence moves
+    void fillInfluencesBoxes();
+    void removeInfluencesMatrixCallbacks();
+    static void influenceMatrixModifiedCallback(MObject &transformNode,
+                                                MDagMessage::MatrixModifiedFlags &modified,
+                                                void *clientData);
+
     void mergeMirrorArray(std::unordered_map<int, float> &valuesBase,
                           std::unordered_map<int, float> &valuesMirrored);
     MStatus applyCommand(int influence, std::unordered_map<int, float> &valuesToSet);
+    MStatus applyCommandMap(std::unordered_map<int, float> &valuesToSet);
     MStatus applyCommandMirror();
     MStatus refreshColors(MIntArray &editVertsIndices, MColorArray &multiEditColors,
                           MColorArray &soloEditColors);
     MStatus editSoloColorSet(bool doBlack);
     MColor getASoloColor(double val) const;
     MStatus refreshPointsNormals();
+    // only the normals of the given vertices, the points are the raw pointers of the mesh
+    MStatus refreshPointsNormals(const MIntArray &verticesIndices);
+    // the evaluation manager can replace the mesh data, the raw pointers don't survive it
+    void refreshRawPoints();
 
     void getColorWithMirror(int vertexIndex, float valueBase, float valueMirror,
                            MColorArray &multiEditColors, MColorArray &soloEditColors,
@@ -307,7 +444,20 @@ class SkinBrushContext : public MPxContext {
     MStatus querySkinClusterValues(MObject &skinCluster, MIntArray &verticesIndices, bool doColors);
     MStatus fillArrayValues(MObject &skinCluster, bool doColors);
     MStatus displayWeightValue(int vertexIndex, bool displayZero = false);
+    void buildInfluenceVertices();
+    void setSkinWeight(int vertexIndex, int influence, double theWeight);
+    void flushInfluenceVertices();
     MStatus fillArrayValuesDEP(MObject &skinCluster, bool doColors);
+    MStatus readWeightsWithPlugs(MObject &skinCluster);
+    MStatus readWeightsWithGetWeights(MObject &skinCluster);
+    MStatus fillArrayValuesPaged(MObject &skinCluster);
+    void buildWeightPages();
+    void setAllWeightPagesLoaded();
+    void addPageOfVertex(int vertexIndex, std::vector<int> &pages, bool withNeighbors = false);
+    void loadWeightPages(std::vector<int> &pages, bool refreshView = false);
+    void loadAllWeightPages();
+    void removeIdleLoadPagesCallback();
+    static void idleLoadPagesCallback(void *clientData);
     void getSkinClusterAttributes(MObject &skinCluster, unsigned int &maxInfluences,
                                   bool &maintainMaxInfluences, unsigned int &normalize);
     MIntArray getInfluenceIndices();
@@ -330,9 +480,14 @@ class SkinBrushContext : public MPxContext {
     void addBrushShapeFallof(std::unordered_map<int, float> &dicVertsDist);
 
     MObject allVertexComponents();
-    MIntArray getVerticesInVolume();
-    void getVerticesInVolumeRange(int index, MIntArray &volumeIndices, MIntArray &rangeIndices,
-                                  MFloatArray &values);
+    // volume brush, the vertices in the brush sphere whatever the shell they are on
+    void refreshVolumeHash();
+    void getVerticesInVolume(const MFloatPoint &center, float radius,
+                             std::unordered_map<int, float> &dicVertsDist);
+    std::vector<int> getVerticesInVolumeRange(int vertexIndex);
+    // the vertices a smoothed vertex averages, in range in volume mode, connected otherwise
+    std::vector<int> getSmoothNeighbors(int vertexIndex);
+    int getSmoothMaxInfluences();
 
     double getFalloffValue(double value, double strength);
     bool eventIsValid(MEvent &event);
@@ -349,6 +504,7 @@ class SkinBrushContext : public MPxContext {
     void setPythonImportPath(MString &value);
     void setEnterToolCommand(MString &value);
     void setExitToolCommand(MString &value);
+    void setMapAttribute(MString &value);
     void setFlood();
     void setVerbose(bool value);
     void setPickMaxInfluence(bool value);
@@ -397,6 +553,7 @@ class SkinBrushContext : public MPxContext {
     MString getPythonImportPath();
     MString getEnterToolCommand();
     MString getExitToolCommand();
+    MString getMapAttribute();
     bool getFractionOversampling();
     bool getIgnoreLock();
 
@@ -415,6 +572,7 @@ class SkinBrushContext : public MPxContext {
     MString getInfluenceName();
     MString getSkinClusterName();
     MString getMeshName();
+    MStringArray getPaintMeshNames();
     ModifierCommands getCommandIndex();
     int getSmoothRepeat();
     int getSoloColor();
@@ -432,6 +590,12 @@ class SkinBrushContext : public MPxContext {
     double getMaxColor();
 
     MIntArray getWeightOrderedIndices();
+    MIntArray getInfluenceVertices(int influence);
+    MIntArray getZeroInfluences();
+    MDoubleArray getWeightsReadTimings();
+    MDoubleArray getDragLatency();
+    MDoubleArray getSetupTimings();
+    double getTopologyByteSize();
     double getAdjustValue();
     MString getPickedInfluence();
 
@@ -444,6 +608,7 @@ class SkinBrushContext : public MPxContext {
     skinBrushTool *cmd;
 
     bool firstPaintDone;
+    bool toolActive = false;  // between toolOnSetup and toolOffCleanup
     bool performBrush;
     int performRefreshViewPort;
     int maxRefreshValue = 2;
@@ -551,6 +716,7 @@ class SkinBrushContext : public MPxContext {
     unsigned int numCVsInV_ = 0, numCVsInU_ = 0;
     bool UIsPeriodic_ = false, VIsPeriodic_ = false;
     unsigned int UDeg_ = 0, VDeg_ = 0;
+    std::vector<int> proxyVertexToCV;  // index in getCVs of each vertex of the tessellation
 
     MIntArray vtxSelection;  // The currently selected vertices. This
                              // is used for flooding.
@@ -558,8 +724,7 @@ class SkinBrushContext : public MPxContext {
     MObject attrValue;
     MDoubleArray valuesForAttribute, paintArrayValues;  // the array of values to paint
 
-    MMeshIntersector intersectorOrigShape;
-    MMeshIntersector intersector;
+    std::unique_ptr<MMeshIntersector> intersectorOrigShape, intersector;
 
     std::vector<bool> selectedIndices;
 
@@ -571,6 +736,8 @@ class SkinBrushContext : public MPxContext {
     MIntArray influenceIndices;
     MDagPathArray inflDagPaths;
     std::vector<drawingDeformers> BBoxOfDeformers;
+    InfluencePickBVH influencesBVH;
+    MCallbackIdArray influencesMatrixCallbackIds;
 
     MStringArray inflNames;
     MString pickedInfluence;
@@ -579,6 +746,11 @@ class SkinBrushContext : public MPxContext {
     unsigned int maxInfluences;
     bool normalize;
 
+    // the skinned meshes of the session, the slot of the active one is empty
+    std::vector<std::unique_ptr<PaintMeshState>> paintMeshes;
+    int activePaintMesh = 0;
+    int lastHitPaintMesh = -1;  // parked mesh tested first by getCloserPaintMesh
+
     MSelectionList prevSelection;
     MSelectionList prevHilite;
 
@@ -593,18 +765,49 @@ class SkinBrushContext : public MPxContext {
     MIntArray deformersIndices;
     MIntArray cpIds;  // the ids of the vertices passed as to update skin for
     std::vector<std::vector<std::pair<int, float>>> skin_weights_;
-    MDoubleArray skinWeightList, fullUndoSkinWeightList, skinWeightsForUndo;
+    // weights, colors, locked vertices and faces of the active mesh, swapped with a parked one
+    std::unique_ptr<PaintMeshArrays> meshArrays{new PaintMeshArrays()};
+    MDoubleArray skinWeightsForUndo;
+    // per influence the sorted vertices with a non zero weight, kept in sync with the weights
+    std::vector<std::vector<int>> influenceVertices;
+    // per influence the vertices that went zero / non zero since the last flushInfluenceVertices
+    std::vector<std::vector<int>> influenceVerticesChanged;
     MIntArray indicesForInfluenceObjects;  // on skinCluster for sparse array
 
+    // painted map -----
+    MString mapAttributeVal;  // empty paints the skinCluster
+    bool mapMode = false;     // skinObj is then the node of the map
+    MPlug mapPlug;
+
+    // last full read of the weights, -1 if not timed
+    double weightsReadPlugsMs = -1.0, weightsReadGetWeightsMs = -1.0;
+    bool weightsReadUsedPlugs = true;
+
+    // weight pages -----
+    std::vector<int> vertexWeightPage;
+    std::vector<std::vector<int>> weightPagesVertices;  // in morton order
+    std::vector<bool> weightPageLoaded;
+    int nbWeightPagesLoaded = 0;
+    bool allWeightPagesLoaded = true;
+    MCallbackId idleLoadPagesCallbackId = 0;
+
+    // weightList / locks callbacks -----
+    MCallbackIdArray weightsCallbackIds;
+    MCallbackId idleRefreshCallbackId = 0;
+    MObject weightListAttr, weightsAttr, lockWeightsAttr, lockedVerticesAttr;
+    bool ignoreWeightsCallbacks = false;  // true while the brush itself sets the weights
+    std::set<int> dirtyVertices;
+    std::set<int> dirtyLockInfluences;
+    bool dirtyVerticesLocks = false;
+
     // mirror things -----
     MIntArray mirrorInfluences;  // indices of the mirror influences
 
     std::vector<bool> influenceLocks;
-    MIntArray lockJoints, ignoreLockJoints, lockVertices;
+    MIntArray lockJoints, ignoreLockJoints;
 
     // colorSet ------------------------
     MDGModifier colorSetMod;
-    MDoubleArray soloColorsValues;
     MColor lockVertColor = MColor((float)0.2, (float)0.2, (float)0.2);
     MColor lockJntColor = MColor((float)0.2, (float)0.2, (float)0.2);
     MString fullColorSet = MString("multiColorsSet");
@@ -617,29 +820,11 @@ class SkinBrushContext : public MPxContext {
     double minSoloColor = 0.0;
     double maxSoloColor = 1.0;
 
-    MColorArray multiCurrentColors, jointsColors,
-        soloCurrentColors;  // lock vertices color are not stored inside these arrays
+    MColorArray jointsColors;
 
-    MIntArray VertexCountPerPolygon, fullVertexList;
-    std::vector<MIntArray> perVertexFaces;             // per vertex Faces
-    std::vector<MIntArray> perFaceVertices;            // per face vertices
-    std::vector<MIntArray> perVertexEdges;             // per face vertices
-    std::vector<std::pair<int, int>> perEdgeVertices;  // to draw the wireframe
-    std::vector<std::vector<MIntArray>> perFaceTriangleVertices;
-
-    std::vector<std::vector<int>> perVertexVerticesSet;  // per vertex vertices
-    std::vector<std::vector<int>> perFaceVerticesSet;    // per Face Vertices
-    std::vector<std::vector<int>> normalsIds;            // vector of faces Ids normals
-
-    // Try the Flat Version
-    std::vector<int> perVertexVerticesSetFLAT;
-    std::vector<int> perVertexVerticesSetINDEX;
-
-    std::vector<int> perFaceVerticesSetFLAT;
-    std::vector<int> perFaceVerticesSetINDEX;
-
-    MVectorArray verticesNormals;
-    MIntArray verticesNormalsIndices;
+    // faces, triangles, edges and vertices around, shared by the hit, the growth, the smooth and
+    // the drawing
+    MeshTopology topology;
 
     const float *rawNormals;
     const float *mayaRawPoints;
@@ -673,6 +858,27 @@ class SkinBrushContext : public MPxContext {
     ModifierKeys removeModifier = ModifierKeys::Shift;  // store the modifier type
 
     int previousfaceHit;   // the faceIndex that was hit during the press common
+
+    // drag scheduler ------------------------
+    std::vector<std::pair<short, short>> coalescedDragPositions;  // corners of the next line
+    double dragDebtMs = 0.0;         // how late the brush is on the cursor
+    bool degradedDrag = false;       // colors and preview edges cut for this event
+    bool colorsDeferred = false;     // color write left for the next on-time event or the release
+    double lastDragMs = 0.0, maxDragMs = 0.0, totalDragMs = 0.0;
+    int nbDragEvents = 0, nbCoalescedDragEvents = 0, nbDegradedDragEvents = 0;
+
+    // volume brush ------------------------
+    VertexSpatialHash volumeHash;
+    bool volumeHashDirty = true;  // another mesh, rebuilt on the next press
+
+    // tool entry ------------------------
+    std::future<void> topologyTask;           // topology of the active mesh, built on a worker
+    std::atomic<bool> hitTopologyReady{true};  // faces, triangles and normals are built
+    int nbVerticesWithoutNormal = 0;
+    // stage timings in ms of the last tool entry, the worker stages overlap the main thread ones
+    double setupPythonMs = 0.0, setupMeshArraysMs = 0.0, setupHitTopologyMs = 0.0,
+           setupSmoothTopologyMs = 0.0, setupEdgesMs = 0.0, setupSkinClusterMs = 0.0,
+           setupWeightsColorsMs = 0.0, setupTopologyWaitMs = 0.0, setupTotalMs = 0.0;
     int biggestInfluence;  // for while we search for biggest influence
 };
 
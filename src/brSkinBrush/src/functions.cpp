@@ -3,7 +3,51 @@
 
 #include <math.h>
 
+#include <cmath>
 #include <limits>
+#include <numeric>
+
+static unsigned int spreadBits10(unsigned int x) {
+    // 10 bits spread every third bit
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+void getMortonOrder(const float* rawPoints, int numVertices, std::vector<int>& order) {
+    order.resize(numVertices);
+    std::iota(order.begin(), order.end(), 0);
+    if (numVertices == 0) return;
+
+    float minPt[3] = {rawPoints[0], rawPoints[1], rawPoints[2]};
+    float maxPt[3] = {rawPoints[0], rawPoints[1], rawPoints[2]};
+    for (int i = 1; i < numVertices; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            minPt[axis] = std::min(minPt[axis], rawPoints[i * 3 + axis]);
+            maxPt[axis] = std::max(maxPt[axis], rawPoints[i * 3 + axis]);
+        }
+    }
+    // 10 bits per axis in the bounding box
+    float scale[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = maxPt[axis] - minPt[axis];
+        scale[axis] = (extent > 0) ? 1023.0f / extent : 0.0f;
+    }
+    std::vector<unsigned int> codes(numVertices);
+    for (int i = 0; i < numVertices; ++i) {
+        unsigned int code = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            unsigned int cell =
+                (unsigned int)((rawPoints[i * 3 + axis] - minPt[axis]) * scale[axis]);
+            code |= spreadBits10(cell) << axis;
+        }
+        codes[i] = code;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return codes[a] < codes[b]; });
+}
 
 /* yourBiggestNumber * scaleFactor < cp */
 double scaleFactor = 65530.0;
@@ -124,6 +168,42 @@ MStatus transferPointNurbsToMesh(MFnMesh& msh, MFnNurbsSurface& nurbsFn) {
     return stat;
 }
 
+void getNurbsProxyVertexToCV(MFnNurbsSurface& nurbsFn, std::vector<int>& proxyVertexToCV) {
+    // the tessellation has one vertex per CV, vertex = u * numCVsInV + v, without the wrapped
+    // CVs of the periodic directions. getCVs has them, cv = u * all numCVsInV + v
+    int allCVsInV = nurbsFn.numCVsInV();
+    int numCVsInV_ = allCVsInV;
+    int numCVsInU_ = nurbsFn.numCVsInU();
+    if (nurbsFn.formInV() == MFnNurbsSurface::kPeriodic) numCVsInV_ -= nurbsFn.degreeV();
+    if (nurbsFn.formInU() == MFnNurbsSurface::kPeriodic) numCVsInU_ -= nurbsFn.degreeU();
+    proxyVertexToCV.clear();
+    if (numCVsInU_ <= 0 || numCVsInV_ <= 0) return;
+    proxyVertexToCV.resize(numCVsInU_ * numCVsInV_);
+    for (int uIndex = 0; uIndex < numCVsInU_; ++uIndex)
+        for (int vIndex = 0; vIndex < numCVsInV_; ++vIndex)
+            proxyVertexToCV[uIndex * numCVsInV_ + vIndex] = uIndex * allCVsInV + vIndex;
+}
+
+MStatus transferPointNurbsToMesh(MFnMesh& msh, MFnNurbsSurface& nurbsFn,
+                                 const std::vector<int>& proxyVertexToCV, MIntArray& vertices) {
+    // only the CVs of the given vertices, one read of the CVs and one write of the points
+    MStatus stat = MS::kSuccess;
+    int nbVertices = msh.numVertices();
+    if (nbVertices != (int)proxyVertexToCV.size())
+        return transferPointNurbsToMesh(msh, nurbsFn);  // not the expected tessellation
+
+    MPointArray allCVs, allPoints;
+    stat = nurbsFn.getCVs(allCVs);
+    CHECK_MSTATUS_AND_RETURN_IT(stat);
+    stat = msh.getPoints(allPoints);
+    CHECK_MSTATUS_AND_RETURN_IT(stat);
+    for (int vertexIndex : vertices) {
+        if (vertexIndex < 0 || vertexIndex >= nbVertices) continue;
+        allPoints[vertexIndex] = allCVs[proxyVertexToCV[vertexIndex]];
+    }
+    return msh.setPoints(allPoints);
+}
+
 MStatus findNurbsTesselateOrig(MDagPath meshPath, MObject& origMeshObj, bool verbose) {
     if (verbose) MGlobal::displayInfo(MString(" |||| findNurbsTesselateOrig ||||"));
     MStatus stat;
@@ -311,11 +391,12 @@ MStatus getListColorsJoints(MObject& skinCluster, int nbJoints,
 
         MPlug colorPlug = influenceColor_plug.elementByPhysicalIndex(i);
         int logicalInd = colorPlug.logicalIndex();
-        if (verbose) {
+        if (verbose && logicalInd < (int)indicesForInfluenceObjects.length()) {
             int indexInfluence = indicesForInfluenceObjects[logicalInd];
             MGlobal::displayInfo(MString("i : ") + i + MString("logical Index: ") + logicalInd +
                                  MString(" | indicesForInfluenceObjects ") + indexInfluence);
         }
+        if (logicalInd >= (int)indicesForInfluenceObjects.length()) continue;
         logicalInd = indicesForInfluenceObjects[logicalInd];
         if (logicalInd < 0 || logicalInd >= nbJoints) {
             MGlobal::displayError(MString("CRASH i : ") + i + MString("logical Index: ") +
@@ -379,6 +460,7 @@ MStatus getListLockJoints(MObject& skinCluster, int nbJoints, MIntArray indicesF
             isLocked = lockPlug.asInt();
         }
         int logicalInd = lockPlug.logicalIndex();
+        if (logicalInd >= (int)indicesForInfluenceObjects.length()) continue;
         logicalInd = indicesForInfluenceObjects[logicalInd];
         if (logicalInd < 0 || logicalInd >= nbJoints) {
             MGlobal::displayError(MString("CRASH i : ") + i + MString("logical Index: ") +
@@ -448,6 +530,65 @@ MStatus getSymetryAttributes(MObject& skinCluster, MIntArray& symetryList) {
     return stat;
 }
 
+MStatus readWeightListCSR(MObject& skinCluster, MIntArray& indicesForInfluenceObjects,
+                          int numVertices, std::vector<int>& rows, std::vector<int>& columns,
+                          std::vector<double>& values) {
+    MStatus status;
+    MFnDependencyNode skinClusterDep(skinCluster);
+    MPlug weightListPlug = skinClusterDep.findPlug("weightList", false, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    MObject weightsAttr = skinClusterDep.attribute("weights");
+    int nbLogical = indicesForInfluenceObjects.length();
+
+    // one walk on the data block, no plug per element
+    MDataHandle weightListData = weightListPlug.asMDataHandle(&status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    MArrayDataHandle weightListHandle(weightListData, &status);
+    if (status != MS::kSuccess) {
+        weightListPlug.destructHandle(weightListData);
+        return status;
+    }
+    std::vector<int> tripletVertex, tripletColumn;
+    std::vector<double> tripletValue;
+    unsigned int nbElements = weightListHandle.elementCount();
+    for (unsigned int i = 0; i < nbElements; ++i) {
+        weightListHandle.jumpToArrayElement(i);
+        int vertexIndex = (int)weightListHandle.elementIndex();
+        if (vertexIndex >= numVertices) continue;
+
+        MArrayDataHandle weightsHandle(weightListHandle.inputValue().child(weightsAttr));
+        unsigned int nbWeights = weightsHandle.elementCount();
+        for (unsigned int j = 0; j < nbWeights; ++j) {
+            weightsHandle.jumpToArrayElement(j);
+            int indexLogical = (int)weightsHandle.elementIndex();
+            if (indexLogical >= nbLogical) continue;
+            int column = indicesForInfluenceObjects[indexLogical];
+            if (column < 0) continue;  // no influence at this logical index
+            double theWeight = weightsHandle.inputValue().asDouble();
+            if (theWeight == 0.0) continue;
+            tripletVertex.push_back(vertexIndex);
+            tripletColumn.push_back(column);
+            tripletValue.push_back(theWeight);
+        }
+    }
+    weightListPlug.destructHandle(weightListData);
+
+    // counting sort on the vertices
+    rows.assign(numVertices + 1, 0);
+    for (int vertexIndex : tripletVertex) rows[vertexIndex + 1]++;
+    for (int vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex)
+        rows[vertexIndex + 1] += rows[vertexIndex];
+    columns.resize(tripletVertex.size());
+    values.resize(tripletVertex.size());
+    std::vector<int> nextInRow(rows.begin(), rows.end() - 1);
+    for (size_t k = 0; k < tripletVertex.size(); ++k) {
+        int pos = nextInRow[tripletVertex[k]]++;
+        columns[pos] = tripletColumn[k];
+        values[pos] = tripletValue[k];
+    }
+    return status;
+}
+
 MStatus getMirrorVertices(MIntArray mirrorVertices, MIntArray& theEditVerts,
                           MIntArray& theMirrorVerts, MIntArray& editAndMirrorVerts,
                           MDoubleArray& editVertsWeights, MDoubleArray& mirrorVertsWeights,
@@ -883,6 +1024,21 @@ MStatus editArrayMirror(ModifierCommands command, int influence, int influenceMi
     return stat;
 }
 
+double brushFalloffValue(int curve, double value, double strength) {
+    switch (curve) {
+        case 0:  // no falloff
+            return strength;
+        case 1:  // linear
+            return value * strength;
+        case 2:  // smoothstep
+            return (value * value * (3 - 2 * value)) * strength;
+        case 3:  // narrow - quadratic
+            return (1 - pow((1 - value) / 1, 0.4)) * strength;
+        default:
+            return value;
+    }
+}
+
 MStatus setAverageWeight(std::vector<int>& verticesAround, int currentVertex, int indexCurrVert,
                          int nbJoints, MIntArray& lockJoints, MDoubleArray& fullWeightArray,
                          MDoubleArray& theWeights, double strengthVal) {
@@ -954,6 +1110,39 @@ MStatus setAverageWeight(std::vector<int>& verticesAround, int currentVertex, in
     return MS::kSuccess;
 }
 
+// ---------------------------------------------------------------------
+// painted maps
+// ---------------------------------------------------------------------
+void editMapArray(ModifierCommands command, const MDoubleArray& fullValues,
+                  const std::map<int, double>& valuesToSet, MDoubleArray& theValues,
+                  double mutliplier) {
+    int i = 0;
+    for (const auto& elem : valuesToSet) {
+        double currentValue = fullValues[elem.first];
+        double theVal = mutliplier * elem.second;
+        double newValue = currentValue;
+        if (command == ModifierCommands::Add)
+            newValue += theVal;
+        else if (command == ModifierCommands::Remove)
+            newValue -= theVal;
+        else if (command == ModifierCommands::AddPercent)
+            newValue += theVal * currentValue;
+        else if (command == ModifierCommands::Absolute)
+            newValue = theVal;
+        else if (command == ModifierCommands::Sharpen)  // the skin sharpen on a map and its rest
+            newValue = 0.5 + (currentValue - 0.5) * (theVal + 1.0);
+        theValues[i++] = std::max(0.0, std::min(newValue, 1.0));
+    }
+}
+
+double getMapAverageValue(const std::vector<int>& verticesAround, const MDoubleArray& fullValues,
+                          double currentValue) {
+    if (verticesAround.empty()) return currentValue;
+    double sum = 0.0;
+    for (int vertexIndex : verticesAround) sum += fullValues[vertexIndex];
+    return sum / (double)verticesAround.size();
+}
+
 MStatus doPruneWeight(MDoubleArray& theWeights, int nbJoints, double pruneCutWeight) {
     MStatus stat;
 
@@ -1053,6 +1242,294 @@ bool RayIntersectsBBox(MPoint minPt, MPoint maxPt, MPoint orig, MVector directio
     return true;
 };
 
+void InfluencePickBVH::clear() {
+    boxIndices.clear();
+    for (int i = 0; i < 12; ++i) inverse[i].clear();
+    for (int axis = 0; axis < 3; ++axis) {
+        boxMin[axis].clear();
+        boxMax[axis].clear();
+        center[axis].clear();
+        nodeMin[axis].clear();
+        nodeMax[axis].clear();
+    }
+    nodeFirst.clear();
+    nodeCount.clear();
+    depth = 0;
+}
+
+void InfluencePickBVH::build(const std::vector<MMatrix>& matrices,
+                             const std::vector<MPoint>& minPts, const std::vector<MPoint>& maxPts) {
+    clear();
+    int nbBoxes = (int)matrices.size();
+    if (nbBoxes == 0) return;
+
+    // world bounding box of every oriented box
+    std::vector<MBoundingBox> worldBoxes(nbBoxes);
+    std::vector<MPoint> worldCenters(nbBoxes);
+    for (int i = 0; i < nbBoxes; ++i) {
+        for (int corner = 0; corner < 8; ++corner) {
+            MPoint pt((corner & 1) ? maxPts[i].x : minPts[i].x,
+                      (corner & 2) ? maxPts[i].y : minPts[i].y,
+                      (corner & 4) ? maxPts[i].z : minPts[i].z);
+            worldBoxes[i].expand(pt * matrices[i]);
+        }
+        worldCenters[i] = ((minPts[i] + maxPts[i]) / 2.0) * matrices[i];
+    }
+
+    // top down build, median split on the largest axis of the centers
+    std::vector<int> order(nbBoxes);
+    std::iota(order.begin(), order.end(), 0);
+    auto addNode = [this](int first, int count) {
+        for (int axis = 0; axis < 3; ++axis) {
+            nodeMin[axis].push_back(0.0);
+            nodeMax[axis].push_back(0.0);
+        }
+        nodeFirst.push_back(first);
+        nodeCount.push_back(count);
+        return (int)nodeFirst.size() - 1;
+    };
+    std::vector<std::pair<int, int>> toSplit = {{addNode(0, nbBoxes), 0}};  // node, level
+    while (!toSplit.empty()) {
+        int node = toSplit.back().first;
+        int level = toSplit.back().second;
+        toSplit.pop_back();
+        depth = std::max(depth, level);
+        int first = nodeFirst[node], count = nodeCount[node];
+
+        MBoundingBox nodeBox, centersBox;
+        for (int i = first; i < first + count; ++i) {
+            nodeBox.expand(worldBoxes[order[i]]);
+            centersBox.expand(worldCenters[order[i]]);
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            nodeMin[axis][node] = nodeBox.min()[axis];
+            nodeMax[axis][node] = nodeBox.max()[axis];
+        }
+        if (count <= PICK_BVH_LEAF_SIZE) continue;
+
+        MVector extent = centersBox.max() - centersBox.min();
+        int axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2)
+                                         : ((extent.y > extent.z) ? 1 : 2);
+        int mid = first + count / 2;
+        std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count,
+                         [&](int a, int b) { return worldCenters[a][axis] < worldCenters[b][axis]; });
+        int left = addNode(first, mid - first);
+        addNode(mid, first + count - mid);
+        nodeFirst[node] = left;
+        nodeCount[node] = 0;
+        toSplit.push_back({left, level + 1});
+        toSplit.push_back({left + 1, level + 1});
+    }
+
+    // boxes in leaf order
+    boxIndices = order;
+    for (int i = 0; i < 12; ++i) inverse[i].resize(nbBoxes);
+    for (int axis = 0; axis < 3; ++axis) {
+        boxMin[axis].resize(nbBoxes);
+        boxMax[axis].resize(nbBoxes);
+        center[axis].resize(nbBoxes);
+    }
+    for (int i = 0; i < nbBoxes; ++i) {
+        int ind = order[i];
+        MMatrix matI = matrices[ind].inverse();
+        for (int row = 0; row < 4; ++row)
+            for (int col = 0; col < 3; ++col) inverse[row * 3 + col][i] = matI(row, col);
+        for (int axis = 0; axis < 3; ++axis) {
+            boxMin[axis][i] = minPts[ind][axis];
+            boxMax[axis][i] = maxPts[ind][axis];
+            center[axis][i] = worldCenters[ind][axis];
+        }
+    }
+}
+
+int InfluencePickBVH::closestHit(const MPoint& orig, const MVector& direction) const {
+    if (empty()) return -1;
+    const double ro[3] = {orig.x, orig.y, orig.z};
+    const double invDir[3] = {1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z};
+
+    int closestBox = -1;
+    double closestDistance = -1;
+    bool hits[PICK_BVH_LEAF_SIZE];
+    // depth first, a node pops before its children push, at most one pending sibling per level
+    std::vector<int> stack(depth + 2);
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        int node = stack[--stackSize];
+        // world slab test of the node
+        double tmin = -std::numeric_limits<double>::max();
+        double tmax = std::numeric_limits<double>::max();
+        for (int axis = 0; axis < 3; ++axis) {
+            double t1 = (nodeMin[axis][node] - ro[axis]) * invDir[axis];
+            double t2 = (nodeMax[axis][node] - ro[axis]) * invDir[axis];
+            tmin = std::max(tmin, std::min(t1, t2));
+            tmax = std::min(tmax, std::max(t1, t2));
+        }
+        if (tmin > tmax) continue;
+
+        int first = nodeFirst[node], count = nodeCount[node];
+        if (count == 0) {
+            stack[stackSize++] = first;
+            stack[stackSize++] = first + 1;
+            continue;
+        }
+        // leaf, ray in the space of each box and slab test, no branch so it vectorizes
+#pragma omp simd
+        for (int k = 0; k < count; ++k) {
+            int i = first + k;
+            double ox = orig.x * inverse[0][i] + orig.y * inverse[3][i] + orig.z * inverse[6][i] +
+                        inverse[9][i];
+            double oy = orig.x * inverse[1][i] + orig.y * inverse[4][i] + orig.z * inverse[7][i] +
+                        inverse[10][i];
+            double oz = orig.x * inverse[2][i] + orig.y * inverse[5][i] + orig.z * inverse[8][i] +
+                        inverse[11][i];
+            double dx = direction.x * inverse[0][i] + direction.y * inverse[3][i] +
+                        direction.z * inverse[6][i];
+            double dy = direction.x * inverse[1][i] + direction.y * inverse[4][i] +
+                        direction.z * inverse[7][i];
+            double dz = direction.x * inverse[2][i] + direction.y * inverse[5][i] +
+                        direction.z * inverse[8][i];
+            double tx1 = (boxMin[0][i] - ox) / dx, tx2 = (boxMax[0][i] - ox) / dx;
+            double ty1 = (boxMin[1][i] - oy) / dy, ty2 = (boxMax[1][i] - oy) / dy;
+            double tz1 = (boxMin[2][i] - oz) / dz, tz2 = (boxMax[2][i] - oz) / dz;
+            double boxTmin = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)),
+                                      std::min(tz1, tz2));
+            double boxTmax = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)),
+                                      std::max(tz1, tz2));
+            hits[k] = boxTmin <= boxTmax;
+        }
+        for (int k = 0; k < count; ++k) {
+            if (!hits[k]) continue;
+            int i = first + k;
+            double dst = MPoint(center[0][i], center[1][i], center[2][i]).distanceTo(orig);
+            if ((closestBox == -1) || (dst < closestDistance)) {
+                closestDistance = dst;
+                closestBox = i;
+            }
+        }
+    }
+    return closestBox == -1 ? -1 : boxIndices[closestBox];
+}
+
+unsigned int VertexSpatialHash::bucketOfCell(int x, int y, int z) const {
+    return (((unsigned int)x * 73856093u) ^ ((unsigned int)y * 19349663u) ^
+            ((unsigned int)z * 83492791u)) &
+           bucketMask;
+}
+
+unsigned int VertexSpatialHash::bucketOf(const float* point) const {
+    return bucketOfCell((int)std::floor(point[0] / cellSize), (int)std::floor(point[1] / cellSize),
+                        (int)std::floor(point[2] / cellSize));
+}
+
+void VertexSpatialHash::clear() {
+    cellSize = 0.0f;
+    points.clear();
+    buckets.clear();
+    vertexBucket.clear();
+    bucketMask = 0;
+}
+
+void VertexSpatialHash::build(const float* rawPoints, int numVertices, float size) {
+    clear();
+    if (numVertices == 0 || size <= 0.0f) return;
+    cellSize = size;
+    // power of two table, about one bucket per vertex
+    unsigned int nbBuckets = 1;
+    while (nbBuckets < (unsigned int)numVertices) nbBuckets <<= 1;
+    bucketMask = nbBuckets - 1;
+    buckets.resize(nbBuckets);
+
+    points.assign(rawPoints, rawPoints + 3 * numVertices);
+    vertexBucket.resize(numVertices);
+    for (int i = 0; i < numVertices; ++i) {
+        unsigned int bucket = bucketOf(&points[3 * i]);
+        vertexBucket[i] = bucket;
+        buckets[bucket].push_back(i);
+    }
+}
+
+void VertexSpatialHash::moveVertex(int vertexIndex, const float* point) {
+    points[3 * vertexIndex] = point[0];
+    points[3 * vertexIndex + 1] = point[1];
+    points[3 * vertexIndex + 2] = point[2];
+    unsigned int bucket = bucketOf(point);
+    unsigned int previous = vertexBucket[vertexIndex];
+    if (bucket == previous) return;
+    std::vector<int>& previousBucket = buckets[previous];
+    auto it = std::find(previousBucket.begin(), previousBucket.end(), vertexIndex);
+    if (it != previousBucket.end()) {
+        *it = previousBucket.back();
+        previousBucket.pop_back();
+    }
+    buckets[bucket].push_back(vertexIndex);
+    vertexBucket[vertexIndex] = bucket;
+}
+
+int VertexSpatialHash::refresh(const float* rawPoints) {
+    int nbMoved = 0;
+    for (unsigned int i = 0; i < vertexBucket.size(); ++i) {
+        const float* point = rawPoints + 3 * i;
+        if (point[0] == points[3 * i] && point[1] == points[3 * i + 1] &&
+            point[2] == points[3 * i + 2])
+            continue;
+        moveVertex(i, point);
+        ++nbMoved;
+    }
+    return nbMoved;
+}
+
+void VertexSpatialHash::update(const float* rawPoints, const MIntArray& vertices) {
+    for (unsigned int i = 0; i < vertices.length(); ++i) {
+        int vertexIndex = vertices[i];
+        if (vertexIndex < 0 || vertexIndex >= (int)vertexBucket.size()) continue;
+        moveVertex(vertexIndex, rawPoints + 3 * vertexIndex);
+    }
+}
+
+void VertexSpatialHash::query(const float* center, float radius,
+                              std::vector<std::pair<int, float>>& found) const {
+    found.clear();
+    if (empty()) return;
+    int minCell[3], maxCell[3];
+    long long nbCells = 1;
+    for (int axis = 0; axis < 3; ++axis) {
+        minCell[axis] = (int)std::floor((center[axis] - radius) / cellSize);
+        maxCell[axis] = (int)std::floor((center[axis] + radius) / cellSize);
+        nbCells *= (long long)(maxCell[axis] - minCell[axis] + 1);
+    }
+    // the cells of the sphere box, or every bucket if that's fewer. Cells can share a bucket
+    std::vector<unsigned int> candidates;
+    if (nbCells >= (long long)buckets.size()) {
+        candidates.resize(buckets.size());
+        std::iota(candidates.begin(), candidates.end(), 0u);
+    } else {
+        candidates.reserve((size_t)nbCells);
+        for (int x = minCell[0]; x <= maxCell[0]; ++x)
+            for (int y = minCell[1]; y <= maxCell[1]; ++y)
+                for (int z = minCell[2]; z <= maxCell[2]; ++z)
+                    candidates.push_back(bucketOfCell(x, y, z));
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+
+    float radiusSq = radius * radius;
+    int nbCandidates = (int)candidates.size();
+    std::vector<std::vector<std::pair<int, float>>> perBucket(nbCandidates);
+#pragma omp parallel for if (nbCandidates > 64)
+    for (int i = 0; i < nbCandidates; ++i) {
+        for (int vertexIndex : buckets[candidates[i]]) {
+            const float* point = &points[3 * vertexIndex];
+            float dx = point[0] - center[0], dy = point[1] - center[1], dz = point[2] - center[2];
+            float distSq = dx * dx + dy * dy + dz * dz;
+            if (distSq <= radiusSq)
+                perBucket[i].push_back(std::make_pair(vertexIndex, std::sqrt(distSq)));
+        }
+    }
+    for (const auto& bucketFound : perBucket)
+        found.insert(found.end(), bucketFound.begin(), bucketFound.end());
+}
+
 MPoint offsetIntersection(const MPoint& rayPoint, const MVector& rayVector,
                           const MVector& originNormal) {
     // A little hack to shift the input ray point around to get the intersections with the offset
@@ -1151,3 +1628,108 @@ void convertToCountIndex(const std::vector<std::unordered_set<int>>& input,
         indices.insert(indices.end(), uSet.begin(), uSet.end());
     }
 }
+
+// counting sort of the rows of a table per item, items are in [0, numItems)
+static void invertRows(const std::vector<int>& starts, const std::vector<int>& items, int numItems,
+                       std::vector<int>& invStarts, std::vector<int>& invRows) {
+    invStarts.assign(numItems + 1, 0);
+    for (int item : items) ++invStarts[item + 1];
+    for (int i = 0; i < numItems; ++i) invStarts[i + 1] += invStarts[i];
+    invRows.resize(items.size());
+    std::vector<int> fill(invStarts.begin(), invStarts.end() - 1);
+    int nbRows = (int)starts.size() - 1;
+    for (int row = 0; row < nbRows; ++row)
+        for (int k = starts[row]; k < starts[row + 1]; ++k) invRows[fill[items[k]]++] = row;
+}
+
+void MeshTopology::buildFaces(int numVertices, const MIntArray& faceCounts,
+                              const MIntArray& faceConnects, const MIntArray& triangleCounts,
+                              const MIntArray& triangles) {
+    int numFaces = (int)faceCounts.length();
+    faceStarts.assign(numFaces + 1, 0);
+    faceTriangleStarts.assign(numFaces + 1, 0);
+    for (int f = 0; f < numFaces; ++f) {
+        faceStarts[f + 1] = faceStarts[f] + faceCounts[f];
+        faceTriangleStarts[f + 1] = faceTriangleStarts[f] + triangleCounts[f];
+    }
+    faceVertices.resize(faceConnects.length());
+    if (!faceVertices.empty()) faceConnects.get(faceVertices.data());
+    triangleVertices.resize(triangles.length());
+    if (!triangleVertices.empty()) triangles.get(triangleVertices.data());
+
+    invertRows(faceStarts, faceVertices, numVertices, vertexFaceStarts, vertexFaces);
+}
+
+void MeshTopology::buildVertexVertices() {
+    int numVertices = (int)vertexFaceStarts.size() - 1;
+    if (numVertices < 0) numVertices = 0;
+    // the rows are first written in slots sized for the vertices of all their faces, then packed
+    std::vector<int> slotStarts(numVertices + 1, 0);
+    for (int v = 0; v < numVertices; ++v) {
+        int size = 0;
+        for (int k = vertexFaceStarts[v]; k < vertexFaceStarts[v + 1]; ++k) {
+            int f = vertexFaces[k];
+            size += faceStarts[f + 1] - faceStarts[f];
+        }
+        slotStarts[v + 1] = slotStarts[v] + size;
+    }
+    std::vector<int> slots(slotStarts[numVertices]);
+    std::vector<int> rowSizes(numVertices, 0);
+#pragma omp parallel for
+    for (int v = 0; v < numVertices; ++v) {
+        int* row = slots.data() + slotStarts[v];
+        int size = 0;
+        for (int k = vertexFaceStarts[v]; k < vertexFaceStarts[v + 1]; ++k) {
+            int f = vertexFaces[k];
+            for (int j = faceStarts[f]; j < faceStarts[f + 1]; ++j)
+                if (faceVertices[j] != v) row[size++] = faceVertices[j];
+        }
+        std::sort(row, row + size);
+        rowSizes[v] = (int)(std::unique(row, row + size) - row);
+    }
+    vertexVertexStarts.assign(numVertices + 1, 0);
+    for (int v = 0; v < numVertices; ++v)
+        vertexVertexStarts[v + 1] = vertexVertexStarts[v] + rowSizes[v];
+    vertexVertices.resize(vertexVertexStarts[numVertices]);
+#pragma omp parallel for
+    for (int v = 0; v < numVertices; ++v)
+        std::copy(slots.begin() + slotStarts[v], slots.begin() + slotStarts[v] + rowSizes[v],
+                  vertexVertices.begin() + vertexVertexStarts[v]);
+}
+
+void MeshTopology::buildEdges(int numVertices, std::vector<int>& pairs) {
+    edgeVertices.swap(pairs);
+    int numEdges = (int)edgeVertices.size() / 2;
+    std::vector<int> edgeStarts(numEdges + 1);
+    for (int e = 0; e <= numEdges; ++e) edgeStarts[e] = 2 * e;
+    invertRows(edgeStarts, edgeVertices, numVertices, vertexEdgeStarts, vertexEdges);
+}
+
+void MeshTopology::clear() {
+    MeshTopology empty;
+    swap(empty);
+}
+
+void MeshTopology::swap(MeshTopology& other) {
+    faceStarts.swap(other.faceStarts);
+    faceVertices.swap(other.faceVertices);
+    faceTriangleStarts.swap(other.faceTriangleStarts);
+    triangleVertices.swap(other.triangleVertices);
+    vertexFaceStarts.swap(other.vertexFaceStarts);
+    vertexFaces.swap(other.vertexFaces);
+    vertexVertexStarts.swap(other.vertexVertexStarts);
+    vertexVertices.swap(other.vertexVertices);
+    edgeVertices.swap(other.edgeVertices);
+    vertexEdgeStarts.swap(other.vertexEdgeStarts);
+    vertexEdges.swap(other.vertexEdges);
+}
+
+size_t MeshTopology::byteSize() const {
+    const std::vector<int>* arrays[] = {&faceStarts,         &faceVertices,     &faceTriangleStarts,
+                                        &triangleVertices,   &vertexFaceStarts, &vertexFaces,
+                                        &vertexVertexStarts, &vertexVertices,   &edgeVertices,
+                                        &vertexEdgeStarts,   &vertexEdges};
+    size_t size = sizeof(MeshTopology);
+    for (const std::vector<int>* array : arrays) size += array->capacity() * sizeof(int);
+    return size;
+}
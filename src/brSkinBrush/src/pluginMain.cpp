@@ -17,6 +17,7 @@
 
 
 #include "functions.h"
+#include "skinBrushStrokeCmd.h"
 #include "skinBrushTool.h"
 #include "version.h"
 
@@ -44,6 +45,13 @@ MStatus initializePlugin(MObject obj) {
         MUserEventMessage::registerUserEvent("brSkinBrush_toolOffCleanup");
         MUserEventMessage::registerUserEvent("brSkinBrush_toolOnSetupStart");
         MUserEventMessage::registerUserEvent("brSkinBrush_toolOnSetupEnd");
+        MUserEventMessage::registerUserEvent("brSkinBrush_paintMeshChanged");
+    }
+
+    status = plugin.registerCommand("brSkinBrushStroke", skinBrushStrokeCmd::creator,
+                                    skinBrushStrokeCmd::newSyntax);
+    if (status != MStatus::kSuccess) {
+        status.perror("Register brSkinBrushStroke failed.");
     }
 
     return status;
@@ -68,6 +76,12 @@ MStatus uninitializePlugin(MObject obj) {
         MUserEventMessage::deregisterUserEvent("brSkinBrush_toolOffCleanup");
         MUserEventMessage::deregisterUserEvent("brSkinBrush_toolOnSetupStart");
         MUserEventMessage::deregisterUserEvent("brSkinBrush_toolOnSetupEnd");
+        MUserEventMessage::deregisterUserEvent("brSkinBrush_paintMeshChanged");
+    }
+
+    status = plugin.deregisterCommand("brSkinBrushStroke");
+    if (status != MStatus::kSuccess) {
+        status.perror("Deregister brSkinBrushStroke failed.");
     }
 
     return status;
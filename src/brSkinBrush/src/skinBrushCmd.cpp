@@ -34,6 +34,7 @@ MStatus SkinBrushContextCmd::appendSyntax() {
     syn.addFlag(kImportPythonFlag, kImportPythonFlagLong, MSyntax::kString);
     syn.addFlag(kEnterToolCommandFlag, kEnterToolCommandFlagLong, MSyntax::kString);
     syn.addFlag(kExitToolCommandFlag, kExitToolCommandFlagLong, MSyntax::kString);
+    syn.addFlag(kMapAttributeFlag, kMapAttributeFlagLong, MSyntax::kString);
 
     syn.addFlag(kFloodFlag, kFloodFlagLong, MSyntax::kNoArg);
     syn.addFlag(kVerboseFlag, kVerboseFlagLong, MSyntax::kBoolean);
@@ -98,6 +99,15 @@ MStatus SkinBrushContextCmd::appendSyntax() {
     syn.addFlag(kWeightOrderedIndicesFlag, kWeightOrderedIndicesFlagLong);
     syn.addFlag(kPickedInfluenceFlag, kPickedInfluenceFlagLong);
 
+    syn.addFlag(kInfluenceVerticesFlag, kInfluenceVerticesFlagLong, MSyntax::kLong);
+    syn.makeFlagQueryWithFullArgs(kInfluenceVerticesFlag, false);
+    syn.addFlag(kZeroInfluencesFlag, kZeroInfluencesFlagLong);
+    syn.addFlag(kWeightsReadTimingsFlag, kWeightsReadTimingsFlagLong);
+    syn.addFlag(kPaintMeshesFlag, kPaintMeshesFlagLong);
+    syn.addFlag(kDragLatencyFlag, kDragLatencyFlagLong);
+    syn.addFlag(kSetupTimingsFlag, kSetupTimingsFlagLong);
+    syn.addFlag(kTopologyByteSizeFlag, kTopologyByteSizeFlagLong);
+
     syn.addFlag(kAdjustValueFlag, kAdjustValueFlagLong);
 
     return MStatus::kSuccess;
@@ -162,6 +172,12 @@ MStatus SkinBrushContextCmd::doEditFlags() {
         smoothContext->setExitToolCommand(value);
     }
 
+    if (argData.isFlagSet(kMapAttributeFlag)) {
+        MString value;
+        status = argData.getFlagArgument(kMapAttributeFlag, 0, value);
+        smoothContext->setMapAttribute(value);
+    }
+
     if (argData.isFlagSet(kFloodFlag)) {
         smoothContext->setFlood();
     }
@@ -438,6 +454,8 @@ MStatus SkinBrushContextCmd::doQueryFlags() {
 
     if (argData.isFlagSet(kExitToolCommandFlag)) setResult(smoothContext->getExitToolCommand());
 
+    if (argData.isFlagSet(kMapAttributeFlag)) setResult(smoothContext->getMapAttribute());
+
     if (argData.isFlagSet(kFractionOversamplingFlag))
         setResult(smoothContext->getFractionOversampling());
 
@@ -509,6 +527,29 @@ MStatus SkinBrushContextCmd::doQueryFlags() {
 
     if (argData.isFlagSet(kPickedInfluenceFlag)) setResult(smoothContext->getPickedInfluence());
 
+    if (argData.isFlagSet(kInfluenceVerticesFlag)) {
+        int value;
+        argData.getFlagArgument(kInfluenceVerticesFlag, 0, value);
+        MPxCommand::setResult(smoothContext->getInfluenceVertices(value));
+    }
+
+    if (argData.isFlagSet(kZeroInfluencesFlag)) MPxCommand::setResult(smoothContext->getZeroInfluences());
+
+    if (argData.isFlagSet(kWeightsReadTimingsFlag))
+        MPxCommand::setResult(smoothContext->getWeightsReadTimings());
+
+    if (argData.isFlagSet(kPaintMeshesFlag))
+        MPxCommand::setResult(smoothContext->getPaintMeshNames());
+
+    if (argData.isFlagSet(kDragLatencyFlag))
+        MPxCommand::setResult(smoothContext->getDragLatency());
+
+    if (argData.isFlagSet(kSetupTimingsFlag))
+        MPxCommand::setResult(smoothContext->getSetupTimings());
+
+    if (argData.isFlagSet(kTopologyByteSizeFlag))
+        MPxCommand::setResult(smoothContext->getTopologyByteSize());
+
     if (argData.isFlagSet(kAdjustValueFlag)) setResult(smoothContext->getAdjustValue());
 
     return MStatus::kSuccess;
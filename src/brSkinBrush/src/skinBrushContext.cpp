@@ -8,6 +8,11 @@
 
 const char helpString[] = "it's a custom brush weights.";
 
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
 // ---------------------------------------------------------------------
 // general methods when calling the context
 // ---------------------------------------------------------------------
@@ -61,6 +66,7 @@ void SkinBrushContext::toolOnSetup(MEvent &) {
             MString("---------------- [SkinBrushContext::toolOnSetup ()]------------------"));
 
     MStatus status = MStatus::kSuccess;
+    auto setupStart = std::chrono::steady_clock::now();
 
     setHelpString(helpString);
     setInViewMessage(true);
@@ -76,45 +82,81 @@ void SkinBrushContext::toolOnSetup(MEvent &) {
         ));
     MGlobal::executePythonCommand("toolOnSetupStart()");
     MUserEventMessage::postUserEvent("brSkinBrush_toolOnSetupStart");
+    this->setupPythonMs = msSince(setupStart);
 
     this->firstPaintDone = false;
+    this->toolActive = true;
     this->pickMaxInfluenceVal = false;
     this->pickInfluenceVal = false;
+    clearPaintMeshes();
+
+    // the topology keeps building on a worker while the weights and colors are read,
+    // the brush hovers as soon as the faces are ready and paints once it's all there
+    this->setupTopologyWaitMs = 0.0;
+    status = getMesh();
+    auto stageStart = std::chrono::steady_clock::now();
+    status = setupPaintMesh();
+    this->setupWeightsColorsMs = msSince(stageStart);
+    if (status != MS::kSuccess) {
+        waitForTopology();
+        abortAction();
+        return;
+    }
+    // the other skinned meshes of the selection are read when the brush goes over them
+    collectPaintMeshes();
 
+    view = M3dView::active3dView();
+    view.refresh(false, true);
+
+    MGlobal::executePythonCommand("toolOnSetupEnd()");
+    MUserEventMessage::postUserEvent("brSkinBrush_toolOnSetupEnd");
+    this->setupTotalMs = msSince(setupStart);
+}
+
+MStatus SkinBrushContext::setupPaintMesh() {
     // first clear a bit the air --------------
-    this->multiCurrentColors.clear();
+    this->meshArrays->multiCurrentColors.clear();
     this->jointsColors.clear();
-    this->soloCurrentColors.clear();
+    this->meshArrays->soloCurrentColors.clear();
 
-    status = getMesh();
+    MStatus status;
     MIntArray editVertsIndices;
-    if (!skinObj.isNull()) {
+    if (this->mapMode) {
+        // one white influence, never locked, mirrored on itself
+        this->jointsColors = MColorArray(1, MColor(1.0, 1.0, 1.0));
+        this->lockJoints = MIntArray(1, 0);
+        this->ignoreLockJoints = MIntArray(1, 0);
+        this->mirrorInfluences = MIntArray(1, 0);
+        status = fillMapValues();
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        addWeightsCallbacks();
+    } else if (!skinObj.isNull()) {
         getListColorsJoints(skinObj, this->nbJoints, indicesForInfluenceObjects, jointsColors,
                             verbose);  // get the joints colors
 
-        this->skinWeightList.clear();
+        this->meshArrays->skinWeightList.clear();
         this->ignoreLockJoints = MIntArray(this->nbJoints, 0);
-        if (this->mirrorInfluences.length() == 0) {
+        if (this->mirrorInfluences.length() < (unsigned int)this->nbJoints) {
             this->mirrorInfluences = MIntArray(this->nbJoints, 0);
             for (unsigned int i = 0; i < this->nbJoints; ++i) this->mirrorInfluences.set(i, i);
         }
 
         getListLockJoints(skinObj, this->nbJoints, indicesForInfluenceObjects, this->lockJoints);
-        getListLockVertices(skinObj, this->lockVertices, editVertsIndices);
+        getListLockVertices(skinObj, this->meshArrays->lockVertices, editVertsIndices);
 
-        status = fillArrayValues(skinObj, true);  // WAY TOO SLOW ... but accurate ?
+        status = fillArrayValuesPaged(skinObj);  // reads the weights on first touch
+        addWeightsCallbacks();
         if (verbose)
             MGlobal::displayInfo(MString("nb found joints colors ") + jointsColors.length());
     } else {
         MGlobal::displayInfo(MString("FAILED : skinObj.isNull"));
-        abortAction();
-        return;
+        return MS::kFailure;
     }
     // get face color assignments ----------
 
     // solo colors -----------------------
-    this->soloCurrentColors = MColorArray(this->numVertices, MColor(0.0, 0, 0.0));
-    this->soloColorsValues = MDoubleArray(this->numVertices, 0.0);
+    this->meshArrays->soloCurrentColors = MColorArray(this->numVertices, MColor(0.0, 0, 0.0));
+    this->meshArrays->soloColorsValues = MDoubleArray(this->numVertices, 0.0);
 
     MStringArray currentColorSets;
     meshFn.getColorSetNames(currentColorSets);
@@ -130,17 +172,17 @@ void SkinBrushContext::toolOnSetup(MEvent &) {
     if (currentColorSets.indexOf(this->soloColorSet2) == -1)  // soloColor
         meshFn.createColorSetWithName(this->soloColorSet2);
 
-    meshFn.setColors(this->multiCurrentColors, &this->fullColorSet);  // set the multi assignation
-    meshFn.assignColors(fullVertexList, &this->fullColorSet);
+    meshFn.setColors(this->meshArrays->multiCurrentColors, &this->fullColorSet);  // set the multi assignation
+    meshFn.assignColors(this->meshArrays->fullVertexList, &this->fullColorSet);
 
-    meshFn.setColors(this->soloCurrentColors, &this->soloColorSet);  // set the solo assignation
-    meshFn.assignColors(fullVertexList, &this->soloColorSet);
+    meshFn.setColors(this->meshArrays->soloCurrentColors, &this->soloColorSet);  // set the solo assignation
+    meshFn.assignColors(this->meshArrays->fullVertexList, &this->soloColorSet);
 
-    meshFn.setColors(this->multiCurrentColors, &this->fullColorSet2);  // set the multi assignation
-    meshFn.assignColors(fullVertexList, &this->fullColorSet2);
+    meshFn.setColors(this->meshArrays->multiCurrentColors, &this->fullColorSet2);  // set the multi assignation
+    meshFn.assignColors(this->meshArrays->fullVertexList, &this->fullColorSet2);
 
-    meshFn.setColors(this->soloCurrentColors, &this->soloColorSet2);  // set the solo assignation
-    meshFn.assignColors(fullVertexList, &this->soloColorSet2);
+    meshFn.setColors(this->meshArrays->soloCurrentColors, &this->soloColorSet2);  // set the solo assignation
+    meshFn.assignColors(this->meshArrays->fullVertexList, &this->soloColorSet2);
 
     MString currentColorSet = meshFn.currentColorSetName();  // set multiColor as current Color
     if (soloColorVal == 1) {                                 // solo
@@ -164,16 +206,16 @@ void SkinBrushContext::toolOnSetup(MEvent &) {
     meshFn.setSomeColors(editVertsIndices, soloEditColors, &this->soloColorSet2);
 
     meshFn.setDisplayColors(true);
-
-    view = M3dView::active3dView();
-    view.refresh(false, true);
-
-    MGlobal::executePythonCommand("toolOnSetupEnd()");
-    MUserEventMessage::postUserEvent("brSkinBrush_toolOnSetupEnd");
+    return MS::kSuccess;
 }
 
 void SkinBrushContext::toolOffCleanup() {
+    this->toolActive = false;
+    waitForTopology();
     setInViewMessage(false);
+    removeWeightsCallbacks();
+    removeInfluencesMatrixCallbacks();
+    removeIdleLoadPagesCallback();
     meshFn.updateSurface();  // try avoiding crashes
     if (exitToolCommandVal.length() > 5) MGlobal::executeCommand(exitToolCommandVal);
     MUserEventMessage::postUserEvent("brSkinBrush_toolOffCleanup");
@@ -181,14 +223,15 @@ void SkinBrushContext::toolOffCleanup() {
         this->firstPaintDone = true;
         MUserEventMessage::postUserEvent("brSkinBrush_cleanCloseUndo");
     }
-
+    // after the exit callbacks, they remove the color sets of all the meshes
+    clearPaintMeshes();
 }
 
 void SkinBrushContext::getClassName(MString &name) const { name.set("brSkinBrush"); }
 
 void SkinBrushContext::refreshJointsLocks() {
     if (verbose) MGlobal::displayInfo(" - refreshJointsLocks-");
-    if (!skinObj.isNull()) {
+    if (!skinObj.isNull() && !this->mapMode) {
         // Get the skin cluster node from the history of the mesh.
         getListLockJoints(skinObj, this->nbJoints, indicesForInfluenceObjects, this->lockJoints);
     }
@@ -215,6 +258,7 @@ void SkinBrushContext::refreshMirrorInfluences(MIntArray &inputMirrorInfluences)
 
 void SkinBrushContext::refreshTheseVertices(MIntArray &verticesIndices) {
     // this command is used when undo is called
+    waitForTopology();
     if (verbose) {
         MGlobal::displayInfo(" - refreshThisVertices-");
         MString toDisplay("List Vertices : ");
@@ -228,16 +272,20 @@ void SkinBrushContext::refreshTheseVertices(MIntArray &verticesIndices) {
     }
 
     querySkinClusterValues(this->skinObj, verticesIndices, true);
+    for (int vtxIndex : verticesIndices) this->dirtyVertices.erase(vtxIndex);
     // query the Locks
-    getListLockJoints(skinObj, this->nbJoints, indicesForInfluenceObjects, this->lockJoints);
-    MIntArray editVertsIndices;
-    getListLockVertices(skinObj, this->lockVertices, editVertsIndices);
+    if (!this->mapMode) {
+        getListLockJoints(skinObj, this->nbJoints, indicesForInfluenceObjects, this->lockJoints);
+        MIntArray editVertsIndices;
+        getListLockVertices(skinObj, this->meshArrays->lockVertices, editVertsIndices);
+    }
 
     if (!meshDag.isValid()) {
         return;
     }
-    // points and normals
-    refreshPointsNormals();
+    // points and normals of the refreshed vertices
+    refreshPointsNormals(verticesIndices);
+    if (!this->volumeHash.empty()) this->volumeHash.update(this->mayaRawPoints, verticesIndices);
 
     MColorArray multiEditColors, soloEditColors;
     refreshColors(verticesIndices, multiEditColors, soloEditColors);
@@ -260,7 +308,211 @@ void SkinBrushContext::refreshTheseVertices(MIntArray &verticesIndices) {
     this->previousMirrorPaint.clear();
 }
 
+// ---------------------------------------------------------------------
+// weights edited outside of the brush (weight editor, scripts, other tools undo)
+// the changed rows are collected by attribute callbacks and refreshed on idle
+// ---------------------------------------------------------------------
+
+// lockWeights is driven by the lockInfluenceWeights of the influences, setting it on a joint does
+// not set the plug of the skinCluster, so the influences get their own callback
+static void addInfluenceLocksCallbacks(const MObject &skinCluster,
+                                       MNodeMessage::MAttr2PlugFunction callback, void *clientData,
+                                       MCallbackIdArray &callbackIds) {
+    MStatus status;
+    MFnDependencyNode skinClusterDep(skinCluster);
+    MPlug lockWeightsPlug = skinClusterDep.findPlug("lockWeights", false, &status);
+    if (status != MS::kSuccess) return;
+    for (unsigned int i = 0; i < lockWeightsPlug.numElements(); ++i) {
+        MPlugArray sources;
+        lockWeightsPlug.elementByPhysicalIndex(i).connectedTo(sources, true, false);
+        if (sources.length() == 0) continue;
+        MObject influenceNode = sources[0].node();
+        MCallbackId callbackId =
+            MNodeMessage::addAttributeChangedCallback(influenceNode, callback, clientData, &status);
+        if (status == MS::kSuccess) callbackIds.append(callbackId);
+    }
+}
+
+void SkinBrushContext::addWeightsCallbacks() {
+    MStatus status;
+    removeWeightsCallbacks();
+    if (skinObj.isNull()) return;
+
+    if (this->mapMode) {
+        // the elements of the map are refreshed like the weights
+        MCallbackId callbackId = MNodeMessage::addAttributeChangedCallback(
+            skinObj, SkinBrushContext::weightsChangedCallback, this, &status);
+        if (status == MS::kSuccess) this->weightsCallbackIds.append(callbackId);
+        return;
+    }
+    MFnDependencyNode skinClusterDep(skinObj);
+    this->weightListAttr = skinClusterDep.attribute("weightList");
+    this->weightsAttr = skinClusterDep.attribute("weights");
+    this->lockWeightsAttr = skinClusterDep.attribute("lockWeights");
+    MCallbackId callbackId = MNodeMessage::addAttributeChangedCallback(
+        skinObj, SkinBrushContext::weightsChangedCallback, this, &status);
+    if (status == MS::kSuccess) this->weightsCallbackIds.append(callbackId);
+    addInfluenceLocksCallbacks(skinObj, SkinBrushContext::weightsChangedCallback, this,
+                               this->weightsCallbackIds);
+
+    // the locked vertices are stored on the deformed shape
+    MFnSkinCluster skinFn(skinObj);
+    MObjectArray objectsDeformed;
+    skinFn.getOutputGeometry(objectsDeformed);
+    if (objectsDeformed.length() == 0) return;
+    MFnDependencyNode deformedDep(objectsDeformed[0]);
+    if (!deformedDep.hasAttribute("lockedVertices")) return;
+    this->lockedVerticesAttr = deformedDep.attribute("lockedVertices");
+    callbackId = MNodeMessage::addAttributeChangedCallback(
+        objectsDeformed[0], SkinBrushContext::weightsChangedCallback, this, &status);
+    if (status == MS::kSuccess) this->weightsCallbackIds.append(callbackId);
+}
+
+void SkinBrushContext::removeWeightsCallbacks() {
+    if (this->weightsCallbackIds.length() > 0) MMessage::removeCallbacks(this->weightsCallbackIds);
+    this->weightsCallbackIds.clear();
+    if (this->idleRefreshCallbackId != 0) MMessage::removeCallback(this->idleRefreshCallbackId);
+    this->idleRefreshCallbackId = 0;
+
+    this->lockedVerticesAttr = MObject();
+    this->dirtyVertices.clear();
+    this->dirtyLockInfluences.clear();
+    this->dirtyVerticesLocks = false;
+}
+
+// stores the vertex of an element of the painted map, every vertex if the whole array is set
+static bool storeDirtyMapPlug(MPlug &plug, const MPlug &mapPlug, unsigned int numVertices,
+                              std::set<int> &dirtyVertices) {
+    if (plug.isElement() && plug.array() == mapPlug) {
+        dirtyVertices.insert(plug.logicalIndex());
+    } else if (plug == mapPlug) {
+        for (unsigned int vtxIndex = 0; vtxIndex < numVertices; ++vtxIndex)
+            dirtyVertices.insert(dirtyVertices.end(), vtxIndex);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// stores the vertex or the influence of the plug, false if the plug is not a weight or a lock
+static bool storeDirtyPlug(MPlug &plug, const MObject &skinCluster, const MObject &weightListAttr,
+                           const MObject &weightsAttr, const MObject &lockWeightsAttr,
+                           const MObject &lockedVerticesAttr, std::set<int> &dirtyVertices,
+                           std::set<int> &dirtyLockInfluences, bool &dirtyVerticesLocks) {
+    MObject attr = plug.attribute();
+    if (attr == weightsAttr) {
+        // weightList[v].weights[j] or weightList[v].weights
+        MPlug weightsPlug = plug.isElement() ? plug.array() : plug;
+        MPlug weightListPlug = weightsPlug.parent();
+        if (!weightListPlug.isElement()) return false;
+        dirtyVertices.insert(weightListPlug.logicalIndex());
+    } else if (attr == weightListAttr) {
+        if (!plug.isElement()) return false;
+        dirtyVertices.insert(plug.logicalIndex());
+    } else if (attr == lockWeightsAttr) {
+        if (!plug.isElement()) return false;
+        dirtyLockInfluences.insert(plug.logicalIndex());
+    } else if (!lockedVerticesAttr.isNull() && attr == lockedVerticesAttr) {
+        dirtyVerticesLocks = true;
+    } else if (plug.partialName(false, false, false, false, false, true) ==
+               "lockInfluenceWeights") {
+        // set on an influence, the lockWeights elements it drives on this skinCluster
+        MPlugArray destinations;
+        plug.connectedTo(destinations, false, true);
+        bool found = false;
+        for (unsigned int i = 0; i < destinations.length(); ++i) {
+            if (destinations[i].node() != skinCluster ||
+                destinations[i].attribute() != lockWeightsAttr)
+                continue;
+            dirtyLockInfluences.insert(destinations[i].logicalIndex());
+            found = true;
+        }
+        return found;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void SkinBrushContext::weightsChangedCallback(MNodeMessage::AttributeMessage msg, MPlug &plug,
+                                              MPlug &, void *clientData) {
+    if (!(msg & (MNodeMessage::kAttributeSet | MNodeMessage::kAttributeArrayAdded |
+                 MNodeMessage::kAttributeArrayRemoved)))
+        return;
+    SkinBrushContext *ctx = static_cast<SkinBrushContext *>(clientData);
+    if (ctx->ignoreWeightsCallbacks) return;
+
+    // only store the indices here, this is called for every plug set
+    if (ctx->mapMode) {
+        if (!storeDirtyMapPlug(plug, ctx->mapPlug, ctx->numVertices, ctx->dirtyVertices)) return;
+    } else if (!storeDirtyPlug(plug, ctx->skinObj, ctx->weightListAttr, ctx->weightsAttr,
+                               ctx->lockWeightsAttr, ctx->lockedVerticesAttr, ctx->dirtyVertices,
+                               ctx->dirtyLockInfluences, ctx->dirtyVerticesLocks)) {
+        return;
+    }
+    if (ctx->idleRefreshCallbackId == 0) {
+        MStatus status;
+        ctx->idleRefreshCallbackId = MEventMessage::addEventCallback(
+            "idle", SkinBrushContext::idleRefreshCallback, ctx, &status);
+        if (status != MS::kSuccess) ctx->idleRefreshCallbackId = 0;
+    }
+}
+
+void SkinBrushContext::idleRefreshCallback(void *clientData) {
+    SkinBrushContext *ctx = static_cast<SkinBrushContext *>(clientData);
+    // one shot, the next edit registers it again
+    MMessage::removeCallback(ctx->idleRefreshCallbackId);
+    ctx->idleRefreshCallbackId = 0;
+    ctx->refreshDirtyVertices();
+}
+
+void SkinBrushContext::refreshDirtyVertices() {
+    std::set<int> toRefresh;
+    toRefresh.swap(this->dirtyVertices);
+    if (skinObj.isNull() || !meshDag.isValid()) {
+        this->dirtyLockInfluences.clear();
+        this->dirtyVerticesLocks = false;
+        return;
+    }
+    // a locked / unlocked influence changes the colors of its footprint only
+    if (!this->dirtyLockInfluences.empty()) flushInfluenceVertices();
+    for (int logicalIndex : this->dirtyLockInfluences) {
+        if (logicalIndex < 0 || logicalIndex >= (int)indicesForInfluenceObjects.length()) continue;
+        int influence = indicesForInfluenceObjects[logicalIndex];
+        if (influence < 0 || influence >= (int)this->influenceVertices.size()) continue;
+        toRefresh.insert(this->influenceVertices[influence].begin(),
+                         this->influenceVertices[influence].end());
+    }
+    this->dirtyLockInfluences.clear();
+
+    if (this->dirtyVerticesLocks) {
+        MIntArray prevLockVertices, lockedIndices;
+        prevLockVertices.copy(this->meshArrays->lockVertices);
+        getListLockVertices(skinObj, this->meshArrays->lockVertices, lockedIndices);
+        for (unsigned int i = 0; i < this->meshArrays->lockVertices.length(); ++i) {
+            int prevLock = (i < prevLockVertices.length()) ? prevLockVertices[i] : 0;
+            if (prevLock != this->meshArrays->lockVertices[i]) toRefresh.insert((int)i);
+        }
+        this->dirtyVerticesLocks = false;
+    }
+    if (toRefresh.empty()) return;
+    if (verbose)
+        MGlobal::displayInfo(MString(" - refreshDirtyVertices- ") + (int)toRefresh.size());
+
+    // past half of the mesh the full refresh is faster
+    if (toRefresh.size() > this->numVertices / 2) {
+        refresh();
+        return;
+    }
+    MIntArray verticesIndices;
+    verticesIndices.setLength((unsigned int)toRefresh.size());
+    unsigned int i = 0;
+    for (int vtxIndex : toRefresh) verticesIndices[i++] = vtxIndex;
+    refreshTheseVertices(verticesIndices);
+}
+
 void SkinBrushContext::refreshDeformerColor(int deformerInd) {
+    if (this->mapMode) return;  // one white influence
     if (!skinObj.isNull()) {
         getListLockJoints(skinObj, this->nbJoints, indicesForInfluenceObjects, this->lockJoints);
         getListColorsJoints(skinObj, this->nbJoints, indicesForInfluenceObjects, this->jointsColors,
@@ -271,16 +523,7 @@ void SkinBrushContext::refreshDeformerColor(int deformerInd) {
     }
 
     // get the vertices indices to edit -------------------
-    MIntArray editVertsIndices;
-    for (unsigned int theVert = 0; theVert < this->numVertices; ++theVert) {
-        double theWeight = 0.0;
-        int ind_swl = theVert * this->nbJoints + deformerInd;
-        if (ind_swl < this->skinWeightList.length())
-            theWeight = this->skinWeightList[ind_swl];
-        if (theWeight != 0.0) {
-            editVertsIndices.append(theVert);
-        }
-    }
+    MIntArray editVertsIndices = getInfluenceVertices(deformerInd);
 
     // display the locks ----------------------
     MColorArray multiEditColors, soloEditColors;
@@ -305,13 +548,17 @@ void SkinBrushContext::refresh() {
     refreshPointsNormals();
     MIntArray editVertsIndices;
 
-    if (!skinObj.isNull()) {
+    if (this->mapMode) {
+        status = fillMapValues();
+        this->dirtyVertices.clear();
+    } else if (!skinObj.isNull()) {
         // Get the skin cluster node from the history of the mesh.
         getListLockJoints(skinObj, this->nbJoints, indicesForInfluenceObjects, this->lockJoints);
         getListColorsJoints(skinObj, this->nbJoints, indicesForInfluenceObjects, this->jointsColors,
                             this->verbose);  // get the joints colors
-        status = getListLockVertices(skinObj, this->lockVertices, editVertsIndices);  // problem ?
+        status = getListLockVertices(skinObj, this->meshArrays->lockVertices, editVertsIndices);  // problem ?
         status = fillArrayValuesDEP(skinObj, true);  // get the skin data and all the colors
+        this->dirtyVertices.clear();
     } else {
         MGlobal::displayError(MString("FAILED : skinObj.isNull"));
         return;
@@ -319,11 +566,11 @@ void SkinBrushContext::refresh() {
 
     this->skinValuesToSet.clear();
 
-    meshFn.setColors(this->multiCurrentColors, &this->fullColorSet);  // set the multi assignation
-    meshFn.setColors(this->soloCurrentColors, &this->soloColorSet);   // set the solo assignation
+    meshFn.setColors(this->meshArrays->multiCurrentColors, &this->fullColorSet);  // set the multi assignation
+    meshFn.setColors(this->meshArrays->soloCurrentColors, &this->soloColorSet);   // set the solo assignation
 
-    meshFn.setColors(this->multiCurrentColors, &this->fullColorSet2);  // set the multi assignation
-    meshFn.setColors(this->soloCurrentColors, &this->soloColorSet2);   // set the solo assignation
+    meshFn.setColors(this->meshArrays->multiCurrentColors, &this->fullColorSet2);  // set the multi assignation
+    meshFn.setColors(this->meshArrays->soloCurrentColors, &this->soloColorSet2);   // set the solo assignation
 
     // display the locks ----------------------
     MColorArray multiEditColors, soloEditColors;
@@ -342,44 +589,125 @@ void SkinBrushContext::refresh() {
     maya2019RefreshColors();
 }
 
-// ---------------------------------------------------------------------
-// viewport 2.0
-// ---------------------------------------------------------------------
-int SkinBrushContext::getClosestInfluenceToCursor(int screenX, int screenY) {
-    MStatus stat;
-    MPoint nearClipPt, farClipPt;
-    MVector direction, direction2;
-    MPoint orig, orig2;
-    view.viewToWorld(screenX, screenY, orig, direction);
+void SkinBrushContext::fillInfluencesBoxes() {
+    double jointDisplayVal;
+    MGlobal::executeCommand("jointDisplayScale -query", jointDisplayVal);
+    if (verbose) MGlobal::displayInfo(MString("jointDisplayScale :  ") + jointDisplayVal);
 
     int lent = this->inflDagPaths.length();
-    int closestInfluence = -1;
-    double closestDistance = -1;
-
-    for (unsigned int i = 0; i < lent; i++) {
-        MMatrix matI = BBoxOfDeformers[i].mat.inverse();
-        orig2 = orig * matI;
-        direction2 = direction * matI;
-
-        MPoint minPt = BBoxOfDeformers[i].minPt;
-        MPoint maxPt = BBoxOfDeformers[i].maxPt;
-        MPoint center = BBoxOfDeformers[i].center;
-
-        bool intersect = RayIntersectsBBox(minPt, maxPt, orig2, direction2);
-        if (intersect) {
-            double dst = center.distanceTo(orig2);
-            if ((closestInfluence == -1) || (dst < closestDistance)) {
-                closestDistance = dst;
-                closestInfluence = i;
+    if (verbose) MGlobal::displayInfo("\nfilling BBoxOfDeformers \n");
+    MPoint zero(0, 0, 0);
+    MVector up(0, 1, 0);
+    MVector right(1, 0, 0);
+    MVector side(0, 0, 1);
+    for (unsigned int i = 0; i < lent; i++) {  // for all deformers
+        MDagPath path = this->inflDagPaths[i];
+        drawingDeformers newDef;
+
+        MMatrix worldMatrix = path.inclusiveMatrix();        // worldMatrix
+        MMatrix parentMatrix = path.exclusiveMatrix();       // parentMatrix
+        MMatrix mat = worldMatrix * parentMatrix.inverse();  // matrix
+
+        MBoundingBox bbox;
+
+        right = MVector(worldMatrix[0]);
+        up = MVector(worldMatrix[1]);
+        side = MVector(worldMatrix[2]);
+
+        unsigned int nbShapes;
+        path.numberOfShapesDirectlyBelow(nbShapes);
+        if (nbShapes != 0) {
+            path.extendToShapeDirectlyBelow(0);
+            MFnDagNode dag(path);
+            bbox = dag.boundingBox();  // Returns the bounding box for the dag node in
+                                       // object space.
+
+            MPoint center = bbox.center() * worldMatrix;
+            newDef.center = center;
+            newDef.width = 0.5 * bbox.width() * right.length();
+            newDef.height = 0.5 * bbox.height() * up.length();
+            newDef.depth = 0.5 * bbox.depth() * side.length();
+
+            newDef.mat = worldMatrix;
+            newDef.minPt = bbox.min();
+            newDef.maxPt = bbox.max();
+        } else {
+            MFnDagNode dag(path);
+            MStatus plugStat;
+            MPlug radiusPlug = dag.findPlug("radius", false, &plugStat);
+            double multVal = jointDisplayVal;
+            if (plugStat == MStatus::kSuccess) {
+                multVal *= radiusPlug.asDouble();
             }
+
+            newDef.center = zero * worldMatrix;
+            newDef.width = 0.5 * right.length() * multVal;
+            newDef.height = 0.5 * up.length() * multVal;
+            newDef.depth = 0.5 * side.length() * multVal;
+
+            newDef.mat = worldMatrix;
+            newDef.minPt = multVal * MPoint(-0.5, -0.5, -0.5);
+            newDef.maxPt = multVal * MPoint(0.5, 0.5, 0.5);
+        }
+        newDef.up = up;
+        newDef.right = right;
+
+        BBoxOfDeformers.push_back(newDef);
+    }
+
+    // cached inverse matrices and bvh for the picking, the matrix callbacks clear them
+    std::vector<MMatrix> matrices;
+    std::vector<MPoint> minPts, maxPts;
+    for (const drawingDeformers &def : BBoxOfDeformers) {
+        matrices.push_back(def.mat);
+        minPts.push_back(def.minPt);
+        maxPts.push_back(def.maxPt);
+    }
+    this->influencesBVH.build(matrices, minPts, maxPts);
+
+    if (this->influencesMatrixCallbackIds.length() == 0) {
+        MStatus status;
+        for (unsigned int i = 0; i < lent; i++) {
+            MDagPath path = this->inflDagPaths[i];
+            MCallbackId callbackId = MDagMessage::addWorldMatrixModifiedCallback(
+                path, SkinBrushContext::influenceMatrixModifiedCallback, this, &status);
+            if (status == MS::kSuccess) this->influencesMatrixCallbackIds.append(callbackId);
         }
     }
-    return closestInfluence;
+}
+
+void SkinBrushContext::removeInfluencesMatrixCallbacks() {
+    if (this->influencesMatrixCallbackIds.length() > 0)
+        MMessage::removeCallbacks(this->influencesMatrixCallbackIds);
+    this->influencesMatrixCallbackIds.clear();
+    this->BBoxOfDeformers.clear();
+    this->influencesBVH.clear();
+}
+
+void SkinBrushContext::influenceMatrixModifiedCallback(MObject &, MDagMessage::MatrixModifiedFlags &,
+                                                       void *clientData) {
+    // rebuilt on the next move in pick influence mode
+    SkinBrushContext *ctx = static_cast<SkinBrushContext *>(clientData);
+    ctx->BBoxOfDeformers.clear();
+    ctx->influencesBVH.clear();
+}
+
+// ---------------------------------------------------------------------
+// viewport 2.0
+// ---------------------------------------------------------------------
+int SkinBrushContext::getClosestInfluenceToCursor(int screenX, int screenY) {
+    MVector direction;
+    MPoint orig;
+    view.viewToWorld(screenX, screenY, orig, direction);
+    return this->influencesBVH.closestHit(orig, direction);
 }
 
 int SkinBrushContext::getHighestInfluence(int faceHit, MFloatPoint &hitPoint) {
     // get closest vertex
     auto verticesSet = getSurroundingVerticesPerFace(faceHit);
+    std::vector<int> pages;
+    for (int ptIndex : verticesSet) addPageOfVertex(ptIndex, pages);
+    loadWeightPages(pages, true);
     int indexVertex = -1;
     float closestDist;
     for (int ptIndex : verticesSet) {
@@ -399,8 +727,8 @@ int SkinBrushContext::getHighestInfluence(int faceHit, MFloatPoint &hitPoint) {
     for (int indexInfluence = 0; indexInfluence < this->nbJoints; ++indexInfluence) {
         double theWeight = 0.0;
         int ind_swl = indexVertex * this->nbJoints + indexInfluence;
-        if (ind_swl < this->skinWeightList.length())
-            theWeight = this->skinWeightList[ind_swl];
+        if (ind_swl < this->meshArrays->skinWeightList.length())
+            theWeight = this->meshArrays->skinWeightList[ind_swl];
         allWeights.push_back(theWeight);
         if (theWeight > biggestVal) {
             biggestVal = theWeight;
@@ -429,20 +757,20 @@ MStatus SkinBrushContext::drawTheMesh(MHWRender::MUIDrawManager &drawManager, MV
     drawManager.setLineWidth(1);
 
     MPointArray edgeVertices;
-    for (const auto &pairEdges : this->perEdgeVertices) {
-        double multVal = worldVector * this->verticesNormals[pairEdges.first];
-        double multVal2 = worldVector * this->verticesNormals[pairEdges.second];
+    const std::vector<int> &pairs = this->topology.edgeVertices;
+    for (size_t e = 0; e + 1 < pairs.size(); e += 2) {
+        int first = pairs[e], second = pairs[e + 1];
+        double multVal = worldVector * this->meshArrays->verticesNormals[first];
+        double multVal2 = worldVector * this->meshArrays->verticesNormals[second];
         if ((multVal > 0.0) && (multVal2 > 0.0)) {
             continue;
         }
-        float element[4] = {this->mayaRawPoints[pairEdges.first * 3],
-                            this->mayaRawPoints[pairEdges.first * 3 + 1],
-                            this->mayaRawPoints[pairEdges.first * 3 + 2], 0};
+        float element[4] = {this->mayaRawPoints[first * 3], this->mayaRawPoints[first * 3 + 1],
+                            this->mayaRawPoints[first * 3 + 2], 0};
         edgeVertices.append(element);
 
-        float element2[4] = {this->mayaRawPoints[pairEdges.second * 3],
-                             this->mayaRawPoints[pairEdges.second * 3 + 1],
-                             this->mayaRawPoints[pairEdges.second * 3 + 2], 0};
+        float element2[4] = {this->mayaRawPoints[second * 3], this->mayaRawPoints[second * 3 + 1],
+                             this->mayaRawPoints[second * 3 + 2], 0};
         edgeVertices.append(element2);
         // use the normals to paint ...
     }
@@ -455,78 +783,16 @@ MStatus SkinBrushContext::drawTheMesh(MHWRender::MUIDrawManager &drawManager, MV
 MStatus SkinBrushContext::doPtrMoved(MEvent &event, MHWRender::MUIDrawManager &drawManager,
                                      const MHWRender::MFrameContext &context) {
     event.getPosition(screenX, screenY);
+    // still entering the tool, no hit test until the faces are built
+    if (!this->hitTopologyReady) return MS::kSuccess;
+    refreshRawPoints();
     bool displayPickInfluence = this->pickMaxInfluenceVal || this->pickInfluenceVal;
     if (this->pickInfluenceVal) {
         if (verbose) MGlobal::displayInfo("HERE pickInfluenceVal IS CALLED");
         // -------------------------------------------------------------------------------------------------
         // start fill jnts boundingBox
         // --------------------------------------------------------------------
-        if (this->BBoxOfDeformers.size() == 0) {  // fill it
-            double jointDisplayVal;
-            MGlobal::executeCommand("jointDisplayScale -query", jointDisplayVal);
-            MGlobal::displayInfo(MString("jointDisplayScale :  ") + jointDisplayVal);
-
-            int lent = this->inflDagPaths.length();
-            if (verbose) MGlobal::displayInfo("\nfilling BBoxOfDeformers \n");
-            MPoint zero(0, 0, 0);
-            MVector up(0, 1, 0);
-            MVector right(1, 0, 0);
-            MVector side(0, 0, 1);
-            for (unsigned int i = 0; i < lent; i++) {  // for all deformers
-                MDagPath path = this->inflDagPaths[i];
-                drawingDeformers newDef;
-
-                MMatrix worldMatrix = path.inclusiveMatrix();        // worldMatrix
-                MMatrix parentMatrix = path.exclusiveMatrix();       // parentMatrix
-                MMatrix mat = worldMatrix * parentMatrix.inverse();  // matrix
-
-                MBoundingBox bbox;
-
-                right = MVector(worldMatrix[0]);
-                up = MVector(worldMatrix[1]);
-                side = MVector(worldMatrix[2]);
-
-                unsigned int nbShapes;
-                path.numberOfShapesDirectlyBelow(nbShapes);
-                if (nbShapes != 0) {
-                    path.extendToShapeDirectlyBelow(0);
-                    MFnDagNode dag(path);
-                    bbox = dag.boundingBox();  // Returns the bounding box for the dag node in
-                                               // object space.
-
-                    MPoint center = bbox.center() * worldMatrix;
-                    newDef.center = center;
-                    newDef.width = 0.5 * bbox.width() * right.length();
-                    newDef.height = 0.5 * bbox.height() * up.length();
-                    newDef.depth = 0.5 * bbox.depth() * side.length();
-
-                    newDef.mat = worldMatrix;
-                    newDef.minPt = bbox.min();
-                    newDef.maxPt = bbox.max();
-                } else {
-                    MFnDagNode dag(path);
-                    MStatus plugStat;
-                    MPlug radiusPlug = dag.findPlug("radius", false, &plugStat);
-                    double multVal = jointDisplayVal;
-                    if (plugStat == MStatus::kSuccess) {
-                        multVal *= radiusPlug.asDouble();
-                    }
-
-                    newDef.center = zero * worldMatrix;
-                    newDef.width = 0.5 * right.length() * multVal;
-                    newDef.height = 0.5 * up.length() * multVal;
-                    newDef.depth = 0.5 * side.length() * multVal;
-
-                    newDef.mat = worldMatrix;
-                    newDef.minPt = multVal * MPoint(-0.5, -0.5, -0.5);
-                    newDef.maxPt = multVal * MPoint(0.5, 0.5, 0.5);
-                }
-                newDef.up = up;
-                newDef.right = right;
-
-                BBoxOfDeformers.push_back(newDef);
-            }
-        }  // end fill it
+        if (this->BBoxOfDeformers.size() == 0) fillInfluencesBoxes();
 
         // end fill jnts boundingBox
         // --------------------------------------------------------------------
@@ -543,6 +809,16 @@ MStatus SkinBrushContext::doPtrMoved(MEvent &event, MHWRender::MUIDrawManager &d
         this->refreshDone = true;
     }
 
+    // another mesh of the session in front of the brush, it becomes the painted one
+    int paintMeshIndex = getCloserPaintMesh(screenX, screenY, successFullHit);
+    if (paintMeshIndex != -1 && activatePaintMesh(paintMeshIndex) == MS::kSuccess) {
+        if (this->pickInfluenceVal) {
+            fillInfluencesBoxes();
+            biggestInfluence = getClosestInfluenceToCursor(screenX, screenY);
+        }
+        successFullHit = computeHit(screenX, screenY, true, faceHit, this->centerOfBrush);
+    }
+
     if (!successFullHit && !displayPickInfluence) return MStatus::kNotFound;
 
     drawManager.beginDrawable();
@@ -638,12 +914,14 @@ MStatus SkinBrushContext::doDrag(MEvent &event, MHWRender::MUIDrawManager &drawM
         return MS::kFailure;
     }
 
+    auto eventStart = std::chrono::steady_clock::now();
     status = doDragCommon(event);
     if (this->postSetting && !this->useColorSetsWhilePainting) {
         drawManager.beginDrawable();
         drawMeshWhileDrag(drawManager);
         drawManager.endDrawable();
     }
+    if (event.mouseButton() == MEvent::kLeftMouse) scheduleNextDragEvent(eventStart);
     CHECK_MSTATUS_AND_RETURN_SILENT(status);
 
     // -----------------------------------------------------------------
@@ -700,6 +978,9 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
     // So it can and should be optimized more
     // I think the endgame for this is to only update the changed vertices each runthrough
     int nbVtx = this->verticesPainted.size();
+    // the late events only draw the triangles
+    bool withEdges = this->drawEdges && !this->degradedDrag;
+    bool withPoints = this->drawPoints && !this->degradedDrag;
 
     MFloatPointArray points(nbVtx);
     MFloatVectorArray normals(nbVtx);
@@ -728,7 +1009,7 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
     // UnLockVertices
     ModifierCommands theCommandIndex = getCommandIndexModifiers();
 
-    if (drawTransparency || drawPoints) {
+    if (drawTransparency || withPoints) {
         if (theCommandIndex == ModifierCommands::LockVertices)
             baseColor = this->lockVertColor;
         else if (theCommandIndex == ModifierCommands::Remove)
@@ -774,11 +1055,11 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
     MColorArray *currentColors;
     if (this->soloColorVal == 1){
         usedColors = &colorsSolo;
-        currentColors = &this->soloCurrentColors;
+        currentColors = &this->meshArrays->soloCurrentColors;
     }
     else {
         usedColors = &colors;
-        currentColors = &this->multiCurrentColors;
+        currentColors = &this->meshArrays->multiCurrentColors;
     }
 
     bool doTransparency = drawTransparency;
@@ -800,7 +1081,7 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
         );
         posPoint = posPoint * this->inclusiveMatrix;
         points.set(posPoint, i);
-        normals.set(verticesNormals[ptIndex], i);
+        normals.set(this->meshArrays->verticesNormals[ptIndex], i);
     }
 
     if (drawTriangles) {
@@ -824,13 +1105,14 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
                 float weightMirror = pt.second.second;
                 float transparency = (doTransparency) ? weightBase + weightMirror: 1.0;
                 MColor& colRef = (*usedColors)[i];
+                float h, s, v;  // per thread
                 colRef.get(MColor::kHSV, h, s, v);
                 colRef.set(MColor::kHSV, h, pow(s, 0.8), pow(v, 0.15), transparency);
             }
         }
     }
 
-    if (drawPoints) {
+    if (withPoints) {
 #pragma omp parallel for
         for (unsigned i = 0; i < mja.size(); ++i){
             const auto &pt = mja[i];
@@ -839,7 +1121,7 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
         }
     }
 
-    if (drawEdges) {
+    if (withEdges) {
         darkEdges.setLength(mja.size());
 #pragma omp parallel for
         for (unsigned i = 0; i < mja.size(); ++i){
@@ -849,7 +1131,7 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
         }
     }
 
-    if (drawTriangles || drawEdges) {
+    if (drawTriangles || withEdges) {
         for (unsigned i = 0; i < mja.size(); ++i){
             const auto &pt = mja[i];
             verticesMap[pt.first] = i;
@@ -861,18 +1143,18 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
         for (unsigned i = 0; i < mja.size(); ++i){
             const auto &pt = mja[i];
             int ptIndex = pt.first;
-            for (int f : this->perVertexFaces[ptIndex]){
-                fatFaces_bitset[f] = true;
+            for (int k = this->topology.vertexFaceStarts[ptIndex]; k < this->topology.vertexFaceStarts[ptIndex + 1]; ++k){
+                fatFaces_bitset[this->topology.vertexFaces[k]] = true;
             }
         }
     }
 
-    if (drawEdges) {
+    if (withEdges) {
         for (unsigned i = 0; i < mja.size(); ++i){
             const auto &pt = mja[i];
             int ptIndex = pt.first;
-            for (int e : this->perVertexEdges[ptIndex]){
-                fatEdges_bitset[e] = true;
+            for (int k = this->topology.vertexEdgeStarts[ptIndex]; k < this->topology.vertexEdgeStarts[ptIndex + 1]; ++k){
+                fatEdges_bitset[this->topology.vertexEdges[k]] = true;
             }
         }
     }
@@ -883,7 +1165,8 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
         // so we don't have to constantly allocate memory
         for (unsigned f = 0; f<fatFaces_bitset.size(); ++f){
             if (!fatFaces_bitset[f]) continue;
-            for (auto &tri : this->perFaceTriangleVertices[f]) {
+            for (int t = this->topology.faceTriangleStarts[f]; t < this->topology.faceTriangleStarts[f + 1]; ++t) {
+                const int *tri = &this->topology.triangleVertices[3 * t];
                 if (!vertMap_bitset[tri[0]]) continue;
                 if (!vertMap_bitset[tri[1]]) continue;
                 if (!vertMap_bitset[tri[2]]) continue;
@@ -901,18 +1184,18 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
         drawManager.mesh(MHWRender::MUIDrawManager::kTriangles, points, &normals, usedColors, &indices);
     }
 
-    if (drawEdges) {
+    if (withEdges) {
         // bitset is faster than an unordered_set in this case
         // may be worth keeping the bitsets around on the brush
         // so we don't have to constantly allocate memory
         for (unsigned e = 0; e<fatEdges_bitset.size(); ++e){
             if (!fatEdges_bitset[e]) continue;
-            auto &pairEdges = this->perEdgeVertices[e];
+            const int *pairEdges = &this->topology.edgeVertices[2 * e];
 
-            if (!vertMap_bitset[pairEdges.first]) continue;
-            if (!vertMap_bitset[pairEdges.second]) continue;
-            auto it0 = verticesMap.find(pairEdges.first);
-            auto it1 = verticesMap.find(pairEdges.second);
+            if (!vertMap_bitset[pairEdges[0]]) continue;
+            if (!vertMap_bitset[pairEdges[1]]) continue;
+            auto it0 = verticesMap.find(pairEdges[0]);
+            auto it1 = verticesMap.find(pairEdges[1]);
             indicesEdges.append(it0->second);
             indicesEdges.append(it1->second);
 
@@ -922,7 +1205,7 @@ MStatus SkinBrushContext::drawMeshWhileDrag(MHWRender::MUIDrawManager &drawManag
         drawManager.mesh(MHWRender::MUIDrawManager::kLines, points, &normals, &darkEdges, &indicesEdges);
     }
 
-    if (drawPoints) {
+    if (withPoints) {
         drawManager.setPointSize(4);
         drawManager.mesh(MHWRender::MUIDrawManager::kPoints, points, NULL, &pointsColors);
     }
@@ -960,10 +1243,7 @@ MStatus drawMeshWhileDrag(
     MFloatMatrix &inclusiveMatrix,  // The worldspace matrix of the current mesh
     MVectorArray &verticesNormals, // The per-vertex local space normals of the mesh
 
-    std::vector<MIntArray> &perVertexFaces, // The face indices for each vertex
-    std::vector<MIntArray> &perVertexEdges, // The edge indices for each vertex
-    std::vector<std::vector<MIntArray>> &perFaceTriangleVertices, // Somehow get the triangle indices per face
-    std::vector<std::pair<int, int>> &perEdgeVertices, // The endpoint vertex indices of each edge
+    const MeshTopology &topology, // The faces, triangles and edges of each vertex
 
     MHWRender::MUIDrawManager &drawManager // Maya's DrawManager
 ) {
@@ -1095,6 +1375,7 @@ MStatus drawMeshWhileDrag(
                 float weightMirror = pt.second.second;
                 float transparency = (doTransparency) ? weightBase + weightMirror: 1.0;
                 MColor& colRef = (*usedColors)[i];
+                float h, s, v;  // per thread
                 colRef.get(MColor::kHSV, h, s, v);
                 colRef.set(MColor::kHSV, h, pow(s, 0.8), pow(v, 0.15), transparency);
             }
@@ -1132,8 +1413,8 @@ MStatus drawMeshWhileDrag(
         for (unsigned i = 0; i < mja.size(); ++i){
             const auto &pt = mja[i];
             int ptIndex = pt.first;
-            for (int f : perVertexFaces[ptIndex]){
-                fatFaces_bitset[f] = true;
+            for (int k = topology.vertexFaceStarts[ptIndex]; k < topology.vertexFaceStarts[ptIndex + 1]; ++k){
+                fatFaces_bitset[topology.vertexFaces[k]] = true;
             }
         }
     }
@@ -1142,8 +1423,8 @@ MStatus drawMeshWhileDrag(
         for (unsigned i = 0; i < mja.size(); ++i){
             const auto &pt = mja[i];
             int ptIndex = pt.first;
-            for (int e : perVertexEdges[ptIndex]){
-                fatEdges_bitset[e] = true;
+            for (int k = topology.vertexEdgeStarts[ptIndex]; k < topology.vertexEdgeStarts[ptIndex + 1]; ++k){
+                fatEdges_bitset[topology.vertexEdges[k]] = true;
             }
         }
     }
@@ -1154,7 +1435,8 @@ MStatus drawMeshWhileDrag(
         // so we don't have to constantly allocate memory
         for (unsigned f = 0; f<fatFaces_bitset.size(); ++f){
             if (!fatFaces_bitset[f]) continue;
-            for (auto &tri : perFaceTriangleVertices[f]) {
+            for (int t = topology.faceTriangleStarts[f]; t < topology.faceTriangleStarts[f + 1]; ++t) {
+                const int *tri = &topology.triangleVertices[3 * t];
                 if (!vertMap_bitset[tri[0]]) continue;
                 if (!vertMap_bitset[tri[1]]) continue;
                 if (!vertMap_bitset[tri[2]]) continue;
@@ -1178,12 +1460,12 @@ MStatus drawMeshWhileDrag(
         // so we don't have to constantly allocate memory
         for (unsigned e = 0; e<fatEdges_bitset.size(); ++e){
             if (!fatEdges_bitset[e]) continue;
-            auto &pairEdges = perEdgeVertices[e];
+            const int *pairEdges = &topology.edgeVertices[2 * e];
 
-            if (!vertMap_bitset[pairEdges.first]) continue;
-            if (!vertMap_bitset[pairEdges.second]) continue;
-            auto it0 = verticesMap.find(pairEdges.first);
-            auto it1 = verticesMap.find(pairEdges.second);
+            if (!vertMap_bitset[pairEdges[0]]) continue;
+            if (!vertMap_bitset[pairEdges[1]]) continue;
+            auto it0 = verticesMap.find(pairEdges[0]);
+            auto it1 = verticesMap.find(pairEdges[1]);
             indicesEdges.append(it0->second);
             indicesEdges.append(it1->second);
 
@@ -1205,18 +1487,28 @@ MStatus SkinBrushContext::doRelease(MEvent &event, MHWRender::MUIDrawManager &dr
     return doReleaseCommon(event);
 }
 
+void SkinBrushContext::refreshRawPoints() {
+    // evaluates the deformed mesh if the skinCluster was dirtied, otherwise only a lookup
+    if (skinObj.isNull() || !meshDag.isValid()) return;
+    MStatus status;
+    const float *points = this->meshFn.getRawPoints(&status);
+    if (status == MS::kSuccess) this->mayaRawPoints = points;
+    const float *normals = this->meshFn.getRawNormals(&status);
+    if (status == MS::kSuccess) this->rawNormals = normals;
+}
+
 MStatus SkinBrushContext::refreshPointsNormals() {
     MStatus status = MStatus::kSuccess;
 
     if (!skinObj.isNull() && meshDag.isValid(&status)) {
+        waitForTopology(true);
         this->meshFn.freeCachedIntersectionAccelerator();  // yes ?
-        this->mayaRawPoints = this->meshFn.getRawPoints(&status);
-        this->rawNormals = this->meshFn.getRawNormals(&status);
+        refreshRawPoints();
         int rawNormalsLength = sizeof(this->rawNormals);
 
 #pragma omp parallel for
         for (int vertexInd = 0; vertexInd < this->numVertices; vertexInd++) {
-            int indNormal = this->verticesNormalsIndices[vertexInd];
+            int indNormal = this->meshArrays->verticesNormalsIndices[vertexInd];
             int rawIndNormal = indNormal * 3 + 2;
             if (rawIndNormal < rawNormalsLength) {
                 MVector theNormal(
@@ -1224,13 +1516,37 @@ MStatus SkinBrushContext::refreshPointsNormals() {
                     this->rawNormals[indNormal * 3 + 1],
                     this->rawNormals[indNormal * 3 + 2]
                 );
-                this->verticesNormals.set(theNormal, vertexInd);
+                this->meshArrays->verticesNormals.set(theNormal, vertexInd);
             }
         }
     }
     return status;
 }
 
+MStatus SkinBrushContext::refreshPointsNormals(const MIntArray &verticesIndices) {
+    MStatus status = MStatus::kSuccess;
+
+    if (!skinObj.isNull() && meshDag.isValid(&status)) {
+        waitForTopology(true);
+        this->meshFn.freeCachedIntersectionAccelerator();
+        refreshRawPoints();
+        int nbNormals = this->meshFn.numNormals();
+        int nbVerts = (int)verticesIndices.length();
+
+#pragma omp parallel for
+        for (int i = 0; i < nbVerts; i++) {
+            int vertexInd = verticesIndices[i];
+            if (vertexInd < 0 || vertexInd >= this->numVertices) continue;
+            int indNormal = this->meshArrays->verticesNormalsIndices[vertexInd];
+            if (indNormal < 0 || indNormal >= nbNormals) continue;
+            MVector theNormal(this->rawNormals[indNormal * 3], this->rawNormals[indNormal * 3 + 1],
+                              this->rawNormals[indNormal * 3 + 2]);
+            this->meshArrays->verticesNormals.set(theNormal, vertexInd);
+        }
+    }
+    return status;
+}
+
 // ---------------------------------------------------------------------
 // common methods for legacy viewport and viewport 2.0
 // ---------------------------------------------------------------------
@@ -1238,12 +1554,11 @@ MStatus SkinBrushContext::doPressCommon(MEvent &event) {
     MStatus status = MStatus::kSuccess;
 
     if (meshDag.node().isNull()) return MStatus::kNotFound;
+    waitForTopology();
 
     view = M3dView::active3dView();
 
     if (this->pickMaxInfluenceVal || this->pickInfluenceVal) {
-        this->BBoxOfDeformers.clear();
-
         if (this->pickMaxInfluenceVal && biggestInfluence != -1) {
             MUserEventMessage::postUserEvent("brSkinBrush_influencesReordered");
         }
@@ -1258,10 +1573,11 @@ MStatus SkinBrushContext::doPressCommon(MEvent &event) {
     // store for undo purposes --------------------------------------------------------------
     // only if painting not after
     if (!this->postSetting || paintMirror != 0) {
-        this->fullUndoSkinWeightList = MDoubleArray(this->skinWeightList);
+        this->meshArrays->fullUndoSkinWeightList = MDoubleArray(this->meshArrays->skinWeightList);
     }
     // update values ------------------------------------------------------------------------
     refreshPointsNormals();
+    if (this->volumeVal) refreshVolumeHash();
 
     // first reset attribute to paint values off if we're doing that ------------------------
     paintArrayValues.copy(MDoubleArray(numVertices, 0.0));
@@ -1275,6 +1591,12 @@ MStatus SkinBrushContext::doPressCommon(MEvent &event) {
     // initialize --
     undersamplingSteps = 0;
     performBrush = false;
+    this->coalescedDragPositions.clear();
+    this->dragDebtMs = 0.0;
+    this->degradedDrag = false;
+    this->colorsDeferred = false;
+    this->lastDragMs = this->maxDragMs = this->totalDragMs = 0.0;
+    this->nbDragEvents = this->nbCoalescedDragEvents = this->nbDegradedDragEvents = 0;
 
     event.getPosition(this->screenX, this->screenY);
 
@@ -1340,8 +1662,24 @@ MStatus SkinBrushContext::doPressCommon(MEvent &event) {
     return status;
 }
 
+void SkinBrushContext::scheduleNextDragEvent(std::chrono::steady_clock::time_point eventStart) {
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - eventStart;
+    this->lastDragMs = elapsed.count();
+    this->maxDragMs = std::max(this->maxDragMs, this->lastDragMs);
+    this->totalDragMs += this->lastDragMs;
+    this->nbDragEvents++;
+    // the late time carries over, the cheap events pay it back
+    this->dragDebtMs = std::max(0.0, this->dragDebtMs + this->lastDragMs - DRAG_EVENT_BUDGET_MS);
+}
+
 void SkinBrushContext::growArrayOfHitsFromCenters(std::unordered_map<int, float> &dicVertsDist,
                                                   MFloatPointArray &AllHitPoints) {
+    if (this->volumeVal && !this->volumeHash.empty()) {
+        // no growth over the surface, the other shells in the sphere are painted too
+        for (const auto &hitPt : AllHitPoints)
+            getVerticesInVolume(hitPt, (float)this->sizeVal, dicVertsDist);
+        return;
+    }
     // set of visited vertices
     std::vector<int> vertsVisited, vertsWithinDistance;
 
@@ -1374,7 +1712,7 @@ void SkinBrushContext::growArrayOfHitsFromCenters(std::unordered_map<int, float>
         for (int vertexBorder : verticesontheborder) {
             // First check the normal
             if (!this->coverageVal) {
-                MVector vertexBorderNormal = this->verticesNormals[vertexBorder];
+                MVector vertexBorderNormal = this->meshArrays->verticesNormals[vertexBorder];
                 double multVal = worldVector * vertexBorderNormal;
                 if (multVal > 0.0) continue;
             }
@@ -1413,6 +1751,7 @@ void SkinBrushContext::growArrayOfHitsFromCenters(std::unordered_map<int, float>
 
 MStatus SkinBrushContext::doDragCommon(MEvent &event) {
     MStatus status = MStatus::kSuccess;
+    refreshRawPoints();
 
     // -----------------------------------------------------------------
     // Dragging with the left mouse button performs the painting.
@@ -1423,6 +1762,23 @@ MStatus SkinBrushContext::doDragCommon(MEvent &event) {
         short previousY = this->screenY;
         event.getPosition(this->screenX, this->screenY);
 
+        // late, only keep the position, it's a corner of the line of the next painted event
+        if (this->dragDebtMs > 0.0 &&
+            (int)this->coalescedDragPositions.size() < DRAG_MAX_COALESCED) {
+            this->coalescedDragPositions.push_back(std::make_pair(this->screenX, this->screenY));
+            this->screenX = previousX;
+            this->screenY = previousY;
+            this->nbCoalescedDragEvents++;
+            return status;
+        }
+        // still late after the coalesced ones, the stroke and the apply are exact but the color
+        // write waits
+        this->degradedDrag = this->dragDebtMs > 0.0;
+        if (this->degradedDrag) {
+            this->nbDegradedDragEvents++;
+            this->colorsDeferred = true;
+        }
+
         // dictionnary of visited vertices and distances --- prefill it with the previous hit ---
         std::unordered_map<int, float> dicVertsDistToGrow = this->dicVertsDistSTART;
         std::unordered_map<int, float> dicVertsDistToGrowMirror = this->dicVertsMirrorDistSTART;
@@ -1435,8 +1791,16 @@ MStatus SkinBrushContext::doDragCommon(MEvent &event) {
         }
         // --------- LINE OF PIXELS --------------------
         std::vector<std::pair<short, short>> line2dOfPixels;
-        // get pixels of the line of pixels
-        lineC(previousX, previousY, this->screenX, this->screenY, line2dOfPixels);
+        // get pixels of the line of pixels, through the positions of the coalesced events
+        this->coalescedDragPositions.push_back(std::make_pair(this->screenX, this->screenY));
+        short lineStartX = previousX, lineStartY = previousY;
+        for (const auto &position : this->coalescedDragPositions) {
+            if (!line2dOfPixels.empty()) line2dOfPixels.pop_back();  // start of this segment
+            lineC(lineStartX, lineStartY, position.first, position.second, line2dOfPixels);
+            lineStartX = position.first;
+            lineStartY = position.second;
+        }
+        this->coalescedDragPositions.clear();
         int nbPixelsOfLine = (int)line2dOfPixels.size();
 
         MFloatPoint hitPoint, hitMirrorPoint;
@@ -1538,9 +1902,10 @@ MStatus SkinBrushContext::doDragCommon(MEvent &event) {
                          this->intensityValuesMirror, this->skinValuesMirrorToSet, true);
         }
         mergeMirrorArray(this->skinValuesToSet, this->skinValuesMirrorToSet);
-        if (this->useColorSetsWhilePainting || !this->postSetting) {
+        if ((this->useColorSetsWhilePainting || !this->postSetting) && !this->degradedDrag) {
             doPerformPaint();
         }
+        if (!this->degradedDrag) this->colorsDeferred = false;
         performBrush = true;
     }
     // -----------------------------------------------------------------
@@ -1692,6 +2057,18 @@ MStatus SkinBrushContext::doReleaseCommon(MEvent &event) {
         }
     }
     if (performBrush) {
+        // the positions left by the late events, painted and applied as one line
+        if (!this->coalescedDragPositions.empty() &&
+            event.mouseButton() == MEvent::kLeftMouse) {
+            this->dragDebtMs = 0.0;
+            doDragCommon(event);
+        }
+        this->coalescedDragPositions.clear();
+        // the color write left by the late events
+        this->degradedDrag = false;
+        if (this->colorsDeferred && (this->useColorSetsWhilePainting || !this->postSetting))
+            doPerformPaint();
+        this->colorsDeferred = false;
         doTheAction();
     }
     return MS::kSuccess;
@@ -1730,11 +2107,22 @@ void SkinBrushContext::doTheAction() {
     }
 
     ModifierCommands theCommandIndex = getCommandIndexModifiers();
+    if (this->mapMode && ((theCommandIndex == ModifierCommands::LockVertices) ||
+                          (theCommandIndex == ModifierCommands::UnlockVertices))) {
+        // a map has no locks
+        this->skinValuesToSet.clear();
+        this->skinValuesMirrorToSet.clear();
+        this->previousPaint.clear();
+        this->previousMirrorPaint.clear();
+        return;
+    }
     if ((theCommandIndex == ModifierCommands::LockVertices) || (theCommandIndex == ModifierCommands::UnlockVertices)) {
-        undoLocks.copy(this->lockVertices);
+        undoLocks.copy(this->meshArrays->lockVertices);
         bool addLocks = theCommandIndex == ModifierCommands::LockVertices;
-        editLocks(this->skinObj, editVertsIndices, addLocks, this->lockVertices);
-        redoLocks.copy(this->lockVertices);
+        this->ignoreWeightsCallbacks = true;
+        editLocks(this->skinObj, editVertsIndices, addLocks, this->meshArrays->lockVertices);
+        this->ignoreWeightsCallbacks = false;
+        redoLocks.copy(this->meshArrays->lockVertices);
     } else {
         if (this->paintMirror != 0) {
             int mirrorInfluenceIndex = this->mirrorInfluences[this->influenceIndex];
@@ -1768,7 +2156,7 @@ void SkinBrushContext::doTheAction() {
             for (const auto &theVert : this->verticesPainted) {
                 for (int j = 0; j < this->nbJoints; ++j) {
                     prevWeights[i * this->nbJoints + j] =
-                        this->fullUndoSkinWeightList[theVert * this->nbJoints + j];
+                        this->meshArrays->fullUndoSkinWeightList[theVert * this->nbJoints + j];
                 }
                 i++;
             }
@@ -1792,6 +2180,16 @@ void SkinBrushContext::doTheAction() {
     this->previousPaint.clear();
     this->previousMirrorPaint.clear();
 
+    if (!this->postSetting)
+        finalizeUndoCommand(theCommandIndex, editVertsIndices, prevWeights, undoLocks, redoLocks);
+    else
+        finalizeUndoCommand(theCommandIndex, editVertsIndices, this->skinWeightsForUndo, undoLocks,
+                            redoLocks);
+}
+
+void SkinBrushContext::finalizeUndoCommand(ModifierCommands theCommandIndex,
+                                           MIntArray &editVertsIndices, MDoubleArray &undoWeights,
+                                           MIntArray &undoLocks, MIntArray &redoLocks) {
     if (!this->firstPaintDone) {
         this->firstPaintDone = true;
         MUserEventMessage::postUserEvent("brSkinBrush_cleanCloseUndo");
@@ -1844,8 +2242,10 @@ void SkinBrushContext::doTheAction() {
     if (isNurbs) {
         cmd->setNurbs(nurbsDag);
         cmd->setnumCVInV(numCVsInV_);
+        cmd->setProxyVertexToCV(this->proxyVertexToCV);
     }
     cmd->setSkinCluster(skinObj);
+    if (this->mapMode) cmd->setMapPlug(this->mapPlug);
     cmd->setIsNurbs(isNurbs);
 
     cmd->setInfluenceIndices(influenceIndices);
@@ -1853,11 +2253,7 @@ void SkinBrushContext::doTheAction() {
     cmd->setInfluenceName(iname);
 
     cmd->setUndoVertices(editVertsIndices);
-    if (!this->postSetting) {
-        cmd->setWeights(prevWeights);
-    } else {
-        cmd->setWeights(this->skinWeightsForUndo);
-    }
+    cmd->setWeights(undoWeights);
     cmd->setNormalize(normalize);
     cmd->setContextPointer(this);
 
@@ -1872,6 +2268,99 @@ void SkinBrushContext::doTheAction() {
     MUserEventMessage::postUserEvent("brSkinBrush_afterPaint");
 }
 
+// ---------------------------------------------------------------------
+// flood
+// ---------------------------------------------------------------------
+void SkinBrushContext::floodInChunks(ModifierCommands theCommandIndex, double value) {
+    // chunks keep the edit arrays small and give points to report progress and cancel
+    MStatus status;
+    // a locked influence is not painted, as in applyCommand, there is no chunk to undo
+    if (!this->mapMode && !this->ignoreLockVal && theCommandIndex != ModifierCommands::Sharpen &&
+        this->influenceIndex >= 0 && this->influenceIndex < (int)this->lockJoints.length() &&
+        this->lockJoints[this->influenceIndex] == 1)
+        return;
+    int nbVertices = this->numVertices;
+    int nbChunks = (nbVertices + FLOOD_CHUNK_SIZE - 1) / FLOOD_CHUNK_SIZE;
+
+    bool showProgress = MGlobal::mayaState() == MGlobal::kInteractive &&
+                        nbChunks > 1 && MProgressWindow::reserve();
+    if (showProgress) {
+        MProgressWindow::setTitle("brSkinBrush");
+        MProgressWindow::setProgressStatus("Flood weights");
+        MProgressWindow::setProgressRange(0, nbChunks);
+        MProgressWindow::setProgress(0);
+        MProgressWindow::setInterruptable(true);
+        MProgressWindow::startProgress();
+    }
+
+    MIntArray undoVertices;
+    MDoubleArray undoWeights;
+    bool cancelled = false;
+    for (int chunk = 0; chunk < nbChunks; ++chunk) {
+        if (showProgress && MProgressWindow::isCancelled()) {
+            cancelled = true;
+            break;
+        }
+        int firstVertex = chunk * FLOOD_CHUNK_SIZE;
+        int lastVertex = std::min(firstVertex + FLOOD_CHUNK_SIZE, nbVertices);
+
+        std::unordered_map<int, float> chunkValues;
+        chunkValues.reserve(lastVertex - firstVertex);
+        for (int vtxIndex = firstVertex; vtxIndex < lastVertex; ++vtxIndex)
+            chunkValues.insert(std::make_pair(vtxIndex, (float)value));
+
+        this->skinWeightsForUndo.clear();
+        status = applyCommand(this->influenceIndex, chunkValues);
+        if (status == MStatus::kFailure) {
+            MGlobal::displayError(MString("Something went wrong. EXIT the brush and RESTART it"));
+            break;
+        }
+        // the undo of the completed chunks, vertices are in increasing order like the weights
+        MIntArray chunkVertices;
+        for (int vtxIndex = firstVertex; vtxIndex < lastVertex; ++vtxIndex)
+            chunkVertices.append(vtxIndex);
+        bool undoMismatch =
+            this->skinWeightsForUndo.length() != chunkVertices.length() * this->nbJoints;
+        if (!undoMismatch) {
+            for (int vtxIndex : chunkVertices) undoVertices.append(vtxIndex);
+            for (unsigned int i = 0; i < this->skinWeightsForUndo.length(); ++i)
+                undoWeights.append(this->skinWeightsForUndo[i]);
+        }
+
+        MColorArray multiEditColors, soloEditColors;
+        refreshColors(chunkVertices, multiEditColors, soloEditColors);
+        meshFn.setSomeColors(chunkVertices, multiEditColors, &this->fullColorSet);
+        meshFn.setSomeColors(chunkVertices, soloEditColors, &this->soloColorSet);
+
+        meshFn.setSomeColors(chunkVertices, multiEditColors, &this->fullColorSet2);
+        meshFn.setSomeColors(chunkVertices, soloEditColors, &this->soloColorSet2);
+
+        if (undoMismatch) {
+            // the next chunks stop here, the undo keeps the chunks before this one
+            MGlobal::displayError(MString("flood stopped, no undo for the vertices ") +
+                                  firstVertex + MString(" to ") + (lastVertex - 1));
+            break;
+        }
+        if (showProgress) MProgressWindow::advanceProgress(1);
+    }
+    if (showProgress) MProgressWindow::endProgress();
+    if (cancelled)
+        MGlobal::displayWarning(MString("flood cancelled, ") + undoVertices.length() +
+                                MString(" vertices done out of ") + nbVertices);
+
+    this->verticesPainted.clear();
+    this->skinValuesToSet.clear();
+    this->skinValuesMirrorToSet.clear();
+    this->previousPaint.clear();
+    this->previousMirrorPaint.clear();
+    if (undoVertices.length() == 0) {
+        maya2019RefreshColors();
+        return;
+    }
+    MIntArray undoLocks, redoLocks;
+    finalizeUndoCommand(theCommandIndex, undoVertices, undoWeights, undoLocks, redoLocks);
+}
+
 ModifierCommands SkinBrushContext::getCommandIndexModifiers() const {
     // 0 Add - 1 Remove - 2 AddPercent - 3 Absolute - 4 Smooth - 5 Sharpen - 6 LockVertices - 7
     // unlockVertices
@@ -1947,6 +2436,11 @@ MStatus SkinBrushContext::applyCommandMirror() {
     if ((theCommandIndex == ModifierCommands::LockVertices) || (theCommandIndex == ModifierCommands::UnlockVertices))
         return MStatus::kSuccess;
 
+    std::vector<int> pages;
+    bool withNeighbors = theCommandIndex == ModifierCommands::Smooth;
+    for (const auto &elem : mirroredJoinedArrayOrdered) addPageOfVertex(elem.first, pages, withNeighbors);
+    loadWeightPages(pages);
+
     MDoubleArray theWeights((int)this->nbJoints * mirroredJoinedArrayOrdered.size(), 0.0);
     int repeatLimit = 1;
     if (theCommandIndex == ModifierCommands::Smooth || theCommandIndex == ModifierCommands::Sharpen) {
@@ -1958,6 +2452,7 @@ MStatus SkinBrushContext::applyCommandMirror() {
     for (int repeat = 0; repeat < repeatLimit; ++repeat) {
         if (theCommandIndex == ModifierCommands::Smooth) {
             int indexCurrVert = 0;
+            SparseWeightRows weightRows;
             for (const auto &elem : mirroredJoinedArrayOrdered) {
                 int theVert = elem.first;
                 if (repeat == 0) objVertices.append(theVert);
@@ -1966,24 +2461,33 @@ MStatus SkinBrushContext::applyCommandMirror() {
                 float biggestValue = std::max(valueBase, valueMirror);
 
                 double theWeight = (double)biggestValue;
-                std::vector<int> vertsAround = getSurroundingVerticesPerVert(theVert);
-                status = setAverageWeight(vertsAround, theVert, indexCurrVert, this->nbJoints,
-                                          this->lockJoints, this->skinWeightList, theWeights,
-                                          this->smoothStrengthVal * theWeight);
+                std::vector<int> vertsAround = getSmoothNeighbors(theVert);
+                if (!setAverageWeightSparse(vertsAround.data(), (int)vertsAround.size(), theVert,
+                                            indexCurrVert, this->nbJoints, this->lockJoints,
+                                            this->meshArrays->skinWeightList, weightRows,
+                                            theWeights, this->smoothStrengthVal * theWeight,
+                                            getSmoothMaxInfluences())) {
+                    status = setAverageWeight(vertsAround, theVert, indexCurrVert, this->nbJoints,
+                                              this->lockJoints, this->meshArrays->skinWeightList, theWeights,
+                                              this->smoothStrengthVal * theWeight);
+                    pruneRowToMaxInfluences(theWeights, indexCurrVert * this->nbJoints,
+                                            this->nbJoints, this->lockJoints,
+                                            getSmoothMaxInfluences());
+                }
                 indexCurrVert++;
             }
         } else {
             if (this->ignoreLockVal) {
                 status = editArrayMirror(theCommandIndex, influence, influenceMirror,
                                          this->nbJoints, this->ignoreLockJoints,
-                                         this->skinWeightList, mirroredJoinedArrayOrdered,
+                                         this->meshArrays->skinWeightList, mirroredJoinedArrayOrdered,
                                          theWeights, this->doNormalize, multiplier, verbose);
             } else {
                 if (this->lockJoints[influence] == 1 && theCommandIndex != ModifierCommands::Sharpen) {
                     return status;  //  if locked and it's not sharpen --> do nothing
                 }
                 status = editArrayMirror(theCommandIndex, influence, influenceMirror,
-                                         this->nbJoints, this->lockJoints, this->skinWeightList,
+                                         this->nbJoints, this->lockJoints, this->meshArrays->skinWeightList,
                                          mirroredJoinedArrayOrdered, theWeights, this->doNormalize,
                                          multiplier, verbose);
             }
@@ -1998,18 +2502,16 @@ MStatus SkinBrushContext::applyCommandMirror() {
             if (repeat == 0) objVertices.append(theVert);
 
             for (int j = 0; j < this->nbJoints; ++j) {
-                int ind_swl = theVert * this->nbJoints + j;
-                if (ind_swl >= this->skinWeightList.length())
-                    this->skinWeightList.setLength(ind_swl + 1);
                 double val = 0.0;
                 int ind_tw = i * this->nbJoints + j;
                 if (ind_tw < theWeights.length())
                     val = theWeights[ind_tw];
-                this->skinWeightList[ind_swl] = val;
+                setSkinWeight(theVert, j, val);
             }
             i++;
         }
     }
+    flushInfluenceVertices();
 
     MFnSingleIndexedComponent compFn;
     MObject weightsObj = compFn.create(MFn::kMeshVertComponent);
@@ -2018,8 +2520,10 @@ MStatus SkinBrushContext::applyCommandMirror() {
     CHECK_MSTATUS_AND_RETURN_IT(status);
     this->skinWeightsForUndo.clear();
     if (!isNurbs) {
+        this->ignoreWeightsCallbacks = true;
         skinFn.setWeights(meshDag, weightsObj, influenceIndices, theWeights, normalize,
                           &this->skinWeightsForUndo);
+        this->ignoreWeightsCallbacks = false;
     } else {
         MFnDoubleIndexedComponent doubleFn;
         MObject weightsObjNurbs = doubleFn.create(MFn::kSurfaceCVComponent);
@@ -2035,16 +2539,21 @@ MStatus SkinBrushContext::applyCommandMirror() {
                                      MString("  |  ") + vVal);
             doubleFn.addElement(uVal, vVal);
         }
+        this->ignoreWeightsCallbacks = true;
         skinFn.setWeights(nurbsDag, weightsObjNurbs, influenceIndices, theWeights, normalize,
                           &this->skinWeightsForUndo);
-        transferPointNurbsToMesh(meshFn, nurbsFn);  // we transfer the points postions
+        this->ignoreWeightsCallbacks = false;
+        // we transfer the points postions of the edited CVs
+        transferPointNurbsToMesh(meshFn, nurbsFn, this->proxyVertexToCV, objVertices);
         meshFn.updateSurface();
     }
     refreshPointsNormals();
+    if (this->volumeVal) this->volumeHash.update(this->mayaRawPoints, objVertices);
     return status;
 }
 
 MStatus SkinBrushContext::applyCommand(int influence, std::unordered_map<int, float> &valuesToSet) {
+    if (this->mapMode) return applyCommandMap(valuesToSet);
     MStatus status;
     // we need to sort all of that one way or another ---------------- here it is ------
     std::map<int, double> valuesToSetOrdered(valuesToSet.begin(), valuesToSet.end());
@@ -2052,6 +2561,11 @@ MStatus SkinBrushContext::applyCommand(int influence, std::unordered_map<int, fl
     ModifierCommands theCommandIndex = getCommandIndexModifiers();
     double multiplier = 1.0;
 
+    std::vector<int> pages;
+    bool withNeighbors = theCommandIndex == ModifierCommands::Smooth;
+    for (const auto &elem : valuesToSetOrdered) addPageOfVertex(elem.first, pages, withNeighbors);
+    loadWeightPages(pages);
+
     if (verbose)
         MGlobal::displayInfo(MString("-> applyCommand | theCommandIndex is ") + static_cast<int>(theCommandIndex));
     if ((theCommandIndex != ModifierCommands::LockVertices) && (theCommandIndex != ModifierCommands::UnlockVertices)) {
@@ -2065,14 +2579,23 @@ MStatus SkinBrushContext::applyCommand(int influence, std::unordered_map<int, fl
         for (int repeat = 0; repeat < repeatLimit; ++repeat) {
             if (theCommandIndex == ModifierCommands::Smooth) {
                 int i = 0;
+                SparseWeightRows weightRows;
                 for (const auto &elem : valuesToSetOrdered) {
                     int theVert = elem.first;
                     double theWeight = elem.second;
-                    std::vector<int> vertsAround = getSurroundingVerticesPerVert(theVert);
-
-                    status = setAverageWeight(vertsAround, theVert, i, this->nbJoints,
-                                              this->lockJoints, this->skinWeightList, theWeights,
-                                              this->smoothStrengthVal * theWeight);
+                    std::vector<int> vertsAround = getSmoothNeighbors(theVert);
+
+                    if (!setAverageWeightSparse(vertsAround.data(), (int)vertsAround.size(),
+                                                theVert, i, this->nbJoints, this->lockJoints,
+                                                this->meshArrays->skinWeightList, weightRows,
+                                                theWeights, this->smoothStrengthVal * theWeight,
+                                                getSmoothMaxInfluences())) {
+                        status = setAverageWeight(vertsAround, theVert, i, this->nbJoints,
+                                                  this->lockJoints, this->meshArrays->skinWeightList,
+                                                  theWeights, this->smoothStrengthVal * theWeight);
+                        pruneRowToMaxInfluences(theWeights, i * this->nbJoints, this->nbJoints,
+                                                this->lockJoints, getSmoothMaxInfluences());
+                    }
                     i++;
                 }
             } else {
@@ -2083,13 +2606,13 @@ MStatus SkinBrushContext::applyCommand(int influence, std::unordered_map<int, fl
                 if (this->ignoreLockVal) {
                     status =
                         editArray(theCommandIndex, influence, this->nbJoints,
-                                  this->ignoreLockJoints, this->skinWeightList, valuesToSetOrdered,
+                                  this->ignoreLockJoints, this->meshArrays->skinWeightList, valuesToSetOrdered,
                                   theWeights, this->doNormalize, multiplier, verbose);
                 } else {
                     if (this->lockJoints[influence] == 1 && theCommandIndex != ModifierCommands::Sharpen)
                         return status;  //  if locked and it's not sharpen --> do nothing
                     status = editArray(theCommandIndex, influence, this->nbJoints, this->lockJoints,
-                                       this->skinWeightList, valuesToSetOrdered, theWeights,
+                                       this->meshArrays->skinWeightList, valuesToSetOrdered, theWeights,
                                        this->doNormalize, multiplier, verbose);
                 }
                 if (status == MStatus::kFailure) {
@@ -2107,19 +2630,17 @@ MStatus SkinBrushContext::applyCommand(int influence, std::unordered_map<int, fl
             for (const auto &elem : valuesToSetOrdered) {
                 int theVert = elem.first;
                 for (int j = 0; j < this->nbJoints; ++j) {
-                    int ind_swl = theVert * this->nbJoints + j;
-                    if (ind_swl >= this->skinWeightList.length())
-                        this->skinWeightList.setLength(ind_swl + 1);
                     double val = 0.0;
                     int ind_tw = i * this->nbJoints + j;
                     if (ind_tw < theWeights.length())
                         val = theWeights[ind_tw];
-                    this->skinWeightList[ind_swl] = val;
+                    setSkinWeight(theVert, j, val);
                 }
                 i++;
             }
         }
         if (verbose) MGlobal::displayInfo(MString("-> applyCommand | out of repeat loop  "));
+        flushInfluenceVertices();
         MIntArray objVertices;
         for (const auto &elem : valuesToSetOrdered) {
             int theVert = elem.first;
@@ -2137,8 +2658,10 @@ MStatus SkinBrushContext::applyCommand(int influence, std::unordered_map<int, fl
         this->skinWeightsForUndo.clear();
         if (verbose) MGlobal::displayInfo(MString(" applyCommand | before skinFn.setWeights"));
         if (!isNurbs) {
+            this->ignoreWeightsCallbacks = true;
             skinFn.setWeights(meshDag, weightsObj, influenceIndices, theWeights, normalize,
                               &this->skinWeightsForUndo);
+            this->ignoreWeightsCallbacks = false;
         } else {
             MFnDoubleIndexedComponent doubleFn;
             MObject weightsObjNurbs = doubleFn.create(MFn::kSurfaceCVComponent);
@@ -2155,19 +2678,76 @@ MStatus SkinBrushContext::applyCommand(int influence, std::unordered_map<int, fl
                                          MString("  |  ") + vVal);
                 doubleFn.addElement(uVal, vVal);
             }
+            this->ignoreWeightsCallbacks = true;
             skinFn.setWeights(nurbsDag, weightsObjNurbs, influenceIndices, theWeights, normalize,
                               &this->skinWeightsForUndo);
-            transferPointNurbsToMesh(meshFn, nurbsFn);  // we transfer the points postions
+            this->ignoreWeightsCallbacks = false;
+            // we transfer the points postions of the edited CVs
+            transferPointNurbsToMesh(meshFn, nurbsFn, this->proxyVertexToCV, objVertices);
         }
         if (verbose)
             MGlobal::displayInfo(MString(" applyCommand | before refreshPointsAndNormals"));
         // in do press common
         // update values ---------------
         refreshPointsNormals();
+        if (this->volumeVal) this->volumeHash.update(this->mayaRawPoints, objVertices);
         if (verbose) MGlobal::displayInfo(MString(" applyCommand | FINISH"));
     }
     return status;
 }
+
+MStatus SkinBrushContext::applyCommandMap(std::unordered_map<int, float> &valuesToSet) {
+    // applyCommand on one channel: no locks, no normalization, only the painted elements are set
+    MStatus status;
+    ModifierCommands theCommandIndex = getCommandIndexModifiers();
+    if ((theCommandIndex == ModifierCommands::LockVertices) ||
+        (theCommandIndex == ModifierCommands::UnlockVertices))
+        return status;
+
+    std::map<int, double> valuesToSetOrdered(valuesToSet.begin(), valuesToSet.end());
+    int nbValues = (int)valuesToSetOrdered.size();
+    MIntArray objVertices(nbValues, 0);
+    std::vector<double> brushValues(nbValues);
+    int i = 0;
+    for (const auto &elem : valuesToSetOrdered) {
+        objVertices[i] = elem.first;
+        brushValues[i] = elem.second;
+        i++;
+    }
+
+    MDoubleArray theValues(nbValues, 0.0);
+    int repeatLimit = 1;
+    if (theCommandIndex == ModifierCommands::Smooth || theCommandIndex == ModifierCommands::Sharpen)
+        repeatLimit = this->smoothRepeat;
+    for (int repeat = 0; repeat < repeatLimit; ++repeat) {
+        if (theCommandIndex == ModifierCommands::Smooth) {
+            // every vertex reads the previous pass and writes its own value
+#pragma omp parallel for if (nbValues > 256)
+            for (int k = 0; k < nbValues; ++k) {
+                int theVert = objVertices[k];
+                double currentValue = this->meshArrays->skinWeightList[theVert];
+                double average = getMapAverageValue(getSmoothNeighbors(theVert),
+                                                    this->meshArrays->skinWeightList, currentValue);
+                double theStrength = std::min(1.0, this->smoothStrengthVal * brushValues[k]);
+                theValues[k] = currentValue + theStrength * (average - currentValue);
+            }
+        } else {
+            editMapArray(theCommandIndex, this->meshArrays->skinWeightList, valuesToSetOrdered, theValues);
+        }
+        for (int k = 0; k < nbValues; ++k) setSkinWeight(objVertices[k], 0, theValues[k]);
+    }
+    flushInfluenceVertices();
+
+    this->skinWeightsForUndo.clear();
+    this->ignoreWeightsCallbacks = true;
+    status = setMapValues(this->mapPlug, objVertices, theValues, &this->skinWeightsForUndo);
+    this->ignoreWeightsCallbacks = false;
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    refreshPointsNormals();
+    if (this->volumeVal) this->volumeHash.update(this->mayaRawPoints, objVertices);
+    return status;
+}
 // ---------------------------------------------------------------------
 // COLORS
 // ---------------------------------------------------------------------
@@ -2181,14 +2761,14 @@ MStatus SkinBrushContext::editSoloColorSet(bool doBlack) {
     for (unsigned int theVert = 0; theVert < this->numVertices; ++theVert) {
         double val = 0.0;
         int ind_swl = theVert * this->nbJoints + this->influenceIndex;
-        if (ind_swl < this->skinWeightList.length())
-            val = this->skinWeightList[ind_swl];
-        bool isVtxLocked = this->lockVertices[theVert] == 1;
-        bool update = doBlack || !(this->soloColorsValues[theVert] == 0 && val == 0);
+        if (ind_swl < this->meshArrays->skinWeightList.length())
+            val = this->meshArrays->skinWeightList[ind_swl];
+        bool isVtxLocked = this->meshArrays->lockVertices[theVert] == 1;
+        bool update = doBlack || !(this->meshArrays->soloColorsValues[theVert] == 0 && val == 0);
         if (update) {  // dont update the black
             MColor soloColor = getASoloColor(val);
-            this->soloCurrentColors[theVert] = soloColor;
-            this->soloColorsValues[theVert] = val;
+            this->meshArrays->soloCurrentColors[theVert] = soloColor;
+            this->meshArrays->soloColorsValues[theVert] = val;
             if (isVtxLocked)
                 colToSet.append(this->lockVertColor);
             else
@@ -2216,24 +2796,24 @@ MStatus SkinBrushContext::refreshColors(MIntArray &editVertsIndices, MColorArray
     for (unsigned int i = 0; i < editVertsIndices.length(); ++i) {
         int theVert = editVertsIndices[i];
         MColor multiColor, soloColor;
-        bool isVtxLocked = this->lockVertices[theVert] == 1;
+        bool isVtxLocked = this->meshArrays->lockVertices[theVert] == 1;
 
         for (int j = 0; j < this->nbJoints; ++j) {  // for each joint
             int ind_swl = theVert * this->nbJoints + j;
-            if (ind_swl < this->skinWeightList.length()) {
-                double val = this->skinWeightList[ind_swl];
+            if (ind_swl < this->meshArrays->skinWeightList.length()) {
+                double val = this->meshArrays->skinWeightList[ind_swl];
                 if (this->lockJoints[j] == 1)
                     multiColor += lockJntColor * val;
                 else
                     multiColor += jointsColors[j] * val;
                 if (j == this->influenceIndex) {
-                    this->soloColorsValues[theVert] = val;
+                    this->meshArrays->soloColorsValues[theVert] = val;
                     soloColor = getASoloColor(val);
                 }
             }
         }
-        this->multiCurrentColors[theVert] = multiColor;
-        this->soloCurrentColors[theVert] = soloColor;
+        this->meshArrays->multiCurrentColors[theVert] = multiColor;
+        this->meshArrays->soloCurrentColors[theVert] = soloColor;
         if (isVtxLocked) {
             multiEditColors[i] = this->lockVertColor;
             soloEditColors[i] = this->lockVertColor;
@@ -2280,6 +2860,8 @@ MStatus SkinBrushContext::getMesh() {
     this->meshDag = MDagPath();
     this->nurbsDag = MDagPath();
     this->skinObj = MObject();
+    this->mapPlug = MPlug();
+    this->mapMode = this->mapAttributeVal.length() > 0;
     // -----------------------------------------------------------------
     // mesh
     // -----------------------------------------------------------------
@@ -2305,9 +2887,16 @@ MStatus SkinBrushContext::getMesh() {
         // int vertInd;
         if (VIsPeriodic_) numCVsInV_ -= VDeg_;
         if (UIsPeriodic_) numCVsInU_ -= UDeg_;
+        getNurbsProxyVertexToCV(nurbsFn, this->proxyVertexToCV);
     } else {
         isNurbs = false;
+        this->proxyVertexToCV.clear();
     }
+    return getMeshData();
+}
+
+MStatus SkinBrushContext::getMeshData() {
+    MStatus status = MStatus::kSuccess;
     if (verbose) {
         MGlobal::displayInfo(MString(" is nurbs : ") + isNurbs);
         MGlobal::displayInfo(MString(" painting : ") + meshDag.fullPathName());
@@ -2349,7 +2938,12 @@ MStatus SkinBrushContext::getMesh() {
     this->inclusiveMatrixInverse[3][2] = (float)MIMI[3][2];
     this->inclusiveMatrixInverse[3][3] = (float)MIMI[3][3];
 
+    // the previous topology task writes the same arrays
+    waitForTopology();
+    this->volumeHashDirty = true;
+
     // Set the mesh.
+    auto stageStart = std::chrono::steady_clock::now();
     meshFn.setObject(this->meshDag);
     numVertices = (unsigned)meshFn.numVertices();
     numFaces = (unsigned)meshFn.numPolygons();
@@ -2358,15 +2952,36 @@ MStatus SkinBrushContext::getMesh() {
     this->accelParams =
         meshFn.uniformGridParams(33, 33, 33);  // I dont know why, but '33' seems to work well
 
-    // getConnected vertices Guillaume function
-    getConnectedVertices();
-    getConnectedVerticesSecond();
-    getConnectedVerticesThird();
-    getFromMeshNormals();
-    getConnectedVerticesFlatten();
-
+    // the maya arrays are read here, the topology is built from them on a worker
+    MIntArray triangleCounts, triangleVertices, normalCounts, normals;
+    meshFn.getVertices(this->meshArrays->VertexCountPerPolygon, this->meshArrays->fullVertexList);
+    this->fullVertexListLength = this->meshArrays->fullVertexList.length();
+    meshFn.getTriangles(triangleCounts, triangleVertices);
+    meshFn.getNormalIds(normalCounts, normals);
     this->mayaRawPoints = meshFn.getRawPoints(&status);
-    this->lockVertices = MIntArray(this->numVertices, 0);
+    this->rawNormals = meshFn.getRawNormals(&status);
+    this->setupMeshArraysMs = msSince(stageStart);
+
+    this->hitTopologyReady = false;
+    this->topologyTask = std::async(std::launch::async, &SkinBrushContext::buildTopology, this,
+                                    triangleCounts, triangleVertices, normals);
+
+    // meanwhile the steps that need the maya api
+    stageStart = std::chrono::steady_clock::now();
+    getMeshEdges();
+    this->setupEdgesMs = msSince(stageStart);
+
+    stageStart = std::chrono::steady_clock::now();
+    this->meshArrays->lockVertices = MIntArray(this->numVertices, 0);
+
+    if (this->mapMode) {
+        status = getMapChannel();
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        allVtxCompObj = allVertexComponents();
+        getTheOrigMeshForMirror();
+        this->setupSkinClusterMs = msSince(stageStart);
+        return status;
+    }
 
     // -----------------------------------------------------------------
     // skin cluster
@@ -2395,6 +3010,7 @@ MStatus SkinBrushContext::getMesh() {
     if (normalizeValue > 0) normalize = true;
 
     getTheOrigMeshForMirror();
+    this->setupSkinClusterMs = msSince(stageStart);
     return status;
 }
 
@@ -2406,6 +3022,12 @@ MStatus SkinBrushContext::getTheOrigMeshForMirror() {
     MObject origObj;
     if (this->isNurbs) {
         findNurbsTesselateOrig(this->meshDag, origObj, verbose);
+    } else if (this->mapMode) {
+        // the input of the deformer for this shape, the shape itself for a map on the shape
+        MFnGeometryFilter deformerFn(skinObj, &status);
+        if (status == MS::kSuccess)
+            origObj = deformerFn.inputShapeAtIndex(deformerFn.indexForOutputShape(meshDag.node()));
+        if (origObj.isNull()) origObj = meshDag.node();
     } else {
         findOrigMesh(skinObj, origObj, verbose);
     }
@@ -2418,12 +3040,14 @@ MStatus SkinBrushContext::getTheOrigMeshForMirror() {
 
     MObject origMeshNode = origMeshDag.node();
 
-    status = intersectorOrigShape.create(origMeshNode);  // , matrix);
+    this->intersectorOrigShape.reset(new MMeshIntersector());
+    status = intersectorOrigShape->create(origMeshNode);  // , matrix);
 
     // Create the intersector for the closest point operation for
     // keeping the shells together.
     MObject meshObj = meshDag.node();
-    status = intersector.create(meshObj, meshDag.inclusiveMatrix());
+    this->intersector.reset(new MMeshIntersector());
+    status = intersector->create(meshObj, meshDag.inclusiveMatrix());
     CHECK_MSTATUS_AND_RETURN_IT(status);  // only returns if bad
     return status;
 }
@@ -2431,197 +3055,102 @@ MStatus SkinBrushContext::getTheOrigMeshForMirror() {
 store vertices connections
 */
 
-void SkinBrushContext::getConnectedVertices() {
-    MStatus status;
-
-    // MIntArray vertexCount, vertexList;
-    status = meshFn.getVertices(VertexCountPerPolygon, fullVertexList);
-    this->fullVertexListLength = fullVertexList.length();
-
-    MIntArray triangleCounts, triangleVertices;  // get the triangles to draw the mesh
-    status = meshFn.getTriangles(triangleCounts, triangleVertices);
-
-    // First set array sizes ----------------------------------------------
-    this->perFaceVertices.clear();
-    this->perVertexFaces.clear();
-    this->perFaceTriangleVertices.clear();
-
-    this->perFaceVertices.resize(this->numFaces);
-    this->perVertexFaces.resize(this->numVertices);
-    this->perFaceTriangleVertices.resize(this->numFaces);
+void SkinBrushContext::buildTopology(MIntArray triangleCounts, MIntArray triangleVertices,
+                                     MIntArray normals) {
+    // runs on a worker thread, no maya api call in there
+    auto stageStart = std::chrono::steady_clock::now();
+    this->topology.buildFaces(this->numVertices, this->meshArrays->VertexCountPerPolygon, this->meshArrays->fullVertexList,
+                              triangleCounts, triangleVertices);
+    getFromMeshNormals(normals);
+    this->setupHitTopologyMs = msSince(stageStart);
+    this->hitTopologyReady = true;
+
+    // the vertices around, for the smooth and the pages neighbors
+    stageStart = std::chrono::steady_clock::now();
+    this->topology.buildVertexVertices();
+    this->setupSmoothTopologyMs = msSince(stageStart);
+}
 
-    // end set array sizes ----------------------------------------------
-    // First run --------------------------------------------------------
-    for (unsigned int faceId = 0, iter = 0, triIter = 0; faceId < VertexCountPerPolygon.length();
-         ++faceId) {
-        perFaceVertices[faceId].clear();
-        for (int i = 0; i < VertexCountPerPolygon[faceId]; ++i, ++iter) {
-            int indVertex = fullVertexList[iter];
-            perFaceVertices[faceId].append(indVertex);
-            perVertexFaces[indVertex].append(faceId);
+void SkinBrushContext::waitForTopology(bool hitOnly) {
+    if (!this->topologyTask.valid()) return;
+    auto start = std::chrono::steady_clock::now();
+    if (hitOnly) {
+        while (!this->hitTopologyReady && this->topologyTask.wait_for(std::chrono::milliseconds(
+                                              1)) != std::future_status::ready) {
         }
-        perFaceTriangleVertices[faceId].resize(triangleCounts[faceId]);
-        for (int triId = 0; triId < triangleCounts[faceId]; ++triId) {
-            perFaceTriangleVertices[faceId][triId].setLength(3);
-            perFaceTriangleVertices[faceId][triId][0] = triangleVertices[triIter++];
-            perFaceTriangleVertices[faceId][triId][1] = triangleVertices[triIter++];
-            perFaceTriangleVertices[faceId][triId][2] = triangleVertices[triIter++];
+        if (this->topologyTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            this->setupTopologyWaitMs += msSince(start);
+            return;
         }
     }
+    this->topologyTask.get();
+    this->hitTopologyReady = true;
+    this->setupTopologyWaitMs += msSince(start);
+    if (this->nbVerticesWithoutNormal > 0)
+        MGlobal::displayInfo(MString("cant find the normal of ") + this->nbVerticesWithoutNormal +
+                             MString(" vertices"));
+}
+
+void SkinBrushContext::getMeshEdges() {
     // get the edgesIndices to draw the wireframe --------------------
     MItMeshEdge edgeIter(meshDag);
-
-    this->perEdgeVertices.clear();
-    this->perVertexEdges.clear();
-    this->perEdgeVertices.resize(edgeIter.count());
-    this->perVertexEdges.resize(this->numVertices);
-
-    unsigned int i = 0;
+    std::vector<int> pairs;
+    pairs.reserve(2 * edgeIter.count());
     for (; !edgeIter.isDone(); edgeIter.next()) {
-        int pt0Index = edgeIter.index(0);
-        int pt1Index = edgeIter.index(1);
-        this->perVertexEdges[pt0Index].append(i);
-        this->perVertexEdges[pt1Index].append(i);
-        this->perEdgeVertices[i++] = std::make_pair(pt0Index, pt1Index);
-    }
-}
-void SkinBrushContext::getConnectedVerticesSecond() {
-    // Second run --------------------------------------------------------
-    this->perFaceVerticesSet.clear();
-    perFaceVerticesSet.resize(this->numFaces);
-    for (int faceTmp = 0; faceTmp < numFaces; ++faceTmp) {
-        std::vector<int> tmpSet;
-        MIntArray surroundingVertices = perFaceVertices[faceTmp];
-
-        tmpSet.resize(surroundingVertices.length());
-        surroundingVertices.get(&tmpSet[0]);
-
-        std::sort(tmpSet.begin(), tmpSet.end());
-        perFaceVerticesSet[faceTmp] = tmpSet;
-    }
-}
-void SkinBrushContext::getConnectedVerticesThird() {
-    // fill the std_array connectedSetVertices ------------------------
-    this->perVertexVerticesSet.clear();
-    this->perVertexVerticesSet.resize(this->numVertices);
-
-#pragma omp parallel for
-    for (int vtxTmp = 0; vtxTmp < this->numVertices; ++vtxTmp) {
-        std::vector<int> connVetsSet2;
-        MIntArray connectFaces = perVertexFaces[vtxTmp];
-        for (int fct = 0; fct < connectFaces.length(); ++fct) {
-            auto surroundingVertices = perFaceVerticesSet[connectFaces[fct]];
-            std::vector<int> connVetsSetTMP;
-
-            std::set_union(connVetsSet2.begin(), connVetsSet2.end(), surroundingVertices.begin(),
-                           surroundingVertices.end(), std::back_inserter(connVetsSetTMP));
-            connVetsSet2 = connVetsSetTMP;
-        }
-        auto it = std::find(connVetsSet2.begin(), connVetsSet2.end(), vtxTmp);
-        if (it != std::end(connVetsSet2)) {
-            connVetsSet2.erase(it);
-            this->perVertexVerticesSet[vtxTmp] = connVetsSet2;
-        }
+        pairs.push_back(edgeIter.index(0));
+        pairs.push_back(edgeIter.index(1));
     }
+    this->topology.buildEdges(this->numVertices, pairs);
 }
 
 void SkinBrushContext::getConnectedVerticesTyler() {
     std::vector<std::unordered_set<int>> faceNeighbors, edgeNeighbors;
     std::vector<int> fCounts, fIndices, eCounts, eIndices;
 
-    getRawNeighbors(this->VertexCountPerPolygon, this->fullVertexList, this->numVertices,
+    getRawNeighbors(this->meshArrays->VertexCountPerPolygon, this->meshArrays->fullVertexList, this->numVertices,
                     faceNeighbors, edgeNeighbors);
     convertToCountIndex(faceNeighbors, fCounts, fIndices);
     convertToCountIndex(edgeNeighbors, eCounts, eIndices);
 }
 
-void SkinBrushContext::getFromMeshNormals() {
-    this->verticesNormals.clear();
-    this->verticesNormals.setLength(this->numVertices);
-    // fill the normals ----------------------------------------------------
-    this->normalsIds.clear();
-    this->normalsIds.resize(this->numFaces);
-    MIntArray normalCounts, normals;
-    this->meshFn.getNormalIds(normalCounts, normals);
-
-    int startIndex = 0;
-#pragma omp parallel for
-    for (int faceTmp = 0; faceTmp < normalCounts.length(); ++faceTmp) {
-        int nbNormals = normalCounts[faceTmp];
-        std::vector<int> tmpNormalsIds(nbNormals, 0);
-        for (unsigned int k = 0; k < nbNormals; ++k) {
-            int normalId = normals[k + startIndex];
-            tmpNormalsIds[k] = normalId;
-        }
-        this->normalsIds[faceTmp] = tmpNormalsIds;
-        startIndex += nbNormals;
-    }
-    MStatus stat;
-    this->rawNormals = this->meshFn.getRawNormals(&stat);
+void SkinBrushContext::getFromMeshNormals(const MIntArray &normals) {
+    this->meshArrays->verticesNormals.clear();
+    this->meshArrays->verticesNormals.setLength(this->numVertices);
 
-    // get vertexNormalIndex --------------------------------------------------
-    this->verticesNormalsIndices.clear();
-    this->verticesNormalsIndices.setLength(numVertices);
-#pragma omp parallel for
+    // get vertexNormalIndex, the normal ids are per face vertex like the topology faces
+    this->meshArrays->verticesNormalsIndices.clear();
+    this->meshArrays->verticesNormalsIndices.setLength(numVertices);
+    const MeshTopology &topo = this->topology;
+    int nbWithoutNormal = 0;
+#pragma omp parallel for reduction(+ : nbWithoutNormal)
     for (int vertexInd = 0; vertexInd < this->numVertices; vertexInd++) {
-        auto vertToFace = this->perVertexFaces[vertexInd];
-        if (vertToFace.length() > 0) {
-            int indFace = vertToFace[0];
-            MIntArray surroundingVertices = this->perFaceVertices[indFace];
-            int indNormal = -1;
-            for (unsigned int j = 0; j < surroundingVertices.length(); ++j) {
-                if (surroundingVertices[j] == vertexInd) {
-                    indNormal = this->normalsIds[indFace][0];
-                }
-            }
-            if (indNormal == -1) {
-                MGlobal::displayInfo(
-                    MString("cant find vertex [") + vertexInd +
-                    MString("] in face [") + indFace + MString("] ;")
-                );
+        if (topo.vertexFaceStarts[vertexInd] == topo.vertexFaceStarts[vertexInd + 1]) continue;
+        int indFace = topo.vertexFaces[topo.vertexFaceStarts[vertexInd]];
+        int indNormal = -1;
+        for (int j = topo.faceStarts[indFace]; j < topo.faceStarts[indFace + 1]; ++j) {
+            if (topo.faceVertices[j] == vertexInd && j < (int)normals.length()) {
+                indNormal = normals[j];
+                break;
             }
-            this->verticesNormalsIndices.set(indNormal, vertexInd);
-        }
-    }
-}
-void SkinBrushContext::getConnectedVerticesFlatten() {
-    perVertexVerticesSetFLAT.clear();
-    perVertexVerticesSetINDEX.clear();
-    int sum = 0;
-    for (auto surroundingVtices : this->perVertexVerticesSet) {
-        perVertexVerticesSetINDEX.push_back(sum);
-        for (int vtx : surroundingVtices) {
-            perVertexVerticesSetFLAT.push_back(vtx);
-            sum++;
-        }
-    }
-    perVertexVerticesSetINDEX.push_back(sum);  // one extra for easy access
-    //------------------------------------------------------------------------
-    perFaceVerticesSetFLAT.clear();
-    perFaceVerticesSetINDEX.clear();
-    sum = 0;
-    for (auto surroundingVtices : this->perFaceVerticesSet) {
-        perFaceVerticesSetINDEX.push_back(sum);
-        for (int vtx : surroundingVtices) {
-            perFaceVerticesSetFLAT.push_back(vtx);
-            sum++;
         }
+        // reported from the main thread, see waitForTopology
+        if (indNormal == -1) nbWithoutNormal++;
+        this->meshArrays->verticesNormalsIndices.set(indNormal, vertexInd);
     }
-    perFaceVerticesSetINDEX.push_back(sum);  // one extra for easy access
+    this->nbVerticesWithoutNormal = nbWithoutNormal;
 }
+
 std::vector<int> SkinBrushContext::getSurroundingVerticesPerVert(int vertexIndex) {
-    auto first = perVertexVerticesSetFLAT.begin() + perVertexVerticesSetINDEX[vertexIndex];
-    auto last = perVertexVerticesSetFLAT.begin() + perVertexVerticesSetINDEX[vertexIndex + (int)1];
-    std::vector<int> newVec(first, last);
-    return newVec;
-};
-
-std::vector<int> SkinBrushContext::getSurroundingVerticesPerFace(int vertexIndex) {
-    auto first = perFaceVerticesSetFLAT.begin() + perFaceVerticesSetINDEX[vertexIndex];
-    auto last = perFaceVerticesSetFLAT.begin() + perFaceVerticesSetINDEX[vertexIndex + (int)1];
-    std::vector<int> newVec(first, last);
-    return newVec;
-};
+    auto first = topology.vertexVertices.begin() + topology.vertexVertexStarts[vertexIndex];
+    auto last = topology.vertexVertices.begin() + topology.vertexVertexStarts[vertexIndex + 1];
+    return std::vector<int>(first, last);
+}
+
+std::vector<int> SkinBrushContext::getSurroundingVerticesPerFace(int faceIndex) {
+    auto first = topology.faceVertices.begin() + topology.faceStarts[faceIndex];
+    auto last = topology.faceVertices.begin() + topology.faceStarts[faceIndex + 1];
+    return std::vector<int>(first, last);
+}
 
 //
 // Description:
@@ -2682,6 +3211,348 @@ MStatus SkinBrushContext::getSelection(MDagPath &dagPath) {
     return status;
 }
 
+// ---------------------------------------------------------------------
+// several skinned meshes in one session
+// the mesh under the brush lives in the context members, the other ones are parked in
+// paintMeshes and swapped in when the cursor goes over them
+// ---------------------------------------------------------------------
+void SkinBrushContext::collectPaintMeshes() {
+    MStatus status;
+    clearPaintMeshes();
+    if (isNurbs || skinObj.isNull() || this->mapMode) return;
+
+    std::unique_ptr<PaintMeshState> activeState(new PaintMeshState());
+    activeState->shapePath = this->meshDag;
+    activeState->skinCluster = this->skinObj;
+    activeState->loaded = true;
+    this->paintMeshes.push_back(std::move(activeState));
+    this->activePaintMesh = 0;
+
+    MSelectionList sel;
+    MGlobal::getActiveSelectionList(sel);
+    for (unsigned int i = 0; i < sel.length(); ++i) {
+        MDagPath dagPath;
+        if (sel.getDagPath(i, dagPath) != MS::kSuccess) continue;
+        if (dagPath.extendToShape() != MS::kSuccess) {
+            unsigned int numShapes;
+            dagPath.numberOfShapesDirectlyBelow(numShapes);
+            for (unsigned int j = 0; j < numShapes; j++) {
+                status = dagPath.extendToShapeDirectlyBelow(j);
+                if (status != MStatus::kSuccess) continue;
+                MFnDagNode shapeDag(dagPath);
+                if (!shapeDag.isIntermediateObject()) break;
+                dagPath.pop();
+            }
+        }
+        if (dagPath.apiType() != MFn::kMesh || dagPath == this->meshDag) continue;
+
+        bool alreadyIn = false;
+        for (const auto &state : this->paintMeshes) alreadyIn |= (state->shapePath == dagPath);
+        if (alreadyIn) continue;
+
+        MObject skinClusterObj;
+        if (getSkinCluster(dagPath, skinClusterObj) != MS::kSuccess) continue;
+
+        std::unique_ptr<PaintMeshState> state(new PaintMeshState());
+        state->shapePath = dagPath;
+        state->skinCluster = skinClusterObj;
+        MFnMesh parkedMeshFn(dagPath);
+        state->hitAccelParams = parkedMeshFn.uniformGridParams(33, 33, 33);
+        this->paintMeshes.push_back(std::move(state));
+    }
+    if (verbose)
+        MGlobal::displayInfo(MString(" paint meshes : ") + (int)this->paintMeshes.size());
+    if (this->paintMeshes.size() < 2) this->paintMeshes.clear();
+}
+
+void SkinBrushContext::clearPaintMeshes() {
+    for (auto &state : this->paintMeshes) {
+        if (state->weightsCallbackIds.length() > 0)
+            MMessage::removeCallbacks(state->weightsCallbackIds);
+    }
+    this->paintMeshes.clear();
+    this->activePaintMesh = 0;
+    this->lastHitPaintMesh = -1;
+}
+
+MStringArray SkinBrushContext::getPaintMeshNames() {
+    MStringArray names;
+    if (this->paintMeshes.empty()) {
+        if (this->meshDag.isValid()) names.append(this->meshDag.fullPathName());
+        return names;
+    }
+    for (const auto &state : this->paintMeshes) {
+        if (state->shapePath.isValid()) names.append(state->shapePath.fullPathName());
+    }
+    return names;
+}
+
+// slab test of the ray against a world box, entryDistance is where the ray goes in
+static bool rayHitsBox(const MPoint &origin, const MVector &direction, const MBoundingBox &box,
+                       double &entryDistance) {
+    double tMin = 0.0, tMax = std::numeric_limits<double>::max();
+    MPoint boxMin = box.min(), boxMax = box.max();
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::abs(direction[axis]) < 1e-12) {
+            if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis]) return false;
+            continue;
+        }
+        double t1 = (boxMin[axis] - origin[axis]) / direction[axis];
+        double t2 = (boxMax[axis] - origin[axis]) / direction[axis];
+        if (t1 > t2) std::swap(t1, t2);
+        tMin = std::max(tMin, t1);
+        tMax = std::min(tMax, t2);
+        if (tMin > tMax) return false;
+    }
+    entryDistance = tMin;
+    return true;
+}
+
+int SkinBrushContext::getCloserPaintMesh(short screenPixelX, short screenPixelY, bool activeHit) {
+    // returns the parked mesh hit in front of the active one, -1 if none
+    if (this->paintMeshes.size() < 2) return -1;
+
+    MPoint rayPoint;
+    MVector rayVector;
+    view.viewToWorld(screenPixelX, screenPixelY, rayPoint, rayVector);
+
+    int closestMesh = -1;
+    float closestDistance = activeHit ? this->pressDistance : std::numeric_limits<float>::max();
+    int nbMeshes = (int)this->paintMeshes.size();
+    // the mesh hit last is tested first, its hit then skips the meshes boxed behind it
+    int firstMesh = this->lastHitPaintMesh;
+    if (firstMesh < 0 || firstMesh >= nbMeshes) firstMesh = 0;
+    for (int k = 0; k < nbMeshes; ++k) {
+        int i = (k == 0) ? firstMesh : ((k <= firstMesh) ? k - 1 : k);
+        if (i == this->activePaintMesh) continue;
+        PaintMeshState &state = *this->paintMeshes[i];
+        if (!state.shapePath.isValid()) continue;
+
+        // most meshes are out of the ray or behind the closest hit, skip them on the world box
+        MFnDagNode shapeDagFn(state.shapePath);
+        MBoundingBox box = shapeDagFn.boundingBox();
+        box.transformUsing(state.shapePath.inclusiveMatrix());
+        double entryDistance;
+        if (!rayHitsBox(rayPoint, rayVector, box, entryDistance)) continue;
+        if (entryDistance >= closestDistance) continue;
+
+        MFnMesh parkedMeshFn(state.shapePath);
+        MMeshIsectAccelParams *params =
+            state.loaded ? &state.accelParams : &state.hitAccelParams;
+        MFloatPoint hitPoint;
+        float hitDistance;
+        int faceHit;
+        bool foundIntersect = parkedMeshFn.closestIntersection(
+            rayPoint, rayVector, nullptr, nullptr, false, MSpace::kWorld, 9999, false, params,
+            hitPoint, &hitDistance, &faceHit, nullptr, nullptr, nullptr, 0.0001f);
+        if (foundIntersect && hitDistance < closestDistance) {
+            closestDistance = hitDistance;
+            closestMesh = i;
+        }
+    }
+    if (closestMesh != -1) this->lastHitPaintMesh = closestMesh;
+    return closestMesh;
+}
+
+// the Maya arrays have no swap, only the per influence ones are copied here
+template <typename T>
+static void swapMayaArrays(T &first, T &second) {
+    T tmp(first);
+    first = second;
+    second = tmp;
+}
+
+void SkinBrushContext::swapPaintMeshState(PaintMeshState &state) {
+    waitForTopology();
+    flushInfluenceVertices();
+    this->volumeHashDirty = true;
+    std::swap(this->origMeshDag, state.origMeshDag);
+    std::swap(this->inclusiveMatrix, state.inclusiveMatrix);
+    std::swap(this->inclusiveMatrixInverse, state.inclusiveMatrixInverse);
+    std::swap(this->numVertices, state.numVertices);
+    std::swap(this->numFaces, state.numFaces);
+    std::swap(this->numEdges, state.numEdges);
+    std::swap(this->accelParams, state.accelParams);
+    std::swap(this->accelParamsOrigMesh, state.accelParamsOrigMesh);
+    std::swap(this->intersectorOrigShape, state.intersectorOrigShape);
+    std::swap(this->intersector, state.intersector);
+    std::swap(this->allVtxCompObj, state.allVtxCompObj);
+
+    swapMayaArrays(this->influenceIndices, state.influenceIndices);
+    swapMayaArrays(this->inflDagPaths, state.inflDagPaths);
+    swapMayaArrays(this->inflNames, state.inflNames);
+    swapMayaArrays(this->inflNamePixelSize, state.inflNamePixelSize);
+    std::swap(this->maintainMaxInfluences, state.maintainMaxInfluences);
+    std::swap(this->maxInfluences, state.maxInfluences);
+    std::swap(this->normalize, state.normalize);
+    std::swap(this->nbJoints, state.nbJoints);
+    std::swap(this->nbJointsBig, state.nbJointsBig);
+    swapMayaArrays(this->deformersIndices, state.deformersIndices);
+    swapMayaArrays(this->indicesForInfluenceObjects, state.indicesForInfluenceObjects);
+    this->skin_weights_.swap(state.skin_weights_);
+    this->influenceVertices.swap(state.influenceVertices);
+    // the per vertex arrays, a pointer swap
+    this->meshArrays.swap(state.meshArrays);
+
+    this->vertexWeightPage.swap(state.vertexWeightPage);
+    this->weightPagesVertices.swap(state.weightPagesVertices);
+    this->weightPageLoaded.swap(state.weightPageLoaded);
+    std::swap(this->nbWeightPagesLoaded, state.nbWeightPagesLoaded);
+    std::swap(this->allWeightPagesLoaded, state.allWeightPagesLoaded);
+
+    swapMayaArrays(this->mirrorInfluences, state.mirrorInfluences);
+    swapMayaArrays(this->lockJoints, state.lockJoints);
+    swapMayaArrays(this->ignoreLockJoints, state.ignoreLockJoints);
+    swapMayaArrays(this->jointsColors, state.jointsColors);
+
+    this->topology.swap(state.topology);
+    std::swap(this->fullVertexListLength, state.fullVertexListLength);
+}
+
+void SkinBrushContext::addParkedWeightsCallbacks(PaintMeshState &state) {
+    MStatus status;
+    state.weightListAttr = this->weightListAttr;
+    state.weightsAttr = this->weightsAttr;
+    state.lockWeightsAttr = this->lockWeightsAttr;
+    MCallbackId callbackId = MNodeMessage::addAttributeChangedCallback(
+        state.skinCluster, SkinBrushContext::parkedWeightsChangedCallback, &state, &status);
+    if (status == MS::kSuccess) state.weightsCallbackIds.append(callbackId);
+    addInfluenceLocksCallbacks(state.skinCluster, SkinBrushContext::parkedWeightsChangedCallback,
+                               &state, state.weightsCallbackIds);
+
+    // the locked vertices are stored on the deformed shape
+    MFnSkinCluster skinFn(state.skinCluster);
+    MObjectArray objectsDeformed;
+    skinFn.getOutputGeometry(objectsDeformed);
+    if (objectsDeformed.length() == 0) return;
+    MFnDependencyNode deformedDep(objectsDeformed[0]);
+    if (!deformedDep.hasAttribute("lockedVertices")) return;
+    state.lockedVerticesAttr = deformedDep.attribute("lockedVertices");
+    callbackId = MNodeMessage::addAttributeChangedCallback(
+        objectsDeformed[0], SkinBrushContext::parkedWeightsChangedCallback, &state, &status);
+    if (status == MS::kSuccess) state.weightsCallbackIds.append(callbackId);
+}
+
+void SkinBrushContext::parkedWeightsChangedCallback(MNodeMessage::AttributeMessage msg,
+                                                    MPlug &plug, MPlug &, void *clientData) {
+    if (!(msg & (MNodeMessage::kAttributeSet | MNodeMessage::kAttributeArrayAdded |
+                 MNodeMessage::kAttributeArrayRemoved)))
+        return;
+    // only collected, the mesh is refreshed when it is active again
+    PaintMeshState *state = static_cast<PaintMeshState *>(clientData);
+    storeDirtyPlug(plug, state->skinCluster, state->weightListAttr, state->weightsAttr,
+                   state->lockWeightsAttr, state->lockedVerticesAttr, state->dirtyVertices,
+                   state->dirtyLockInfluences, state->dirtyVerticesLocks);
+}
+
+void SkinBrushContext::resumePaintMesh(PaintMeshState &state) {
+    MStatus status;
+    if (state.weightsCallbackIds.length() > 0) MMessage::removeCallbacks(state.weightsCallbackIds);
+    state.weightsCallbackIds.clear();
+    this->meshDag = state.shapePath;
+    this->skinObj = state.skinCluster;
+    swapPaintMeshState(state);
+    meshFn.setObject(this->meshDag);
+    meshOrigFn.setObject(this->origMeshDag);
+    this->mayaOrigRawPoints = meshOrigFn.getRawPoints(&status);
+    refreshPointsNormals();
+    removeIdleLoadPagesCallback();
+
+    // the edits done while parked
+    addWeightsCallbacks();
+    this->dirtyVertices.swap(state.dirtyVertices);
+    this->dirtyLockInfluences.swap(state.dirtyLockInfluences);
+    this->dirtyVerticesLocks = state.dirtyVerticesLocks;
+    state.dirtyVerticesLocks = false;
+    refreshDirtyVertices();
+    if (!this->allWeightPagesLoaded) {
+        this->idleLoadPagesCallbackId = MEventMessage::addEventCallback(
+            "idle", SkinBrushContext::idleLoadPagesCallback, this, &status);
+        if (status != MS::kSuccess) this->idleLoadPagesCallbackId = 0;
+    }
+}
+
+MStatus SkinBrushContext::activatePaintMesh(int index) {
+    MStatus status;
+    if (index == this->activePaintMesh || index < 0 || index >= (int)this->paintMeshes.size())
+        return MS::kFailure;
+    PaintMeshState &target = *this->paintMeshes[index];
+    if (!target.shapePath.isValid()) return MS::kFailure;
+
+    // the influences follow by name from one skinCluster to the other
+    MString influenceName;
+    if (this->influenceIndex >= 0 && this->influenceIndex < (int)this->inflNames.length())
+        influenceName = this->inflNames[this->influenceIndex];
+    auto selectInfluenceByName = [&]() {
+        int newInfluence = this->inflNames.indexOf(influenceName);
+        this->influenceIndex = (newInfluence != -1) ? newInfluence : 0;
+        this->pickedInfluence =
+            (this->inflNames.length() > 0) ? this->inflNames[this->influenceIndex] : MString();
+    };
+
+    // park the active mesh, the edits not refreshed yet are applied first
+    PaintMeshState &active = *this->paintMeshes[this->activePaintMesh];
+    refreshDirtyVertices();
+    removeWeightsCallbacks();
+    removeInfluencesMatrixCallbacks();
+    removeIdleLoadPagesCallback();
+    swapPaintMeshState(active);
+    addParkedWeightsCallbacks(active);
+
+    if (!target.loaded) {
+        // read the first time, as at tool entry
+        if (target.weightsCallbackIds.length() > 0)
+            MMessage::removeCallbacks(target.weightsCallbackIds);
+        target.weightsCallbackIds.clear();
+        this->meshDag = target.shapePath;
+        this->skinObj = target.skinCluster;
+        status = getMeshData();
+        if (status == MS::kSuccess) {
+            selectInfluenceByName();
+            status = setupPaintMesh();
+        }
+        // the brush is already over it, no progressive entry here
+        waitForTopology();
+        if (status != MS::kSuccess) {
+            // not paintable, skipped from now on, back to the previous mesh
+            target.shapePath = MDagPath();
+            resumePaintMesh(active);
+            selectInfluenceByName();
+            return MS::kFailure;
+        }
+        target.loaded = true;
+    } else {
+        resumePaintMesh(target);
+        selectInfluenceByName();
+        // the color settings may have changed while parked
+        if (soloColorVal == 1) {
+            meshFn.setCurrentColorSetName(this->soloColorSet);
+            editSoloColorSet(true);
+        } else {
+            meshFn.setCurrentColorSetName(this->fullColorSet);
+        }
+    }
+    this->activePaintMesh = index;
+    if (verbose) MGlobal::displayInfo(MString(" painting : ") + meshDag.fullPathName());
+
+    this->previousPaint.clear();
+    this->previousMirrorPaint.clear();
+    this->skinValuesToSet.clear();
+    this->verticesPainted.clear();
+    this->refreshDone = false;
+    this->biggestInfluence = -1;
+    MUserEventMessage::postUserEvent("brSkinBrush_paintMeshChanged");
+    return MS::kSuccess;
+}
+
+void SkinBrushContext::refreshPaintMeshVertices(MObject &skinCluster, MIntArray &verticesIndices) {
+    // a parked mesh collects the undo / redo edits with its callbacks
+    if (!this->paintMeshes.empty() && skinCluster != this->skinObj) return;
+    // undo after the tool exit, the color sets are removed
+    if (!this->toolActive) return;
+    refreshTheseVertices(verticesIndices);
+}
+
 //
 // Description:
 //      Parse the history of the mesh at the given dagPath and return
@@ -2722,6 +3593,53 @@ MStatus SkinBrushContext::getSkinCluster(MDagPath &meshDag, MObject &skinCluster
     return status;
 }
 
+MStatus SkinBrushContext::getMapChannel() {
+    MStatus status;
+    if (isNurbs) {
+        MGlobal::displayError("brSkinBrush: the maps are painted on meshes only");
+        return MS::kFailure;
+    }
+    status = getMapPlug(this->mapAttributeVal, this->mapPlug);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    this->skinObj = this->mapPlug.node();
+
+    this->nbJoints = 1;
+    this->influenceIndex = 0;
+    this->influenceIndices = MIntArray(1, 0);
+    this->indicesForInfluenceObjects = MIntArray(1, 0);
+    this->inflDagPaths.clear();
+    this->maintainMaxInfluences = false;
+    this->maxInfluences = 1;
+    this->normalize = false;
+
+    MString mapName = this->mapPlug.partialName(true);
+    QRect sz = QFontMetrics(QFont("MS Shell Dlg 2", 14)).boundingRect(mapName.asChar());
+    this->inflNames = MStringArray(1, mapName);
+    this->inflNamePixelSize = MIntArray(2, 0);
+    this->inflNamePixelSize[0] = std::max(sz.width() + 2, 5);
+    this->inflNamePixelSize[1] = std::max(sz.height() + 2, 5);
+    return status;
+}
+
+MStatus SkinBrushContext::fillMapValues() {
+    // one value per vertex, read at once even on a dense mesh
+    MStatus status = readMapValues(this->mapPlug, this->numVertices, this->meshArrays->skinWeightList);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    buildInfluenceVertices();
+    setAllWeightPagesLoaded();
+
+    int nbVerts = this->numVertices;
+    skin_weights_.resize(nbVerts);
+    this->meshArrays->multiCurrentColors.setLength(nbVerts);
+#pragma omp parallel for
+    for (int vertexIndex = 0; vertexIndex < nbVerts; ++vertexIndex) {
+        MColor theColor(0, 0, 0, 1);
+        theColor += this->jointsColors[0] * this->meshArrays->skinWeightList[vertexIndex];
+        this->meshArrays->multiCurrentColors[vertexIndex] = theColor;
+    }
+    return status;
+}
+
 MStatus SkinBrushContext::fillArrayValues(MObject &skinCluster, bool doColors) {
     MStatus status = MS::kSuccess;
     if (verbose) MGlobal::displayInfo(" FILLED ARRAY VALUES ");
@@ -2731,9 +3649,9 @@ MStatus SkinBrushContext::fillArrayValues(MObject &skinCluster, bool doColors) {
     unsigned int infCount;
 
     if (!isNurbs) {
-        status = skinFn.getWeights(meshDag, allVtxCompObj, this->skinWeightList, infCount);
+        status = skinFn.getWeights(meshDag, allVtxCompObj, this->meshArrays->skinWeightList, infCount);
     } else {
-        status = skinFn.getWeights(nurbsDag, allVtxCompObj, this->skinWeightList, infCount);
+        status = skinFn.getWeights(nurbsDag, allVtxCompObj, this->meshArrays->skinWeightList, infCount);
     }
     CHECK_MSTATUS_AND_RETURN_IT(status);
     this->nbJoints = infCount;
@@ -2741,12 +3659,14 @@ MStatus SkinBrushContext::fillArrayValues(MObject &skinCluster, bool doColors) {
     // quickly the ignore locks
     this->ignoreLockJoints.clear();
     this->ignoreLockJoints = MIntArray(this->nbJoints, 0);
+    buildInfluenceVertices();
+    setAllWeightPagesLoaded();
 
     if (doColors) {
         skin_weights_.resize(this->numVertices);
 
-        this->multiCurrentColors.clear();
-        this->multiCurrentColors.setLength(this->numVertices);
+        this->meshArrays->multiCurrentColors.clear();
+        this->meshArrays->multiCurrentColors.setLength(this->numVertices);
         // get values for array --
         for (unsigned int vertexIndex = 0; vertexIndex < this->numVertices; ++vertexIndex) {
             MColor theColor(0.0, 0.0, 0.0);
@@ -2755,8 +3675,8 @@ MStatus SkinBrushContext::fillArrayValues(MObject &skinCluster, bool doColors) {
 
                 int ind_swl = vertexIndex * infCount + indexInfluence;
                 double theWeight = 0.0;
-                if (ind_swl < this->skinWeightList.length())
-                    theWeight = this->skinWeightList[ind_swl];
+                if (ind_swl < this->meshArrays->skinWeightList.length())
+                    theWeight = this->meshArrays->skinWeightList[ind_swl];
 
                 if (doColors) {
                     if (lockJoints[indexInfluence] == 1)
@@ -2772,7 +3692,7 @@ MStatus SkinBrushContext::fillArrayValues(MObject &skinCluster, bool doColors) {
                 }
             }
             if (doColors) {  // not store lock vert color
-                this->multiCurrentColors[vertexIndex] = theColor;
+                this->meshArrays->multiCurrentColors[vertexIndex] = theColor;
                 if ((verbose) && (vertexIndex == 4)) {
                     MGlobal::displayInfo(MString(" VTX 4 R: ") + theColor.r + MString("  G: ") +
                                          theColor.g + MString("  B: ") + theColor.b +
@@ -2786,13 +3706,16 @@ MStatus SkinBrushContext::fillArrayValues(MObject &skinCluster, bool doColors) {
 }
 
 MStatus SkinBrushContext::displayWeightValue(int vertexIndex, bool displayZero) {
+    std::vector<int> pages;
+    addPageOfVertex(vertexIndex, pages);
+    loadWeightPages(pages);
     MString toDisplay = MString("weigth of vtx (") + vertexIndex + MString(") : ");
     for (unsigned int indexInfluence = 0; indexInfluence < this->nbJoints;
          indexInfluence++) {  // for each joint
         double theWeight = 0.0;
         int ind_swl = vertexIndex * this->nbJoints + indexInfluence;
-        if (ind_swl < this->skinWeightList.length())
-            theWeight = this->skinWeightList[ind_swl];
+        if (ind_swl < this->meshArrays->skinWeightList.length())
+            theWeight = this->meshArrays->skinWeightList[ind_swl];
         if (theWeight == 0 && !displayZero) continue;
         toDisplay += MString("[") + indexInfluence + MString(": ") + theWeight + MString("] ");
     }
@@ -2800,16 +3723,238 @@ MStatus SkinBrushContext::displayWeightValue(int vertexIndex, bool displayZero)
     return MS::kSuccess;
 }
 
+void SkinBrushContext::buildInfluenceVertices() {
+    // one pass over the weights, vertices are visited in order so every list comes out sorted
+    this->influenceVertices.clear();
+    this->influenceVertices.resize(this->nbJoints);
+    this->influenceVerticesChanged.clear();
+    if (this->nbJoints == 0) return;
+    int nbVerts = this->meshArrays->skinWeightList.length() / this->nbJoints;
+    for (int vertexIndex = 0; vertexIndex < nbVerts; ++vertexIndex) {
+        for (int indexInfluence = 0; indexInfluence < this->nbJoints; ++indexInfluence) {
+            if (this->meshArrays->skinWeightList[vertexIndex * this->nbJoints + indexInfluence] != 0.0)
+                this->influenceVertices[indexInfluence].push_back(vertexIndex);
+        }
+    }
+}
+
+void SkinBrushContext::setSkinWeight(int vertexIndex, int influence, double theWeight) {
+    // write one weight, the zero / non zero transitions are merged in the influence to vertices
+    // index by flushInfluenceVertices once the bulk write is done
+    int ind_swl = vertexIndex * this->nbJoints + influence;
+    unsigned int prevLength = this->meshArrays->skinWeightList.length();
+    if (ind_swl >= (int)prevLength) {
+        this->meshArrays->skinWeightList.setLength(ind_swl + 1);
+        for (unsigned int k = prevLength; k <= (unsigned int)ind_swl; ++k)
+            this->meshArrays->skinWeightList[k] = 0.0;
+    }
+    double prevWeight = this->meshArrays->skinWeightList[ind_swl];
+    this->meshArrays->skinWeightList[ind_swl] = theWeight;
+
+    if ((prevWeight != 0.0) == (theWeight != 0.0)) return;
+    if (influence >= (int)this->influenceVerticesChanged.size())
+        this->influenceVerticesChanged.resize(influence + 1);
+    this->influenceVerticesChanged[influence].push_back(vertexIndex);
+}
+
+void SkinBrushContext::flushInfluenceVertices() {
+    // one sorted merge per changed influence: the kept vertices plus the changed ones that are
+    // non zero now
+    int nbInfluences = (int)this->influenceVerticesChanged.size();
+    if (nbInfluences > (int)this->influenceVertices.size())
+        this->influenceVertices.resize(nbInfluences);
+    for (int influence = 0; influence < nbInfluences; ++influence) {
+        std::vector<int> &changed = this->influenceVerticesChanged[influence];
+        if (changed.empty()) continue;
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+        std::vector<int> &verts = this->influenceVertices[influence];
+        std::vector<int> kept;
+        kept.reserve(verts.size());
+        std::set_difference(verts.begin(), verts.end(), changed.begin(), changed.end(),
+                            std::back_inserter(kept));
+        auto zeroEnd = std::remove_if(changed.begin(), changed.end(), [&](int vertexIndex) {
+            return this->meshArrays->skinWeightList[vertexIndex * this->nbJoints + influence] == 0.0;
+        });
+        verts.resize(kept.size() + (zeroEnd - changed.begin()));
+        std::merge(kept.begin(), kept.end(), changed.begin(), zeroEnd, verts.begin());
+        changed.clear();
+    }
+}
+
+MIntArray SkinBrushContext::getInfluenceVertices(int influence) {
+    loadAllWeightPages();
+    flushInfluenceVertices();
+    MIntArray verts;
+    if (influence < 0 || influence >= (int)this->influenceVertices.size()) return verts;
+    const std::vector<int> &influenceVerts = this->influenceVertices[influence];
+    verts.setLength((unsigned int)influenceVerts.size());
+    for (unsigned int i = 0; i < influenceVerts.size(); ++i) verts[i] = influenceVerts[i];
+    return verts;
+}
+
+MIntArray SkinBrushContext::getZeroInfluences() {
+    loadAllWeightPages();
+    flushInfluenceVertices();
+    MIntArray zeroInfluences;
+    for (int indexInfluence = 0; indexInfluence < this->nbJoints; ++indexInfluence) {
+        if (indexInfluence >= (int)this->influenceVertices.size() ||
+            this->influenceVertices[indexInfluence].empty())
+            zeroInfluences.append(indexInfluence);
+    }
+    return zeroInfluences;
+}
+
+// ---------------------------------------------------------------------
+// weight pages
+// ---------------------------------------------------------------------
+MStatus SkinBrushContext::fillArrayValuesPaged(MObject &skinCluster) {
+    MStatus status = MS::kSuccess;
+    buildWeightPages();
+    if (this->weightPagesVertices.size() < WEIGHT_PAGES_LAZY_MIN)
+        return fillArrayValues(skinCluster, true);
+    if (verbose)
+        MGlobal::displayInfo(MString(" FILL ARRAY VALUES PAGED ") +
+                             (int)this->weightPagesVertices.size() + MString(" pages"));
+
+    // nothing is read here, the pages are read when touched or on idle
+    this->meshArrays->skinWeightList = MDoubleArray(this->numVertices * this->nbJoints, 0.0);
+    this->ignoreLockJoints = MIntArray(this->nbJoints, 0);
+    this->influenceVertices.clear();
+    this->influenceVertices.resize(this->nbJoints);
+    this->influenceVerticesChanged.clear();
+    skin_weights_.resize(this->numVertices);
+    this->meshArrays->multiCurrentColors = MColorArray(this->numVertices, MColor(0.0, 0.0, 0.0));
+
+    removeIdleLoadPagesCallback();
+    this->idleLoadPagesCallbackId = MEventMessage::addEventCallback(
+        "idle", SkinBrushContext::idleLoadPagesCallback, this, &status);
+    if (status != MS::kSuccess) {
+        this->idleLoadPagesCallbackId = 0;
+        return fillArrayValues(skinCluster, true);
+    }
+    return status;
+}
+
+void SkinBrushContext::buildWeightPages() {
+    // pages of vertices following a morton curve of the points at tool entry
+    std::vector<int> order;
+    getMortonOrder(this->mayaRawPoints, this->numVertices, order);
+
+    int nbPages = (this->numVertices + WEIGHT_PAGE_SIZE - 1) / WEIGHT_PAGE_SIZE;
+    this->vertexWeightPage.resize(this->numVertices);
+    this->weightPagesVertices.clear();
+    this->weightPagesVertices.resize(nbPages);
+    for (int i = 0; i < (int)order.size(); ++i) {
+        int page = i / WEIGHT_PAGE_SIZE;
+        this->vertexWeightPage[order[i]] = page;
+        this->weightPagesVertices[page].push_back(order[i]);
+    }
+    this->weightPageLoaded.assign(nbPages, false);
+    this->nbWeightPagesLoaded = 0;
+    this->allWeightPagesLoaded = (nbPages == 0);
+}
+
+void SkinBrushContext::setAllWeightPagesLoaded() {
+    removeIdleLoadPagesCallback();
+    this->weightPageLoaded.assign(this->weightPagesVertices.size(), true);
+    this->nbWeightPagesLoaded = (int)this->weightPagesVertices.size();
+    this->allWeightPagesLoaded = true;
+}
+
+void SkinBrushContext::addPageOfVertex(int vertexIndex, std::vector<int> &pages, bool withNeighbors) {
+    if (this->allWeightPagesLoaded) return;
+    if (vertexIndex < 0 || vertexIndex >= (int)this->vertexWeightPage.size()) return;
+    int page = this->vertexWeightPage[vertexIndex];
+    if (!this->weightPageLoaded[page] && std::find(pages.begin(), pages.end(), page) == pages.end())
+        pages.push_back(page);
+    if (!withNeighbors) return;
+    // the smooth reads the ring around the vertex
+    for (int neighbor : getSmoothNeighbors(vertexIndex)) addPageOfVertex(neighbor, pages);
+}
+
+void SkinBrushContext::loadWeightPages(std::vector<int> &pages, bool refreshView) {
+    MIntArray verticesIndices;
+    for (int page : pages) {
+        if (this->weightPageLoaded[page]) continue;
+        for (int vtxIndex : this->weightPagesVertices[page]) verticesIndices.append(vtxIndex);
+        this->weightPageLoaded[page] = true;
+        this->nbWeightPagesLoaded++;
+    }
+    pages.clear();
+    if (verticesIndices.length() == 0) return;
+    if (verbose)
+        MGlobal::displayInfo(MString(" - loadWeightPages - ") + verticesIndices.length() +
+                             MString(" vertices"));
+
+    // the influence lists are merged once for the read pages, at the end of the query
+    querySkinClusterValues(this->skinObj, verticesIndices, false);
+    // a page read during a stroke was not in the copy taken at press
+    if (this->meshArrays->fullUndoSkinWeightList.length() == this->meshArrays->skinWeightList.length()) {
+        for (int vtxIndex : verticesIndices) {
+            for (int j = 0; j < this->nbJoints; ++j) {
+                int ind_swl = vtxIndex * this->nbJoints + j;
+                this->meshArrays->fullUndoSkinWeightList[ind_swl] = this->meshArrays->skinWeightList[ind_swl];
+            }
+        }
+    }
+    if (this->nbWeightPagesLoaded == (int)this->weightPagesVertices.size()) {
+        this->allWeightPagesLoaded = true;
+        removeIdleLoadPagesCallback();
+    }
+
+    MColorArray multiEditColors, soloEditColors;
+    refreshColors(verticesIndices, multiEditColors, soloEditColors);
+    meshFn.setSomeColors(verticesIndices, multiEditColors, &this->fullColorSet);
+    meshFn.setSomeColors(verticesIndices, soloEditColors, &this->soloColorSet);
+
+    meshFn.setSomeColors(verticesIndices, multiEditColors, &this->fullColorSet2);
+    meshFn.setSomeColors(verticesIndices, soloEditColors, &this->soloColorSet2);
+    if (refreshView) maya2019RefreshColors();
+}
+
+void SkinBrushContext::loadAllWeightPages() {
+    if (this->allWeightPagesLoaded) return;
+    std::vector<int> pages;
+    for (int page = 0; page < (int)this->weightPagesVertices.size(); ++page) {
+        if (!this->weightPageLoaded[page]) pages.push_back(page);
+    }
+    loadWeightPages(pages);
+}
+
+void SkinBrushContext::removeIdleLoadPagesCallback() {
+    if (this->idleLoadPagesCallbackId != 0) MMessage::removeCallback(this->idleLoadPagesCallbackId);
+    this->idleLoadPagesCallbackId = 0;
+}
+
+void SkinBrushContext::idleLoadPagesCallback(void *clientData) {
+    SkinBrushContext *ctx = static_cast<SkinBrushContext *>(clientData);
+    if (ctx->skinObj.isNull() || !ctx->meshDag.isValid()) {
+        ctx->removeIdleLoadPagesCallback();
+        return;
+    }
+    // next pages in morton order within the time budget
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int> pages;
+    for (int page = 0; page < (int)ctx->weightPagesVertices.size(); ++page) {
+        if (ctx->weightPageLoaded[page]) continue;
+        pages.push_back(page);
+        ctx->loadWeightPages(pages);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        if (elapsed.count() >= WEIGHT_PAGES_IDLE_MS) break;
+    }
+    ctx->maya2019RefreshColors();
+}
+
 MStatus SkinBrushContext::fillArrayValuesDEP(MObject &skinCluster, bool doColors) {
     MStatus status = MS::kSuccess;
     if (verbose) MGlobal::displayInfo(" FILLED ARRAY VALUES ");
 
     MFnDependencyNode skinClusterDep(skinCluster);
 
-    MPlug weight_list_plug = skinClusterDep.findPlug("weightList", false);
     MPlug matrix_plug = skinClusterDep.findPlug("matrix", false);
-    // MGlobal::displayInfo(weight_list_plug.name());
-    int nbElements = weight_list_plug.numElements();
     unsigned int infCount = matrix_plug.numElements();
 
     matrix_plug.getExistingArrayAttributeIndices(this->deformersIndices);
@@ -2819,61 +3964,161 @@ MStatus SkinBrushContext::fillArrayValuesDEP(MObject &skinCluster, bool doColors
         if (el > this->nbJointsBig) this->nbJointsBig = el;
     }
     this->nbJointsBig += 1;
-    // this->nbJointsBig = this->deformersIndices[this->deformersIndices.length() - 1] +
-    // 1;//matrix_plug.evaluateNumElements();
     if (verbose)
         MGlobal::displayInfo(MString(" nb jnts ") + this->nbJoints + MString(" nb jnts Big ") +
                              this->nbJointsBig + MString(" influenceIndices ") +
                              this->influenceIndices.length());
     this->nbJoints = infCount;
 
-    // For the first component, the weights are ordered by influence object in the same order that
-    // is returned by the MFnSkinCluster::influenceObjects method.
-    // use influenceIndices
-    skin_weights_.resize(nbElements);
-    if (doColors) {
-        this->multiCurrentColors.clear();
-        this->multiCurrentColors.setLength(nbElements);
+    // the faster reader is picked per mesh size, the first mesh of a size times both
+    static std::map<int, bool> plugsFasterPerSize;
+    int sizeKey = 0;
+    for (unsigned int nb = this->numVertices; nb > 1; nb >>= 1) sizeKey++;
+    auto found = plugsFasterPerSize.find(sizeKey);
+    bool timeBoth = found == plugsFasterPerSize.end();
+    bool usePlugs = timeBoth || found->second;
+
+    if (timeBoth || !usePlugs) {
+        auto start = std::chrono::steady_clock::now();
+        status = readWeightsWithGetWeights(skinCluster);
+        this->weightsReadGetWeightsMs = std::chrono::duration<double, std::milli>(
+                                            std::chrono::steady_clock::now() - start)
+                                            .count();
+        if (status != MS::kSuccess) {
+            this->weightsReadGetWeightsMs = -1.0;
+            usePlugs = true;
+        }
     }
-    this->skinWeightList = MDoubleArray(nbElements * this->nbJoints, 0.0);
-
-// MThreadUtils::syncNumOpenMPThreads();
-// in option C/C++ turn omp on !!!!
-#pragma omp parallel for  // collapse(2)
-    for (int i = 0; i < nbElements; ++i) {
-        // weightList[i]
-        MPlug ith_weights_plug = weight_list_plug.elementByPhysicalIndex(i);
-        int vertexIndex = ith_weights_plug.logicalIndex();
-
-        // weightList[i].weight
-        MPlug plug_weights = ith_weights_plug.child(0);  // access first compound child
-        int nb_weights = plug_weights.numElements();
+    if (timeBoth || usePlugs) {
+        auto start = std::chrono::steady_clock::now();
+        MStatus plugsStatus = readWeightsWithPlugs(skinCluster);
+        this->weightsReadPlugsMs = std::chrono::duration<double, std::milli>(
+                                       std::chrono::steady_clock::now() - start)
+                                       .count();
+        if (plugsStatus != MS::kSuccess) {
+            this->weightsReadPlugsMs = -1.0;
+            if (!timeBoth) status = readWeightsWithGetWeights(skinCluster);
+        } else {
+            status = plugsStatus;
+        }
+    }
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (timeBoth) {
+        usePlugs = this->weightsReadPlugsMs >= 0.0 &&
+                   (this->weightsReadGetWeightsMs < 0.0 ||
+                    this->weightsReadPlugsMs <= this->weightsReadGetWeightsMs);
+        plugsFasterPerSize[sizeKey] = usePlugs;
+    }
+    this->weightsReadUsedPlugs = usePlugs;
+    if (verbose)
+        MGlobal::displayInfo(MString(" weights read | plugs ") + this->weightsReadPlugsMs +
+                             MString(" ms | getWeights ") + this->weightsReadGetWeightsMs +
+                             MString(" ms | using ") + (usePlugs ? "plugs" : "getWeights"));
 
-        MColor theColor(0, 0, 0, 1);
-        for (int j = 0; j < nb_weights; j++) {  // for each joint
-            MPlug weight_plug = plug_weights.elementByPhysicalIndex(j);
-            // weightList[i].weight[j]
-            int indexInfluence = weight_plug.logicalIndex();
-            double theWeight = weight_plug.asDouble();
-            // store in the correct Spot --
-            indexInfluence = this->indicesForInfluenceObjects[indexInfluence];
-            int ind_swl = vertexIndex * this->nbJoints + indexInfluence;
-            if (ind_swl >= this->skinWeightList.length())
-                this->skinWeightList.setLength(ind_swl + 1);
-            this->skinWeightList[ind_swl] = theWeight;
-            if (doColors) {  // and not locked
+    int nbVerts = this->numVertices;
+    skin_weights_.resize(nbVerts);
+    if (doColors) {
+        this->meshArrays->multiCurrentColors.clear();
+        this->meshArrays->multiCurrentColors.setLength(nbVerts);
+        // every vertex writes its own color only
+#pragma omp parallel for
+        for (int vertexIndex = 0; vertexIndex < nbVerts; ++vertexIndex) {
+            MColor theColor(0, 0, 0, 1);
+            for (int indexInfluence = 0; indexInfluence < this->nbJoints; ++indexInfluence) {
+                double theWeight = this->meshArrays->skinWeightList[vertexIndex * this->nbJoints + indexInfluence];
+                if (theWeight == 0.0) continue;
                 if (this->lockJoints[indexInfluence] == 1)
                     theColor += lockJntColor * theWeight;
                 else
                     theColor += this->jointsColors[indexInfluence] * theWeight;
             }
+            this->meshArrays->multiCurrentColors[vertexIndex] = theColor;
         }
-        if (doColors) {  // not store lock vert color
-            this->multiCurrentColors[vertexIndex] = theColor;
+    }
+    buildInfluenceVertices();
+    setAllWeightPagesLoaded();
+    return status;
+}
+
+MStatus SkinBrushContext::readWeightsWithPlugs(MObject &skinCluster) {
+    std::vector<int> rows, columns;
+    std::vector<double> values;
+    MStatus status = readWeightListCSR(skinCluster, this->indicesForInfluenceObjects,
+                                       this->numVertices, rows, columns, values);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    int nbVerts = this->numVertices;
+    this->meshArrays->skinWeightList = MDoubleArray(nbVerts * this->nbJoints, 0.0);
+    // rows are disjoint in the dense array
+#pragma omp parallel for
+    for (int vertexIndex = 0; vertexIndex < nbVerts; ++vertexIndex) {
+        for (int k = rows[vertexIndex]; k < rows[vertexIndex + 1]; ++k) {
+            if (columns[k] < 0 || columns[k] >= this->nbJoints) continue;
+            this->meshArrays->skinWeightList[vertexIndex * this->nbJoints + columns[k]] = values[k];
         }
     }
     return status;
 }
+
+MStatus SkinBrushContext::readWeightsWithGetWeights(MObject &skinCluster) {
+    MStatus status;
+    MFnSkinCluster skinFn(skinCluster, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    unsigned int infCount;
+    if (!isNurbs)
+        status = skinFn.getWeights(meshDag, allVtxCompObj, this->meshArrays->skinWeightList, infCount);
+    else
+        status = skinFn.getWeights(nurbsDag, allVtxCompObj, this->meshArrays->skinWeightList, infCount);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if ((int)infCount != this->nbJoints ||
+        this->meshArrays->skinWeightList.length() != this->numVertices * infCount)
+        return MS::kFailure;
+    return status;
+}
+
+MDoubleArray SkinBrushContext::getWeightsReadTimings() {
+    MDoubleArray timings;
+    timings.append(this->weightsReadPlugsMs);
+    timings.append(this->weightsReadGetWeightsMs);
+    timings.append(this->weightsReadUsedPlugs ? 1.0 : 0.0);
+    return timings;
+}
+
+MDoubleArray SkinBrushContext::getSetupTimings() {
+    // python start, mesh arrays, hit topology, smooth topology, edges, skinCluster and
+    // intersectors, weights and colors, wait on the topology, total
+    waitForTopology();
+    MDoubleArray timings;
+    timings.append(this->setupPythonMs);
+    timings.append(this->setupMeshArraysMs);
+    timings.append(this->setupHitTopologyMs);
+    timings.append(this->setupSmoothTopologyMs);
+    timings.append(this->setupEdgesMs);
+    timings.append(this->setupSkinClusterMs);
+    timings.append(this->setupWeightsColorsMs);
+    timings.append(this->setupTopologyWaitMs);
+    timings.append(this->setupTotalMs);
+    return timings;
+}
+
+double SkinBrushContext::getTopologyByteSize() {
+    // bytes held by the connectivity of the mesh under the brush
+    waitForTopology();
+    return (double)this->topology.byteSize();
+}
+
+MDoubleArray SkinBrushContext::getDragLatency() {
+    // last, average and max time of the drag events of the last stroke, then the events,
+    // coalesced events and degraded events counts
+    MDoubleArray latency;
+    latency.append(this->lastDragMs);
+    latency.append(this->nbDragEvents > 0 ? this->totalDragMs / this->nbDragEvents : 0.0);
+    latency.append(this->maxDragMs);
+    latency.append((double)this->nbDragEvents);
+    latency.append((double)this->nbCoalescedDragEvents);
+    latency.append((double)this->nbDegradedDragEvents);
+    return latency;
+}
 //
 // Description:
 //      Return the influence indices of all influences of the given
@@ -2901,10 +4146,19 @@ MIntArray SkinBrushContext::getInfluenceIndices() {
 
     this->inflNames.setLength(lent);
     this->inflNamePixelSize.setLength(2 * lent);
-    this->indicesForInfluenceObjects.setLength(lent);
     MStatus stat;
     this->nbJoints = lent;
 
+    // logical index -> influence, the logical indices have gaps when an influence was removed
+    MIntArray logicalIndices(lent, -1);
+    int maxLogical = -1;
+    for (i = 0; i < lent; i++) {
+        logicalIndices[i] = skinFn.indexForInfluenceObject(this->inflDagPaths[i]);
+        maxLogical = std::max(maxLogical, logicalIndices[i]);
+    }
+    this->indicesForInfluenceObjects = MIntArray(maxLogical + 1, -1);
+    for (i = 0; i < lent; i++) this->indicesForInfluenceObjects[logicalIndices[i]] = i;
+
     QFontMetrics fontMetrics(QFont("MS Shell Dlg 2", 14));
 
     for (i = 0; i < lent; i++) {
@@ -2925,9 +4179,6 @@ MIntArray SkinBrushContext::getInfluenceIndices() {
 
         this->inflNamePixelSize[2 * i] = wid;
         this->inflNamePixelSize[2 * i + 1] = height;
-
-        int indexLogical = skinFn.indexForInfluenceObject(this->inflDagPaths[i]);
-        this->indicesForInfluenceObjects[indexLogical] = i;
     }
     return influenceIndices;
 }
@@ -2938,6 +4189,15 @@ MStatus SkinBrushContext::querySkinClusterValues(MObject &skinCluster, MIntArray
 
     if (meshDag.node().isNull()) return MStatus::kNotFound;
 
+    if (this->mapMode) {
+        MDoubleArray values;
+        status = readMapValues(this->mapPlug, verticesIndices, values);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        for (unsigned int i = 0; i < verticesIndices.length(); ++i)
+            setSkinWeight(verticesIndices[i], 0, values[i]);
+        flushInfluenceVertices();
+        return status;
+    }
     MFnSkinCluster skinFn(skinCluster, &status);
     MDoubleArray weightsVertices;
     unsigned int infCount;
@@ -2968,10 +4228,7 @@ MStatus SkinBrushContext::querySkinClusterValues(MObject &skinCluster, MIntArray
         MColor theColor;
         for (unsigned int j = 0; j < infCount; j++) {  // for each joint
             double theWeight = weightsVertices[i * infCount + j];
-            int ind_swl = vertexIndex * this->nbJoints + j;
-            if (ind_swl >= this->skinWeightList.length())
-                this->skinWeightList.setLength(ind_swl + 1);
-            this->skinWeightList[ind_swl] = theWeight;
+            setSkinWeight(vertexIndex, j, theWeight);
             if (doColors) {
                 if (lockJoints[j] == 1)
                     theColor += lockJntColor * theWeight;
@@ -2980,6 +4237,7 @@ MStatus SkinBrushContext::querySkinClusterValues(MObject &skinCluster, MIntArray
             }
         }
     }
+    flushInfluenceVertices();
     return status;
 }
 
@@ -3037,7 +4295,7 @@ bool SkinBrushContext::getMirrorHit(bool getNormal, int &faceHit, MFloatPoint &h
         MPoint pointToMirror = MPoint(this->origHitPoint);
         MPoint mirrorPoint = pointToMirror * mirrorMatrix;
 
-        stat = intersectorOrigShape.getClosestPoint(mirrorPoint, pointInfo, mirrorMinDist);
+        stat = intersectorOrigShape->getClosestPoint(mirrorPoint, pointInfo, mirrorMinDist);
         if (MS::kSuccess != stat) return false;
 
         faceHit = pointInfo.faceIndex();
@@ -3045,7 +4303,7 @@ bool SkinBrushContext::getMirrorHit(bool getNormal, int &faceHit, MFloatPoint &h
         float hitBary1, hitBary2;
         pointInfo.getBarycentricCoords(hitBary1, hitBary2);
 
-        MIntArray triangle = this->perFaceTriangleVertices[faceHit][hitTriangle];
+        const int *triangle = this->topology.triangle(faceHit, hitTriangle);
 
         float hitBary3 = (1 - hitBary1 - hitBary2);
         float x = this->mayaRawPoints[triangle[0] * 3] * hitBary1 +
@@ -3060,7 +4318,7 @@ bool SkinBrushContext::getMirrorHit(bool getNormal, int &faceHit, MFloatPoint &h
         hitPoint = MFloatPoint(x, y, z) * this->inclusiveMatrix;
     } else {
         MPoint mirrorPoint = MPoint(this->centerOfBrush) * mirrorMatrix;
-        stat = intersector.getClosestPoint(mirrorPoint, pointInfo, mirrorMinDist);
+        stat = intersector->getClosestPoint(mirrorPoint, pointInfo, mirrorMinDist);
         if (MS::kSuccess != stat) return false;
 
         faceHit = pointInfo.faceIndex();
@@ -3095,7 +4353,7 @@ bool SkinBrushContext::computeHit(short screenPixelX, short screenPixelY, bool g
     if (!foundIntersect) return false;
 
     if (paintMirror > 0 && paintMirror < 4) {  // if we compute the orig
-        MIntArray triangle = this->perFaceTriangleVertices[faceHit][hitTriangle];
+        const int *triangle = this->topology.triangle(faceHit, hitTriangle);
         float hitBary3 = (1 - hitBary1 - hitBary2);
         float x = this->mayaOrigRawPoints[triangle[0] * 3] * hitBary1 +
                   this->mayaOrigRawPoints[triangle[1] * 3] * hitBary2 +
@@ -3166,11 +4424,11 @@ void SkinBrushContext::getColorWithMirror(int vertexIndex, float valueBase, floa
             soloColor = this->lockVertColor;
             multColor = this->lockVertColor;
         } else {  // unlock verts
-            multColor = this->multiCurrentColors[vertexIndex];
-            soloColor = this->soloCurrentColors[vertexIndex];
+            multColor = this->meshArrays->multiCurrentColors[vertexIndex];
+            soloColor = this->meshArrays->soloCurrentColors[vertexIndex];
         }
-    } else if (!this->lockVertices[vertexIndex]) {
-        MColor currentColor = this->multiCurrentColors[vertexIndex];
+    } else if (!this->meshArrays->lockVertices[vertexIndex]) {
+        MColor currentColor = this->meshArrays->multiCurrentColors[vertexIndex];
         int influenceMirrorColorIndex = this->mirrorInfluences[this->influenceIndex];
         MColor jntColor = this->jointsColors[this->influenceIndex];
         MColor jntMirrorColor = this->jointsColors[influenceMirrorColorIndex];
@@ -3180,17 +4438,17 @@ void SkinBrushContext::getColorWithMirror(int vertexIndex, float valueBase, floa
         // UnLockVertices
 
         if (theCommandIndex == ModifierCommands::Smooth || theCommandIndex == ModifierCommands::Sharpen) {
-            soloColor = biggestValue * white + (1.0 - biggestValue) * this->soloCurrentColors[vertexIndex];
-            multColor = biggestValue * white + (1.0 - biggestValue) * this->multiCurrentColors[vertexIndex];
+            soloColor = biggestValue * white + (1.0 - biggestValue) * this->meshArrays->soloCurrentColors[vertexIndex];
+            multColor = biggestValue * white + (1.0 - biggestValue) * this->meshArrays->multiCurrentColors[vertexIndex];
         } else {
             double newW = 0.0;
             int ind_swl = vertexIndex * nbJoints + this->influenceIndex;
-            if (ind_swl < this->skinWeightList.length())
-                newW = this->skinWeightList[ind_swl];
+            if (ind_swl < this->meshArrays->skinWeightList.length())
+                newW = this->meshArrays->skinWeightList[ind_swl];
             double newWMirror = 0.0;
             int ind_swlM = vertexIndex * nbJoints + influenceMirrorColorIndex;
-            if (ind_swlM < this->skinWeightList.length())
-                newWMirror = this->skinWeightList[ind_swlM];
+            if (ind_swlM < this->meshArrays->skinWeightList.length())
+                newWMirror = this->meshArrays->skinWeightList[ind_swlM];
             double sumNewWs = newW + newWMirror;
 
             if (theCommandIndex == ModifierCommands::Remove) {
@@ -3249,7 +4507,7 @@ MStatus SkinBrushContext::preparePaint(std::unordered_map<int, float> &dicVertsD
         float value = element.second * multiplier;
         // check if need to set this color, we store in intensityValues to check if it's already at
         // 1 -------
-        if ((this->lockVertices[index] == 1 && !isCommandLock) || intensityValues[index] == 1) {
+        if ((this->meshArrays->lockVertices[index] == 1 && !isCommandLock) || intensityValues[index] == 1) {
             continue;
         }
         // get the correct value of paint by adding this value -----
@@ -3292,6 +4550,10 @@ MStatus SkinBrushContext::doPerformPaint() {
     MColorArray multiEditColors, soloEditColors;
     MIntArray editVertsIndices;
 
+    std::vector<int> pages;
+    for (const auto &pt : this->mirroredJoinedArray) addPageOfVertex(pt.first, pages);
+    loadWeightPages(pages);
+
     for (const auto &pt : this->mirroredJoinedArray) {
         int ptIndex = pt.first;
         float weightBase = pt.second.first;
@@ -3355,99 +4617,59 @@ MObject SkinBrushContext::allVertexComponents() {
 
 //
 // Description:
-//      Return the vertex indices within the brush volume.
-//
-// Input Arguments:
-//      None
-//
-// Return Value:
-//      int array           The array of indices in the volume.
+//      Refresh the spatial hash of the volume brush. It's rebuilt for
+//      another mesh or brush size, otherwise only the vertices that
+//      moved change cell.
 //
-MIntArray SkinBrushContext::getVerticesInVolume() {
-    MIntArray indices;
-
-    double radius = sizeVal * sizeVal;
-
-    MItMeshVertex vtxIter(meshDag);
-    while (!vtxIter.isDone()) {
-        MPoint pnt = vtxIter.position(MSpace::kWorld);
-
-        double x = pnt.x - surfacePoints[0].x;
-        double y = pnt.y - surfacePoints[0].y;
-        double z = pnt.z - surfacePoints[0].z;
-
-        x *= x;
-        y *= y;
-        z *= z;
-
-        if (x + y + z <= radius) indices.append(vtxIter.index());
-
-        vtxIter.next();
+void SkinBrushContext::refreshVolumeHash() {
+    // cells of the brush size, the range queries are smaller and stay in a few cells
+    float cellSize = (float)this->sizeVal;
+    bool rebuild = this->volumeHashDirty || this->volumeHash.empty() ||
+                   this->volumeHash.points.size() != 3 * (size_t)this->numVertices ||
+                   this->volumeHash.cellSize < 0.5f * cellSize ||
+                   this->volumeHash.cellSize > 2.0f * cellSize;
+    if (rebuild) {
+        this->volumeHash.build(this->mayaRawPoints, this->numVertices, cellSize);
+        this->volumeHashDirty = false;
+    } else {
+        // the rig may have moved since the last stroke
+        this->volumeHash.refresh(this->mayaRawPoints);
     }
-
-    return indices;
 }
 
-//
-// Description:
-//      Return the vertex indices of the brush volume which are within
-//      the range of the current index.
-//
-// Input Arguments:
-//      index               The vertex index.
-//      volumeIndices       The array of all indices of the brush
-//                          volume.
-//      rangeIndices        The array of indices which are in range of
-//                          the vertex.
-//      values              The array of falloff values based on the
-//                          distance to the center vertex.
-//
-// Return Value:
-//      None
-//
-void SkinBrushContext::getVerticesInVolumeRange(int index, MIntArray &volumeIndices,
-                                                MIntArray &rangeIndices, MFloatArray &values) {
-    unsigned int i;
-
-    double radius = sizeVal * rangeVal;
-    radius *= radius;
-
-    double smoothStrength = strengthVal;
-    if (fractionOversamplingVal) smoothStrength /= oversamplingVal;
-
-    MItMeshVertex vtxIter(meshDag);
-    int prevIndex;
-    vtxIter.setIndex(index, prevIndex);
-
-    MPoint point = vtxIter.position(MSpace::kWorld);
-
-    for (i = 0; i < volumeIndices.length(); i++) {
-        int volumeIndex = volumeIndices[i];
-
-        vtxIter.setIndex(volumeIndex, prevIndex);
-
-        MPoint pnt = vtxIter.position(MSpace::kWorld);
-
-        double x = pnt.x - point.x;
-        double y = pnt.y - point.y;
-        double z = pnt.z - point.z;
-
-        x *= x;
-        y *= y;
-        z *= z;
-
-        double delta = x + y + z;
+void SkinBrushContext::getVerticesInVolume(const MFloatPoint &center, float radius,
+                                           std::unordered_map<int, float> &dicVertsDist) {
+    float centerPoint[3] = {center.x, center.y, center.z};
+    std::vector<std::pair<int, float>> found;
+    this->volumeHash.query(centerPoint, radius, found);
+    for (const auto &vertexDist : found) {
+        auto ret = dicVertsDist.insert(vertexDist);
+        if (!ret.second) ret.first->second = std::min(vertexDist.second, ret.first->second);
+    }
+}
 
-        if (volumeIndex != index && delta <= radius) {
-            rangeIndices.append(volumeIndex);
+std::vector<int> SkinBrushContext::getVerticesInVolumeRange(int vertexIndex) {
+    std::vector<int> rangeIndices;
+    if (this->volumeHash.empty()) return rangeIndices;
+    float radius = (float)(this->sizeVal * this->rangeVal);
+    std::vector<std::pair<int, float>> found;
+    this->volumeHash.query(&this->volumeHash.points[3 * vertexIndex], radius, found);
+    rangeIndices.reserve(found.size());
+    for (const auto &vertexDist : found)
+        if (vertexDist.first != vertexIndex) rangeIndices.push_back(vertexDist.first);
+    std::sort(rangeIndices.begin(), rangeIndices.end());
+    return rangeIndices;
+}
 
-            float value = (float)(1 - (delta / radius));
-            value = (float)getFalloffValue(value, smoothStrength);
-            values.append(value);
-        }
+int SkinBrushContext::getSmoothMaxInfluences() {
+    // the smooth stays within the influence budget of the skinCluster
+    if (!this->maintainMaxInfluences) return 0;
+    return (int)this->maxInfluences;
+}
 
-        vtxIter.next();
-    }
+std::vector<int> SkinBrushContext::getSmoothNeighbors(int vertexIndex) {
+    if (this->volumeVal && !this->volumeHash.empty()) return getVerticesInVolumeRange(vertexIndex);
+    return getSurroundingVerticesPerVert(vertexIndex);
 }
 
 //
@@ -3463,19 +4685,7 @@ void SkinBrushContext::getVerticesInVolumeRange(int index, MIntArray &volumeIndi
 //      double              The brush curve-based falloff value.
 //
 double SkinBrushContext::getFalloffValue(double value, double strength) {
-
-    switch (curveVal) {
-        case 0: // no falloff
-            return strength;
-        case 1: // linear
-            return value * strength;
-        case 2: // smoothstep
-            return (value * value * (3 - 2 * value)) * strength;
-        case 3: // narrow - quadratic
-            return (1 - pow((1 - value) / 1, 0.4)) * strength;
-        default:
-            return value;
-    }
+    return brushFalloffValue(curveVal, value, strength);
 }
 
 //
@@ -48,7 +48,10 @@ void SkinBrushContext::setExitToolCommand(MString &value) {
     MToolsInfo::setDirtyFlag(*this);
 }
 
+void SkinBrushContext::setMapAttribute(MString &value) { mapAttributeVal = value; }
+
 void SkinBrushContext::setFlood() {
+    loadAllWeightPages();
     this->verticesPainted.clear();
     this->skinValuesToSet.clear();
     double value = strengthVal;
@@ -68,11 +71,21 @@ void SkinBrushContext::setFlood() {
     )
         value = smoothStrengthVal;
 
-    for (int i = 0; i < this->numVertices; ++i) {
-        this->verticesPainted.insert(i);
-        this->skinValuesToSet.insert(std::make_pair(i, value));
+    bool isCommandLock = (theCommandIndex == ModifierCommands::LockVertices) ||
+                         (theCommandIndex == ModifierCommands::UnlockVertices);
+    // smooth reads the neighbors, in chunks the vertices of a chunk border would read their
+    // neighbors already smoothed. It floods in a single pass
+    bool isCommandSmooth = theCommandIndex == ModifierCommands::Smooth;
+    if (this->paintMirror == 0 && !isCommandLock && !isCommandSmooth &&
+        this->numVertices > FLOOD_CHUNK_SIZE) {
+        floodInChunks(theCommandIndex, value);
+    } else {
+        for (int i = 0; i < this->numVertices; ++i) {
+            this->verticesPainted.insert(i);
+            this->skinValuesToSet.insert(std::make_pair(i, value));
+        }
+        doTheAction();
     }
-    doTheAction();
     if (verbose)
         MGlobal::displayInfo(MString("SET FLOOD IS CALLED command ") + static_cast<int>(theCommandIndex) +
                              MString(" value ") + value);
@@ -357,6 +370,7 @@ bool SkinBrushContext::getDrawRange() { return drawRangeVal; }
 MString SkinBrushContext::getPythonImportPath() { return moduleImportString; }
 MString SkinBrushContext::getEnterToolCommand() { return enterToolCommandVal; }
 MString SkinBrushContext::getExitToolCommand() { return exitToolCommandVal; }
+MString SkinBrushContext::getMapAttribute() { return mapAttributeVal; }
 bool SkinBrushContext::getFractionOversampling() { return fractionOversamplingVal; }
 
 bool SkinBrushContext::getIgnoreLock() { return ignoreLockVal; }
@@ -0,0 +1,622 @@
+// ---------------------------------------------------------------------
+//
+//  skinBrushStrokeCmd.cpp
+//  brSkinBrush
+//
+// ---------------------------------------------------------------------
+#include "skinBrushStrokeCmd.h"
+
+#include <maya/MDagPathArray.h>
+#include <maya/MFnMesh.h>
+#include <maya/MFnNurbsCurve.h>
+#include <maya/MFnSingleIndexedComponent.h>
+#include <maya/MFnSkinCluster.h>
+#include <maya/MGlobal.h>
+#include <maya/MPointArray.h>
+#include <maya/MSelectionList.h>
+
+#include <algorithm>
+#include <cmath>
+
+const char* skinBrushStrokeCmd::kMeshNameFlagShort = "-mn";
+const char* skinBrushStrokeCmd::kMeshNameFlagLong = "-meshName";
+const char* skinBrushStrokeCmd::kPointFlagShort = "-p";
+const char* skinBrushStrokeCmd::kPointFlagLong = "-point";
+const char* skinBrushStrokeCmd::kStrokeCountFlagShort = "-sc";
+const char* skinBrushStrokeCmd::kStrokeCountFlagLong = "-strokeCount";
+const char* skinBrushStrokeCmd::kCurveFlagShort = "-cv";
+const char* skinBrushStrokeCmd::kCurveFlagLong = "-curveName";
+const char* skinBrushStrokeCmd::kSizeFlagShort = "-sz";
+const char* skinBrushStrokeCmd::kSizeFlagLong = "-size";
+const char* skinBrushStrokeCmd::kStrengthFlagShort = "-st";
+const char* skinBrushStrokeCmd::kStrengthFlagLong = "-strength";
+const char* skinBrushStrokeCmd::kFalloffFlagShort = "-c";
+const char* skinBrushStrokeCmd::kFalloffFlagLong = "-curve";
+const char* skinBrushStrokeCmd::kCommandFlagShort = "-cmd";
+const char* skinBrushStrokeCmd::kCommandFlagLong = "-commandIndex";
+const char* skinBrushStrokeCmd::kInfluenceFlagShort = "-i";
+const char* skinBrushStrokeCmd::kInfluenceFlagLong = "-influence";
+const char* skinBrushStrokeCmd::kMirrorFlagShort = "-mp";
+const char* skinBrushStrokeCmd::kMirrorFlagLong = "-mirrorPaint";
+const char* skinBrushStrokeCmd::kMirrorInfluenceFlagShort = "-mi";
+const char* skinBrushStrokeCmd::kMirrorInfluenceFlagLong = "-mirrorInfluence";
+const char* skinBrushStrokeCmd::kSmoothRepeatFlagShort = "-rp";
+const char* skinBrushStrokeCmd::kSmoothRepeatFlagLong = "-smoothRepeat";
+const char* skinBrushStrokeCmd::kVolumeFlagShort = "-vol";
+const char* skinBrushStrokeCmd::kVolumeFlagLong = "-volume";
+const char* skinBrushStrokeCmd::kIgnoreLockFlagShort = "-ilj";
+const char* skinBrushStrokeCmd::kIgnoreLockFlagLong = "-ignoreLock";
+const char* skinBrushStrokeCmd::kVerboseFlagShort = "-vrb";
+const char* skinBrushStrokeCmd::kVerboseFlagLong = "-verbose";
+const char* skinBrushStrokeCmd::kHelpFlagShort = "-h";
+const char* skinBrushStrokeCmd::kHelpFlagLong = "-help";
+
+static void DisplayStrokeHelp() {
+    MString help;
+    help += "Flags:\n";
+    help += "-meshName            -mn    String     Name of the skinned mesh, uses selection if not passed\n";
+    help += "-point               -p     3 Float    World space point of a stroke (multi-use)\n";
+    help += "-strokeCount         -sc    Int        Number of points of each stroke, in order (multi-use)\n";
+    help += "                                          All the points are one stroke if not passed\n";
+    help += "-curveName           -cv    String     Curve sampled as one more stroke (multi-use)\n";
+    help += "-size                -sz    Float      Radius of the brush\n";
+    help += "-strength            -st    Float      Strength of the brush\n";
+    help += "-curve               -c     Int        Falloff 0 none - 1 linear - 2 smooth - 3 narrow\n";
+    help += "-commandIndex        -cmd   Int        0 Add - 1 Remove - 2 AddPercent - 3 Absolute\n";
+    help += "                                          4 Smooth - 5 Sharpen\n";
+    help += "-influence           -i     String     Influence to paint\n";
+    help += "-mirrorPaint         -mp    Int        Mirror like the brush, 0 off - 1 2 3 X Y Z on the\n";
+    help += "                                          orig shape - 4 5 6 X Y Z in world space\n";
+    help += "-mirrorInfluence     -mi    String     Influence painted on the mirror side\n";
+    help += "-smoothRepeat        -rp    Int        Repeats of the smooth and sharpen\n";
+    help += "-volume              -vol   Bool       Paint the vertices in the sphere of the brush\n";
+    help += "-ignoreLock          -ilj   Bool       Ignore the locked influences\n";
+    help += "-verbose             -vrb   Bool       Verbose print\n";
+    help += "-help                -h     N/A        Display this text.\n";
+    MGlobal::displayInfo(help);
+}
+
+void* skinBrushStrokeCmd::creator() { return new skinBrushStrokeCmd(); }
+
+MSyntax skinBrushStrokeCmd::newSyntax() {
+    MSyntax syntax;
+    syntax.addFlag(kMeshNameFlagShort, kMeshNameFlagLong, MSyntax::kString);
+    syntax.addFlag(kPointFlagShort, kPointFlagLong, MSyntax::kDouble, MSyntax::kDouble,
+                   MSyntax::kDouble);
+    syntax.makeFlagMultiUse(kPointFlagShort);
+    syntax.addFlag(kStrokeCountFlagShort, kStrokeCountFlagLong, MSyntax::kLong);
+    syntax.makeFlagMultiUse(kStrokeCountFlagShort);
+    syntax.addFlag(kCurveFlagShort, kCurveFlagLong, MSyntax::kString);
+    syntax.makeFlagMultiUse(kCurveFlagShort);
+    syntax.addFlag(kSizeFlagShort, kSizeFlagLong, MSyntax::kDouble);
+    syntax.addFlag(kStrengthFlagShort, kStrengthFlagLong, MSyntax::kDouble);
+    syntax.addFlag(kFalloffFlagShort, kFalloffFlagLong, MSyntax::kLong);
+    syntax.addFlag(kCommandFlagShort, kCommandFlagLong, MSyntax::kLong);
+    syntax.addFlag(kInfluenceFlagShort, kInfluenceFlagLong, MSyntax::kString);
+    syntax.addFlag(kMirrorFlagShort, kMirrorFlagLong, MSyntax::kLong);
+    syntax.addFlag(kMirrorInfluenceFlagShort, kMirrorInfluenceFlagLong, MSyntax::kString);
+    syntax.addFlag(kSmoothRepeatFlagShort, kSmoothRepeatFlagLong, MSyntax::kLong);
+    syntax.addFlag(kVolumeFlagShort, kVolumeFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kIgnoreLockFlagShort, kIgnoreLockFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kVerboseFlagShort, kVerboseFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kHelpFlagShort, kHelpFlagLong);
+    return syntax;
+}
+
+MStatus skinBrushStrokeCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kHelpFlagShort)) {
+        DisplayStrokeHelp();
+        return MS::kSuccess;
+    }
+    if (argData.isFlagSet(kVerboseFlagShort))
+        verbose = argData.flagArgumentBool(kVerboseFlagShort, 0, &status);
+    if (argData.isFlagSet(kMeshNameFlagShort))
+        meshName_ = argData.flagArgumentString(kMeshNameFlagShort, 0, &status);
+    if (argData.isFlagSet(kSizeFlagShort))
+        size_ = argData.flagArgumentDouble(kSizeFlagShort, 0, &status);
+    if (argData.isFlagSet(kStrengthFlagShort))
+        strength_ = argData.flagArgumentDouble(kStrengthFlagShort, 0, &status);
+    if (argData.isFlagSet(kFalloffFlagShort))
+        curve_ = argData.flagArgumentInt(kFalloffFlagShort, 0, &status);
+    if (argData.isFlagSet(kMirrorFlagShort))
+        paintMirror_ = argData.flagArgumentInt(kMirrorFlagShort, 0, &status);
+    if (argData.isFlagSet(kSmoothRepeatFlagShort))
+        smoothRepeat_ = std::max(1, argData.flagArgumentInt(kSmoothRepeatFlagShort, 0, &status));
+    if (argData.isFlagSet(kVolumeFlagShort))
+        volume_ = argData.flagArgumentBool(kVolumeFlagShort, 0, &status);
+    if (argData.isFlagSet(kIgnoreLockFlagShort))
+        ignoreLock_ = argData.flagArgumentBool(kIgnoreLockFlagShort, 0, &status);
+    if (argData.isFlagSet(kCommandFlagShort)) {
+        int commandIndex = argData.flagArgumentInt(kCommandFlagShort, 0, &status);
+        if (commandIndex < 0 || commandIndex > static_cast<int>(ModifierCommands::Sharpen)) {
+            MGlobal::displayError(MString("brSkinBrushStroke: wrong command index ") + commandIndex);
+            return MS::kFailure;
+        }
+        command_ = static_cast<ModifierCommands>(commandIndex);
+    }
+    if (size_ <= 0.0) {
+        MGlobal::displayError("brSkinBrushStroke: the size has to be positive");
+        return MS::kFailure;
+    }
+    if (curve_ < 0 || curve_ > 3) {
+        MGlobal::displayError(MString("brSkinBrushStroke: wrong curve ") + curve_ +
+                              MString(", 0 to 3"));
+        return MS::kInvalidParameter;
+    }
+    if (paintMirror_ < 0 || paintMirror_ > 6) {
+        MGlobal::displayError(MString("brSkinBrushStroke: wrong mirrorPaint ") + paintMirror_ +
+                              MString(", 0 to 6"));
+        return MS::kInvalidParameter;
+    }
+
+    status = getMeshData();
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (argData.isFlagSet(kInfluenceFlagShort)) {
+        MString influenceName = argData.flagArgumentString(kInfluenceFlagShort, 0, &status);
+        influence_ = getInfluenceIndex(influenceName);
+        if (influence_ == -1) {
+            MGlobal::displayError(MString("brSkinBrushStroke: ") + influenceName +
+                                  MString(" is not an influence of the skinCluster"));
+            return MS::kFailure;
+        }
+    } else if (command_ != ModifierCommands::Smooth) {
+        MGlobal::displayError("brSkinBrushStroke: -influence is needed");
+        return MS::kFailure;
+    }
+    mirrorInfluence_ = influence_;
+    if (argData.isFlagSet(kMirrorInfluenceFlagShort)) {
+        MString influenceName = argData.flagArgumentString(kMirrorInfluenceFlagShort, 0, &status);
+        mirrorInfluence_ = getInfluenceIndex(influenceName);
+        if (mirrorInfluence_ == -1) {
+            MGlobal::displayError(MString("brSkinBrushStroke: ") + influenceName +
+                                  MString(" is not an influence of the skinCluster"));
+            return MS::kFailure;
+        }
+    }
+
+    std::vector<std::vector<MPoint>> strokes;
+    status = getStrokes(argData, strokes);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (strokes.empty()) {
+        MGlobal::displayError("brSkinBrushStroke: no stroke, pass -point or -curveName");
+        return MS::kFailure;
+    }
+
+    // strokes ------------------------------------------------------------
+    for (const auto& stroke : strokes) {
+        std::unordered_map<int, float> valuesToSet, valuesMirrorToSet;
+        std::unordered_map<int, float> previousPaint, previousMirrorPaint;
+        std::vector<float> intensityValues(numVertices_, 0), intensityValuesMirror(numVertices_, 0);
+        for (const MPoint& point : stroke) {
+            std::unordered_map<int, float> dicVertsDist;
+            bool hit = getDab(point, false, dicVertsDist);
+            if (hit) addDab(dicVertsDist, previousPaint, intensityValues, valuesToSet);
+            // the orig mirror starts from the hit on the orig shape
+            if (paintMirror_ == 0 || (!hit && paintMirror_ < 4)) continue;
+            std::unordered_map<int, float> dicVertsMirrorDist;
+            if (getDab(point, true, dicVertsMirrorDist))
+                addDab(dicVertsMirrorDist, previousMirrorPaint, intensityValuesMirror,
+                       valuesMirrorToSet);
+        }
+        status = applyStroke(valuesToSet, valuesMirrorToSet);
+        if (status == MS::kFailure) {
+            MGlobal::displayError("brSkinBrushStroke: the stroke could not be applied");
+            return status;
+        }
+    }
+
+    // one write for all the strokes ----------------------------------------
+    undoVertices_.clear();
+    redoWeights_.clear();
+    for (int vertexIndex : editedVertices_) {
+        undoVertices_.append(vertexIndex);
+        for (int j = 0; j < nbJoints_; ++j)
+            redoWeights_.append(fullWeights_[vertexIndex * nbJoints_ + j]);
+    }
+    int nbStrokes = (int)strokes.size();
+    fullWeights_.clear();
+    topology_.clear();
+    volumeHash_.clear();
+    points_.clear();
+    origPoints_.clear();
+    intersector_.reset();
+    intersectorOrig_.reset();
+    editedVertices_.clear();
+
+    if (verbose)
+        MGlobal::displayInfo(MString("brSkinBrushStroke: ") + nbStrokes + MString(" strokes, ") +
+                             undoVertices_.length() + MString(" vertices edited"));
+    setResult((int)undoVertices_.length());
+    if (undoVertices_.length() == 0) return MS::kSuccess;
+    return setWeights(redoWeights_, &undoWeights_);
+}
+
+MStatus skinBrushStrokeCmd::redoIt() {
+    if (undoVertices_.length() == 0) return MS::kSuccess;
+    return setWeights(redoWeights_, nullptr);
+}
+
+MStatus skinBrushStrokeCmd::undoIt() {
+    if (undoVertices_.length() == 0) return MS::kSuccess;
+    return setWeights(undoWeights_, nullptr);
+}
+
+MStatus skinBrushStrokeCmd::setWeights(MDoubleArray& weights, MDoubleArray* oldWeights) {
+    MStatus status;
+    MFnSingleIndexedComponent compFn;
+    MObject weightsObj = compFn.create(MFn::kMeshVertComponent);
+    compFn.addElements(undoVertices_);
+    MFnSkinCluster skinFn(skinCluster_, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    return skinFn.setWeights(meshPath_, weightsObj, influenceIndices_, weights, normalize_,
+                             oldWeights);
+}
+
+MStatus skinBrushStrokeCmd::getStrokes(const MArgDatabase& argData,
+                                       std::vector<std::vector<MPoint>>& strokes) {
+    MStatus status;
+    std::vector<MPoint> points;
+    unsigned int nbPoints = argData.numberOfFlagUses(kPointFlagShort);
+    for (unsigned int i = 0; i < nbPoints; ++i) {
+        MArgList pointArgs;
+        argData.getFlagArgumentList(kPointFlagShort, i, pointArgs);
+        unsigned int index = 0;
+        points.push_back(pointArgs.asPoint(index, 3, &status));
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    unsigned int nbCounts = argData.numberOfFlagUses(kStrokeCountFlagShort);
+    if (nbCounts == 0) {
+        if (!points.empty()) strokes.push_back(points);
+    } else {
+        unsigned int first = 0;
+        for (unsigned int i = 0; i < nbCounts; ++i) {
+            MArgList countArgs;
+            argData.getFlagArgumentList(kStrokeCountFlagShort, i, countArgs);
+            int count = countArgs.asInt(0, &status);
+            if (count < 0 || first + count > points.size()) {
+                MGlobal::displayError("brSkinBrushStroke: -strokeCount does not match the points");
+                return MS::kFailure;
+            }
+            strokes.push_back(std::vector<MPoint>(points.begin() + first,
+                                                  points.begin() + first + count));
+            first += count;
+        }
+    }
+
+    // curves are sampled every quarter of the brush
+    unsigned int nbCurves = argData.numberOfFlagUses(kCurveFlagShort);
+    for (unsigned int i = 0; i < nbCurves; ++i) {
+        MArgList curveArgs;
+        argData.getFlagArgumentList(kCurveFlagShort, i, curveArgs);
+        MString curveName = curveArgs.asString(0, &status);
+        MSelectionList selection;
+        MDagPath curvePath;
+        status = selection.add(curveName);
+        if (status == MS::kSuccess) status = selection.getDagPath(0, curvePath);
+        if (status == MS::kSuccess) status = curvePath.extendToShape();
+        MFnNurbsCurve curveFn(curvePath, &status);
+        if (status != MS::kSuccess) {
+            MGlobal::displayError(MString("brSkinBrushStroke: ") + curveName +
+                                  MString(" is not a curve"));
+            return MS::kFailure;
+        }
+        double length = curveFn.length();
+        int nbSamples = std::max(1, (int)std::ceil(length / (0.25 * size_)));
+        std::vector<MPoint> curvePoints;
+        for (int k = 0; k <= nbSamples; ++k) {
+            double param = curveFn.findParamFromLength(length * k / nbSamples);
+            MPoint point;
+            curveFn.getPointAtParam(param, point, MSpace::kWorld);
+            curvePoints.push_back(point);
+        }
+        strokes.push_back(curvePoints);
+    }
+    return MS::kSuccess;
+}
+
+MStatus skinBrushStrokeCmd::getMeshData() {
+    MStatus status;
+    MSelectionList selection;
+    if (meshName_.length() > 0)
+        status = selection.add(meshName_);
+    else
+        status = MGlobal::getActiveSelectionList(selection);
+    if (status != MS::kSuccess || selection.length() == 0) {
+        MGlobal::displayError("brSkinBrushStroke: pass -meshName or select a skinned mesh");
+        return MS::kFailure;
+    }
+    selection.getDagPath(0, meshPath_);
+    meshPath_.extendToShape();
+    if (meshPath_.apiType() != MFn::kMesh) {
+        MGlobal::displayError("brSkinBrushStroke: works on meshes only");
+        return MS::kFailure;
+    }
+    status = findSkinCluster(meshPath_, skinCluster_, 0, verbose);
+    if (status != MS::kSuccess || skinCluster_.isNull()) {
+        MGlobal::displayError(MString("brSkinBrushStroke: no skinCluster on ") +
+                              meshPath_.partialPathName());
+        return MS::kFailure;
+    }
+
+    // mesh ----------------------------------------------------------------
+    MFnMesh meshFn(meshPath_);
+    numVertices_ = meshFn.numVertices();
+    const float* rawPoints = meshFn.getRawPoints(&status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    points_.assign(rawPoints, rawPoints + 3 * numVertices_);
+
+    MIntArray vertexCounts, vertexList, triangleCounts, triangleVertices;
+    meshFn.getVertices(vertexCounts, vertexList);
+    meshFn.getTriangles(triangleCounts, triangleVertices);
+    topology_.buildFaces(numVertices_, vertexCounts, vertexList, triangleCounts, triangleVertices);
+    topology_.buildVertexVertices();
+    if (volume_) volumeHash_.build(points_.data(), numVertices_, (float)size_);
+
+    MObject meshObj = meshPath_.node();
+    intersector_.reset(new MMeshIntersector());
+    status = intersector_->create(meshObj, meshPath_.inclusiveMatrix());
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    if (paintMirror_ > 0 && paintMirror_ < 4) {
+        MObject origObj;
+        status = findOrigMesh(skinCluster_, origObj, verbose);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        MFnMesh origFn(origObj);
+        if (origFn.numVertices() != numVertices_) {
+            MGlobal::displayError("brSkinBrushStroke: the orig shape has another topology");
+            return MS::kFailure;
+        }
+        const float* origRawPoints = origFn.getRawPoints(&status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        origPoints_.assign(origRawPoints, origRawPoints + 3 * numVertices_);
+        intersectorOrig_.reset(new MMeshIntersector());
+        status = intersectorOrig_->create(origObj);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+
+    // skinCluster ---------------------------------------------------------
+    MFnSkinCluster skinFn(skinCluster_, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    MDagPathArray inflDagPaths;
+    skinFn.influenceObjects(inflDagPaths);
+    nbJoints_ = inflDagPaths.length();
+    influenceIndices_.clear();
+    influenceNames_.clear();
+    MIntArray indicesForInfluenceObjects;
+    for (int i = 0; i < nbJoints_; ++i) {
+        influenceIndices_.append(i);
+        MFnDependencyNode influenceFn(inflDagPaths[i].node());
+        influenceNames_.append(influenceFn.name());
+        int indexLogical = skinFn.indexForInfluenceObject(inflDagPaths[i]);
+        while ((int)indicesForInfluenceObjects.length() <= indexLogical)
+            indicesForInfluenceObjects.append(-1);
+        indicesForInfluenceObjects[indexLogical] = i;
+    }
+    getListLockJoints(skinCluster_, nbJoints_, indicesForInfluenceObjects, lockJoints_);
+    ignoreLockJoints_ = MIntArray(nbJoints_, 0);
+    MIntArray lockedIndices;
+    getListLockVertices(skinCluster_, lockVertices_, lockedIndices);
+
+    maxInfluences_ = 0;
+    if (skinFn.findPlug("maintainMaxInfluences", false).asBool())
+        maxInfluences_ = skinFn.findPlug("maxInfluences", false).asInt();
+    normalize_ = skinFn.findPlug("normalizeWeights", false).asInt() > 0;
+
+    MFnSingleIndexedComponent compFn;
+    MObject allVerticesObj = compFn.create(MFn::kMeshVertComponent);
+    compFn.setCompleteData(numVertices_);
+    unsigned int infCount;
+    status = skinFn.getWeights(meshPath_, allVerticesObj, fullWeights_, infCount);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    return status;
+}
+
+int skinBrushStrokeCmd::getInfluenceIndex(const MString& influenceName) {
+    for (unsigned int i = 0; i < influenceNames_.length(); ++i)
+        if (influenceNames_[i] == influenceName) return (int)i;
+    return -1;
+}
+
+bool skinBrushStrokeCmd::getSurfacePoint(MMeshIntersector& intersector, const MPoint& point,
+                                         MFloatPoint& hitPoint, int& faceHit,
+                                         MFloatPoint* origHitPoint) {
+    MPointOnMesh pointInfo;
+    MPoint closestTo(point);
+    if (intersector.getClosestPoint(closestTo, pointInfo) != MS::kSuccess) return false;
+
+    faceHit = pointInfo.faceIndex();
+    float hitBary1, hitBary2;
+    pointInfo.getBarycentricCoords(hitBary1, hitBary2);
+    float hitBary3 = (1 - hitBary1 - hitBary2);
+    const int* triangle = topology_.triangle(faceHit, pointInfo.triangleIndex());
+    auto onTriangle = [&](const std::vector<float>& rawPoints) {
+        float xyz[3];
+        for (int k = 0; k < 3; ++k)
+            xyz[k] = rawPoints[triangle[0] * 3 + k] * hitBary1 +
+                     rawPoints[triangle[1] * 3 + k] * hitBary2 +
+                     rawPoints[triangle[2] * 3 + k] * hitBary3;
+        return MFloatPoint(xyz[0], xyz[1], xyz[2]);
+    };
+    hitPoint = onTriangle(points_);
+    if (origHitPoint && !origPoints_.empty()) *origHitPoint = onTriangle(origPoints_);
+    return true;
+}
+
+bool skinBrushStrokeCmd::getDab(const MPoint& worldPoint, bool mirror,
+                                std::unordered_map<int, float>& dicVertsDist) {
+    MFloatPoint hitPoint;
+    int faceHit = -1;
+    bool foundHit = false;
+    if (!mirror) {
+        foundHit = getSurfacePoint(*intersector_, worldPoint, hitPoint, faceHit, &origHitPoint_);
+    } else {
+        MMatrix mirrorMatrix;
+        int axis = (paintMirror_ - 1) % 3;
+        mirrorMatrix.matrix[axis][axis] = -1.0;
+        if (paintMirror_ < 4) {  // on the orig shape
+            MPoint mirrorPoint = MPoint(origHitPoint_) * mirrorMatrix;
+            foundHit = getSurfacePoint(*intersectorOrig_, mirrorPoint, hitPoint, faceHit);
+        } else {
+            MPoint mirrorPoint = worldPoint * mirrorMatrix;
+            foundHit = getSurfacePoint(*intersector_, mirrorPoint, hitPoint, faceHit);
+        }
+    }
+    if (!foundHit) return false;
+
+    float size = (float)size_;
+    if (volume_) {
+        float center[3] = {hitPoint.x, hitPoint.y, hitPoint.z};
+        std::vector<std::pair<int, float>> found;
+        volumeHash_.query(center, size, found);
+        for (const auto& vertexDist : found) dicVertsDist.insert(vertexDist);
+    } else {
+        auto distanceTo = [&](int vertexIndex) {
+            MFloatPoint posPoint(points_[vertexIndex * 3], points_[vertexIndex * 3 + 1],
+                                 points_[vertexIndex * 3 + 2]);
+            return posPoint.distanceTo(hitPoint);
+        };
+        // the vertices of the face hit, then the growth over the surface inside the brush
+        std::vector<int> borderOfGrowth, grown;
+        for (int k = topology_.faceStarts[faceHit]; k < topology_.faceStarts[faceHit + 1]; ++k) {
+            int vertexIndex = topology_.faceVertices[k];
+            float dist = distanceTo(vertexIndex);
+            if (dist <= size && dicVertsDist.insert(std::make_pair(vertexIndex, dist)).second)
+                borderOfGrowth.push_back(vertexIndex);
+        }
+        while (!borderOfGrowth.empty()) {
+            grown.clear();
+            for (int vertexIndex : borderOfGrowth) {
+                for (int k = topology_.vertexVertexStarts[vertexIndex];
+                     k < topology_.vertexVertexStarts[vertexIndex + 1]; ++k) {
+                    int vertexAround = topology_.vertexVertices[k];
+                    if (dicVertsDist.count(vertexAround)) continue;
+                    float dist = distanceTo(vertexAround);
+                    if (dist > size) continue;
+                    dicVertsDist.insert(std::make_pair(vertexAround, dist));
+                    grown.push_back(vertexAround);
+                }
+            }
+            borderOfGrowth.swap(grown);
+        }
+    }
+    if (dicVertsDist.empty()) return false;
+
+    // falloff, like addBrushShapeFallof
+    for (auto& element : dicVertsDist) {
+        float value = 1.0f - (element.second / size);
+        element.second = (float)brushFalloffValue(curve_, value, strength_);
+    }
+    return true;
+}
+
+void skinBrushStrokeCmd::addDab(std::unordered_map<int, float>& dicVertsDist,
+                                std::unordered_map<int, float>& dicVertsDistPrevPaint,
+                                std::vector<float>& intensityValues,
+                                std::unordered_map<int, float>& skinValToSet) {
+    // same merge as preparePaint when the brush sets the weights on release
+    auto endOfFind = dicVertsDistPrevPaint.end();
+    for (const auto& element : dicVertsDist) {
+        int index = element.first;
+        bool lockedVertex = index < (int)lockVertices_.length() && lockVertices_[index] == 1;
+        if (lockedVertex || intensityValues[index] == 1) continue;
+        float value = element.second + intensityValues[index];
+        auto res = dicVertsDistPrevPaint.find(index);
+        if (res != endOfFind) value -= std::min(res->second, element.second);
+        value = std::min(value, (float)1.0);
+        intensityValues[index] = value;
+
+        auto ret = skinValToSet.insert(std::make_pair(index, value));
+        if (!ret.second) ret.first->second = std::max(value, ret.first->second);
+    }
+    dicVertsDistPrevPaint = dicVertsDist;
+}
+
+std::vector<int> skinBrushStrokeCmd::getSmoothNeighbors(int vertexIndex) {
+    if (!volume_) {
+        auto first = topology_.vertexVertices.begin() + topology_.vertexVertexStarts[vertexIndex];
+        auto last = topology_.vertexVertices.begin() + topology_.vertexVertexStarts[vertexIndex + 1];
+        return std::vector<int>(first, last);
+    }
+    std::vector<std::pair<int, float>> found;
+    volumeHash_.query(&points_[vertexIndex * 3], (float)size_, found);
+    std::vector<int> rangeIndices;
+    for (const auto& vertexDist : found)
+        if (vertexDist.first != vertexIndex) rangeIndices.push_back(vertexDist.first);
+    std::sort(rangeIndices.begin(), rangeIndices.end());
+    return rangeIndices;
+}
+
+MStatus skinBrushStrokeCmd::applyStroke(std::unordered_map<int, float>& valuesToSet,
+                                        std::unordered_map<int, float>& valuesMirrorToSet) {
+    MStatus status = MS::kSuccess;
+    // like doTheAction, one influence painted on both sides is merged in one array
+    bool separateMirror = paintMirror_ != 0 && mirrorInfluence_ != influence_;
+    if (!separateMirror) {
+        for (const auto& element : valuesMirrorToSet) {
+            auto ret = valuesToSet.insert(element);
+            if (!ret.second) ret.first->second = std::max(element.second, ret.first->second);
+        }
+        valuesMirrorToSet.clear();
+    }
+    std::map<int, std::pair<float, float>> mirroredJoinedArray;
+    for (const auto& element : valuesToSet) mirroredJoinedArray[element.first].first = element.second;
+    for (const auto& element : valuesMirrorToSet)
+        mirroredJoinedArray[element.first].second = element.second;
+    if (mirroredJoinedArray.empty()) return status;
+
+    bool isSmooth = command_ == ModifierCommands::Smooth;
+    if (!isSmooth && !ignoreLock_ && command_ != ModifierCommands::Sharpen &&
+        lockJoints_[influence_] == 1)
+        return status;  //  if locked and it's not sharpen --> do nothing
+    MIntArray& locks = ignoreLock_ ? ignoreLockJoints_ : lockJoints_;
+
+    std::vector<int> vertices;
+    std::map<int, double> valuesToSetOrdered;
+    for (const auto& element : mirroredJoinedArray) {
+        vertices.push_back(element.first);
+        valuesToSetOrdered[element.first] = element.second.first;
+    }
+    int repeatLimit = 1;
+    if (isSmooth || command_ == ModifierCommands::Sharpen) repeatLimit = smoothRepeat_;
+
+    MDoubleArray theWeights(nbJoints_ * (int)vertices.size(), 0.0);
+    for (int repeat = 0; repeat < repeatLimit; ++repeat) {
+        if (isSmooth) {
+            int i = 0;
+            SparseWeightRows weightRows;
+            for (const auto& element : mirroredJoinedArray) {
+                int theVert = element.first;
+                double theWeight = std::max(element.second.first, element.second.second);
+                std::vector<int> vertsAround = getSmoothNeighbors(theVert);
+                if (!setAverageWeightSparse(vertsAround.data(), (int)vertsAround.size(), theVert,
+                                            i, nbJoints_, lockJoints_, fullWeights_, weightRows,
+                                            theWeights, strength_ * theWeight, maxInfluences_)) {
+                    setAverageWeight(vertsAround, theVert, i, nbJoints_, lockJoints_,
+                                     fullWeights_, theWeights, strength_ * theWeight);
+                    pruneRowToMaxInfluences(theWeights, i * nbJoints_, nbJoints_, lockJoints_,
+                                            maxInfluences_);
+                }
+                i++;
+            }
+        } else if (separateMirror) {
+            status = editArrayMirror(command_, influence_, mirrorInfluence_, nbJoints_, locks,
+                                     fullWeights_, mirroredJoinedArray, theWeights, true, 1.0,
+                                     verbose);
+        } else {
+            status = editArray(command_, influence_, nbJoints_, locks, fullWeights_,
+                               valuesToSetOrdered, theWeights, true, 1.0, verbose);
+        }
+        if (status == MS::kFailure) return status;
+        // the next repeat and the next stroke start from these weights
+        for (size_t i = 0; i < vertices.size(); ++i)
+            for (int j = 0; j < nbJoints_; ++j)
+                fullWeights_[vertices[i] * nbJoints_ + j] = theWeights[(int)i * nbJoints_ + j];
+    }
+    editedVertices_.insert(vertices.begin(), vertices.end());
+    return status;
+}
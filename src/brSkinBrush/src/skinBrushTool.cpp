@@ -280,6 +280,15 @@ MStatus skinBrushTool::setWeightsForDoit(bool isUndo) {
         MGlobal::displayError(MString("skinBrushTool::undoIt error getting the skin "));
         return status;
     }
+    if (!this->mapPlug.isNull()) {
+        // a painted map, the values are swapped so the same call undoes and redoes
+        MDoubleArray previousValues;
+        status = setMapValues(this->mapPlug, this->undoVertices, this->undoWeights, &previousValues);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        this->undoWeights = previousValues;
+        callBrushRefresh();
+        return status;
+    }
     MFnSkinCluster skinFn(skinObj, &status);
     CHECK_MSTATUS_AND_RETURN_IT(status);
 
@@ -326,7 +335,8 @@ MStatus skinBrushTool::setWeightsForDoit(bool isUndo) {
                 skinFn.setWeights(nurbsDag, weightsObj, influenceIndices, this->redoWeights, true);
             }
             if (validMesh) {
-                transferPointNurbsToMesh(meshFn, nrbsFn);  // we transfer the points postions
+                // we transfer the points postions of the edited CVs
+                transferPointNurbsToMesh(meshFn, nrbsFn, proxyVertexToCV, this->undoVertices);
             } else {
                 MGlobal::displayInfo("mesh not valid need to clean it");
             }
@@ -383,7 +393,7 @@ MStatus skinBrushTool::callBrushRefresh() {
     -------
     */
 
-    ctxt->refreshTheseVertices(undoVertices);
+    ctxt->refreshPaintMeshVertices(skinObj, undoVertices);
     MUserEventMessage::postUserEvent("brSkinBrush_afterPaint");
     return MStatus::kSuccess;
 }
@@ -626,10 +636,14 @@ void skinBrushTool::setNormalize(bool value) { normalize = value; }
 
 void skinBrushTool::setSkinCluster(MObject &skinCluster) { skinObj = skinCluster; }
 
+void skinBrushTool::setMapPlug(MPlug &plug) { mapPlug = plug; }
+
 void skinBrushTool::setIsNurbs(bool value) { isNurbs = value; }
 
 void skinBrushTool::setnumCVInV(int value) { numCVsInV_ = value; }
 
+void skinBrushTool::setProxyVertexToCV(const std::vector<int> &value) { proxyVertexToCV = value; }
+
 void skinBrushTool::setSkinClusterName(MString &skinClusterName) { skinName = skinClusterName; }
 
 void skinBrushTool::setWeights(MDoubleArray &weights) { undoWeights = weights; }
@@ -0,0 +1,41 @@
+#ifndef _sparseWeights_h
+#define _sparseWeights_h
+
+// smooth of dense vertex * influence weights arrays on their non zero influences, compiled in
+// both plugins
+
+#include <maya/MDoubleArray.h>
+#include <maya/MIntArray.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define SMOOTH_ACCUMULATOR_SIZE 64
+// Non zero influences of the rows of a dense vertex * influence weights array. A row is scanned
+// the first time it's read, a smooth pass reads every row once instead of once per vertex around.
+// Clear it when the weights change, it's not thread safe.
+struct SparseWeightRows {
+    std::unordered_map<int, std::pair<int, int>> ranges;  // vertex -> [first, end) in columns
+    std::vector<int> columns;
+    void clear() {
+        ranges.clear();
+        columns.clear();
+    }
+    std::pair<int, int> row(const MDoubleArray& fullWeightArray, int nbJoints, int vertex);
+};
+// Smooth of one vertex on sparse rows. The non zero influences of the vertex and of the vertices
+// around are merged in a small accumulator, only the maxInfluences biggest unlocked ones are kept
+// (0 keeps them all) and renormalized around the locked ones. Returns false when the accumulator
+// is full, the dense setAverageWeight is used then.
+bool setAverageWeightSparse(const int* verticesAround, int sizeVertices, int currentVertex,
+                            int indexCurrVert, int nbJoints, const MIntArray& lockJoints,
+                            const MDoubleArray& fullWeightArray, SparseWeightRows& weightRows,
+                            MDoubleArray& theWeights, double strengthVal, int maxInfluences);
+// keeps the maxInfluences biggest weights of a row next to the locked ones (0 keeps them all),
+// the kept unlocked weights are scaled back to the unlocked total. For the dense smooth
+void pruneRowToMaxInfluences(MDoubleArray& theWeights, int rowStart, int nbJoints,
+                             const MIntArray& lockJoints, int maxInfluences);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _vertexMaps_h
+#define _vertexMaps_h
+
+#include <maya/MDoubleArray.h>
+#include <maya/MIntArray.h>
+#include <maya/MPlug.h>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+
+// Per vertex float maps: deformer weightList, blendShape base and target weights, doubleArray
+// attributes. mapPlug is the array of the map, missing elements of a sparse multi read as the
+// default of the attribute.
+MStatus getMapPlug(const MString& attributeName, MPlug& mapPlug);
+MStatus readMapValues(MPlug& mapPlug, int numVertices, MDoubleArray& values);
+MStatus readMapValues(MPlug& mapPlug, const MIntArray& vertices, MDoubleArray& values);
+// only the given elements are set, oldValues receives their previous values
+MStatus setMapValues(MPlug& mapPlug, const MIntArray& vertices, const MDoubleArray& values,
+                     MDoubleArray* oldValues = nullptr);
+
+#endif
@@ -0,0 +1,123 @@
+#include "sparseWeights.h"
+
+std::pair<int, int> SparseWeightRows::row(const MDoubleArray& fullWeightArray, int nbJoints,
+                                          int vertex) {
+    auto found = ranges.find(vertex);
+    if (found != ranges.end()) return found->second;
+    int first = (int)columns.size();
+    int rowStart = vertex * nbJoints;
+    for (int jnt = 0; jnt < nbJoints; ++jnt)
+        if (fullWeightArray[rowStart + jnt] != 0.0) columns.push_back(jnt);
+    std::pair<int, int> range(first, (int)columns.size());
+    ranges.emplace(vertex, range);
+    return range;
+}
+
+void pruneRowToMaxInfluences(MDoubleArray& theWeights, int rowStart, int nbJoints,
+                             const MIntArray& lockJoints, int maxInfluences) {
+    if (maxInfluences <= 0) return;
+    std::vector<int> unlocked;
+    int nbLocked = 0;
+    double totalUnlocked = 0.0;
+    for (int jnt = 0; jnt < nbJoints; ++jnt) {
+        double w = theWeights[rowStart + jnt];
+        if (w == 0.0) continue;
+        if (lockJoints[jnt] == 1) {
+            ++nbLocked;
+        } else {
+            unlocked.push_back(jnt);
+            totalUnlocked += w;
+        }
+    }
+    if (nbLocked + (int)unlocked.size() <= maxInfluences) return;
+    int keep = std::max(0, maxInfluences - nbLocked);
+    std::partial_sort(
+        unlocked.begin(), unlocked.begin() + keep, unlocked.end(),
+        [&](int a, int b) { return theWeights[rowStart + a] > theWeights[rowStart + b]; });
+    double totalKept = 0.0;
+    for (int k = 0; k < keep; ++k) totalKept += theWeights[rowStart + unlocked[k]];
+    for (int k = keep; k < (int)unlocked.size(); ++k) theWeights[rowStart + unlocked[k]] = 0.0;
+    if (totalKept <= 0.0) return;
+    double mult = totalUnlocked / totalKept;
+    for (int k = 0; k < keep; ++k) theWeights[rowStart + unlocked[k]] *= mult;
+}
+
+bool setAverageWeightSparse(const int* verticesAround, int sizeVertices, int currentVertex,
+                            int indexCurrVert, int nbJoints, const MIntArray& lockJoints,
+                            const MDoubleArray& fullWeightArray, SparseWeightRows& weightRows,
+                            MDoubleArray& theWeights, double strengthVal, int maxInfluences) {
+    int influences[SMOOTH_ACCUMULATOR_SIZE];
+    double sums[SMOOTH_ACCUMULATOR_SIZE], currents[SMOOTH_ACCUMULATOR_SIZE];
+    int count = 0;
+    auto slotOf = [&](int jnt) -> int {
+        for (int k = 0; k < count; ++k)
+            if (influences[k] == jnt) return k;
+        if (count == SMOOTH_ACCUMULATOR_SIZE) return -1;
+        influences[count] = jnt;
+        sums[count] = 0.0;
+        currents[count] = 0.0;
+        return count++;
+    };
+
+    // current row first, kept for the locked influences and the revert
+    std::pair<int, int> range = weightRows.row(fullWeightArray, nbJoints, currentVertex);
+    int rowStart = currentVertex * nbJoints;
+    for (int e = range.first; e < range.second; ++e) {
+        int jnt = weightRows.columns[e];
+        int k = slotOf(jnt);
+        if (k == -1) return false;
+        currents[k] = fullWeightArray[rowStart + jnt];
+    }
+    for (int i = 0; i < sizeVertices; ++i) {
+        int vertex = verticesAround[i];
+        std::pair<int, int> around = weightRows.row(fullWeightArray, nbJoints, vertex);
+        rowStart = vertex * nbJoints;
+        for (int e = around.first; e < around.second; ++e) {
+            int jnt = weightRows.columns[e];
+            int k = slotOf(jnt);
+            if (k == -1) return false;
+            sums[k] += fullWeightArray[rowStart + jnt];
+        }
+    }
+
+    double targets[SMOOTH_ACCUMULATOR_SIZE];
+    int unlocked[SMOOTH_ACCUMULATOR_SIZE];
+    int nbUnlocked = 0, nbLocked = 0;
+    double totalBaseVtxLock = 0.0;
+    for (int k = 0; k < count; ++k) {
+        if (lockJoints[influences[k]] == 1) {
+            targets[k] = currents[k];
+            totalBaseVtxLock += currents[k];
+            if (currents[k] != 0.0) ++nbLocked;
+            continue;
+        }
+        double average = sizeVertices > 0 ? sums[k] / sizeVertices : currents[k];
+        targets[k] = strengthVal * average + (1.0 - strengthVal) * currents[k];
+        if (targets[k] > 0.0) unlocked[nbUnlocked++] = k;
+    }
+    // influence budget, the biggest unlocked targets are kept next to the locked ones
+    if (maxInfluences > 0 && nbLocked + nbUnlocked > maxInfluences) {
+        int keep = std::max(0, maxInfluences - nbLocked);
+        std::partial_sort(unlocked, unlocked + keep, unlocked + nbUnlocked,
+                          [&targets](int a, int b) { return targets[a] > targets[b]; });
+        for (int j = keep; j < nbUnlocked; ++j) targets[unlocked[j]] = 0.0;
+        nbUnlocked = keep;
+    }
+    double totalVtxUnlock = 0.0;
+    for (int j = 0; j < nbUnlocked; ++j) totalVtxUnlock += targets[unlocked[j]];
+
+    // setting part, only the accumulated influences can be non zero ---------------
+    int rowToSet = indexCurrVert * nbJoints;
+    for (int jnt = 0; jnt < nbJoints; ++jnt) theWeights[rowToSet + jnt] = 0.0;
+    double normalizedValueAvailable = 1.0 - totalBaseVtxLock;
+    if (normalizedValueAvailable > 0.0 && totalVtxUnlock > 0.0) {  // we have room to set weights
+        double mult = normalizedValueAvailable / totalVtxUnlock;
+        for (int k = 0; k < count; ++k) {
+            bool isLockJnt = lockJoints[influences[k]] == 1;
+            theWeights[rowToSet + influences[k]] = isLockJnt ? currents[k] : targets[k] * mult;
+        }
+    } else {  // normalize problem let's revert
+        for (int k = 0; k < count; ++k) theWeights[rowToSet + influences[k]] = currents[k];
+    }
+    return true;
+}
@@ -0,0 +1,139 @@
+#include "vertexMaps.h"
+
+#include <maya/MArrayDataHandle.h>
+#include <maya/MDataHandle.h>
+#include <maya/MFnDoubleArrayData.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnNumericData.h>
+#include <maya/MFnTypedAttribute.h>
+#include <maya/MGlobal.h>
+#include <maya/MSelectionList.h>
+
+#include <algorithm>
+
+MStatus getMapPlug(const MString& attributeName, MPlug& mapPlug) {
+    MStatus status;
+    MSelectionList sel;
+    status = sel.add(attributeName);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = sel.getPlug(0, mapPlug);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (mapPlug.isArray()) {
+        MFnNumericAttribute numericFn(mapPlug.attribute(), &status);
+        if (status == MS::kSuccess) return status;
+    } else {
+        MFnTypedAttribute typedFn(mapPlug.attribute(), &status);
+        if (status == MS::kSuccess && typedFn.attrType() == MFnData::kDoubleArray) return status;
+    }
+    MGlobal::displayError(attributeName + MString(" is not a per vertex map"));
+    return MS::kFailure;
+}
+
+static bool mapIsDouble(MPlug& mapPlug) {
+    MFnNumericAttribute numericFn(mapPlug.attribute());
+    return numericFn.unitType() == MFnNumericData::kDouble;
+}
+
+static double mapDefaultValue(MPlug& mapPlug) {
+    double defaultValue = 1.0;
+    if (mapPlug.isArray()) {
+        MFnNumericAttribute numericFn(mapPlug.attribute());
+        numericFn.getDefault(defaultValue);
+    }
+    return defaultValue;
+}
+
+MStatus readMapValues(MPlug& mapPlug, int numVertices, MDoubleArray& values) {
+    MStatus status;
+    values = MDoubleArray(numVertices, mapDefaultValue(mapPlug));
+    if (!mapPlug.isArray()) {
+        MObject data = mapPlug.asMObject(&status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        MFnDoubleArrayData arrayFn(data, &status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        MDoubleArray mapValues = arrayFn.array();
+        int nbValues = std::min((int)mapValues.length(), numVertices);
+        for (int i = 0; i < nbValues; ++i) values[i] = mapValues[i];
+        return status;
+    }
+    bool isDouble = mapIsDouble(mapPlug);
+    // one walk on the data block, no plug per element
+    MDataHandle mapData = mapPlug.asMDataHandle(&status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    MArrayDataHandle mapHandle(mapData, &status);
+    if (status != MS::kSuccess) {
+        mapPlug.destructHandle(mapData);
+        return status;
+    }
+    unsigned int nbElements = mapHandle.elementCount();
+    for (unsigned int i = 0; i < nbElements; ++i) {
+        mapHandle.jumpToArrayElement(i);
+        int vertexIndex = (int)mapHandle.elementIndex();
+        if (vertexIndex >= numVertices) continue;
+        MDataHandle valueHandle = mapHandle.inputValue();
+        values[vertexIndex] = isDouble ? valueHandle.asDouble() : (double)valueHandle.asFloat();
+    }
+    mapPlug.destructHandle(mapData);
+    return status;
+}
+
+MStatus readMapValues(MPlug& mapPlug, const MIntArray& vertices, MDoubleArray& values) {
+    MStatus status;
+    unsigned int nbVertices = vertices.length();
+    values.setLength(nbVertices);
+    if (!mapPlug.isArray()) {
+        MDoubleArray allValues;
+        int numVertices = 0;
+        for (unsigned int i = 0; i < nbVertices; ++i)
+            numVertices = std::max(numVertices, vertices[i] + 1);
+        status = readMapValues(mapPlug, numVertices, allValues);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        for (unsigned int i = 0; i < nbVertices; ++i) values[i] = allValues[vertices[i]];
+        return status;
+    }
+    // an element not set yet reads the default
+    bool isDouble = mapIsDouble(mapPlug);
+    for (unsigned int i = 0; i < nbVertices; ++i) {
+        MPlug elementPlug = mapPlug.elementByLogicalIndex(vertices[i], &status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        values[i] = isDouble ? elementPlug.asDouble() : (double)elementPlug.asFloat();
+    }
+    return status;
+}
+
+MStatus setMapValues(MPlug& mapPlug, const MIntArray& vertices, const MDoubleArray& values,
+                     MDoubleArray* oldValues) {
+    MStatus status;
+    if (oldValues != nullptr) {
+        status = readMapValues(mapPlug, vertices, *oldValues);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    unsigned int nbVertices = std::min(vertices.length(), values.length());
+    if (!mapPlug.isArray()) {
+        // the whole array is set back, padded with the default past its end
+        MObject data = mapPlug.asMObject(&status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        MFnDoubleArrayData arrayFn(data, &status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        MDoubleArray mapValues = arrayFn.array();
+        for (unsigned int i = 0; i < nbVertices; ++i) {
+            unsigned int vertexIndex = (unsigned int)vertices[i];
+            while (mapValues.length() <= vertexIndex) mapValues.append(1.0);
+            mapValues[vertexIndex] = values[i];
+        }
+        MFnDoubleArrayData newArrayFn;
+        MObject newData = newArrayFn.create(mapValues, &status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        return mapPlug.setValue(newData);
+    }
+    bool isDouble = mapIsDouble(mapPlug);
+    for (unsigned int i = 0; i < nbVertices; ++i) {
+        MPlug elementPlug = mapPlug.elementByLogicalIndex(vertices[i], &status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        if (isDouble)
+            elementPlug.setDouble(values[i]);
+        else
+            elementPlug.setFloat((float)values[i]);
+    }
+    return status;
+}